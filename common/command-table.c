@@ -0,0 +1,155 @@
+//**********************************************************************;
+// Copyright (c) 2017, Intel Corporation
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+// THE POSSIBILITY OF SUCH DAMAGE.
+//**********************************************************************;
+
+#include "sapi/tpm20.h"
+#include "command-table.h"
+
+/*
+ * One row per command:
+ *   COMMAND (name, command handles, response handles,
+ *            decrypt allowed, encrypt allowed, auth allowed)
+ * The handle counts follow the handle areas of part 3 of the TPM 2.0
+ * specification. Decrypt / encrypt allowed are set when the first command /
+ * response parameter is a sized buffer a session may encrypt, auth allowed
+ * when the command may carry an authorization area.
+ */
+#define COMMAND(cc, in, out, decrypt, encrypt, auth) \
+    [TPM2_CC_##cc - TPM2_CC_FIRST] = \
+        { "TPM2_" #cc, in, out, decrypt, encrypt, auth },
+
+const TPM2_COMMAND_INFO tpm2CommandTable[TPM2_CC_LAST - TPM2_CC_FIRST + 1] =
+{
+    COMMAND (NV_UndefineSpaceSpecial,    2, 0, 0, 0, 1) /* 11f */
+    COMMAND (EvictControl,               2, 0, 0, 0, 1) /* 120 */
+    COMMAND (HierarchyControl,           1, 0, 0, 0, 1) /* 121 */
+    COMMAND (NV_UndefineSpace,           2, 0, 0, 0, 1) /* 122 */
+    COMMAND (ChangeEPS,                  1, 0, 0, 0, 1) /* 124 */
+    COMMAND (ChangePPS,                  1, 0, 0, 0, 1) /* 125 */
+    COMMAND (Clear,                      1, 0, 0, 0, 1) /* 126 */
+    COMMAND (ClearControl,               1, 0, 0, 0, 1) /* 127 */
+    COMMAND (ClockSet,                   1, 0, 0, 0, 1) /* 128 */
+    COMMAND (HierarchyChangeAuth,        1, 0, 1, 0, 1) /* 129 */
+    COMMAND (NV_DefineSpace,             1, 0, 1, 0, 1) /* 12a */
+    COMMAND (PCR_Allocate,               1, 0, 0, 0, 1) /* 12b */
+    COMMAND (PCR_SetAuthPolicy,          1, 0, 1, 0, 1) /* 12c */
+    COMMAND (PP_Commands,                1, 0, 0, 0, 1) /* 12d */
+    COMMAND (SetPrimaryPolicy,           1, 0, 1, 0, 1) /* 12e */
+    COMMAND (FieldUpgradeStart,          2, 0, 1, 0, 1) /* 12f */
+    COMMAND (ClockRateAdjust,            1, 0, 0, 0, 1) /* 130 */
+    COMMAND (CreatePrimary,              1, 1, 1, 1, 1) /* 131 */
+    COMMAND (NV_GlobalWriteLock,         1, 0, 0, 0, 1) /* 132 */
+    COMMAND (GetCommandAuditDigest,      2, 0, 1, 1, 1) /* 133 */
+    COMMAND (NV_Increment,               2, 0, 0, 0, 1) /* 134 */
+    COMMAND (NV_SetBits,                 2, 0, 0, 0, 1) /* 135 */
+    COMMAND (NV_Extend,                  2, 0, 1, 0, 1) /* 136 */
+    COMMAND (NV_Write,                   2, 0, 1, 0, 1) /* 137 */
+    COMMAND (NV_WriteLock,               2, 0, 0, 0, 1) /* 138 */
+    COMMAND (DictionaryAttackLockReset,  1, 0, 0, 0, 1) /* 139 */
+    COMMAND (DictionaryAttackParameters, 1, 0, 0, 0, 1) /* 13a */
+    COMMAND (NV_ChangeAuth,              1, 0, 1, 0, 1) /* 13b */
+    COMMAND (PCR_Event,                  1, 0, 1, 0, 1) /* 13c */
+    COMMAND (PCR_Reset,                  1, 0, 0, 0, 1) /* 13d */
+    COMMAND (SequenceComplete,           1, 0, 1, 1, 1) /* 13e */
+    COMMAND (SetAlgorithmSet,            1, 0, 0, 0, 1) /* 13f */
+    COMMAND (SetCommandCodeAuditStatus,  1, 0, 0, 0, 1) /* 140 */
+    COMMAND (FieldUpgradeData,           0, 0, 1, 0, 1) /* 141 */
+    COMMAND (IncrementalSelfTest,        0, 0, 0, 0, 1) /* 142 */
+    COMMAND (SelfTest,                   0, 0, 0, 0, 1) /* 143 */
+    COMMAND (Startup,                    0, 0, 0, 0, 0) /* 144 */
+    COMMAND (Shutdown,                   0, 0, 0, 0, 1) /* 145 */
+    COMMAND (StirRandom,                 0, 0, 1, 0, 1) /* 146 */
+    COMMAND (ActivateCredential,         2, 0, 1, 1, 1) /* 147 */
+    COMMAND (Certify,                    2, 0, 1, 1, 1) /* 148 */
+    COMMAND (PolicyNV,                   3, 0, 1, 0, 1) /* 149 */
+    COMMAND (CertifyCreation,            2, 0, 1, 1, 1) /* 14a */
+    COMMAND (Duplicate,                  2, 0, 1, 1, 1) /* 14b */
+    COMMAND (GetTime,                    2, 0, 1, 1, 1) /* 14c */
+    COMMAND (GetSessionAuditDigest,      3, 0, 1, 1, 1) /* 14d */
+    COMMAND (NV_Read,                    2, 0, 0, 1, 1) /* 14e */
+    COMMAND (NV_ReadLock,                2, 0, 0, 0, 1) /* 14f */
+    COMMAND (ObjectChangeAuth,           2, 0, 1, 1, 1) /* 150 */
+    COMMAND (PolicySecret,               2, 0, 1, 1, 1) /* 151 */
+    COMMAND (Rewrap,                     2, 0, 1, 1, 1) /* 152 */
+    COMMAND (Create,                     1, 0, 1, 1, 1) /* 153 */
+    COMMAND (ECDH_ZGen,                  1, 0, 1, 1, 1) /* 154 */
+    COMMAND (HMAC,                       1, 0, 1, 1, 1) /* 155 */
+    COMMAND (Import,                     1, 0, 1, 1, 1) /* 156 */
+    COMMAND (Load,                       1, 1, 1, 1, 1) /* 157 */
+    COMMAND (Quote,                      1, 0, 1, 1, 1) /* 158 */
+    COMMAND (RSA_Decrypt,                1, 0, 1, 1, 1) /* 159 */
+    COMMAND (HMAC_Start,                 1, 1, 1, 0, 1) /* 15b */
+    COMMAND (SequenceUpdate,             1, 0, 1, 0, 1) /* 15c */
+    COMMAND (Sign,                       1, 0, 1, 0, 1) /* 15d */
+    COMMAND (Unseal,                     1, 0, 0, 1, 1) /* 15e */
+    COMMAND (PolicySigned,               2, 0, 1, 1, 1) /* 160 */
+    COMMAND (ContextLoad,                0, 1, 0, 0, 0) /* 161 */
+    COMMAND (ContextSave,                1, 0, 0, 0, 0) /* 162 */
+    COMMAND (ECDH_KeyGen,                1, 0, 0, 1, 1) /* 163 */
+    COMMAND (EncryptDecrypt,             1, 0, 1, 1, 1) /* 164 */
+    COMMAND (FlushContext,               1, 0, 0, 0, 0) /* 165 */
+    COMMAND (LoadExternal,               0, 1, 1, 1, 1) /* 167 */
+    COMMAND (MakeCredential,             1, 0, 1, 1, 1) /* 168 */
+    COMMAND (NV_ReadPublic,              1, 0, 0, 1, 1) /* 169 */
+    COMMAND (PolicyAuthorize,            1, 0, 1, 0, 1) /* 16a */
+    COMMAND (PolicyAuthValue,            1, 0, 0, 0, 1) /* 16b */
+    COMMAND (PolicyCommandCode,          1, 0, 0, 0, 1) /* 16c */
+    COMMAND (PolicyCounterTimer,         1, 0, 1, 0, 1) /* 16d */
+    COMMAND (PolicyCpHash,               1, 0, 1, 0, 1) /* 16e */
+    COMMAND (PolicyLocality,             1, 0, 0, 0, 1) /* 16f */
+    COMMAND (PolicyNameHash,             1, 0, 1, 0, 1) /* 170 */
+    COMMAND (PolicyOR,                   1, 0, 0, 0, 1) /* 171 */
+    COMMAND (PolicyTicket,               1, 0, 1, 0, 1) /* 172 */
+    COMMAND (ReadPublic,                 1, 0, 0, 1, 1) /* 173 */
+    COMMAND (RSA_Encrypt,                1, 0, 1, 1, 1) /* 174 */
+    COMMAND (StartAuthSession,           2, 1, 1, 1, 1) /* 176 */
+    COMMAND (VerifySignature,            1, 0, 1, 0, 1) /* 177 */
+    COMMAND (ECC_Parameters,             0, 0, 0, 0, 1) /* 178 */
+    COMMAND (FirmwareRead,               0, 0, 0, 1, 1) /* 179 */
+    COMMAND (GetCapability,              0, 0, 0, 0, 1) /* 17a */
+    COMMAND (GetRandom,                  0, 0, 0, 1, 1) /* 17b */
+    COMMAND (GetTestResult,              0, 0, 0, 1, 1) /* 17c */
+    COMMAND (Hash,                       0, 0, 1, 1, 1) /* 17d */
+    COMMAND (PCR_Read,                   0, 0, 0, 0, 1) /* 17e */
+    COMMAND (PolicyPCR,                  1, 0, 1, 0, 1) /* 17f */
+    COMMAND (PolicyRestart,              1, 0, 0, 0, 1) /* 180 */
+    COMMAND (ReadClock,                  0, 0, 0, 0, 0) /* 181 */
+    COMMAND (PCR_Extend,                 1, 0, 0, 0, 1) /* 182 */
+    COMMAND (PCR_SetAuthValue,           1, 0, 1, 0, 1) /* 183 */
+    COMMAND (NV_Certify,                 3, 0, 1, 1, 1) /* 184 */
+    COMMAND (EventSequenceComplete,      2, 0, 1, 0, 1) /* 185 */
+    COMMAND (HashSequenceStart,          0, 1, 1, 0, 1) /* 186 */
+    COMMAND (PolicyPhysicalPresence,     1, 0, 0, 0, 1) /* 187 */
+    COMMAND (PolicyDuplicationSelect,    1, 0, 1, 0, 1) /* 188 */
+    COMMAND (PolicyGetDigest,            1, 0, 0, 1, 1) /* 189 */
+    COMMAND (TestParms,                  0, 0, 0, 0, 1) /* 18a */
+    COMMAND (Commit,                     1, 0, 1, 1, 1) /* 18b */
+    COMMAND (PolicyPassword,             1, 0, 0, 0, 1) /* 18c */
+    COMMAND (ZGen_2Phase,                1, 0, 1, 1, 1) /* 18d */
+    COMMAND (EC_Ephemeral,               0, 0, 0, 1, 1) /* 18e */
+    COMMAND (PolicyNvWritten,            1, 0, 0, 0, 1) /* 18f */
+    COMMAND (EncryptDecrypt2,            1, 0, 1, 1, 1) /* 193 */
+};
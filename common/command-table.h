@@ -0,0 +1,75 @@
+//**********************************************************************;
+// Copyright (c) 2017, Intel Corporation
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+// THE POSSIBILITY OF SUCH DAMAGE.
+//**********************************************************************;
+
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include "sapi/tpm20.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Static per-command metadata, one entry per command code between
+ * TPM2_CC_FIRST and TPM2_CC_LAST. The table is indexed directly by
+ * (commandCode - TPM2_CC_FIRST); holes in the command code space have a
+ * NULL name.
+ */
+typedef struct {
+    const char *name;
+    UINT8 numCommandHandles;  /* handles in the command handle area */
+    UINT8 numResponseHandles; /* handles in the response handle area */
+    UINT8 decryptAllowed:1;   /* first command parameter may be encrypted */
+    UINT8 encryptAllowed:1;   /* first response parameter may be encrypted */
+    UINT8 authAllowed:1;      /* command may carry an authorization area */
+} TPM2_COMMAND_INFO;
+
+extern const TPM2_COMMAND_INFO
+    tpm2CommandTable[TPM2_CC_LAST - TPM2_CC_FIRST + 1];
+
+/*
+ * Return the metadata for commandCode, or NULL if the command code isn't
+ * one that this implementation knows about.
+ */
+static inline const TPM2_COMMAND_INFO *
+GetCommandInfo(TPM2_CC commandCode)
+{
+    const TPM2_COMMAND_INFO *info;
+
+    if (commandCode < TPM2_CC_FIRST || commandCode > TPM2_CC_LAST)
+        return NULL;
+
+    info = &tpm2CommandTable[commandCode - TPM2_CC_FIRST];
+    return info->name ? info : NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -621,6 +621,13 @@ TSS2_RC Tss2_Sys_ReadPublic_Complete(
     TPM2B_NAME	*qualifiedName
     );
 
+TSS2_RC Tss2_Sys_ReadPublic_CompleteView(
+    TSS2_SYS_CONTEXT *sysContext,
+    TSS2_SYS_TPM2B_VIEW	*outPublic,
+    TSS2_SYS_TPM2B_VIEW	*name,
+    TSS2_SYS_TPM2B_VIEW	*qualifiedName
+    );
+
 TSS2_RC Tss2_Sys_ReadPublic(
     TSS2_SYS_CONTEXT *sysContext,
     TPMI_DH_OBJECT	objectHandle,
@@ -2440,6 +2447,11 @@ TSS2_RC Tss2_Sys_NV_Read_Complete(
     TPM2B_MAX_NV_BUFFER	*data
     );
 
+TSS2_RC Tss2_Sys_NV_Read_CompleteView(
+    TSS2_SYS_CONTEXT *sysContext,
+    TSS2_SYS_TPM2B_VIEW	*data
+    );
+
 TSS2_RC Tss2_Sys_NV_Read(
     TSS2_SYS_CONTEXT *sysContext,
     TPMI_RH_NV_AUTH	authHandle,
@@ -140,6 +140,9 @@ typedef struct {
 #define TSS2_BASE_RC_INCOMPATIBLE_TCTI     20 /* Unknown or unusable TCTI version */
 #define TSS2_BASE_RC_NOT_SUPPORTED         21 /* Functionality not supported. */
 #define TSS2_BASE_RC_BAD_TCTI_STRUCTURE    22 /* TCTI context is bad. */
+#define TSS2_BASE_RC_RSP_AUTH_FAILED       23 /* Response HMAC doesn't match the
+                                                 value computed by the host. */
+#define TSS2_BASE_RC_NOT_FOUND             24 /* Requested entry isn't present. */
 
 // Base error codes from 0xf800 - 0xffff are reserved for level- and implementation-specific
 // errors.
@@ -213,5 +216,9 @@ typedef struct {
                                                      TSS2_BASE_RC_INCOMPATIBLE_TCTI))
 #define TSS2_SYS_RC_BAD_TCTI_STRUCTURE          ((TSS2_RC)(TSS2_SYS_ERROR_LEVEL | \
                                                      TSS2_BASE_RC_BAD_TCTI_STRUCTURE))
+#define TSS2_SYS_RC_RSP_AUTH_FAILED             ((TSS2_RC)(TSS2_SYS_ERROR_LEVEL | \
+                                                     TSS2_BASE_RC_RSP_AUTH_FAILED))
+#define TSS2_SYS_RC_NOT_FOUND                   ((TSS2_RC)(TSS2_SYS_ERROR_LEVEL | \
+                                                     TSS2_BASE_RC_NOT_FOUND))
 
 #endif /* TSS2_COMMON_H */
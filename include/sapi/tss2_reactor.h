@@ -0,0 +1,118 @@
+//**********************************************************************;
+// Copyright (c) 2017, Intel Corporation
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+// THE POSSIBILITY OF SUCH DAMAGE.
+//**********************************************************************;
+
+#ifndef TSS2_REACTOR_H
+#define TSS2_REACTOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <sapi/tpm20.h>
+
+/*
+ * Event loop driving Tss2_Sys_ExecuteAsync / Tss2_Sys_ExecuteFinish for
+ * any number of SAPI contexts from one thread. Each registered context's
+ * TCTI must implement getPollHandles; the reactor waits on those handles
+ * with epoll and calls ExecuteFinish with TSS2_TCTI_TIMEOUT_NONE when they
+ * become ready, so a context only costs work when its TPM has answered.
+ *
+ * A reactor is not thread safe: register, submit, dispatch and unregister
+ * from the thread running it.
+ */
+typedef struct TSS2_REACTOR TSS2_REACTOR;
+typedef struct TSS2_REACTOR_ENTRY TSS2_REACTOR_ENTRY;
+
+/*
+ * Invoked from Tss2_Reactor_Dispatch once ExecuteFinish returns anything
+ * but TRY_AGAIN. 'rc' is what it returned: on TSS2_RC_SUCCESS the
+ * response can be read with the command's _Complete function. The entry
+ * may be resubmitted or unregistered from the callback.
+ */
+typedef void (*TSS2_REACTOR_CALLBACK) (
+    TSS2_SYS_CONTEXT *sysContext,
+    TSS2_RC rc,
+    void *data);
+
+TSS2_RC Tss2_Reactor_New (
+    TSS2_REACTOR **reactor);
+
+/* Unregisters any remaining entries; outstanding commands are dropped. */
+void Tss2_Reactor_Free (
+    TSS2_REACTOR *reactor);
+
+/*
+ * The reactor's epoll descriptor, readable whenever Tss2_Reactor_Dispatch
+ * has work to do. Lets the reactor be nested in another event loop.
+ */
+int Tss2_Reactor_GetFd (
+    TSS2_REACTOR *reactor);
+
+/*
+ * Add a SAPI context. Its TCTI's poll handles may not be shared with
+ * another registered context.
+ */
+TSS2_RC Tss2_Reactor_Register (
+    TSS2_REACTOR *reactor,
+    TSS2_SYS_CONTEXT *sysContext,
+    TSS2_REACTOR_ENTRY **entry);
+
+TSS2_RC Tss2_Reactor_Unregister (
+    TSS2_REACTOR_ENTRY *entry);
+
+/*
+ * Send the command prepared in the entry's SAPI context (the _Prepare
+ * function and any Tss2_Sys_SetCmdAuths have been called) with
+ * Tss2_Sys_ExecuteAsync. 'callback' is invoked once the response has been
+ * received. An entry has at most one command outstanding. On failure
+ * nothing is outstanding and the callback won't be invoked.
+ */
+TSS2_RC Tss2_Reactor_Submit (
+    TSS2_REACTOR_ENTRY *entry,
+    TSS2_REACTOR_CALLBACK callback,
+    void *data);
+
+/*
+ * Wait up to 'timeout' milliseconds (TSS2_TCTI_TIMEOUT_BLOCK to wait
+ * indefinitely, TSS2_TCTI_TIMEOUT_NONE to only handle what is ready) for
+ * responses and invoke the callbacks of the commands that completed.
+ * 'completed', when not NULL, receives their number.
+ */
+TSS2_RC Tss2_Reactor_Dispatch (
+    TSS2_REACTOR *reactor,
+    int32_t timeout,
+    size_t *completed);
+
+/* Number of submitted commands whose callback hasn't run yet. */
+size_t Tss2_Reactor_Outstanding (
+    TSS2_REACTOR *reactor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TSS2_REACTOR_H */
@@ -72,6 +72,16 @@ typedef struct {
 // SAPI data types
 //
 
+//
+// A sized buffer (TPM2B) of a response, left where it is in the SAPI
+// context: 'len' bytes at 'ptr'. Returned by the _CompleteView functions
+// and valid until the next command is prepared on the context.
+//
+typedef struct {
+    const uint8_t *ptr;
+    uint16_t len;
+} TSS2_SYS_TPM2B_VIEW;
+
 //
 // SAPI management functions, e.g. Part 3
 // Command-Independent functions.
@@ -143,6 +153,12 @@ TSS2_RC Tss2_Sys_Execute(
     TSS2_SYS_CONTEXT *sysContext
     );
 
+TSS2_RC Tss2_Sys_ExecuteBatch(
+    TSS2_SYS_CONTEXT * const *sysContexts,
+    size_t count,
+    TSS2_RC *rvals
+    );
+
 //
 // Command Completion functions:
 //
@@ -174,6 +190,259 @@ TSS2_RC Tss2_Sys_GetRpBuffer(
     const uint8_t **rpBuffer
     );
 
+//
+// Host crypto.
+//
+// Session HMACs are computed in-process rather than by round-tripping
+// through the TPM. The hash primitive used for this comes from a process
+// wide callback table; the built-in portable implementation (SHA1, SHA256,
+// SHA384, SHA512) is used until an application installs its own backend.
+// The backend keeps its state in the caller-provided hash context; a
+// backend that needs more room than this may store a pointer in it.
+//
+typedef struct {
+    uint64_t opaque[64];
+} TSS2_SYS_HASH_CONTEXT;
+
+typedef struct {
+    TSS2_RC (*hashStart)(
+        TSS2_SYS_HASH_CONTEXT *hashContext,
+        TPMI_ALG_HASH hashAlg,
+        void *userData);
+    TSS2_RC (*hashUpdate)(
+        TSS2_SYS_HASH_CONTEXT *hashContext,
+        const uint8_t *buffer,
+        size_t size);
+    TSS2_RC (*hashFinish)(
+        TSS2_SYS_HASH_CONTEXT *hashContext,
+        uint8_t *digest,
+        size_t *digestSize);
+    // Optional; duplicates a running hash. Lets HMAC / KDF reuse the state
+    // after the key pad has been absorbed instead of rehashing it.
+    TSS2_RC (*hashCopy)(
+        TSS2_SYS_HASH_CONTEXT *dest,
+        const TSS2_SYS_HASH_CONTEXT *src);
+    // Optional; called instead of hashFinish when an operation is abandoned.
+    void (*hashAbort)(
+        TSS2_SYS_HASH_CONTEXT *hashContext);
+    void *userData;
+} TSS2_SYS_CRYPTO_CALLBACKS;
+
+// Passing NULL restores the built-in backend. Not thread safe; install the
+// backend before other threads start using the SAPI.
+TSS2_RC Tss2_Sys_SetCryptoCallbacks(
+    const TSS2_SYS_CRYPTO_CALLBACKS *callbacks
+    );
+
+//
+// Session HMAC (TPM 2.0 Part 1, 19.6.10 / 19.6.16):
+//   HMAC(sessionKey || authValue, pHash || nonceNewer || nonceOlder ||
+//        nonceDecrypt || nonceEncrypt || sessionAttributes)
+// pHash is the cpHash for a command and the rpHash for a response. The
+// caller decides whether authValue is included (it is omitted for the
+// bound entity). NULL sized buffers are treated as empty.
+//
+TSS2_RC Tss2_Sys_CalcSessionHmac(
+    TPMI_ALG_HASH authHash,
+    const TPM2B_DIGEST *pHash,
+    const TPM2B_DIGEST *sessionKey,
+    const TPM2B_AUTH *authValue,
+    const TPM2B_NONCE *nonceNewer,
+    const TPM2B_NONCE *nonceOlder,
+    const TPM2B_NONCE *nonceDecrypt,
+    const TPM2B_NONCE *nonceEncrypt,
+    TPMA_SESSION sessionAttributes,
+    TPM2B_DIGEST *hmac
+    );
+
+// Same inputs as Tss2_Sys_CalcSessionHmac; compares the result against
+// hmac in constant time and returns TSS2_SYS_RC_RSP_AUTH_FAILED on mismatch.
+TSS2_RC Tss2_Sys_CheckSessionHmac(
+    TPMI_ALG_HASH authHash,
+    const TPM2B_DIGEST *pHash,
+    const TPM2B_DIGEST *sessionKey,
+    const TPM2B_AUTH *authValue,
+    const TPM2B_NONCE *nonceNewer,
+    const TPM2B_NONCE *nonceOlder,
+    const TPM2B_NONCE *nonceDecrypt,
+    const TPM2B_NONCE *nonceEncrypt,
+    TPMA_SESSION sessionAttributes,
+    const TPM2B_DIGEST *hmac
+    );
+
+//
+// Key derivation functions (TPM 2.0 Part 1, 11.4.10).
+// KDFa: SP800-108 counter mode with HMAC(hashAlg) as PRF. KDFe: SP800-56A
+// concatenation KDF. label is a NUL terminated string; the terminator is
+// part of the derivation input. resultKey receives (bits + 7) / 8 bytes.
+//
+TSS2_RC Tss2_Sys_KDFa(
+    TPMI_ALG_HASH hashAlg,
+    const TPM2B *key,
+    const char *label,
+    const TPM2B *contextU,
+    const TPM2B *contextV,
+    UINT16 bits,
+    TPM2B_MAX_BUFFER *resultKey
+    );
+
+TSS2_RC Tss2_Sys_KDFe(
+    TPMI_ALG_HASH hashAlg,
+    const TPM2B *z,
+    const char *label,
+    const TPM2B *partyUInfo,
+    const TPM2B *partyVInfo,
+    UINT16 bits,
+    TPM2B_MAX_BUFFER *resultKey
+    );
+
+//
+// Parameter encryption (TPM 2.0 Part 1, 21), done on the host.
+// AES: CFB mode with key and IV from KDFa(authHash, sessionKey || authValue,
+// "CFB", nonceNewer, nonceOlder, keyBits + 128). XOR: the parameter is
+// masked with KDFa(authHash, sessionKey || authValue, "XOR", nonceNewer,
+// nonceOlder, size * 8). For a command nonceNewer is the caller's nonce and
+// nonceOlder the TPM's; for a response the roles are swapped.
+//
+TSS2_RC Tss2_Sys_ParamCrypt(
+    const TPMT_SYM_DEF *symmetric,
+    TPMI_ALG_HASH authHash,
+    const TPM2B_DIGEST *sessionKey,
+    const TPM2B_AUTH *authValue,
+    const TPM2B_NONCE *nonceNewer,
+    const TPM2B_NONCE *nonceOlder,
+    TPMI_YES_NO decrypt,
+    uint8_t *buffer,
+    size_t size
+    );
+
+// Encrypts the first command parameter in place in the command buffer.
+// Call after _Prepare and before the command HMAC is computed.
+TSS2_RC Tss2_Sys_EncryptCommandParam(
+    TSS2_SYS_CONTEXT *sysContext,
+    const TPMT_SYM_DEF *symmetric,
+    TPMI_ALG_HASH authHash,
+    const TPM2B_DIGEST *sessionKey,
+    const TPM2B_AUTH *authValue,
+    const TPM2B_NONCE *nonceCaller,
+    const TPM2B_NONCE *nonceTPM
+    );
+
+// Decrypts the first response parameter in place in the response buffer.
+// The response HMAC covers the encrypted parameter, so check it first.
+TSS2_RC Tss2_Sys_DecryptResponseParam(
+    TSS2_SYS_CONTEXT *sysContext,
+    const TPMT_SYM_DEF *symmetric,
+    TPMI_ALG_HASH authHash,
+    const TPM2B_DIGEST *sessionKey,
+    const TPM2B_AUTH *authValue,
+    const TPM2B_NONCE *nonceTPM,
+    const TPM2B_NONCE *nonceCaller
+    );
+
+//
+// cpHash / rpHash of the command prepared in (or response received into)
+// the context, computed on the host directly over the parameter area.
+//
+// cpHash = H(commandCode || name1 || name2 || name3 || cpBuffer)
+// rpHash = H(responseCode || commandCode || rpBuffer)
+//
+// Names are those of the command's handles, in handle order; pass NULL
+// (or an empty name) for handles the command does not have.
+//
+TSS2_RC Tss2_Sys_GetCpHash(
+    TSS2_SYS_CONTEXT *sysContext,
+    TPMI_ALG_HASH hashAlg,
+    const TPM2B_NAME *name1,
+    const TPM2B_NAME *name2,
+    const TPM2B_NAME *name3,
+    TPM2B_DIGEST *cpHash
+    );
+
+TSS2_RC Tss2_Sys_GetRpHash(
+    TSS2_SYS_CONTEXT *sysContext,
+    TPMI_ALG_HASH hashAlg,
+    TPM2B_DIGEST *rpHash
+    );
+
+//
+// Name computation for objects and NV indices, done on the host from the
+// public area: nameAlg || H_nameAlg(marshaled public area).
+//
+TSS2_RC Tss2_Sys_GetPublicName(
+    const TPM2B_PUBLIC *publicArea,
+    TPM2B_NAME *name
+    );
+
+TSS2_RC Tss2_Sys_GetNvPublicName(
+    const TPM2B_NV_PUBLIC *nvPublic,
+    TPM2B_NAME *name
+    );
+
+//
+// Handle keyed name cache.
+//
+// The cache is allocated by the caller (see Tss2_Sys_GetNameCacheSize) and
+// may be shared by several SAPI contexts; it does no locking of its own.
+// Once attached to a context with Tss2_Sys_SetNameCache it is kept up to
+// date from successful responses: Load, LoadExternal, CreatePrimary,
+// ReadPublic, NV_ReadPublic and NV_DefineSpace add entries; FlushContext,
+// EvictControl, ContextLoad, NV_UndefineSpace(Special), Clear, NV writes
+// that may set TPMA_NV_WRITTEN and NV_WriteLock, NV_ReadLock and
+// NV_GlobalWriteLock (all NV indices) remove them.
+//
+// Only transient, persistent and NV index handles are stored; for every
+// other handle the name is the handle itself and lookups always succeed.
+// A cache miss returns TSS2_SYS_RC_NOT_FOUND. When the cache is full an
+// entry near the new handle's hash slot is evicted to make room.
+//
+typedef struct TSS2_SYS_NAME_CACHE TSS2_SYS_NAME_CACHE;
+
+// maxEntries of 0 selects a default size.
+size_t Tss2_Sys_GetNameCacheSize(
+    UINT32 maxEntries
+    );
+
+TSS2_RC Tss2_Sys_InitializeNameCache(
+    TSS2_SYS_NAME_CACHE *nameCache,
+    size_t cacheSize,
+    UINT32 maxEntries
+    );
+
+// Pass NULL to detach the context's cache.
+TSS2_RC Tss2_Sys_SetNameCache(
+    TSS2_SYS_CONTEXT *sysContext,
+    TSS2_SYS_NAME_CACHE *nameCache
+    );
+
+TSS2_RC Tss2_Sys_NameCacheLookup(
+    TSS2_SYS_NAME_CACHE *nameCache,
+    TPM2_HANDLE handle,
+    TPM2B_NAME *name
+    );
+
+TSS2_RC Tss2_Sys_NameCacheAdd(
+    TSS2_SYS_NAME_CACHE *nameCache,
+    TPM2_HANDLE handle,
+    const TPM2B_NAME *name
+    );
+
+TSS2_RC Tss2_Sys_NameCacheAddPublic(
+    TSS2_SYS_NAME_CACHE *nameCache,
+    TPM2_HANDLE handle,
+    const TPM2B_PUBLIC *publicArea
+    );
+
+TSS2_RC Tss2_Sys_NameCacheAddNvPublic(
+    TSS2_SYS_NAME_CACHE *nameCache,
+    const TPM2B_NV_PUBLIC *nvPublic
+    );
+
+TSS2_RC Tss2_Sys_NameCacheRemove(
+    TSS2_SYS_NAME_CACHE *nameCache,
+    TPM2_HANDLE handle
+    );
+
 #include "sys_api_part3.h"
 
 #ifdef __cplusplus
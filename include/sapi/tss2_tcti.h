@@ -56,6 +56,7 @@ extern "C" {
 
 #if defined(__linux__) || defined(__unix__)
 #include <poll.h>
+#include <sys/uio.h>
 typedef struct pollfd TSS2_TCTI_POLL_HANDLE;
 #else
 typedef void TSS2_TCTI_POLL_HANDLE;
@@ -83,6 +84,12 @@ typedef void TSS2_TCTI_POLL_HANDLE;
     ((TSS2_TCTI_CONTEXT_COMMON_V1*)tctiContext)->getPollHandles
 #define TSS2_TCTI_SET_LOCALITY(tctiContext) \
     ((TSS2_TCTI_CONTEXT_COMMON_V1*)tctiContext)->setLocality
+#define TSS2_TCTI_TRANSMITV(tctiContext) \
+    ((TSS2_TCTI_CONTEXT_COMMON_V2*)tctiContext)->transmitv
+#define TSS2_TCTI_SUBMIT(tctiContext) \
+    ((TSS2_TCTI_CONTEXT_COMMON_V3*)tctiContext)->submit
+#define TSS2_TCTI_REAP(tctiContext) \
+    ((TSS2_TCTI_CONTEXT_COMMON_V3*)tctiContext)->reap
 
 // Macros to simplify invocation of functions from the common TCTI structure
 #define tss2_tcti_transmit(tctiContext, size, command) \
@@ -129,6 +136,42 @@ typedef void TSS2_TCTI_POLL_HANDLE;
     (TSS2_TCTI_SET_LOCALITY(tctiContext) == NULL) ? \
         TSS2_TCTI_RC_NOT_IMPLEMENTED: \
     TSS2_TCTI_SET_LOCALITY(tctiContext)(tctiContext, locality))
+/*
+ * transmitv only exists from version 2 on. Callers holding a version 1
+ * TCTI get TSS2_TCTI_RC_NOT_IMPLEMENTED and must coalesce the command into
+ * a single buffer for 'transmit' themselves.
+ */
+#define tss2_tcti_transmitv(tctiContext, iov, iovcnt) \
+    ((tctiContext == NULL) ? TSS2_TCTI_RC_BAD_REFERENCE: \
+    (TSS2_TCTI_VERSION(tctiContext) < 1) ? \
+        TSS2_TCTI_RC_ABI_MISMATCH: \
+    (TSS2_TCTI_VERSION(tctiContext) < 2 || \
+     TSS2_TCTI_TRANSMITV(tctiContext) == NULL) ? \
+        TSS2_TCTI_RC_NOT_IMPLEMENTED: \
+    TSS2_TCTI_TRANSMITV(tctiContext)(tctiContext, iov, iovcnt))
+/*
+ * submit / reap only exist from version 3 on; see
+ * TSS2_TCTI_CONTEXT_COMMON_V3.
+ */
+#define tss2_tcti_submit(tctiContext, command_size, command, response_size, \
+                         response, user_tag) \
+    ((tctiContext == NULL) ? TSS2_TCTI_RC_BAD_REFERENCE: \
+    (TSS2_TCTI_VERSION(tctiContext) < 1) ? \
+        TSS2_TCTI_RC_ABI_MISMATCH: \
+    (TSS2_TCTI_VERSION(tctiContext) < 3 || \
+     TSS2_TCTI_SUBMIT(tctiContext) == NULL) ? \
+        TSS2_TCTI_RC_NOT_IMPLEMENTED: \
+    TSS2_TCTI_SUBMIT(tctiContext)(tctiContext, command_size, command, \
+                                  response_size, response, user_tag))
+#define tss2_tcti_reap(tctiContext, completions, max, count, timeout) \
+    ((tctiContext == NULL) ? TSS2_TCTI_RC_BAD_REFERENCE: \
+    (TSS2_TCTI_VERSION(tctiContext) < 1) ? \
+        TSS2_TCTI_RC_ABI_MISMATCH: \
+    (TSS2_TCTI_VERSION(tctiContext) < 3 || \
+     TSS2_TCTI_REAP(tctiContext) == NULL) ? \
+        TSS2_TCTI_RC_NOT_IMPLEMENTED: \
+    TSS2_TCTI_REAP(tctiContext)(tctiContext, completions, max, count, \
+                                timeout))
 
 typedef struct TSS2_TCTI_OPAQUE_CONTEXT_BLOB TSS2_TCTI_CONTEXT;
 
@@ -153,7 +196,74 @@ TSS2_TCTI_POLL_HANDLE *handles, size_t *num_handles);
     TSS2_RC (*setLocality) (TSS2_TCTI_CONTEXT *tctiContext, uint8_t locality);
 } TSS2_TCTI_CONTEXT_COMMON_V1;
 
-typedef TSS2_TCTI_CONTEXT_COMMON_V1 TSS2_TCTI_CONTEXT_COMMON_CURRENT;
+/*
+ * Version 2 appends a vectored transmit: the command is the concatenation
+ * of the iovcnt buffers in iov, so callers can send the header, handles,
+ * authorization area and parameters from where they already live.
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_RC (*transmit)( TSS2_TCTI_CONTEXT *tctiContext, size_t size,
+uint8_t *command);
+    TSS2_RC (*receive) (TSS2_TCTI_CONTEXT *tctiContext, size_t *size,
+uint8_t *response, int32_t timeout);
+    void (*finalize) (TSS2_TCTI_CONTEXT *tctiContext);
+    TSS2_RC (*cancel) (TSS2_TCTI_CONTEXT *tctiContext);
+    TSS2_RC (*getPollHandles) (TSS2_TCTI_CONTEXT *tctiContext,
+TSS2_TCTI_POLL_HANDLE *handles, size_t *num_handles);
+    TSS2_RC (*setLocality) (TSS2_TCTI_CONTEXT *tctiContext, uint8_t locality);
+    TSS2_RC (*transmitv) (TSS2_TCTI_CONTEXT *tctiContext,
+const struct iovec *iov, int iovcnt);
+} TSS2_TCTI_CONTEXT_COMMON_V2;
+
+/* One finished command, as returned by 'reap'. */
+typedef struct {
+    uint64_t user_tag;
+    TSS2_RC rc;
+    size_t response_size;
+} TSS2_TCTI_COMPLETION;
+
+/*
+ * Version 3 appends a completion queue. 'submit' queues a command with
+ * the buffer its response goes to and a tag of the caller's choosing;
+ * the TCTI sends queued commands to the TPM in order and completes them
+ * in the same order, so several callers (e.g. SAPI contexts) may have
+ * commands in flight on one TCTI. Commands are sent one at a time unless
+ * the TCTI is configured to pipeline them (the socket TCTI's
+ * pipelineDepth). 'reap' waits up to 'timeout' for the first completion,
+ * then also returns, without waiting, any others that are ready, up to
+ * 'max'.
+ *
+ * Command and response buffers belong to the TCTI from submit until the
+ * command's completion is reaped. The response buffer must hold
+ * TPM2_MAX_RESPONSE_SIZE bytes; the command buffer may double as the
+ * response buffer. 'transmit' / 'receive' return
+ * TSS2_TCTI_RC_BAD_SEQUENCE while queued commands are outstanding.
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_RC (*transmit)( TSS2_TCTI_CONTEXT *tctiContext, size_t size,
+uint8_t *command);
+    TSS2_RC (*receive) (TSS2_TCTI_CONTEXT *tctiContext, size_t *size,
+uint8_t *response, int32_t timeout);
+    void (*finalize) (TSS2_TCTI_CONTEXT *tctiContext);
+    TSS2_RC (*cancel) (TSS2_TCTI_CONTEXT *tctiContext);
+    TSS2_RC (*getPollHandles) (TSS2_TCTI_CONTEXT *tctiContext,
+TSS2_TCTI_POLL_HANDLE *handles, size_t *num_handles);
+    TSS2_RC (*setLocality) (TSS2_TCTI_CONTEXT *tctiContext, uint8_t locality);
+    TSS2_RC (*transmitv) (TSS2_TCTI_CONTEXT *tctiContext,
+const struct iovec *iov, int iovcnt);
+    TSS2_RC (*submit) (TSS2_TCTI_CONTEXT *tctiContext, size_t command_size,
+uint8_t *command, size_t response_size, uint8_t *response,
+uint64_t user_tag);
+    TSS2_RC (*reap) (TSS2_TCTI_CONTEXT *tctiContext,
+TSS2_TCTI_COMPLETION *completions, size_t max, size_t *count,
+int32_t timeout);
+} TSS2_TCTI_CONTEXT_COMMON_V3;
+
+typedef TSS2_TCTI_CONTEXT_COMMON_V3 TSS2_TCTI_CONTEXT_COMMON_CURRENT;
 
 #ifdef __cplusplus
 }
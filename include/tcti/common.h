@@ -30,6 +30,14 @@
 
 #include <sapi/tpm20.h>
 
+/*
+ * Flags for the TCTI configuration structures.
+ * TCTI_FLAG_IO_URING: move commands and responses through an io_uring
+ * (linked send / receive, registered buffers) where the library and the
+ * kernel support it, falling back to plain system calls otherwise.
+ */
+#define TCTI_FLAG_IO_URING (1 << 0)
+
 typedef enum { NO_PREFIX = 0, RM_PREFIX = 1 } printf_type;
 typedef int (*TCTI_LOG_CALLBACK)( void *data, printf_type type, const char *format, ...);
 typedef int (*TCTI_LOG_BUFFER_CALLBACK)( void *useriData, printf_type type, UINT8 *buffer, UINT32 length);
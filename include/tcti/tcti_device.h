@@ -39,6 +39,7 @@ typedef struct {
     const char *device_path;
     TCTI_LOG_CALLBACK logCallback;
     void *logData;
+    uint32_t flags;
 } TCTI_DEVICE_CONF;
 
 TSS2_RC InitDeviceTcti (
@@ -0,0 +1,85 @@
+//**********************************************************************;
+// Copyright (c) 2017, Intel Corporation
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+// THE POSSIBILITY OF SUCH DAMAGE.
+//**********************************************************************;
+
+#ifndef TCTI_MUX_H
+#define TCTI_MUX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <sapi/tpm20.h>
+#include <tcti/common.h>
+
+/*
+ * Multiplexing TCTI: lets any number of SAPI contexts, on any number of
+ * threads, share one underlying TCTI and thus one connection to the TPM.
+ *
+ * A TCTI_MUX owns the underlying TCTI and an I/O thread. Commands sent
+ * through the TCTI contexts initialized by InitMuxTcti are queued on a
+ * lock-free queue and the I/O thread sends them to the TPM one at a time,
+ * in the order they were queued. Each of these contexts is used by one
+ * thread at a time, like any other TCTI, but different contexts may be
+ * used concurrently. Their poll handle is readable once the response to
+ * their command has arrived.
+ */
+typedef struct TCTI_MUX TCTI_MUX;
+
+/*
+ * Start the I/O thread for 'tcti', which must not be used directly until
+ * TctiMuxFree returns. It is not finalized by the mux.
+ */
+TSS2_RC TctiMuxNew (
+    TSS2_TCTI_CONTEXT *tcti,        // IN
+    TCTI_MUX **mux                  // OUT
+    );
+
+/*
+ * Stop the I/O thread. All the contexts initialized with 'mux' must have
+ * been finalized.
+ */
+void TctiMuxFree (
+    TCTI_MUX *mux                   // IN
+    );
+
+typedef struct {
+    TCTI_MUX *mux;
+    TCTI_LOG_CALLBACK logCallback;
+    void *logData;
+} TCTI_MUX_CONF;
+
+TSS2_RC InitMuxTcti (
+    TSS2_TCTI_CONTEXT *tctiContext, // OUT
+    size_t *contextSize,            // IN/OUT
+    const TCTI_MUX_CONF *config     // IN
+    );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TCTI_MUX_H */
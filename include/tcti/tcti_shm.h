@@ -0,0 +1,61 @@
+//**********************************************************************;
+// Copyright (c) 2017, Intel Corporation
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+// THE POSSIBILITY OF SUCH DAMAGE.
+//**********************************************************************;
+
+#ifndef TCTI_SHM_H
+#define TCTI_SHM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <sapi/tpm20.h>
+#include <tcti/common.h>
+
+/*
+ * Shared memory TCTI: commands and responses are exchanged with a TPM
+ * service on the same host (e.g. tcti-shm-server in front of the
+ * simulator) through rings in a memfd shared with it. 'path' is the Unix
+ * socket the service listens on for new sessions, a name starting with
+ * '@' is in the abstract namespace.
+ */
+typedef struct {
+    const char *path;
+    TCTI_LOG_CALLBACK logCallback;
+    void *logData;
+} TCTI_SHM_CONF;
+
+TSS2_RC InitShmTcti (
+    TSS2_TCTI_CONTEXT *tctiContext, // OUT
+    size_t *contextSize,            // IN/OUT
+    const TCTI_SHM_CONF *config     // IN
+    );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TCTI_SHM_H */
@@ -53,6 +53,22 @@ typedef struct {
     TCTI_LOG_CALLBACK logCallback;
     TCTI_LOG_BUFFER_CALLBACK logBufferCallback;
     void *logData;
+    uint32_t flags;
+    /*
+     * Unix domain sockets of the TPM command and platform channels, used
+     * instead of hostname / port when 'path' is set (both are required
+     * then). A name starting with '@' is in the abstract namespace.
+     */
+    const char *path;
+    const char *platformPath;
+    /*
+     * Commands queued with 'submit' that may be sent before the response
+     * to the oldest one has been read. 0 and 1 keep one command in flight;
+     * larger values are capped at the depth of the submit queue. The TPM
+     * still executes the commands one at a time and responses are
+     * returned in order.
+     */
+    uint32_t pipelineDepth;
 } TCTI_SOCKET_CONF;
 
 TSS2_RC InitSocketTcti (
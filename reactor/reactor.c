@@ -0,0 +1,369 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "sapi/tpm20.h"
+#include "sapi/tss2_reactor.h"
+
+/* epoll_wait batch size; more ready entries are picked up next dispatch */
+#define REACTOR_MAX_EVENTS 64
+
+struct TSS2_REACTOR {
+    int epfd;
+    size_t outstanding;
+    unsigned int dispatching;
+    TSS2_REACTOR_ENTRY *entries;
+    /* entries unregistered during dispatch, freed once it's done */
+    TSS2_REACTOR_ENTRY *zombies;
+};
+
+struct TSS2_REACTOR_ENTRY {
+    TSS2_REACTOR *reactor;
+    TSS2_SYS_CONTEXT *sysContext;
+    TSS2_REACTOR_CALLBACK callback;
+    void *data;
+    TSS2_REACTOR_ENTRY *prev;
+    TSS2_REACTOR_ENTRY *next;
+    bool pending;
+    bool dead;
+    size_t num_handles;
+    TSS2_TCTI_POLL_HANDLE handles [];
+};
+
+static uint32_t
+poll_to_epoll (short events)
+{
+    uint32_t ep = 0;
+
+    if (events & POLLIN)
+        ep |= EPOLLIN;
+    if (events & POLLPRI)
+        ep |= EPOLLPRI;
+    if (events & POLLOUT)
+        ep |= EPOLLOUT;
+
+    return ep;
+}
+
+/*
+ * Handles are registered EPOLLONESHOT and disabled: an idle entry's
+ * descriptors are never reported, so a TCTI that stays readable (a closed
+ * socket, say) can't make the loop spin. Each submit or TRY_AGAIN
+ * re-enables them with reactor_arm; the MOD re-evaluates readiness, so a
+ * response that arrived in between is still reported.
+ */
+static TSS2_RC
+reactor_add (TSS2_REACTOR_ENTRY *entry)
+{
+    struct epoll_event ev = { 0 };
+    size_t i;
+
+    for (i = 0; i < entry->num_handles; i++) {
+        ev.events = EPOLLONESHOT;
+        ev.data.ptr = entry;
+        if (epoll_ctl (entry->reactor->epfd,
+                       EPOLL_CTL_ADD,
+                       entry->handles [i].fd,
+                       &ev) != 0)
+        {
+            while (i-- > 0)
+                epoll_ctl (entry->reactor->epfd,
+                           EPOLL_CTL_DEL,
+                           entry->handles [i].fd,
+                           NULL);
+            return TSS2_SYS_RC_GENERAL_FAILURE;
+        }
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+reactor_arm (TSS2_REACTOR_ENTRY *entry)
+{
+    struct epoll_event ev = { 0 };
+    size_t i;
+
+    for (i = 0; i < entry->num_handles; i++) {
+        ev.events = EPOLLONESHOT | poll_to_epoll (entry->handles [i].events);
+        ev.data.ptr = entry;
+        if (epoll_ctl (entry->reactor->epfd,
+                       EPOLL_CTL_MOD,
+                       entry->handles [i].fd,
+                       &ev) != 0)
+        {
+            return TSS2_SYS_RC_GENERAL_FAILURE;
+        }
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+reactor_reap (TSS2_REACTOR *reactor)
+{
+    TSS2_REACTOR_ENTRY *entry;
+
+    while (reactor->zombies != NULL) {
+        entry = reactor->zombies;
+        reactor->zombies = entry->next;
+        free (entry);
+    }
+}
+
+TSS2_RC
+Tss2_Reactor_New (TSS2_REACTOR **reactor)
+{
+    TSS2_REACTOR *new;
+
+    if (reactor == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    new = calloc (1, sizeof (*new));
+    if (new == NULL)
+        return TSS2_SYS_RC_GENERAL_FAILURE;
+
+    new->epfd = epoll_create1 (EPOLL_CLOEXEC);
+    if (new->epfd < 0) {
+        free (new);
+        return TSS2_SYS_RC_GENERAL_FAILURE;
+    }
+
+    *reactor = new;
+    return TSS2_RC_SUCCESS;
+}
+
+void
+Tss2_Reactor_Free (TSS2_REACTOR *reactor)
+{
+    if (reactor == NULL)
+        return;
+
+    while (reactor->entries != NULL)
+        Tss2_Reactor_Unregister (reactor->entries);
+    reactor_reap (reactor);
+    close (reactor->epfd);
+    free (reactor);
+}
+
+int
+Tss2_Reactor_GetFd (TSS2_REACTOR *reactor)
+{
+    if (reactor == NULL)
+        return -1;
+
+    return reactor->epfd;
+}
+
+TSS2_RC
+Tss2_Reactor_Register (TSS2_REACTOR *reactor,
+                       TSS2_SYS_CONTEXT *sysContext,
+                       TSS2_REACTOR_ENTRY **entry)
+{
+    TSS2_TCTI_CONTEXT *tctiContext;
+    TSS2_REACTOR_ENTRY *new;
+    size_t num_handles = 0;
+    TSS2_RC rc;
+
+    if (reactor == NULL || sysContext == NULL || entry == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    rc = Tss2_Sys_GetTctiContext (sysContext, &tctiContext);
+    if (rc != TSS2_RC_SUCCESS)
+        return rc;
+
+    rc = tss2_tcti_get_poll_handles (tctiContext, NULL, &num_handles);
+    if (rc != TSS2_RC_SUCCESS)
+        return rc;
+    if (num_handles == 0)
+        return TSS2_SYS_RC_INCOMPATIBLE_TCTI;
+
+    new = calloc (1, sizeof (*new) +
+                     num_handles * sizeof (TSS2_TCTI_POLL_HANDLE));
+    if (new == NULL)
+        return TSS2_SYS_RC_GENERAL_FAILURE;
+
+    rc = tss2_tcti_get_poll_handles (tctiContext, new->handles, &num_handles);
+    if (rc != TSS2_RC_SUCCESS) {
+        free (new);
+        return rc;
+    }
+    new->reactor = reactor;
+    new->sysContext = sysContext;
+    new->num_handles = num_handles;
+
+    rc = reactor_add (new);
+    if (rc != TSS2_RC_SUCCESS) {
+        free (new);
+        return rc;
+    }
+
+    new->next = reactor->entries;
+    if (reactor->entries != NULL)
+        reactor->entries->prev = new;
+    reactor->entries = new;
+
+    *entry = new;
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+Tss2_Reactor_Unregister (TSS2_REACTOR_ENTRY *entry)
+{
+    TSS2_REACTOR *reactor;
+    size_t i;
+
+    if (entry == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+    if (entry->dead)
+        return TSS2_SYS_RC_BAD_SEQUENCE;
+
+    reactor = entry->reactor;
+    for (i = 0; i < entry->num_handles; i++)
+        epoll_ctl (reactor->epfd, EPOLL_CTL_DEL, entry->handles [i].fd, NULL);
+    if (entry->pending)
+        reactor->outstanding--;
+
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        reactor->entries = entry->next;
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+
+    /*
+     * Later events in the batch being dispatched may still point at the
+     * entry: keep it around, marked dead, until the dispatch finishes.
+     */
+    if (reactor->dispatching) {
+        entry->dead = true;
+        entry->next = reactor->zombies;
+        reactor->zombies = entry;
+    } else {
+        free (entry);
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+Tss2_Reactor_Submit (TSS2_REACTOR_ENTRY *entry,
+                     TSS2_REACTOR_CALLBACK callback,
+                     void *data)
+{
+    TSS2_RC rc;
+
+    if (entry == NULL || callback == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+    if (entry->dead || entry->pending)
+        return TSS2_SYS_RC_BAD_SEQUENCE;
+
+    /*
+     * Arm first: once the command is sent there is no taking it back. An
+     * idle entry that is reported anyway is skipped by the dispatch.
+     */
+    rc = reactor_arm (entry);
+    if (rc != TSS2_RC_SUCCESS)
+        return rc;
+
+    rc = Tss2_Sys_ExecuteAsync (entry->sysContext);
+    if (rc != TSS2_RC_SUCCESS)
+        return rc;
+
+    entry->callback = callback;
+    entry->data = data;
+    entry->pending = true;
+    entry->reactor->outstanding++;
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+Tss2_Reactor_Dispatch (TSS2_REACTOR *reactor,
+                       int32_t timeout,
+                       size_t *completed)
+{
+    struct epoll_event events [REACTOR_MAX_EVENTS];
+    TSS2_REACTOR_ENTRY *entry;
+    size_t count = 0;
+    TSS2_RC rc;
+    int i, n;
+
+    if (reactor == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+    if (timeout < TSS2_TCTI_TIMEOUT_BLOCK)
+        return TSS2_SYS_RC_BAD_VALUE;
+
+    n = epoll_wait (reactor->epfd, events, REACTOR_MAX_EVENTS, timeout);
+    if (n < 0 && errno != EINTR)
+        return TSS2_SYS_RC_GENERAL_FAILURE;
+
+    reactor->dispatching++;
+    for (i = 0; i < n; i++) {
+        entry = events [i].data.ptr;
+        /* a second handle of an entry that completed in this batch */
+        if (entry->dead || !entry->pending)
+            continue;
+
+        rc = Tss2_Sys_ExecuteFinish (entry->sysContext,
+                                     TSS2_TCTI_TIMEOUT_NONE);
+        if (rc == TSS2_TCTI_RC_TRY_AGAIN) {
+            /* not rearmed, the entry would never be reported again */
+            rc = reactor_arm (entry);
+            if (rc == TSS2_RC_SUCCESS)
+                continue;
+        }
+
+        entry->pending = false;
+        reactor->outstanding--;
+        count++;
+        entry->callback (entry->sysContext, rc, entry->data);
+    }
+    if (--reactor->dispatching == 0)
+        reactor_reap (reactor);
+
+    if (completed != NULL)
+        *completed = count;
+
+    return TSS2_RC_SUCCESS;
+}
+
+size_t
+Tss2_Reactor_Outstanding (TSS2_REACTOR *reactor)
+{
+    if (reactor == NULL)
+        return 0;
+
+    return reactor->outstanding;
+}
@@ -0,0 +1,95 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#ifndef HANDLE_TABLE_H
+#define HANDLE_TABLE_H
+
+#include <pthread.h>
+
+#include "sapi/tpm20.h"
+
+/*
+ * Store of fixed size values keyed by TPM handle, for per-session and
+ * per-entity state kept by applications. The values live in a pool
+ * allocated once by handle_table_init and never move, so a pointer from
+ * handle_table_get / handle_table_insert stays valid until its handle is
+ * removed. Lookups go through an open addressed index (linear probing,
+ * at most half full) and take the table's lock shared, so any number of
+ * readers may run concurrently; insert and remove take it exclusively.
+ * Synchronizing updates made through a returned pointer is up to the
+ * caller.
+ */
+typedef struct {
+    pthread_rwlock_t lock;
+    uint8_t *pool;
+    UINT32 *slots;       /* pool index + 1 of the entry hashed here, 0 if empty */
+    size_t entry_size;
+    size_t value_size;
+    UINT32 slot_mask;
+    UINT32 capacity;
+    UINT32 count;
+    UINT32 free_head;    /* first free pool entry, capacity if none */
+} HANDLE_TABLE;
+
+/* Spread handles, which mostly differ in their low bits, over a table. */
+static inline UINT32
+handle_hash (TPM2_HANDLE handle)
+{
+    UINT32 hash = handle;
+
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3b;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+TSS2_RC handle_table_init (HANDLE_TABLE *table,
+                           UINT32 capacity,
+                           size_t value_size);
+void handle_table_finalize (HANDLE_TABLE *table);
+/*
+ * Store a copy of value (zeroes if NULL) under handle, replacing any
+ * existing value. Fails with TSS2_SYS_RC_INSUFFICIENT_CONTEXT when the
+ * pool is exhausted.
+ */
+TSS2_RC handle_table_insert (HANDLE_TABLE *table,
+                             TPM2_HANDLE handle,
+                             const void *value,
+                             void **stored);
+/* Copy the value out under the shared lock. */
+TSS2_RC handle_table_lookup (HANDLE_TABLE *table,
+                             TPM2_HANDLE handle,
+                             void *value);
+void *handle_table_get (HANDLE_TABLE *table,
+                        TPM2_HANDLE handle);
+TSS2_RC handle_table_remove (HANDLE_TABLE *table,
+                             TPM2_HANDLE handle);
+UINT32 handle_table_count (HANDLE_TABLE *table);
+
+#endif /* HANDLE_TABLE_H */
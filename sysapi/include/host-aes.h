@@ -0,0 +1,67 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#ifndef HOST_AES_H
+#define HOST_AES_H
+
+#include "sapi/tpm20.h"
+
+#define HOST_AES_BLOCK_SIZE 16
+#define HOST_AES_MAX_ROUNDS 14
+
+/*
+ * AES encryption (FIPS 197) as needed for CFB parameter encryption; CFB
+ * only ever runs the block cipher forward so there is no inverse cipher.
+ * Blocks are processed with AES-NI when the CPU supports it.
+ */
+typedef struct {
+    uint8_t round_keys[(HOST_AES_MAX_ROUNDS + 1) * HOST_AES_BLOCK_SIZE];
+    unsigned int rounds;
+} HOST_AES_CONTEXT;
+
+TSS2_RC host_aes_init (HOST_AES_CONTEXT *ctx,
+                       const uint8_t *key,
+                       uint16_t key_bits);
+void host_aes_encrypt_block (const HOST_AES_CONTEXT *ctx,
+                             const uint8_t *in,
+                             uint8_t *out);
+/* In-place CFB-128. iv is updated so calls can be chained. */
+void host_aes_cfb_encrypt (const HOST_AES_CONTEXT *ctx,
+                           uint8_t *iv,
+                           uint8_t *buffer,
+                           size_t size);
+void host_aes_cfb_decrypt (const HOST_AES_CONTEXT *ctx,
+                           uint8_t *iv,
+                           uint8_t *buffer,
+                           size_t size);
+void host_aes_clear (HOST_AES_CONTEXT *ctx);
+
+int host_aes_accel_available (void);
+int host_aes_set_accel (int enable);
+
+#endif /* HOST_AES_H */
@@ -0,0 +1,89 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#ifndef HOST_CRYPTO_H
+#define HOST_CRYPTO_H
+
+#include "sapi/tpm20.h"
+
+#define HOST_HASH_MAX_BLOCK_SIZE 128
+
+/*
+ * When the backend can copy hash state, outer_ctx holds the outer hash with
+ * the opad block already absorbed, so finishing an HMAC (or deriving many
+ * HMACs from one key via host_hmac_copy) never rehashes the key pads.
+ */
+typedef struct {
+    TSS2_SYS_HASH_CONTEXT hash_ctx;
+    TSS2_SYS_HASH_CONTEXT outer_ctx;
+    TPMI_ALG_HASH hash_alg;
+    uint16_t block_size;
+    uint8_t has_outer_ctx;
+    uint8_t opad[HOST_HASH_MAX_BLOCK_SIZE];
+} HOST_HMAC_CONTEXT;
+
+/*
+ * Hash primitives routed through the installed TSS2_SYS_CRYPTO_CALLBACKS
+ * (the built-in SHA implementation by default).
+ */
+uint16_t host_hash_block_size (TPMI_ALG_HASH hash_alg);
+TSS2_RC host_hash_start (TSS2_SYS_HASH_CONTEXT *ctx,
+                         TPMI_ALG_HASH hash_alg);
+TSS2_RC host_hash_update (TSS2_SYS_HASH_CONTEXT *ctx,
+                          const uint8_t *buffer,
+                          size_t size);
+TSS2_RC host_hash_finish (TSS2_SYS_HASH_CONTEXT *ctx,
+                          uint8_t *digest,
+                          size_t *digest_size);
+void host_hash_abort (TSS2_SYS_HASH_CONTEXT *ctx);
+int host_hash_can_copy (void);
+TSS2_RC host_hash_copy (TSS2_SYS_HASH_CONTEXT *dest,
+                        const TSS2_SYS_HASH_CONTEXT *src);
+
+/* HMAC (RFC 2104) on top of the hash primitives. */
+TSS2_RC host_hmac_start (HOST_HMAC_CONTEXT *ctx,
+                         TPMI_ALG_HASH hash_alg,
+                         const uint8_t *key,
+                         size_t key_size);
+TSS2_RC host_hmac_update (HOST_HMAC_CONTEXT *ctx,
+                          const uint8_t *buffer,
+                          size_t size);
+TSS2_RC host_hmac_finish (HOST_HMAC_CONTEXT *ctx,
+                          uint8_t *digest,
+                          size_t *digest_size);
+void host_hmac_abort (HOST_HMAC_CONTEXT *ctx);
+/* Only valid if host_hash_can_copy (). */
+TSS2_RC host_hmac_copy (HOST_HMAC_CONTEXT *dest,
+                        const HOST_HMAC_CONTEXT *src);
+
+/* Compare without an early exit so timing does not leak the mismatch. */
+int host_is_equal (const uint8_t *buffer_a,
+                   const uint8_t *buffer_b,
+                   size_t size);
+
+#endif /* HOST_CRYPTO_H */
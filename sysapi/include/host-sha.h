@@ -0,0 +1,72 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#ifndef HOST_SHA_H
+#define HOST_SHA_H
+
+#include "sapi/tpm20.h"
+
+/*
+ * Built-in portable implementation of the SHA-1 / SHA-2 hash functions.
+ * This is the default backend behind the host crypto callbacks; the state
+ * lives inside the caller's TSS2_SYS_HASH_CONTEXT.
+ */
+typedef struct {
+    TPMI_ALG_HASH hash_alg;
+    uint16_t block_size;
+    uint16_t digest_size;
+    uint16_t block_used;
+    uint64_t total_size;
+    union {
+        uint32_t h32[8];
+        uint64_t h64[8];
+    } state;
+    uint8_t block[128];
+} HOST_SHA_CONTEXT;
+
+TSS2_RC host_sha_start (TSS2_SYS_HASH_CONTEXT *ctx,
+                        TPMI_ALG_HASH hash_alg,
+                        void *user_data);
+TSS2_RC host_sha_update (TSS2_SYS_HASH_CONTEXT *ctx,
+                         const uint8_t *buffer,
+                         size_t size);
+TSS2_RC host_sha_finish (TSS2_SYS_HASH_CONTEXT *ctx,
+                         uint8_t *digest,
+                         size_t *digest_size);
+TSS2_RC host_sha_copy (TSS2_SYS_HASH_CONTEXT *dest,
+                       const TSS2_SYS_HASH_CONTEXT *src);
+
+/*
+ * SHA-256 uses the x86 SHA extensions when the CPU has them. The
+ * accelerated path can be switched off to compare against the portable
+ * code; host_sha_set_accel returns the previous setting.
+ */
+int host_sha_accel_available (void);
+int host_sha_set_accel (int enable);
+
+#endif /* HOST_SHA_H */
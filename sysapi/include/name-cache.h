@@ -0,0 +1,66 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#ifndef NAME_CACHE_H
+#define NAME_CACHE_H
+
+#include "sapi/tpm20.h"
+#include "sysapi_util.h"
+
+#define NAME_CACHE_DEFAULT_ENTRIES 64
+
+/* Entry flags. */
+#define NAME_CACHE_NV_WRITTEN 0x01
+
+typedef struct {
+    TPM2_HANDLE handle; /* 0 (a PCR handle, never cached) marks a free slot */
+    UINT32 flags;
+    TPM2B_NAME name;
+} NAME_CACHE_ENTRY;
+
+/*
+ * Open addressed (linear probing) table of at most max_entries entries
+ * spread over a power of two number of slots, so it stays at most half
+ * full. Deletion shifts the following cluster back; no tombstones.
+ */
+struct TSS2_SYS_NAME_CACHE {
+    UINT32 slot_mask;
+    UINT32 max_entries;
+    UINT32 entry_count;
+    NAME_CACHE_ENTRY slots[];
+};
+
+/*
+ * Hooks run by the SAPI command flow: name_cache_prepare records which
+ * entities the prepared command affects, name_cache_response applies
+ * that to the attached cache once the TPM reports success.
+ */
+void name_cache_prepare (_TSS2_SYS_CONTEXT_BLOB *ctx);
+void name_cache_response (_TSS2_SYS_CONTEXT_BLOB *ctx);
+
+#endif /* NAME_CACHE_H */
@@ -98,6 +98,31 @@ typedef struct {
 
     /* Offset to next data in command/response buffer. */
     size_t nextData;
+
+    /*
+     * Size of the authorization area (size field plus the marshalled
+     * TPMS_AUTH_COMMANDs) set by Tss2_Sys_SetCmdAuths, see authArea.
+     */
+    UINT32 authAreaSize;
+
+    /*
+     * Optional name cache, and the handles / name the prepared command
+     * will add or invalidate once it succeeds (see name-cache.c).
+     */
+    TSS2_SYS_NAME_CACHE *nameCache;
+    TPM2_HANDLE nameCacheHandles[2];
+    TPM2B_NAME nameCacheName;
+
+    /*
+     * Room reserved in front of cmdBuffer for the largest authorization
+     * area, so this must stay the last field. Tss2_Sys_SetCmdAuths moves
+     * the header and handles down by authAreaSize and marshals the area
+     * between them and cpBuffer: the command is laid out in its final
+     * position and the parameters never move. The command then starts at
+     * cmdBuffer - authAreaSize, see req_header_from_cxt.
+     */
+    UINT8 authArea[sizeof(UINT32) +
+                   TPM2_MAX_SESSION_NUM * sizeof(TPMS_AUTH_COMMAND)];
 } _TSS2_SYS_CONTEXT_BLOB;
 
 struct TSS2_SYS_CONTEXT;
@@ -117,19 +142,9 @@ resp_header_from_cxt(_TSS2_SYS_CONTEXT_BLOB *ctx)
 static inline TPM20_Header_In *
 req_header_from_cxt(_TSS2_SYS_CONTEXT_BLOB *ctx)
 {
-    return (TPM20_Header_In *)ctx->cmdBuffer;
+    return (TPM20_Header_In *)(ctx->cmdBuffer - ctx->authAreaSize);
 }
 
-typedef struct {
-    TPM2_CC commandCode;
-    int numCommandHandles;  // Num of handles that require authorization in
-                            // command: used for virtualization and for
-                            // parsing sessions following handles section.
-    int numResponseHandles; // Num of handles that require authorization in
-                            // in response: used for virtualization and for
-                            // parsing sessions following handles section.
-} COMMAND_HANDLES;
-
 struct TSS2_SYS_CONTEXT;
 
 #ifdef __cplusplus
@@ -144,6 +159,10 @@ void InitSysContextFields(_TSS2_SYS_CONTEXT_BLOB *ctx);
 void InitSysContextPtrs(_TSS2_SYS_CONTEXT_BLOB *ctx, size_t contextSize);
 TSS2_RC CompleteChecks(_TSS2_SYS_CONTEXT_BLOB *ctx);
 TSS2_RC CommonComplete(_TSS2_SYS_CONTEXT_BLOB *ctx);
+TSS2_RC CompleteTpm2bView(
+    _TSS2_SYS_CONTEXT_BLOB *ctx,
+    size_t maxSize,
+    TSS2_SYS_TPM2B_VIEW *view);
 
 TSS2_RC CommonOneCall(
     _TSS2_SYS_CONTEXT_BLOB *ctx,
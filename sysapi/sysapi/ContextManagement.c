@@ -64,6 +64,7 @@ TSS2_RC Tss2_Sys_Initialize(
         return TSS2_SYS_RC_ABI_MISMATCH;
 
     ctx->tctiContext = tctiContext;
+    ctx->nameCache = NULL;
     InitSysContextPtrs(ctx, contextSize);
     InitSysContextFields(ctx);
     ctx->previousStage = CMD_STAGE_INITIALIZE;
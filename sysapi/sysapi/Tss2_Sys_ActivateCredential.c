@@ -81,10 +81,6 @@ TSS2_RC Tss2_Sys_ActivateCredential_Prepare(
     if (rval)
         return rval;
 
-    ctx->decryptAllowed = 1;
-    ctx->encryptAllowed = 1;
-    ctx->authAllowed = 1;
-
     return CommonPrepareEpilogue(ctx);
 }
 
@@ -93,10 +93,6 @@ TSS2_RC Tss2_Sys_CertifyCreation_Prepare(
     if (rval)
         return rval;
 
-    ctx->decryptAllowed = 1;
-    ctx->encryptAllowed = 1;
-    ctx->authAllowed = 1;
-
     return CommonPrepareEpilogue(ctx);
 }
 
@@ -69,10 +69,6 @@ TSS2_RC Tss2_Sys_NV_Read_Prepare(
     if (rval)
         return rval;
 
-    ctx->decryptAllowed = 0;
-    ctx->encryptAllowed = 1;
-    ctx->authAllowed = 1;
-
     return CommonPrepareEpilogue(ctx);
 }
 
@@ -96,6 +92,27 @@ TSS2_RC Tss2_Sys_NV_Read_Complete(
                                                  data);
 }
 
+/*
+ * Like Tss2_Sys_NV_Read_Complete, but 'data' points at the bytes read in
+ * the context's response buffer instead of receiving a copy of them.
+ */
+TSS2_RC Tss2_Sys_NV_Read_CompleteView(
+    TSS2_SYS_CONTEXT *sysContext,
+    TSS2_SYS_TPM2B_VIEW *data)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+    TSS2_RC rval;
+
+    if (!ctx)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    rval = CommonComplete(ctx);
+    if (rval)
+        return rval;
+
+    return CompleteTpm2bView(ctx, TPM2_MAX_NV_BUFFER_SIZE, data);
+}
+
 TSS2_RC Tss2_Sys_NV_Read(
     TSS2_SYS_CONTEXT *sysContext,
     TPMI_RH_NV_AUTH authHandle,
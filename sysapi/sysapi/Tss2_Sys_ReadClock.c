@@ -41,10 +41,6 @@ TSS2_RC Tss2_Sys_ReadClock_Prepare(
     if (rval)
         return rval;
 
-    ctx->decryptAllowed = 0;
-    ctx->encryptAllowed = 0;
-    ctx->authAllowed = 0;
-
     return CommonPrepareEpilogue(ctx);
 }
 
@@ -48,10 +48,6 @@ TSS2_RC Tss2_Sys_ReadPublic_Prepare(
     if (rval)
         return rval;
 
-    ctx->decryptAllowed = 0;
-    ctx->encryptAllowed = 1;
-    ctx->authAllowed = 1;
-
     return CommonPrepareEpilogue(ctx);
 }
 
@@ -88,6 +84,38 @@ TSS2_RC Tss2_Sys_ReadPublic_Complete(
                                         &ctx->nextData, qualifiedName);
 }
 
+/*
+ * Like Tss2_Sys_ReadPublic_Complete, but the outputs point into the
+ * context's response buffer. outPublic is the public area as marshaled by
+ * the TPM, i.e. what the object's name is the digest of.
+ */
+TSS2_RC Tss2_Sys_ReadPublic_CompleteView(
+    TSS2_SYS_CONTEXT *sysContext,
+    TSS2_SYS_TPM2B_VIEW *outPublic,
+    TSS2_SYS_TPM2B_VIEW *name,
+    TSS2_SYS_TPM2B_VIEW *qualifiedName)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+    TSS2_RC rval;
+
+    if (!ctx)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    rval = CommonComplete(ctx);
+    if (rval)
+        return rval;
+
+    rval = CompleteTpm2bView(ctx, sizeof(TPMT_PUBLIC), outPublic);
+    if (rval)
+        return rval;
+
+    rval = CompleteTpm2bView(ctx, sizeof(TPMU_NAME), name);
+    if (rval)
+        return rval;
+
+    return CompleteTpm2bView(ctx, sizeof(TPMU_NAME), qualifiedName);
+}
+
 TSS2_RC Tss2_Sys_ReadPublic(
     TSS2_SYS_CONTEXT *sysContext,
     TPMI_DH_OBJECT objectHandle,
@@ -48,10 +48,6 @@ TSS2_RC Tss2_Sys_SelfTest_Prepare(
      if (rval)
         return rval;
 
-    ctx->decryptAllowed = 0;
-    ctx->encryptAllowed = 0;
-    ctx->authAllowed = 1;
-
     return CommonPrepareEpilogue(ctx);
 }
 
@@ -72,10 +72,6 @@ TSS2_RC Tss2_Sys_SetPrimaryPolicy_Prepare(
     if (rval)
         return rval;
 
-    ctx->decryptAllowed = 1;
-    ctx->encryptAllowed = 0;
-    ctx->authAllowed = 1;
-
     return CommonPrepareEpilogue(ctx);
 }
 
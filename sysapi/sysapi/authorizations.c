@@ -26,6 +26,8 @@
  * THE POSSIBILITY OF SUCH DAMAGE.
  ***********************************************************************/
 
+#include <string.h>
+
 #include "tss2_endian.h"
 #include "sapi/tpm20.h"
 #include "sysapi_util.h"
@@ -38,7 +40,9 @@ TSS2_RC Tss2_Sys_SetCmdAuths(
     uint8_t i;
     UINT32 authSize = 0;
     UINT32 newCmdSize = 0;
+    size_t handlesSize;
     size_t authOffset;
+    UINT8 *command;
     TSS2_RC rval = TSS2_RC_SUCCESS;
 
     if (!ctx || !cmdAuthsArray)
@@ -56,8 +60,20 @@ TSS2_RC Tss2_Sys_SetCmdAuths(
     ctx->rval = TSS2_RC_SUCCESS;
     ctx->authsCount = 0;
 
-    if (!cmdAuthsArray->cmdAuthsCount)
+    handlesSize = ctx->cpBuffer - ctx->cmdBuffer;
+
+    if (!cmdAuthsArray->cmdAuthsCount) {
+        if (ctx->authAreaSize) {
+            req_header_from_cxt(ctx)->tag = HOST_TO_BE_16(TPM2_ST_NO_SESSIONS);
+            req_header_from_cxt(ctx)->commandSize =
+                HOST_TO_BE_32(BE_TO_HOST_32(req_header_from_cxt(ctx)->commandSize) -
+                              ctx->authAreaSize);
+            /* Move the header and handles back against the parameters. */
+            memmove(ctx->cmdBuffer, req_header_from_cxt(ctx), handlesSize);
+            ctx->authAreaSize = 0;
+        }
         return rval;
+    }
 
     req_header_from_cxt(ctx)->tag = HOST_TO_BE_16(TPM2_ST_SESSIONS);
 
@@ -68,6 +84,12 @@ TSS2_RC Tss2_Sys_SetCmdAuths(
         if (!cmdAuthsArray->cmdAuths[i])
             return TSS2_SYS_RC_BAD_VALUE;
 
+        if (cmdAuthsArray->cmdAuths[i]->nonce.size >
+                sizeof(cmdAuthsArray->cmdAuths[i]->nonce.buffer) ||
+            cmdAuthsArray->cmdAuths[i]->hmac.size >
+                sizeof(cmdAuthsArray->cmdAuths[i]->hmac.buffer))
+            return TSS2_SYS_RC_BAD_VALUE;
+
         authSize += sizeof(TPMI_SH_AUTH_SESSION);
         authSize += sizeof(UINT16) + cmdAuthsArray->cmdAuths[i]->nonce.size;
         authSize += sizeof(UINT8);
@@ -80,41 +102,43 @@ TSS2_RC Tss2_Sys_SetCmdAuths(
             ctx->encryptSession = 1;
     }
 
+    if (authSize + sizeof(UINT32) > sizeof(ctx->authArea))
+        return TSS2_SYS_RC_INSUFFICIENT_CONTEXT;
+
+    /* Replace any authorization area set earlier for this command. */
     newCmdSize = authSize;
     newCmdSize += sizeof(UINT32); /* authorization size field */
     newCmdSize += BE_TO_HOST_32(req_header_from_cxt(ctx)->commandSize);
+    newCmdSize -= ctx->authAreaSize;
 
     if (newCmdSize > ctx->maxCmdSize)
         return TSS2_SYS_RC_INSUFFICIENT_CONTEXT;
 
-    if (ctx->cpBufferUsedSize > ctx->maxCmdSize)
-        return TSS2_SYS_RC_INSUFFICIENT_CONTEXT;
-
-    /* We're going to have to move stuff around.
-     * First move current cpBuffer down by the auth area size. */
-    memmove(ctx->cpBuffer + authSize + sizeof(UINT32),
-            ctx->cpBuffer, ctx->cpBufferUsedSize);
-
-    /* Reset the auth size field */
-    *(UINT32 *)ctx->cpBuffer = 0;
-
-    /* Now copy in the authorization area. */
-    authOffset = ctx->cpBuffer - ctx->cmdBuffer;
-    rval = Tss2_MU_UINT32_Marshal(authSize, ctx->cmdBuffer,
-                          newCmdSize, &authOffset);
+    /*
+     * Rather than moving the parameters up to make room for the
+     * authorization area, the header and handles move down into the room
+     * reserved in front of cmdBuffer and the area is marshalled in its
+     * final place, between them and cpBuffer.
+     */
+    command = ctx->cpBuffer - authSize - sizeof(UINT32) - handlesSize;
+    memmove(command, req_header_from_cxt(ctx), handlesSize);
+    ctx->authAreaSize = authSize + sizeof(UINT32);
+
+    authOffset = handlesSize;
+    rval = Tss2_MU_UINT32_Marshal(authSize, command,
+                                  handlesSize + ctx->authAreaSize, &authOffset);
     if (rval)
         return rval;
 
     for (i = 0; i < cmdAuthsArray->cmdAuthsCount; i++) {
         rval = Tss2_MU_TPMS_AUTH_COMMAND_Marshal(cmdAuthsArray->cmdAuths[i],
-                                         ctx->cmdBuffer, newCmdSize,
+                                         command,
+                                         handlesSize + ctx->authAreaSize,
                                          &authOffset);
         if (rval)
-            break;
+            return rval;
     }
 
-    ctx->cpBuffer += authSize + sizeof(UINT32);
-
     /* Now update the command size. */
     req_header_from_cxt(ctx)->commandSize = HOST_TO_BE_32(newCmdSize);
     ctx->authsCount = cmdAuthsArray->cmdAuthsCount;
@@ -28,6 +28,7 @@
 #include "sapi/tpm20.h"
 #include "sysapi_util.h"
 #include "tss2_endian.h"
+#include "name-cache.h"
 
 TSS2_RC Tss2_Sys_ExecuteAsync(TSS2_SYS_CONTEXT *sysContext)
 {
@@ -40,9 +41,13 @@ TSS2_RC Tss2_Sys_ExecuteAsync(TSS2_SYS_CONTEXT *sysContext)
     if (ctx->previousStage != CMD_STAGE_PREPARE)
         return TSS2_SYS_RC_BAD_SEQUENCE;
 
+    /*
+     * Tss2_Sys_SetCmdAuths lays the command out in one piece, starting in
+     * front of cmdBuffer when it has an authorization area.
+     */
     rval = tss2_tcti_transmit(ctx->tctiContext,
-                              HOST_TO_BE_32(req_header_from_cxt(ctx)->commandSize),
-                              ctx->cmdBuffer);
+                              BE_TO_HOST_32(req_header_from_cxt(ctx)->commandSize),
+                              (UINT8 *)req_header_from_cxt(ctx));
     if (rval)
         return rval;
 
@@ -51,57 +56,48 @@ TSS2_RC Tss2_Sys_ExecuteAsync(TSS2_SYS_CONTEXT *sysContext)
     return rval;
 }
 
-TSS2_RC Tss2_Sys_ExecuteFinish(TSS2_SYS_CONTEXT *sysContext, int32_t timeout)
+/*
+ * Parse the header of a response of responseSize bytes the TCTI delivered
+ * to ctx->cmdBuffer and move the context out of CMD_STAGE_SEND_COMMAND.
+ */
+static TSS2_RC ProcessResponse(_TSS2_SYS_CONTEXT_BLOB *ctx, size_t responseSize)
 {
-    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
     TSS2_RC rval;
-    size_t responseSize = 0;
-
-    if (!ctx)
-        return TSS2_SYS_RC_BAD_REFERENCE;
-
-    if (ctx->previousStage != CMD_STAGE_SEND_COMMAND)
-        return TSS2_SYS_RC_BAD_SEQUENCE;
-
-    responseSize = ctx->maxCmdSize;
-
-    rval = tss2_tcti_receive(ctx->tctiContext, &responseSize,
-                             ctx->cmdBuffer, timeout);
-    if (rval)
-        return rval;
-
-    if (rval == TSS2_TCTI_RC_INSUFFICIENT_BUFFER)
-        return TSS2_SYS_RC_INSUFFICIENT_CONTEXT;
 
     /*
      * Unmarshal the tag, response size, and response code as soon
      * as possible. Later processing code should get this data from
      * the TPM20_Header_Out in the context structure. No need to
-     * unmarshal this stuff again.
+     * unmarshal this stuff again. Only the bytes actually received
+     * are parsed.
      */
-     ctx->nextData = 0;
+    ctx->nextData = 0;
+    ctx->previousStage = CMD_STAGE_PREPARE;
+
+    if (responseSize < sizeof(TPM20_Header_Out))
+        return TSS2_SYS_RC_INSUFFICIENT_RESPONSE;
 
-     rval = Tss2_MU_TPM2_ST_Unmarshal(ctx->cmdBuffer,
-                                     ctx->maxCmdSize,
+    rval = Tss2_MU_TPM2_ST_Unmarshal(ctx->cmdBuffer,
+                                     responseSize,
                                      &ctx->nextData,
                                      &ctx->rsp_header.tag);
     if (rval)
         return rval;
 
-     rval = Tss2_MU_UINT32_Unmarshal(ctx->cmdBuffer,
-                                     ctx->maxCmdSize,
-                                     &ctx->nextData,
-                                     &ctx->rsp_header.responseSize);
+    rval = Tss2_MU_UINT32_Unmarshal(ctx->cmdBuffer,
+                                    responseSize,
+                                    &ctx->nextData,
+                                    &ctx->rsp_header.responseSize);
     if (rval)
         return rval;
 
-    if (ctx->rsp_header.responseSize > ctx->maxCmdSize) {
+    if (ctx->rsp_header.responseSize > responseSize) {
         ctx->rval = TSS2_SYS_RC_MALFORMED_RESPONSE;
         return TSS2_SYS_RC_MALFORMED_RESPONSE;
     }
 
     rval = Tss2_MU_UINT32_Unmarshal(ctx->cmdBuffer,
-                                    ctx->maxCmdSize,
+                                    responseSize,
                                     &ctx->nextData,
                                     &ctx->rsp_header.responseCode);
     if (rval)
@@ -115,22 +111,89 @@ TSS2_RC Tss2_Sys_ExecuteFinish(TSS2_SYS_CONTEXT *sysContext, int32_t timeout)
     ctx->rval = rval;
 
     /* If we received a TPM error other than CANCELED or if we didn't
-     * receive enough response bytes, reset SAPI state machine to
+     * receive enough response bytes, leave the SAPI state machine in
      * CMD_STAGE_PREPARE. There's nothing else we can do for current command.
      */
-    if (ctx->rsp_header.responseSize < sizeof(TPM20_Header_Out)) {
-        ctx->previousStage = CMD_STAGE_PREPARE;
+    if (ctx->rsp_header.responseSize < sizeof(TPM20_Header_Out))
         return TSS2_SYS_RC_INSUFFICIENT_RESPONSE;
-    }
-    if (rval == TPM2_RC_CANCELED) {
-        ctx->previousStage = CMD_STAGE_PREPARE;
+    if (rval == TPM2_RC_CANCELED)
         return TSS2_SYS_RC_INSUFFICIENT_RESPONSE;
-    }
 
     ctx->previousStage = CMD_STAGE_RECEIVE_RESPONSE;
+    if (rval == TSS2_RC_SUCCESS)
+        name_cache_response(ctx);
+
     return rval;
 }
 
+/*
+ * Drop a response too large for the context's buffer: the TCTI only lets
+ * go of a response once it has been received in full.
+ */
+static TSS2_RC DiscardResponse(_TSS2_SYS_CONTEXT_BLOB *ctx, int32_t timeout)
+{
+    UINT8 scratch[TPM2_MAX_RESPONSE_SIZE];
+    size_t size = sizeof(scratch);
+    TSS2_RC rval;
+
+    rval = tss2_tcti_receive(ctx->tctiContext, &size, scratch, timeout);
+    if (rval == TSS2_TCTI_RC_TRY_AGAIN)
+        return rval;
+
+    ctx->previousStage = CMD_STAGE_INITIALIZE;
+
+    return TSS2_SYS_RC_INSUFFICIENT_CONTEXT;
+}
+
+/*
+ * After Tss2_Sys_ExecuteAsync the context is in CMD_STAGE_SEND_COMMAND
+ * until the whole response has been received, and ExecuteFinish may be
+ * called any number of times with any timeout until then:
+ *
+ * - TSS2_TCTI_RC_TRY_AGAIN: the response, or the rest of it, didn't arrive
+ *   within the timeout. The context is left untouched. The TCTI keeps
+ *   whatever part of the response it already read, and every call offers
+ *   it the same buffer, so nothing is lost or read twice. Calling again
+ *   with TSS2_TCTI_TIMEOUT_NONE once the TCTI's poll handles are ready is
+ *   how event loops drive it.
+ * - TSS2_TCTI_RC_INSUFFICIENT_BUFFER: the response doesn't fit the
+ *   context's buffer and is reported as TSS2_SYS_RC_INSUFFICIENT_CONTEXT.
+ *   It is read from the TCTI into a scratch buffer and dropped, so a later
+ *   command can't pick it up, and the context goes back to
+ *   CMD_STAGE_INITIALIZE. Should the rest of it not be in yet, that is
+ *   TSS2_TCTI_RC_TRY_AGAIN as above.
+ * - Other TCTI errors are returned as is, without a stage change.
+ *
+ * Once the TCTI has delivered the response it's gone from the TCTI, so
+ * the header is parsed exactly once and the context always leaves
+ * CMD_STAGE_SEND_COMMAND: to CMD_STAGE_RECEIVE_RESPONSE for a response the
+ * _Complete functions can unmarshal, or back to CMD_STAGE_PREPARE for one
+ * that is malformed, too short or reports TPM2_RC_CANCELED.
+ */
+TSS2_RC Tss2_Sys_ExecuteFinish(TSS2_SYS_CONTEXT *sysContext, int32_t timeout)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+    TSS2_RC rval;
+    size_t responseSize = 0;
+
+    if (!ctx)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    if (ctx->previousStage != CMD_STAGE_SEND_COMMAND)
+        return TSS2_SYS_RC_BAD_SEQUENCE;
+
+    responseSize = ctx->maxCmdSize;
+
+    rval = tss2_tcti_receive(ctx->tctiContext, &responseSize,
+                             ctx->cmdBuffer, timeout);
+    if (rval == TSS2_TCTI_RC_INSUFFICIENT_BUFFER)
+        return DiscardResponse(ctx, timeout);
+    if (rval)
+        return rval;
+
+    return ProcessResponse(ctx, responseSize);
+}
+
 TSS2_RC Tss2_Sys_Execute(TSS2_SYS_CONTEXT *sysContext)
 {
     TSS2_RC rval;
@@ -144,3 +207,180 @@ TSS2_RC Tss2_Sys_Execute(TSS2_SYS_CONTEXT *sysContext)
 
     return Tss2_Sys_ExecuteFinish(sysContext, TSS2_TCTI_TIMEOUT_BLOCK);
 }
+
+/*
+ * Give up on the outstanding commands of a batch after reaping failed.
+ * They are reaped anyway, so that the TCTI's queue is empty and the TCTI
+ * usable again, but their responses are dropped: the contexts go back to
+ * CMD_STAGE_INITIALIZE and report rval. Should reaping keep failing, the
+ * remaining contexts are reset all the same.
+ */
+static void BatchAbort(
+    TSS2_SYS_CONTEXT * const *sysContexts,
+    size_t next,
+    size_t outstanding,
+    TSS2_TCTI_CONTEXT *tcti,
+    TSS2_RC rval,
+    TSS2_RC *rvals)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx;
+    TSS2_TCTI_COMPLETION completions[8];
+    size_t i, j, reaped;
+    TSS2_RC rc;
+
+    while (outstanding > 0) {
+        rc = tss2_tcti_reap(tcti, completions,
+                            sizeof(completions) / sizeof(completions[0]),
+                            &reaped, TSS2_TCTI_TIMEOUT_BLOCK);
+        if (rc == TSS2_TCTI_RC_TRY_AGAIN)
+            continue;
+        if (rc)
+            break;
+
+        for (j = 0; j < reaped; j++) {
+            i = completions[j].user_tag;
+            if (i >= next)
+                continue;
+            ctx = syscontext_cast(sysContexts[i]);
+            if (ctx->previousStage != CMD_STAGE_SEND_COMMAND)
+                continue;
+            ctx->previousStage = CMD_STAGE_INITIALIZE;
+            rvals[i] = rval;
+            outstanding--;
+        }
+    }
+
+    for (i = 0; i < next; i++) {
+        ctx = syscontext_cast(sysContexts[i]);
+        if (ctx->previousStage == CMD_STAGE_SEND_COMMAND) {
+            ctx->previousStage = CMD_STAGE_INITIALIZE;
+            rvals[i] = rval;
+        }
+    }
+}
+
+/*
+ * Execute the commands prepared in sysContexts[0..count-1], which must all
+ * be in CMD_STAGE_PREPARE, be distinct and use the same TCTI. The commands
+ * must not depend on each other's responses: they are handed to the TCTI
+ * back to back through its 'submit' queue, so a TCTI that keeps several
+ * commands in flight gets them all before the first response is read.
+ * The batch owns the TCTI's queue until it returns. TCTIs without a queue
+ * (version 1 and 2) and contexts whose buffer can't take any response get
+ * the commands one at a time with Tss2_Sys_Execute instead.
+ *
+ * Responses are left in each context's own buffer, where the command's
+ * _Complete function reads them as after Tss2_Sys_Execute. rvals[i] is
+ * what Tss2_Sys_Execute would have returned for sysContexts[i]. A command
+ * the TCTI failed on leaves its context in CMD_STAGE_INITIALIZE: the
+ * response may have overwritten part of it, so it must be prepared again.
+ *
+ * Returns TSS2_RC_SUCCESS if every command succeeded, otherwise the first
+ * failure in rvals. Errors about the arguments are returned before
+ * anything is sent; an error from 'reap' ends the batch and is also stored
+ * for each command still in flight.
+ */
+TSS2_RC Tss2_Sys_ExecuteBatch(
+    TSS2_SYS_CONTEXT * const *sysContexts,
+    size_t count,
+    TSS2_RC *rvals)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx;
+    TPM20_Header_In *header;
+    TSS2_TCTI_CONTEXT *tcti;
+    TSS2_TCTI_COMPLETION completions[8];
+    size_t i, j, next, outstanding, reaped;
+    int queued = 1;
+    TSS2_RC rval;
+
+    if (!sysContexts || !rvals)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    if (count == 0)
+        return TSS2_RC_SUCCESS;
+
+    for (i = 0; i < count; i++) {
+        ctx = syscontext_cast(sysContexts[i]);
+        if (!ctx)
+            return TSS2_SYS_RC_BAD_REFERENCE;
+        if (ctx->previousStage != CMD_STAGE_PREPARE)
+            return TSS2_SYS_RC_BAD_SEQUENCE;
+        if (ctx->tctiContext != syscontext_cast(sysContexts[0])->tctiContext)
+            return TSS2_SYS_RC_BAD_VALUE;
+        for (j = 0; j < i; j++)
+            if (sysContexts[j] == sysContexts[i])
+                return TSS2_SYS_RC_BAD_VALUE;
+        if (ctx->maxCmdSize < TPM2_MAX_RESPONSE_SIZE)
+            queued = 0;
+    }
+
+    tcti = syscontext_cast(sysContexts[0])->tctiContext;
+    if (TSS2_TCTI_VERSION(tcti) < 3 ||
+        TSS2_TCTI_SUBMIT(tcti) == NULL || TSS2_TCTI_REAP(tcti) == NULL)
+        queued = 0;
+
+    if (!queued) {
+        for (i = 0; i < count; i++)
+            rvals[i] = Tss2_Sys_Execute(sysContexts[i]);
+        goto out;
+    }
+
+    next = 0;
+    outstanding = 0;
+    while (next < count || outstanding > 0) {
+        /* queue as many commands as the TCTI takes */
+        while (next < count) {
+            ctx = syscontext_cast(sysContexts[next]);
+            header = req_header_from_cxt(ctx);
+            rval = tss2_tcti_submit(tcti, BE_TO_HOST_32(header->commandSize),
+                                    (UINT8 *)header, ctx->maxCmdSize,
+                                    ctx->cmdBuffer, next);
+            if (rval == TSS2_TCTI_RC_TRY_AGAIN && outstanding > 0)
+                break;
+            rvals[next] = rval;
+            if (rval == TSS2_RC_SUCCESS) {
+                ctx->previousStage = CMD_STAGE_SEND_COMMAND;
+                outstanding++;
+            }
+            next++;
+        }
+        if (outstanding == 0)
+            continue;
+
+        rval = tss2_tcti_reap(tcti, completions,
+                              sizeof(completions) / sizeof(completions[0]),
+                              &reaped, TSS2_TCTI_TIMEOUT_BLOCK);
+        if (rval == TSS2_TCTI_RC_TRY_AGAIN)
+            continue;
+        if (rval) {
+            BatchAbort(sysContexts, next, outstanding, tcti, rval, rvals);
+            return rval;
+        }
+
+        for (j = 0; j < reaped; j++) {
+            i = completions[j].user_tag;
+            if (i >= next)
+                continue;
+            ctx = syscontext_cast(sysContexts[i]);
+            if (ctx->previousStage != CMD_STAGE_SEND_COMMAND)
+                continue;
+            outstanding--;
+
+            if (completions[j].rc) {
+                ctx->previousStage = CMD_STAGE_INITIALIZE;
+                rvals[i] = completions[j].rc;
+                if (rvals[i] == TSS2_TCTI_RC_INSUFFICIENT_BUFFER)
+                    rvals[i] = TSS2_SYS_RC_INSUFFICIENT_CONTEXT;
+                continue;
+            }
+            rvals[i] = ProcessResponse(ctx, completions[j].response_size);
+        }
+    }
+
+out:
+    for (i = 0; i < count; i++)
+        if (rvals[i])
+            return rvals[i];
+
+    return TSS2_RC_SUCCESS;
+}
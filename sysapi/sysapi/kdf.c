@@ -0,0 +1,293 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <string.h>
+
+#include "sapi/tpm20.h"
+#include "sysapi_util.h"
+#include "host-crypto.h"
+#include "kdf.h"
+
+static void
+kdf_store_be32 (uint8_t *buffer,
+                uint32_t value)
+{
+    buffer[0] = (uint8_t)(value >> 24);
+    buffer[1] = (uint8_t)(value >> 16);
+    buffer[2] = (uint8_t)(value >> 8);
+    buffer[3] = (uint8_t)value;
+}
+
+static TSS2_RC
+kdf_check_args (TPMI_ALG_HASH hashAlg,
+                const char *label,
+                UINT16 bits,
+                TPM2B_MAX_BUFFER *resultKey,
+                UINT16 *digest_size)
+{
+    if (!label || !resultKey)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    *digest_size = GetDigestSize(hashAlg);
+    if (*digest_size == 0)
+        return TSS2_SYS_RC_BAD_VALUE;
+
+    if ((bits + 7) / 8 > sizeof(resultKey->buffer))
+        return TSS2_SYS_RC_BAD_SIZE;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * Copy (or XOR) one PRF block into the output, clipping the final block.
+ */
+static void
+kdf_emit (uint8_t *output,
+          const uint8_t *digest,
+          size_t count,
+          int xor_output)
+{
+    size_t i;
+
+    if (!xor_output) {
+        memcpy(output, digest, count);
+        return;
+    }
+    for (i = 0; i < count; i++)
+        output[i] ^= digest[i];
+}
+
+/* Clear the excess high order bits if bits is not a multiple of 8. */
+static void
+kdf_mask_bits (uint8_t *output,
+               UINT16 bits)
+{
+    if ((bits % 8) != 0)
+        output[0] &= (1 << (bits % 8)) - 1;
+}
+
+static TSS2_RC
+kdf_hmac_update (HOST_HMAC_CONTEXT *ctx,
+                 const TPM2B *buffer)
+{
+    if (buffer == NULL || buffer->size == 0)
+        return TSS2_RC_SUCCESS;
+
+    return host_hmac_update(ctx, buffer->buffer, buffer->size);
+}
+
+static TSS2_RC
+kdf_hash_update (TSS2_SYS_HASH_CONTEXT *ctx,
+                 const TPM2B *buffer)
+{
+    if (buffer == NULL || buffer->size == 0)
+        return TSS2_RC_SUCCESS;
+
+    return host_hash_update(ctx, buffer->buffer, buffer->size);
+}
+
+TSS2_RC
+kdf_kdfa (TPMI_ALG_HASH hash_alg,
+          const uint8_t *key,
+          size_t key_size,
+          const char *label,
+          const TPM2B *context_u,
+          const TPM2B *context_v,
+          UINT16 bits,
+          uint8_t *output,
+          int xor_output)
+{
+    HOST_HMAC_CONTEXT keyed, ctx;
+    uint8_t digest[sizeof(TPMU_HA)];
+    uint8_t counter[4], bits_be[4];
+    size_t digest_size, label_size, offset, count;
+    size_t bytes = (bits + 7) / 8;
+    UINT16 hash_size;
+    UINT32 i;
+    int copy;
+    TSS2_RC rval = TSS2_RC_SUCCESS;
+
+    hash_size = GetDigestSize(hash_alg);
+    if (hash_size == 0)
+        return TSS2_SYS_RC_BAD_VALUE;
+
+    label_size = strlen(label) + 1;
+    kdf_store_be32(bits_be, bits);
+
+    /*
+     * Every iteration is keyed identically, so absorb the key pads once and
+     * clone that state per counter value when the backend supports it.
+     */
+    copy = host_hash_can_copy();
+    if (copy) {
+        rval = host_hmac_start(&keyed, hash_alg, key, key_size);
+        if (rval)
+            return rval;
+    }
+
+    for (i = 1, offset = 0; offset < bytes; i++, offset += count) {
+        kdf_store_be32(counter, i);
+
+        if (copy)
+            rval = host_hmac_copy(&ctx, &keyed);
+        else
+            rval = host_hmac_start(&ctx, hash_alg, key, key_size);
+        if (rval)
+            break;
+
+        rval = host_hmac_update(&ctx, counter, sizeof(counter));
+        if (!rval)
+            rval = host_hmac_update(&ctx, (const uint8_t *)label, label_size);
+        if (!rval)
+            rval = kdf_hmac_update(&ctx, context_u);
+        if (!rval)
+            rval = kdf_hmac_update(&ctx, context_v);
+        if (!rval)
+            rval = host_hmac_update(&ctx, bits_be, sizeof(bits_be));
+        if (rval) {
+            host_hmac_abort(&ctx);
+            break;
+        }
+
+        digest_size = sizeof(digest);
+        rval = host_hmac_finish(&ctx, digest, &digest_size);
+        if (rval)
+            break;
+
+        count = bytes - offset < hash_size ? bytes - offset : hash_size;
+        kdf_emit(&output[offset], digest, count, xor_output);
+    }
+
+    if (copy)
+        host_hmac_abort(&keyed);
+    memset(digest, 0, sizeof(digest));
+    return rval;
+}
+
+TSS2_RC Tss2_Sys_KDFa(
+    TPMI_ALG_HASH hashAlg,
+    const TPM2B *key,
+    const char *label,
+    const TPM2B *contextU,
+    const TPM2B *contextV,
+    UINT16 bits,
+    TPM2B_MAX_BUFFER *resultKey)
+{
+    UINT16 hashSize;
+    TSS2_RC rval;
+
+    if (!key)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    rval = kdf_check_args(hashAlg, label, bits, resultKey, &hashSize);
+    if (rval)
+        return rval;
+
+    rval = kdf_kdfa(hashAlg, key->buffer, key->size, label, contextU,
+                    contextV, bits, resultKey->buffer, 0);
+    if (rval) {
+        resultKey->size = 0;
+        return rval;
+    }
+
+    resultKey->size = (bits + 7) / 8;
+    kdf_mask_bits(resultKey->buffer, bits);
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC Tss2_Sys_KDFe(
+    TPMI_ALG_HASH hashAlg,
+    const TPM2B *z,
+    const char *label,
+    const TPM2B *partyUInfo,
+    const TPM2B *partyVInfo,
+    UINT16 bits,
+    TPM2B_MAX_BUFFER *resultKey)
+{
+    TSS2_SYS_HASH_CONTEXT ctx;
+    uint8_t digest[sizeof(TPMU_HA)];
+    uint8_t counter[4];
+    size_t digestSize;
+    size_t labelSize;
+    UINT16 bytes = (bits + 7) / 8;
+    UINT16 hashSize, count;
+    UINT32 i;
+    TSS2_RC rval = TSS2_RC_SUCCESS;
+
+    if (!z)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    rval = kdf_check_args(hashAlg, label, bits, resultKey, &hashSize);
+    if (rval)
+        return rval;
+
+    labelSize = strlen(label) + 1;
+    resultKey->size = 0;
+
+    for (i = 1; resultKey->size < bytes; i++) {
+        kdf_store_be32(counter, i);
+
+        rval = host_hash_start(&ctx, hashAlg);
+        if (rval)
+            break;
+
+        rval = host_hash_update(&ctx, counter, sizeof(counter));
+        if (!rval)
+            rval = kdf_hash_update(&ctx, z);
+        if (!rval)
+            rval = host_hash_update(&ctx, (const uint8_t *)label, labelSize);
+        if (!rval)
+            rval = kdf_hash_update(&ctx, partyUInfo);
+        if (!rval)
+            rval = kdf_hash_update(&ctx, partyVInfo);
+        if (rval) {
+            host_hash_abort(&ctx);
+            break;
+        }
+
+        digestSize = sizeof(digest);
+        rval = host_hash_finish(&ctx, digest, &digestSize);
+        if (rval)
+            break;
+
+        count = bytes - resultKey->size;
+        if (count > hashSize)
+            count = hashSize;
+        kdf_emit(&resultKey->buffer[resultKey->size], digest, count, 0);
+        resultKey->size += count;
+    }
+
+    memset(digest, 0, sizeof(digest));
+    if (rval) {
+        resultKey->size = 0;
+        return rval;
+    }
+
+    kdf_mask_bits(resultKey->buffer, bits);
+    return TSS2_RC_SUCCESS;
+}
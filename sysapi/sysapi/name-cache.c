@@ -0,0 +1,709 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <string.h>
+
+#include "sapi/tpm20.h"
+#include "sysapi_util.h"
+#include "handle-table.h"
+#include "host-crypto.h"
+#include "name-cache.h"
+
+#define NAME_CACHE_MIN_SLOTS 8
+
+static int
+name_cache_is_entity (TPM2_HANDLE handle)
+{
+    switch (handle >> TPM2_HR_SHIFT) {
+    case TPM2_HT_TRANSIENT:
+    case TPM2_HT_PERSISTENT:
+    case TPM2_HT_NV_INDEX:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static UINT32
+name_cache_slot (const TSS2_SYS_NAME_CACHE *cache,
+                 TPM2_HANDLE handle)
+{
+    return handle_hash (handle) & cache->slot_mask;
+}
+
+static NAME_CACHE_ENTRY *
+name_cache_find (TSS2_SYS_NAME_CACHE *cache,
+                 TPM2_HANDLE handle)
+{
+    UINT32 i = name_cache_slot (cache, handle);
+
+    while (cache->slots[i].handle != 0) {
+        if (cache->slots[i].handle == handle)
+            return &cache->slots[i];
+        i = (i + 1) & cache->slot_mask;
+    }
+
+    return NULL;
+}
+
+static void
+name_cache_delete (TSS2_SYS_NAME_CACHE *cache,
+                   NAME_CACHE_ENTRY *entry)
+{
+    UINT32 hole = entry - cache->slots;
+    UINT32 i = hole;
+    UINT32 home;
+
+    /*
+     * Move back every entry of the following cluster whose home slot is
+     * not cyclically between the hole and its current position.
+     */
+    for (;;) {
+        i = (i + 1) & cache->slot_mask;
+        if (cache->slots[i].handle == 0)
+            break;
+        home = name_cache_slot (cache, cache->slots[i].handle);
+        if (((i - home) & cache->slot_mask) >= ((i - hole) & cache->slot_mask)) {
+            cache->slots[hole] = cache->slots[i];
+            hole = i;
+        }
+    }
+
+    memset (&cache->slots[hole], 0, sizeof (cache->slots[hole]));
+    cache->entry_count--;
+}
+
+static void
+name_cache_remove (TSS2_SYS_NAME_CACHE *cache,
+                   TPM2_HANDLE handle)
+{
+    NAME_CACHE_ENTRY *entry;
+
+    if (!name_cache_is_entity (handle))
+        return;
+
+    entry = name_cache_find (cache, handle);
+    if (entry != NULL)
+        name_cache_delete (cache, entry);
+}
+
+static TSS2_RC
+name_cache_insert (TSS2_SYS_NAME_CACHE *cache,
+                   TPM2_HANDLE handle,
+                   const TPM2B_NAME *name,
+                   UINT32 flags)
+{
+    NAME_CACHE_ENTRY *entry;
+    UINT32 i;
+
+    if (!name_cache_is_entity (handle))
+        return TSS2_SYS_RC_BAD_VALUE;
+
+    if (name->size == 0 || name->size > sizeof (name->name))
+        return TSS2_SYS_RC_BAD_SIZE;
+
+    entry = name_cache_find (cache, handle);
+    if (entry == NULL) {
+        if (cache->entry_count >= cache->max_entries) {
+            /* Full: evict whatever lives nearest the new entry's slot. */
+            i = name_cache_slot (cache, handle);
+            while (cache->slots[i].handle == 0)
+                i = (i + 1) & cache->slot_mask;
+            name_cache_delete (cache, &cache->slots[i]);
+        }
+        i = name_cache_slot (cache, handle);
+        while (cache->slots[i].handle != 0)
+            i = (i + 1) & cache->slot_mask;
+        entry = &cache->slots[i];
+        entry->handle = handle;
+        cache->entry_count++;
+    }
+
+    entry->flags = flags;
+    entry->name.size = name->size;
+    memcpy (entry->name.name, name->name, name->size);
+
+    return TSS2_RC_SUCCESS;
+}
+
+/* Drop every NV index; deleting may move a later entry into slot i. */
+static void
+name_cache_remove_nv (TSS2_SYS_NAME_CACHE *cache)
+{
+    UINT32 i = 0;
+
+    while (i <= cache->slot_mask) {
+        if (cache->slots[i].handle != 0 &&
+            (cache->slots[i].handle >> TPM2_HR_SHIFT) == TPM2_HT_NV_INDEX)
+            name_cache_delete (cache, &cache->slots[i]);
+        else
+            i++;
+    }
+}
+
+static void
+name_cache_clear (TSS2_SYS_NAME_CACHE *cache)
+{
+    memset (cache->slots, 0,
+            (cache->slot_mask + 1) * sizeof (NAME_CACHE_ENTRY));
+    cache->entry_count = 0;
+}
+
+/* name = nameAlg || H_nameAlg(public area) */
+static TSS2_RC
+name_compute (TPMI_ALG_HASH name_alg,
+              const uint8_t *buffer,
+              size_t size,
+              TPM2B_NAME *name)
+{
+    TSS2_SYS_HASH_CONTEXT ctx;
+    size_t offset = 0;
+    size_t digest_size;
+    TSS2_RC rval;
+
+    rval = Tss2_MU_UINT16_Marshal (name_alg, name->name, sizeof (name->name),
+                                   &offset);
+    if (rval != TSS2_RC_SUCCESS)
+        return rval;
+
+    rval = host_hash_start (&ctx, name_alg);
+    if (rval != TSS2_RC_SUCCESS)
+        return rval;
+
+    rval = host_hash_update (&ctx, buffer, size);
+    if (rval != TSS2_RC_SUCCESS) {
+        host_hash_abort (&ctx);
+        return rval;
+    }
+
+    digest_size = sizeof (name->name) - offset;
+    rval = host_hash_finish (&ctx, &name->name[offset], &digest_size);
+    if (rval != TSS2_RC_SUCCESS)
+        return rval;
+    name->size = offset + digest_size;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * Index, nameAlg and cache flags from a marshaled TPMS_NV_PUBLIC:
+ * nvIndex (4) || nameAlg (2) || attributes (4) || ...
+ */
+static TSS2_RC
+nv_public_fields (const uint8_t *buffer,
+                  size_t size,
+                  TPM2_HANDLE *nv_index,
+                  TPMI_ALG_HASH *name_alg,
+                  UINT32 *flags)
+{
+    UINT32 attributes;
+    size_t offset = 0;
+    TSS2_RC rval;
+
+    rval = Tss2_MU_UINT32_Unmarshal (buffer, size, &offset, nv_index);
+    if (rval != TSS2_RC_SUCCESS)
+        return rval;
+    rval = Tss2_MU_UINT16_Unmarshal (buffer, size, &offset, name_alg);
+    if (rval != TSS2_RC_SUCCESS)
+        return rval;
+    rval = Tss2_MU_UINT32_Unmarshal (buffer, size, &offset, &attributes);
+    if (rval != TSS2_RC_SUCCESS)
+        return rval;
+
+    *flags = (attributes & TPMA_NV_TPMA_NV_WRITTEN) ? NAME_CACHE_NV_WRITTEN : 0;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/* Name, index and cache flags from a marshaled TPMS_NV_PUBLIC. */
+static TSS2_RC
+name_compute_nv (const uint8_t *buffer,
+                 size_t size,
+                 TPM2_HANDLE *nv_index,
+                 UINT32 *flags,
+                 TPM2B_NAME *name)
+{
+    TPMI_ALG_HASH name_alg;
+    TSS2_RC rval;
+
+    rval = nv_public_fields (buffer, size, nv_index, &name_alg, flags);
+    if (rval != TSS2_RC_SUCCESS)
+        return rval;
+
+    return name_compute (name_alg, buffer, size, name);
+}
+
+/* Skip a TPM2B in the response without looking at its (maybe encrypted) contents. */
+static TSS2_RC
+name_cache_skip_tpm2b (const uint8_t *buffer,
+                       size_t size,
+                       size_t *offset)
+{
+    UINT16 tpm2b_size;
+    TSS2_RC rval;
+
+    rval = Tss2_MU_UINT16_Unmarshal (buffer, size, offset, &tpm2b_size);
+    if (rval != TSS2_RC_SUCCESS)
+        return rval;
+
+    if (tpm2b_size > size - *offset)
+        return TSS2_SYS_RC_MALFORMED_RESPONSE;
+    *offset += tpm2b_size;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+name_cache_command_handle (_TSS2_SYS_CONTEXT_BLOB *ctx,
+                           unsigned int index,
+                           TPM2_HANDLE *handle)
+{
+    size_t offset = sizeof (TPM20_Header_In) + index * sizeof (TPM2_HANDLE);
+
+    return Tss2_MU_UINT32_Unmarshal ((const uint8_t *)req_header_from_cxt (ctx),
+                                     ctx->cpBuffer - ctx->cmdBuffer,
+                                     &offset, handle);
+}
+
+static TSS2_RC
+name_cache_first_param_handle (_TSS2_SYS_CONTEXT_BLOB *ctx,
+                               TPM2_HANDLE *handle)
+{
+    size_t offset = 0;
+
+    return Tss2_MU_UINT32_Unmarshal (ctx->cpBuffer, ctx->cpBufferUsedSize,
+                                     &offset, handle);
+}
+
+static void
+name_cache_prepare_define_space (_TSS2_SYS_CONTEXT_BLOB *ctx)
+{
+    size_t offset = 0;
+    UINT16 public_size;
+    UINT32 flags;
+
+    /* auth (TPM2B_AUTH) || publicInfo (TPM2B_NV_PUBLIC) */
+    if (name_cache_skip_tpm2b (ctx->cpBuffer, ctx->cpBufferUsedSize, &offset))
+        return;
+    if (Tss2_MU_UINT16_Unmarshal (ctx->cpBuffer, ctx->cpBufferUsedSize,
+                                  &offset, &public_size))
+        return;
+    if (public_size > ctx->cpBufferUsedSize - offset)
+        return;
+    if (name_compute_nv (&ctx->cpBuffer[offset], public_size,
+                         &ctx->nameCacheHandles[0], &flags,
+                         &ctx->nameCacheName))
+        ctx->nameCacheName.size = 0;
+}
+
+void
+name_cache_prepare (_TSS2_SYS_CONTEXT_BLOB *ctx)
+{
+    ctx->nameCacheHandles[0] = 0;
+    ctx->nameCacheHandles[1] = 0;
+    ctx->nameCacheName.size = 0;
+
+    if (ctx->nameCache == NULL)
+        return;
+
+    switch (ctx->commandCode) {
+    case TPM2_CC_ReadPublic:
+    case TPM2_CC_NV_ReadPublic:
+    case TPM2_CC_NV_UndefineSpaceSpecial:
+    case TPM2_CC_FlushContext:
+        name_cache_command_handle (ctx, 0, &ctx->nameCacheHandles[0]);
+        break;
+    case TPM2_CC_NV_UndefineSpace:
+    case TPM2_CC_NV_Write:
+    case TPM2_CC_NV_Increment:
+    case TPM2_CC_NV_Extend:
+    case TPM2_CC_NV_SetBits:
+    case TPM2_CC_NV_WriteLock:
+    case TPM2_CC_NV_ReadLock:
+        name_cache_command_handle (ctx, 1, &ctx->nameCacheHandles[0]);
+        break;
+    case TPM2_CC_EvictControl:
+        name_cache_command_handle (ctx, 1, &ctx->nameCacheHandles[0]);
+        name_cache_first_param_handle (ctx, &ctx->nameCacheHandles[1]);
+        break;
+    case TPM2_CC_NV_DefineSpace:
+        name_cache_prepare_define_space (ctx);
+        break;
+    default:
+        break;
+    }
+}
+
+static void
+name_cache_response_name (TSS2_SYS_NAME_CACHE *cache,
+                          const uint8_t *buffer,
+                          size_t size,
+                          size_t offset,
+                          unsigned int skip_count,
+                          TPM2_HANDLE handle)
+{
+    TPM2B_NAME name;
+    unsigned int i;
+
+    for (i = 0; i < skip_count; i++) {
+        if (name_cache_skip_tpm2b (buffer, size, &offset))
+            return;
+    }
+    if (Tss2_MU_TPM2B_NAME_Unmarshal (buffer, size, &offset, &name))
+        return;
+
+    name_cache_insert (cache, handle, &name, 0);
+}
+
+/* nvPublic (TPM2B_NV_PUBLIC) || nvName: keep TPMA_NV_WRITTEN with the name. */
+static void
+name_cache_nv_read_public (TSS2_SYS_NAME_CACHE *cache,
+                           const uint8_t *buffer,
+                           size_t size,
+                           size_t offset,
+                           TPM2_HANDLE handle)
+{
+    TPMI_ALG_HASH name_alg;
+    TPM2_HANDLE nv_index;
+    UINT16 public_size;
+    TPM2B_NAME name;
+    UINT32 flags;
+
+    if (Tss2_MU_UINT16_Unmarshal (buffer, size, &offset, &public_size))
+        return;
+    if (public_size > size - offset)
+        return;
+    if (nv_public_fields (&buffer[offset], public_size, &nv_index,
+                          &name_alg, &flags))
+        return;
+    offset += public_size;
+    if (Tss2_MU_TPM2B_NAME_Unmarshal (buffer, size, &offset, &name))
+        return;
+
+    name_cache_insert (cache, handle, &name, flags);
+}
+
+static void
+name_cache_evict_control (TSS2_SYS_NAME_CACHE *cache,
+                          TPM2_HANDLE object_handle,
+                          TPM2_HANDLE persistent_handle)
+{
+    NAME_CACHE_ENTRY *entry;
+    TPM2B_NAME name;
+
+    if ((object_handle >> TPM2_HR_SHIFT) == TPM2_HT_PERSISTENT) {
+        name_cache_remove (cache, object_handle);
+        return;
+    }
+
+    /* The persistent copy has the transient object's name. */
+    entry = name_cache_find (cache, object_handle);
+    if (entry == NULL) {
+        name_cache_remove (cache, persistent_handle);
+        return;
+    }
+    name = entry->name;
+    name_cache_insert (cache, persistent_handle, &name, 0);
+}
+
+void
+name_cache_response (_TSS2_SYS_CONTEXT_BLOB *ctx)
+{
+    TSS2_SYS_NAME_CACHE *cache = ctx->nameCache;
+    const uint8_t *buffer = ctx->cmdBuffer;
+    size_t size = ctx->rsp_header.responseSize;
+    size_t offset = sizeof (TPM20_Header_Out);
+    TPM2_HANDLE handle = 0;
+    NAME_CACHE_ENTRY *entry;
+
+    if (cache == NULL)
+        return;
+
+    if (ctx->numResponseHandles > 0 &&
+        Tss2_MU_UINT32_Unmarshal (buffer, size, &offset, &handle))
+        return;
+    if (ctx->rsp_header.tag == TPM2_ST_SESSIONS)
+        offset += sizeof (UINT32);
+
+    switch (ctx->commandCode) {
+    case TPM2_CC_Load:
+    case TPM2_CC_LoadExternal:
+        name_cache_response_name (cache, buffer, size, offset, 0, handle);
+        break;
+    case TPM2_CC_CreatePrimary:
+        /*
+         * outPublic, creationData, creationHash, then creationTicket
+         * (tag, hierarchy, digest) before the name.
+         */
+        if (name_cache_skip_tpm2b (buffer, size, &offset) ||
+            name_cache_skip_tpm2b (buffer, size, &offset) ||
+            name_cache_skip_tpm2b (buffer, size, &offset))
+            break;
+        offset += sizeof (TPM2_ST) + sizeof (TPMI_RH_HIERARCHY);
+        name_cache_response_name (cache, buffer, size, offset, 1, handle);
+        break;
+    case TPM2_CC_ReadPublic:
+        name_cache_response_name (cache, buffer, size, offset, 1,
+                                  ctx->nameCacheHandles[0]);
+        break;
+    case TPM2_CC_NV_ReadPublic:
+        name_cache_nv_read_public (cache, buffer, size, offset,
+                                   ctx->nameCacheHandles[0]);
+        break;
+    case TPM2_CC_NV_DefineSpace:
+        if (ctx->nameCacheName.size != 0)
+            name_cache_insert (cache, ctx->nameCacheHandles[0],
+                               &ctx->nameCacheName, 0);
+        break;
+    case TPM2_CC_ContextLoad:
+        name_cache_remove (cache, handle);
+        break;
+    case TPM2_CC_FlushContext:
+    case TPM2_CC_NV_UndefineSpace:
+    case TPM2_CC_NV_UndefineSpaceSpecial:
+        name_cache_remove (cache, ctx->nameCacheHandles[0]);
+        break;
+    case TPM2_CC_NV_Write:
+    case TPM2_CC_NV_Increment:
+    case TPM2_CC_NV_Extend:
+    case TPM2_CC_NV_SetBits:
+        /* The first write sets TPMA_NV_WRITTEN and so changes the name. */
+        entry = name_cache_find (cache, ctx->nameCacheHandles[0]);
+        if (entry != NULL && !(entry->flags & NAME_CACHE_NV_WRITTEN))
+            name_cache_delete (cache, entry);
+        break;
+    case TPM2_CC_NV_WriteLock:
+    case TPM2_CC_NV_ReadLock:
+        /* TPMA_NV_WRITELOCKED / TPMA_NV_READLOCKED are part of the name. */
+        name_cache_remove (cache, ctx->nameCacheHandles[0]);
+        break;
+    case TPM2_CC_NV_GlobalWriteLock:
+        /* Sets TPMA_NV_WRITELOCKED on every TPMA_NV_GLOBALLOCK index. */
+        name_cache_remove_nv (cache);
+        break;
+    case TPM2_CC_EvictControl:
+        name_cache_evict_control (cache, ctx->nameCacheHandles[0],
+                                  ctx->nameCacheHandles[1]);
+        break;
+    case TPM2_CC_Clear:
+        name_cache_clear (cache);
+        break;
+    default:
+        break;
+    }
+}
+
+TSS2_RC Tss2_Sys_GetPublicName(
+    const TPM2B_PUBLIC *publicArea,
+    TPM2B_NAME *name)
+{
+    uint8_t buffer[sizeof(TPMT_PUBLIC)];
+    size_t size = 0;
+    TSS2_RC rval;
+
+    if (!publicArea || !name)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    rval = Tss2_MU_TPMT_PUBLIC_Marshal(&publicArea->publicArea, buffer,
+                                       sizeof(buffer), &size);
+    if (rval)
+        return rval;
+
+    return name_compute(publicArea->publicArea.nameAlg, buffer, size, name);
+}
+
+TSS2_RC Tss2_Sys_GetNvPublicName(
+    const TPM2B_NV_PUBLIC *nvPublic,
+    TPM2B_NAME *name)
+{
+    uint8_t buffer[sizeof(TPMS_NV_PUBLIC)];
+    TPM2_HANDLE nv_index;
+    size_t size = 0;
+    UINT32 flags;
+    TSS2_RC rval;
+
+    if (!nvPublic || !name)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    rval = Tss2_MU_TPMS_NV_PUBLIC_Marshal(&nvPublic->nvPublic, buffer,
+                                          sizeof(buffer), &size);
+    if (rval)
+        return rval;
+
+    return name_compute_nv(buffer, size, &nv_index, &flags, name);
+}
+
+size_t Tss2_Sys_GetNameCacheSize(UINT32 maxEntries)
+{
+    UINT32 slots = NAME_CACHE_MIN_SLOTS;
+
+    if (maxEntries == 0)
+        maxEntries = NAME_CACHE_DEFAULT_ENTRIES;
+    if (maxEntries > UINT32_MAX / 4)
+        return 0;
+
+    while (slots < maxEntries * 2)
+        slots <<= 1;
+
+    return sizeof(TSS2_SYS_NAME_CACHE) + slots * sizeof(NAME_CACHE_ENTRY);
+}
+
+TSS2_RC Tss2_Sys_InitializeNameCache(
+    TSS2_SYS_NAME_CACHE *nameCache,
+    size_t cacheSize,
+    UINT32 maxEntries)
+{
+    size_t size;
+
+    if (!nameCache)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    if (maxEntries == 0)
+        maxEntries = NAME_CACHE_DEFAULT_ENTRIES;
+
+    size = Tss2_Sys_GetNameCacheSize(maxEntries);
+    if (size == 0)
+        return TSS2_SYS_RC_BAD_VALUE;
+    if (cacheSize < size)
+        return TSS2_SYS_RC_INSUFFICIENT_CONTEXT;
+
+    memset(nameCache, 0, size);
+    nameCache->slot_mask = (size - sizeof(TSS2_SYS_NAME_CACHE)) /
+                           sizeof(NAME_CACHE_ENTRY) - 1;
+    nameCache->max_entries = maxEntries;
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC Tss2_Sys_SetNameCache(
+    TSS2_SYS_CONTEXT *sysContext,
+    TSS2_SYS_NAME_CACHE *nameCache)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+
+    if (!ctx)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    ctx->nameCache = nameCache;
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC Tss2_Sys_NameCacheLookup(
+    TSS2_SYS_NAME_CACHE *nameCache,
+    TPM2_HANDLE handle,
+    TPM2B_NAME *name)
+{
+    NAME_CACHE_ENTRY *entry;
+    size_t offset = 0;
+
+    if (!nameCache || !name)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    if (!name_cache_is_entity(handle)) {
+        name->size = sizeof(TPM2_HANDLE);
+        return Tss2_MU_UINT32_Marshal(handle, name->name, sizeof(name->name),
+                                      &offset);
+    }
+
+    entry = name_cache_find(nameCache, handle);
+    if (!entry)
+        return TSS2_SYS_RC_NOT_FOUND;
+
+    name->size = entry->name.size;
+    memcpy(name->name, entry->name.name, entry->name.size);
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC Tss2_Sys_NameCacheAdd(
+    TSS2_SYS_NAME_CACHE *nameCache,
+    TPM2_HANDLE handle,
+    const TPM2B_NAME *name)
+{
+    if (!nameCache || !name)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    return name_cache_insert(nameCache, handle, name, 0);
+}
+
+TSS2_RC Tss2_Sys_NameCacheAddPublic(
+    TSS2_SYS_NAME_CACHE *nameCache,
+    TPM2_HANDLE handle,
+    const TPM2B_PUBLIC *publicArea)
+{
+    TPM2B_NAME name;
+    TSS2_RC rval;
+
+    if (!nameCache)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    rval = Tss2_Sys_GetPublicName(publicArea, &name);
+    if (rval)
+        return rval;
+
+    return name_cache_insert(nameCache, handle, &name, 0);
+}
+
+TSS2_RC Tss2_Sys_NameCacheAddNvPublic(
+    TSS2_SYS_NAME_CACHE *nameCache,
+    const TPM2B_NV_PUBLIC *nvPublic)
+{
+    uint8_t buffer[sizeof(TPMS_NV_PUBLIC)];
+    TPM2_HANDLE nv_index;
+    TPM2B_NAME name;
+    size_t size = 0;
+    UINT32 flags;
+    TSS2_RC rval;
+
+    if (!nameCache || !nvPublic)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    rval = Tss2_MU_TPMS_NV_PUBLIC_Marshal(&nvPublic->nvPublic, buffer,
+                                          sizeof(buffer), &size);
+    if (rval)
+        return rval;
+
+    rval = name_compute_nv(buffer, size, &nv_index, &flags, &name);
+    if (rval)
+        return rval;
+
+    return name_cache_insert(nameCache, nv_index, &name, flags);
+}
+
+TSS2_RC Tss2_Sys_NameCacheRemove(
+    TSS2_SYS_NAME_CACHE *nameCache,
+    TPM2_HANDLE handle)
+{
+    if (!nameCache)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    name_cache_remove(nameCache, handle);
+
+    return TSS2_RC_SUCCESS;
+}
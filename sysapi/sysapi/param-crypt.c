@@ -0,0 +1,185 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <string.h>
+
+#include "sapi/tpm20.h"
+#include "sysapi_util.h"
+#include "tss2_endian.h"
+#include "host-aes.h"
+#include "kdf.h"
+
+static TSS2_RC
+param_crypt (const TPMT_SYM_DEF *symmetric,
+             TPMI_ALG_HASH authHash,
+             const TPM2B_DIGEST *sessionKey,
+             const TPM2B_AUTH *authValue,
+             const TPM2B_NONCE *nonceNewer,
+             const TPM2B_NONCE *nonceOlder,
+             TPMI_YES_NO decrypt,
+             uint8_t *buffer,
+             size_t size)
+{
+    HOST_AES_CONTEXT aes;
+    uint8_t key[sizeof(TPMU_HA) * 2];
+    uint8_t keyIv[TPM2_MAX_SYM_KEY_BYTES + TPM2_MAX_SYM_BLOCK_SIZE];
+    size_t keySize = 0;
+    UINT16 symKeyBytes;
+    TSS2_RC rval;
+
+    if (!symmetric || (!buffer && size))
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    if (size == 0)
+        return TSS2_RC_SUCCESS;
+
+    if (sessionKey) {
+        if (sessionKey->size > sizeof(TPMU_HA))
+            return TSS2_SYS_RC_BAD_SIZE;
+        memcpy(key, sessionKey->buffer, sessionKey->size);
+        keySize = sessionKey->size;
+    }
+    if (authValue) {
+        if (authValue->size > sizeof(TPMU_HA))
+            return TSS2_SYS_RC_BAD_SIZE;
+        memcpy(&key[keySize], authValue->buffer, authValue->size);
+        keySize += authValue->size;
+    }
+
+    switch (symmetric->algorithm) {
+    case TPM2_ALG_XOR:
+        /* The mask is KDFa output XORed straight into the parameter. */
+        if (size * 8 > UINT16_MAX) {
+            rval = TSS2_SYS_RC_BAD_SIZE;
+            break;
+        }
+        rval = kdf_kdfa(authHash, key, keySize, "XOR",
+                        (const TPM2B *)nonceNewer, (const TPM2B *)nonceOlder,
+                        (UINT16)(size * 8), buffer, 1);
+        break;
+
+    case TPM2_ALG_AES:
+        if (symmetric->mode.aes != TPM2_ALG_CFB) {
+            rval = TSS2_SYS_RC_BAD_VALUE;
+            break;
+        }
+        symKeyBytes = symmetric->keyBits.aes / 8;
+        if (symKeyBytes > TPM2_MAX_SYM_KEY_BYTES) {
+            rval = TSS2_SYS_RC_BAD_VALUE;
+            break;
+        }
+        /* Key followed by the IV. */
+        rval = kdf_kdfa(authHash, key, keySize, "CFB",
+                        (const TPM2B *)nonceNewer, (const TPM2B *)nonceOlder,
+                        symmetric->keyBits.aes + HOST_AES_BLOCK_SIZE * 8,
+                        keyIv, 0);
+        if (rval)
+            break;
+        rval = host_aes_init(&aes, keyIv, symmetric->keyBits.aes);
+        if (rval)
+            break;
+        if (decrypt == YES)
+            host_aes_cfb_decrypt(&aes, &keyIv[symKeyBytes], buffer, size);
+        else
+            host_aes_cfb_encrypt(&aes, &keyIv[symKeyBytes], buffer, size);
+        host_aes_clear(&aes);
+        break;
+
+    default:
+        rval = TSS2_SYS_RC_BAD_VALUE;
+        break;
+    }
+
+    memset(key, 0, sizeof(key));
+    memset(keyIv, 0, sizeof(keyIv));
+    return rval;
+}
+
+TSS2_RC Tss2_Sys_ParamCrypt(
+    const TPMT_SYM_DEF *symmetric,
+    TPMI_ALG_HASH authHash,
+    const TPM2B_DIGEST *sessionKey,
+    const TPM2B_AUTH *authValue,
+    const TPM2B_NONCE *nonceNewer,
+    const TPM2B_NONCE *nonceOlder,
+    TPMI_YES_NO decrypt,
+    uint8_t *buffer,
+    size_t size)
+{
+    return param_crypt(symmetric, authHash, sessionKey, authValue,
+                       nonceNewer, nonceOlder, decrypt, buffer, size);
+}
+
+TSS2_RC Tss2_Sys_EncryptCommandParam(
+    TSS2_SYS_CONTEXT *sysContext,
+    const TPMT_SYM_DEF *symmetric,
+    TPMI_ALG_HASH authHash,
+    const TPM2B_DIGEST *sessionKey,
+    const TPM2B_AUTH *authValue,
+    const TPM2B_NONCE *nonceCaller,
+    const TPM2B_NONCE *nonceTPM)
+{
+    size_t paramSize;
+    const uint8_t *paramBuffer;
+    TSS2_RC rval;
+
+    rval = Tss2_Sys_GetDecryptParam(sysContext, &paramSize, &paramBuffer);
+    if (rval)
+        return rval;
+
+    /* The parameter is already in the command buffer; encrypt it there. */
+    return param_crypt(symmetric, authHash, sessionKey, authValue,
+                       nonceCaller, nonceTPM, NO, (uint8_t *)paramBuffer,
+                       paramSize);
+}
+
+TSS2_RC Tss2_Sys_DecryptResponseParam(
+    TSS2_SYS_CONTEXT *sysContext,
+    const TPMT_SYM_DEF *symmetric,
+    TPMI_ALG_HASH authHash,
+    const TPM2B_DIGEST *sessionKey,
+    const TPM2B_AUTH *authValue,
+    const TPM2B_NONCE *nonceTPM,
+    const TPM2B_NONCE *nonceCaller)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+    size_t paramSize;
+    const uint8_t *paramBuffer;
+    TSS2_RC rval;
+
+    rval = Tss2_Sys_GetEncryptParam(sysContext, &paramSize, &paramBuffer);
+    if (rval)
+        return rval;
+
+    if (paramBuffer + paramSize > ctx->cmdBuffer + ctx->maxCmdSize)
+        return TSS2_SYS_RC_MALFORMED_RESPONSE;
+
+    return param_crypt(symmetric, authHash, sessionKey, authValue,
+                       nonceTPM, nonceCaller, YES, (uint8_t *)paramBuffer,
+                       paramSize);
+}
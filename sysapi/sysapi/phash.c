@@ -0,0 +1,152 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include "sapi/tpm20.h"
+#include "sysapi_util.h"
+#include "host-crypto.h"
+#include "tss2_endian.h"
+
+/*
+ * cpHash and rpHash are hashed straight out of the command / response
+ * buffer; nothing is copied, so the parameter area may be any size the
+ * context buffer can hold.
+ */
+static TSS2_RC
+phash_update_name (TSS2_SYS_HASH_CONTEXT *ctx,
+                   const TPM2B_NAME *name)
+{
+    if (name == NULL || name->size == 0)
+        return TSS2_RC_SUCCESS;
+
+    if (name->size > sizeof (name->name))
+        return TSS2_SYS_RC_BAD_SIZE;
+
+    return host_hash_update (ctx, name->name, name->size);
+}
+
+static TSS2_RC
+phash_finish (TSS2_SYS_HASH_CONTEXT *ctx,
+              TPM2B_DIGEST *digest)
+{
+    size_t digest_size = sizeof (digest->buffer);
+    TSS2_RC rval;
+
+    rval = host_hash_finish (ctx, digest->buffer, &digest_size);
+    if (rval != TSS2_RC_SUCCESS)
+        return rval;
+    digest->size = digest_size;
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC Tss2_Sys_GetCpHash(
+    TSS2_SYS_CONTEXT *sysContext,
+    TPMI_ALG_HASH hashAlg,
+    const TPM2B_NAME *name1,
+    const TPM2B_NAME *name2,
+    const TPM2B_NAME *name3,
+    TPM2B_DIGEST *cpHash)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+    const TPM2B_NAME *names[] = { name1, name2, name3 };
+    TSS2_SYS_HASH_CONTEXT hash_ctx;
+    UINT32 command_code;
+    unsigned int i;
+    TSS2_RC rval;
+
+    if (!ctx || !cpHash)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    if (ctx->previousStage != CMD_STAGE_PREPARE)
+        return TSS2_SYS_RC_BAD_SEQUENCE;
+
+    rval = host_hash_start(&hash_ctx, hashAlg);
+    if (rval)
+        return rval;
+
+    command_code = HOST_TO_BE_32(ctx->commandCode);
+    rval = host_hash_update(&hash_ctx, (uint8_t *)&command_code,
+                            sizeof(command_code));
+    if (rval)
+        goto err;
+
+    for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        rval = phash_update_name(&hash_ctx, names[i]);
+        if (rval)
+            goto err;
+    }
+
+    rval = host_hash_update(&hash_ctx, ctx->cpBuffer, ctx->cpBufferUsedSize);
+    if (rval)
+        goto err;
+
+    return phash_finish(&hash_ctx, cpHash);
+
+err:
+    host_hash_abort(&hash_ctx);
+    return rval;
+}
+
+TSS2_RC Tss2_Sys_GetRpHash(
+    TSS2_SYS_CONTEXT *sysContext,
+    TPMI_ALG_HASH hashAlg,
+    TPM2B_DIGEST *rpHash)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+    TSS2_SYS_HASH_CONTEXT hash_ctx;
+    UINT32 header[2];
+    TSS2_RC rval;
+
+    if (!ctx || !rpHash)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    /* Only successful responses carry an rpHash-covered parameter area. */
+    if (ctx->previousStage != CMD_STAGE_RECEIVE_RESPONSE ||
+        ctx->rval != TSS2_RC_SUCCESS)
+        return TSS2_SYS_RC_BAD_SEQUENCE;
+
+    rval = host_hash_start(&hash_ctx, hashAlg);
+    if (rval)
+        return rval;
+
+    header[0] = HOST_TO_BE_32(TPM2_RC_SUCCESS);
+    header[1] = HOST_TO_BE_32(ctx->commandCode);
+    rval = host_hash_update(&hash_ctx, (uint8_t *)header, sizeof(header));
+    if (rval)
+        goto err;
+
+    rval = host_hash_update(&hash_ctx, ctx->rpBuffer, ctx->rpBufferUsedSize);
+    if (rval)
+        goto err;
+
+    return phash_finish(&hash_ctx, rpHash);
+
+err:
+    host_hash_abort(&hash_ctx);
+    return rval;
+}
@@ -0,0 +1,160 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <string.h>
+
+#include "sapi/tpm20.h"
+#include "sysapi_util.h"
+#include "host-crypto.h"
+
+static TSS2_RC
+session_hmac_update (HOST_HMAC_CONTEXT *ctx,
+                     const TPM2B *buffer)
+{
+    if (buffer == NULL || buffer->size == 0)
+        return TSS2_RC_SUCCESS;
+
+    return host_hmac_update (ctx, buffer->buffer, buffer->size);
+}
+
+static TSS2_RC
+session_hmac_compute (TPMI_ALG_HASH authHash,
+                      const TPM2B_DIGEST *pHash,
+                      const TPM2B_DIGEST *sessionKey,
+                      const TPM2B_AUTH *authValue,
+                      const TPM2B_NONCE *nonceNewer,
+                      const TPM2B_NONCE *nonceOlder,
+                      const TPM2B_NONCE *nonceDecrypt,
+                      const TPM2B_NONCE *nonceEncrypt,
+                      TPMA_SESSION sessionAttributes,
+                      TPM2B_DIGEST *hmac)
+{
+    HOST_HMAC_CONTEXT ctx;
+    const TPM2B *message[] = {
+        (const TPM2B *)pHash,
+        (const TPM2B *)nonceNewer,
+        (const TPM2B *)nonceOlder,
+        (const TPM2B *)nonceDecrypt,
+        (const TPM2B *)nonceEncrypt,
+    };
+    uint8_t key[sizeof (TPMU_HA) * 2];
+    size_t key_size = 0;
+    size_t hmac_size;
+    unsigned int i;
+    TSS2_RC rval;
+
+    if (sessionKey != NULL) {
+        if (sessionKey->size > sizeof (TPMU_HA))
+            return TSS2_SYS_RC_BAD_SIZE;
+        memcpy (key, sessionKey->buffer, sessionKey->size);
+        key_size = sessionKey->size;
+    }
+    if (authValue != NULL) {
+        if (authValue->size > sizeof (TPMU_HA))
+            return TSS2_SYS_RC_BAD_SIZE;
+        memcpy (&key[key_size], authValue->buffer, authValue->size);
+        key_size += authValue->size;
+    }
+
+    rval = host_hmac_start (&ctx, authHash, key, key_size);
+    memset (key, 0, sizeof (key));
+    if (rval != TSS2_RC_SUCCESS)
+        return rval;
+
+    for (i = 0; i < sizeof (message) / sizeof (message[0]); i++) {
+        rval = session_hmac_update (&ctx, message[i]);
+        if (rval != TSS2_RC_SUCCESS)
+            goto err;
+    }
+    rval = host_hmac_update (&ctx, &sessionAttributes.val, 1);
+    if (rval != TSS2_RC_SUCCESS)
+        goto err;
+
+    hmac_size = sizeof (hmac->buffer);
+    rval = host_hmac_finish (&ctx, hmac->buffer, &hmac_size);
+    if (rval != TSS2_RC_SUCCESS)
+        return rval;
+    hmac->size = hmac_size;
+
+    return TSS2_RC_SUCCESS;
+
+err:
+    host_hmac_abort (&ctx);
+    return rval;
+}
+
+TSS2_RC Tss2_Sys_CalcSessionHmac(
+    TPMI_ALG_HASH authHash,
+    const TPM2B_DIGEST *pHash,
+    const TPM2B_DIGEST *sessionKey,
+    const TPM2B_AUTH *authValue,
+    const TPM2B_NONCE *nonceNewer,
+    const TPM2B_NONCE *nonceOlder,
+    const TPM2B_NONCE *nonceDecrypt,
+    const TPM2B_NONCE *nonceEncrypt,
+    TPMA_SESSION sessionAttributes,
+    TPM2B_DIGEST *hmac)
+{
+    if (!hmac)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    return session_hmac_compute(authHash, pHash, sessionKey, authValue,
+                                nonceNewer, nonceOlder, nonceDecrypt,
+                                nonceEncrypt, sessionAttributes, hmac);
+}
+
+TSS2_RC Tss2_Sys_CheckSessionHmac(
+    TPMI_ALG_HASH authHash,
+    const TPM2B_DIGEST *pHash,
+    const TPM2B_DIGEST *sessionKey,
+    const TPM2B_AUTH *authValue,
+    const TPM2B_NONCE *nonceNewer,
+    const TPM2B_NONCE *nonceOlder,
+    const TPM2B_NONCE *nonceDecrypt,
+    const TPM2B_NONCE *nonceEncrypt,
+    TPMA_SESSION sessionAttributes,
+    const TPM2B_DIGEST *hmac)
+{
+    TPM2B_DIGEST expected;
+    TSS2_RC rval;
+
+    if (!hmac)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    rval = session_hmac_compute(authHash, pHash, sessionKey, authValue,
+                                nonceNewer, nonceOlder, nonceDecrypt,
+                                nonceEncrypt, sessionAttributes, &expected);
+    if (rval)
+        return rval;
+
+    if (hmac->size != expected.size ||
+        !host_is_equal(hmac->buffer, expected.buffer, expected.size))
+        return TSS2_SYS_RC_RSP_AUTH_FAILED;
+
+    return TSS2_RC_SUCCESS;
+}
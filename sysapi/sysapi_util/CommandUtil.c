@@ -28,6 +28,8 @@
 #include "sapi/tpm20.h"
 #include "sysapi_util.h"
 #include "tss2_endian.h"
+#include "name-cache.h"
+#include "common/command-table.h"
 
 void InitSysContextFields(_TSS2_SYS_CONTEXT_BLOB *ctx)
 {
@@ -42,6 +44,7 @@ void InitSysContextFields(_TSS2_SYS_CONTEXT_BLOB *ctx)
     ctx->completeCalledFromOneCall = 0;
     ctx->nextData = 0;
     ctx->rpBufferUsedSize = 0;
+    ctx->authAreaSize = 0;
     ctx->rval = TSS2_RC_SUCCESS;
 }
 
@@ -83,7 +86,8 @@ TSS2_RC CommonPreparePrologue(
     _TSS2_SYS_CONTEXT_BLOB *ctx,
     TPM2_CC commandCode)
 {
-	int numCommandHandles;
+    const TPM2_COMMAND_INFO *info;
+    int numCommandHandles = 0;
     TSS2_RC rval;
 
     if (!ctx)
@@ -102,11 +106,19 @@ TSS2_RC CommonPreparePrologue(
         return rval;
 
     ctx->commandCode = commandCode;
-    ctx->numResponseHandles = GetNumResponseHandles(commandCode);
-    ctx->rspParamsSize = (UINT32 *)(ctx->cmdBuffer + sizeof(TPM20_Header_Out) +
-                         (GetNumResponseHandles(commandCode) * sizeof(UINT32)));
+    ctx->numResponseHandles = 0;
+
+    info = GetCommandInfo(commandCode);
+    if (info) {
+        numCommandHandles = info->numCommandHandles;
+        ctx->numResponseHandles = info->numResponseHandles;
+        ctx->decryptAllowed = info->decryptAllowed;
+        ctx->encryptAllowed = info->encryptAllowed;
+        ctx->authAllowed = info->authAllowed;
+    }
 
-    numCommandHandles = GetNumCommandHandles(commandCode);
+    ctx->rspParamsSize = (UINT32 *)(ctx->cmdBuffer + sizeof(TPM20_Header_Out) +
+                         (ctx->numResponseHandles * sizeof(UINT32)));
     ctx->cpBuffer = ctx->cmdBuffer + ctx->nextData +
                                      (numCommandHandles * sizeof(UINT32));
     return rval;
@@ -117,6 +129,7 @@ TSS2_RC CommonPrepareEpilogue(_TSS2_SYS_CONTEXT_BLOB *ctx)
     ctx->cpBufferUsedSize = ctx->cmdBuffer + ctx->nextData - ctx->cpBuffer;
     req_header_from_cxt(ctx)->commandSize = HOST_TO_BE_32(ctx->nextData);
     ctx->previousStage = CMD_STAGE_PREPARE;
+    name_cache_prepare(ctx);
 
     return TSS2_RC_SUCCESS;
 }
@@ -172,6 +185,43 @@ TSS2_RC CommonComplete(_TSS2_SYS_CONTEXT_BLOB *ctx)
     return rval;
 }
 
+/*
+ * Point 'view' (if not NULL) at the TPM2B at ctx->nextData and step over
+ * it, like the TPM2B unmarshal functions do but without copying it out.
+ * The TPM2B must lie within the response parameters and hold at most
+ * maxSize bytes, the size of the buffer in the matching TPM2B type.
+ */
+TSS2_RC CompleteTpm2bView(
+    _TSS2_SYS_CONTEXT_BLOB *ctx,
+    size_t maxSize,
+    TSS2_SYS_TPM2B_VIEW *view)
+{
+    size_t end = ctx->rpBuffer - ctx->cmdBuffer + ctx->rpBufferUsedSize;
+    UINT16 size;
+    TSS2_RC rval;
+
+    if (end > BE_TO_HOST_32(resp_header_from_cxt(ctx)->responseSize))
+        return TSS2_SYS_RC_MALFORMED_RESPONSE;
+
+    rval = Tss2_MU_UINT16_Unmarshal(ctx->cmdBuffer, end, &ctx->nextData,
+                                    &size);
+    if (rval)
+        return rval;
+
+    if (size > end - ctx->nextData)
+        return TSS2_TYPES_RC_INSUFFICIENT_BUFFER;
+    if (size > maxSize)
+        return TSS2_SYS_RC_MALFORMED_RESPONSE;
+
+    if (view) {
+        view->ptr = ctx->cmdBuffer + ctx->nextData;
+        view->len = size;
+    }
+    ctx->nextData += size;
+
+    return TSS2_RC_SUCCESS;
+}
+
 TSS2_RC CommonOneCall(
     _TSS2_SYS_CONTEXT_BLOB *ctx,
     TSS2_SYS_CMD_AUTHS const *cmdAuthsArray,
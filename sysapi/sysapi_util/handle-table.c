@@ -0,0 +1,270 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sapi/tpm20.h"
+#include "handle-table.h"
+
+typedef struct {
+    TPM2_HANDLE handle;
+    UINT32 next_free;
+} HANDLE_TABLE_ENTRY;
+
+/* Values start on this boundary within each pool entry. */
+#define HANDLE_TABLE_ALIGN 16
+#define HANDLE_TABLE_VALUE_OFFSET HANDLE_TABLE_ALIGN
+
+static HANDLE_TABLE_ENTRY *
+handle_table_entry (const HANDLE_TABLE *table,
+                    UINT32 index)
+{
+    return (HANDLE_TABLE_ENTRY *)(table->pool + (size_t)index * table->entry_size);
+}
+
+static void *
+handle_table_value (HANDLE_TABLE_ENTRY *entry)
+{
+    return (uint8_t *)entry + HANDLE_TABLE_VALUE_OFFSET;
+}
+
+/* Index slot holding handle, or the empty slot ending its probe sequence. */
+static UINT32
+handle_table_probe (const HANDLE_TABLE *table,
+                    TPM2_HANDLE handle)
+{
+    UINT32 i = handle_hash (handle) & table->slot_mask;
+
+    while (table->slots[i] != 0 &&
+           handle_table_entry (table, table->slots[i] - 1)->handle != handle)
+        i = (i + 1) & table->slot_mask;
+
+    return i;
+}
+
+TSS2_RC
+handle_table_init (HANDLE_TABLE *table,
+                   UINT32 capacity,
+                   size_t value_size)
+{
+    UINT32 slot_count = 8;
+    UINT32 i;
+
+    if (table == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+    if (capacity == 0 || capacity > UINT32_MAX / 4)
+        return TSS2_SYS_RC_BAD_VALUE;
+
+    while (slot_count < capacity * 2)
+        slot_count <<= 1;
+
+    memset (table, 0, sizeof (*table));
+    table->value_size = value_size;
+    table->entry_size = (HANDLE_TABLE_VALUE_OFFSET + value_size +
+                         HANDLE_TABLE_ALIGN - 1) & ~(size_t)(HANDLE_TABLE_ALIGN - 1);
+    table->pool = calloc (capacity, table->entry_size);
+    table->slots = calloc (slot_count, sizeof (UINT32));
+    if (table->pool == NULL || table->slots == NULL) {
+        free (table->pool);
+        free (table->slots);
+        return TSS2_SYS_RC_GENERAL_FAILURE;
+    }
+    if (pthread_rwlock_init (&table->lock, NULL) != 0) {
+        free (table->pool);
+        free (table->slots);
+        return TSS2_SYS_RC_GENERAL_FAILURE;
+    }
+
+    table->slot_mask = slot_count - 1;
+    table->capacity = capacity;
+    for (i = 0; i < capacity; i++)
+        handle_table_entry (table, i)->next_free = i + 1;
+    table->free_head = 0;
+
+    return TSS2_RC_SUCCESS;
+}
+
+void
+handle_table_finalize (HANDLE_TABLE *table)
+{
+    if (table == NULL || table->pool == NULL)
+        return;
+
+    pthread_rwlock_destroy (&table->lock);
+    free (table->pool);
+    free (table->slots);
+    memset (table, 0, sizeof (*table));
+}
+
+TSS2_RC
+handle_table_insert (HANDLE_TABLE *table,
+                     TPM2_HANDLE handle,
+                     const void *value,
+                     void **stored)
+{
+    HANDLE_TABLE_ENTRY *entry;
+    UINT32 slot, index;
+
+    if (table == NULL || table->pool == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    pthread_rwlock_wrlock (&table->lock);
+
+    slot = handle_table_probe (table, handle);
+    if (table->slots[slot] != 0) {
+        entry = handle_table_entry (table, table->slots[slot] - 1);
+    } else {
+        if (table->free_head == table->capacity) {
+            pthread_rwlock_unlock (&table->lock);
+            return TSS2_SYS_RC_INSUFFICIENT_CONTEXT;
+        }
+        index = table->free_head;
+        entry = handle_table_entry (table, index);
+        table->free_head = entry->next_free;
+        entry->handle = handle;
+        table->slots[slot] = index + 1;
+        table->count++;
+    }
+
+    if (value != NULL)
+        memcpy (handle_table_value (entry), value, table->value_size);
+    else
+        memset (handle_table_value (entry), 0, table->value_size);
+    if (stored != NULL)
+        *stored = handle_table_value (entry);
+
+    pthread_rwlock_unlock (&table->lock);
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+handle_table_lookup (HANDLE_TABLE *table,
+                     TPM2_HANDLE handle,
+                     void *value)
+{
+    TSS2_RC rval = TSS2_SYS_RC_NOT_FOUND;
+    UINT32 slot;
+
+    if (table == NULL || table->pool == NULL || value == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    pthread_rwlock_rdlock (&table->lock);
+
+    slot = handle_table_probe (table, handle);
+    if (table->slots[slot] != 0) {
+        memcpy (value,
+                handle_table_value (handle_table_entry (table, table->slots[slot] - 1)),
+                table->value_size);
+        rval = TSS2_RC_SUCCESS;
+    }
+
+    pthread_rwlock_unlock (&table->lock);
+
+    return rval;
+}
+
+void *
+handle_table_get (HANDLE_TABLE *table,
+                  TPM2_HANDLE handle)
+{
+    void *value = NULL;
+    UINT32 slot;
+
+    if (table == NULL || table->pool == NULL)
+        return NULL;
+
+    pthread_rwlock_rdlock (&table->lock);
+
+    slot = handle_table_probe (table, handle);
+    if (table->slots[slot] != 0)
+        value = handle_table_value (handle_table_entry (table, table->slots[slot] - 1));
+
+    pthread_rwlock_unlock (&table->lock);
+
+    return value;
+}
+
+TSS2_RC
+handle_table_remove (HANDLE_TABLE *table,
+                     TPM2_HANDLE handle)
+{
+    HANDLE_TABLE_ENTRY *entry;
+    UINT32 hole, i, home;
+
+    if (table == NULL || table->pool == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    pthread_rwlock_wrlock (&table->lock);
+
+    hole = handle_table_probe (table, handle);
+    if (table->slots[hole] == 0) {
+        pthread_rwlock_unlock (&table->lock);
+        return TSS2_SYS_RC_NOT_FOUND;
+    }
+
+    entry = handle_table_entry (table, table->slots[hole] - 1);
+    entry->next_free = table->free_head;
+    table->free_head = table->slots[hole] - 1;
+    table->count--;
+
+    /* Backward shift the rest of the cluster over the hole. */
+    i = hole;
+    for (;;) {
+        i = (i + 1) & table->slot_mask;
+        if (table->slots[i] == 0)
+            break;
+        home = handle_hash (handle_table_entry (table, table->slots[i] - 1)->handle) &
+               table->slot_mask;
+        if (((i - home) & table->slot_mask) >= ((i - hole) & table->slot_mask)) {
+            table->slots[hole] = table->slots[i];
+            hole = i;
+        }
+    }
+    table->slots[hole] = 0;
+
+    pthread_rwlock_unlock (&table->lock);
+
+    return TSS2_RC_SUCCESS;
+}
+
+UINT32
+handle_table_count (HANDLE_TABLE *table)
+{
+    UINT32 count;
+
+    if (table == NULL || table->pool == NULL)
+        return 0;
+
+    pthread_rwlock_rdlock (&table->lock);
+    count = table->count;
+    pthread_rwlock_unlock (&table->lock);
+
+    return count;
+}
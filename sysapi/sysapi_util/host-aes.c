@@ -0,0 +1,331 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <string.h>
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define HOST_AES_X86 1
+#endif
+
+#include "sapi/tpm20.h"
+#include "host-aes.h"
+
+static const uint8_t aes_sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
+    0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+    0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
+    0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
+    0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+    0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
+    0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
+    0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
+    0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
+    0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
+    0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
+    0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+    0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
+    0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
+    0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+static uint8_t
+aes_xtime (uint8_t value)
+{
+    return (uint8_t)((value << 1) ^ ((value & 0x80) ? 0x1b : 0x00));
+}
+
+static void
+aes_encrypt_block_portable (const HOST_AES_CONTEXT *ctx,
+                            const uint8_t *in,
+                            uint8_t *out)
+{
+    const uint8_t *round_key = ctx->round_keys;
+    uint8_t state[HOST_AES_BLOCK_SIZE];
+    uint8_t tmp[HOST_AES_BLOCK_SIZE];
+    uint8_t all, a0, a1, a2, a3;
+    unsigned int round, column, i;
+
+    for (i = 0; i < HOST_AES_BLOCK_SIZE; i++)
+        state[i] = in[i] ^ round_key[i];
+
+    for (round = 1; round <= ctx->rounds; round++) {
+        /* SubBytes and ShiftRows; the state is stored column major. */
+        for (i = 0; i < HOST_AES_BLOCK_SIZE; i++)
+            tmp[i] = aes_sbox[state[(i + 4 * (i % 4)) % 16]];
+
+        /* MixColumns, skipped in the final round. */
+        if (round != ctx->rounds) {
+            for (column = 0; column < 4; column++) {
+                a0 = tmp[column * 4];
+                a1 = tmp[column * 4 + 1];
+                a2 = tmp[column * 4 + 2];
+                a3 = tmp[column * 4 + 3];
+                all = a0 ^ a1 ^ a2 ^ a3;
+                tmp[column * 4] ^= all ^ aes_xtime (a0 ^ a1);
+                tmp[column * 4 + 1] ^= all ^ aes_xtime (a1 ^ a2);
+                tmp[column * 4 + 2] ^= all ^ aes_xtime (a2 ^ a3);
+                tmp[column * 4 + 3] ^= all ^ aes_xtime (a3 ^ a0);
+            }
+        }
+
+        round_key += HOST_AES_BLOCK_SIZE;
+        for (i = 0; i < HOST_AES_BLOCK_SIZE; i++)
+            state[i] = tmp[i] ^ round_key[i];
+    }
+
+    memcpy (out, state, HOST_AES_BLOCK_SIZE);
+    memset (state, 0, sizeof (state));
+    memset (tmp, 0, sizeof (tmp));
+}
+
+#ifdef HOST_AES_X86
+/*
+ * The round keys from the FIPS 197 expansion are in the byte order the
+ * AESENC instructions expect, so both paths share the key schedule.
+ */
+__attribute__ ((target ("aes,sse2")))
+static void
+aes_cfb_aesni (const HOST_AES_CONTEXT *ctx,
+               uint8_t *iv,
+               uint8_t *buffer,
+               size_t size,
+               int decrypt)
+{
+    __m128i keys[HOST_AES_MAX_ROUNDS + 1];
+    __m128i feedback, data;
+    unsigned int i;
+
+    for (i = 0; i <= ctx->rounds; i++)
+        keys[i] = _mm_loadu_si128 ((const __m128i *)&ctx->round_keys[i * 16]);
+    feedback = _mm_loadu_si128 ((const __m128i *)iv);
+
+    for (; size >= HOST_AES_BLOCK_SIZE; size -= HOST_AES_BLOCK_SIZE,
+                                        buffer += HOST_AES_BLOCK_SIZE) {
+        feedback = _mm_xor_si128 (feedback, keys[0]);
+        for (i = 1; i < ctx->rounds; i++)
+            feedback = _mm_aesenc_si128 (feedback, keys[i]);
+        feedback = _mm_aesenclast_si128 (feedback, keys[ctx->rounds]);
+
+        data = _mm_loadu_si128 ((const __m128i *)buffer);
+        _mm_storeu_si128 ((__m128i *)buffer, _mm_xor_si128 (data, feedback));
+        /* The next IV is always the ciphertext block. */
+        feedback = decrypt ? data : _mm_xor_si128 (data, feedback);
+    }
+    _mm_storeu_si128 ((__m128i *)iv, feedback);
+
+    for (i = 0; i <= ctx->rounds; i++)
+        keys[i] = _mm_setzero_si128 ();
+}
+
+static int
+aes_detect_aesni (void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx))
+        return 0;
+    return (ecx & (1 << 25)) != 0;
+}
+#else
+static int
+aes_detect_aesni (void)
+{
+    return 0;
+}
+#endif
+
+/* -1: not probed yet, 0: portable code, 1: AES-NI */
+static int aes_accel = -1;
+
+int
+host_aes_accel_available (void)
+{
+    return aes_detect_aesni ();
+}
+
+int
+host_aes_set_accel (int enable)
+{
+    int previous = __atomic_load_n (&aes_accel, __ATOMIC_RELAXED);
+
+    if (previous < 0)
+        previous = aes_detect_aesni ();
+    __atomic_store_n (&aes_accel, enable ? aes_detect_aesni () : 0,
+                      __ATOMIC_RELAXED);
+    return previous;
+}
+
+static int
+aes_use_accel (void)
+{
+    int accel = __atomic_load_n (&aes_accel, __ATOMIC_RELAXED);
+
+    if (accel < 0) {
+        accel = aes_detect_aesni ();
+        __atomic_store_n (&aes_accel, accel, __ATOMIC_RELAXED);
+    }
+    return accel;
+}
+
+TSS2_RC
+host_aes_init (HOST_AES_CONTEXT *ctx,
+               const uint8_t *key,
+               uint16_t key_bits)
+{
+    unsigned int key_words, total_words, i;
+    uint8_t *words;
+    uint8_t tmp[4], swap, rcon = 0x01;
+
+    if (ctx == NULL || key == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    switch (key_bits) {
+    case 128:
+    case 192:
+    case 256:
+        break;
+    default:
+        return TSS2_SYS_RC_BAD_VALUE;
+    }
+
+    key_words = key_bits / 32;
+    ctx->rounds = key_words + 6;
+    total_words = 4 * (ctx->rounds + 1);
+    words = ctx->round_keys;
+    memcpy (words, key, key_words * 4);
+
+    for (i = key_words; i < total_words; i++) {
+        memcpy (tmp, &words[(i - 1) * 4], 4);
+        if (i % key_words == 0) {
+            swap = tmp[0];
+            tmp[0] = aes_sbox[tmp[1]] ^ rcon;
+            tmp[1] = aes_sbox[tmp[2]];
+            tmp[2] = aes_sbox[tmp[3]];
+            tmp[3] = aes_sbox[swap];
+            rcon = aes_xtime (rcon);
+        } else if (key_words > 6 && i % key_words == 4) {
+            tmp[0] = aes_sbox[tmp[0]];
+            tmp[1] = aes_sbox[tmp[1]];
+            tmp[2] = aes_sbox[tmp[2]];
+            tmp[3] = aes_sbox[tmp[3]];
+        }
+        words[i * 4] = words[(i - key_words) * 4] ^ tmp[0];
+        words[i * 4 + 1] = words[(i - key_words) * 4 + 1] ^ tmp[1];
+        words[i * 4 + 2] = words[(i - key_words) * 4 + 2] ^ tmp[2];
+        words[i * 4 + 3] = words[(i - key_words) * 4 + 3] ^ tmp[3];
+    }
+    memset (tmp, 0, sizeof (tmp));
+
+    return TSS2_RC_SUCCESS;
+}
+
+void
+host_aes_encrypt_block (const HOST_AES_CONTEXT *ctx,
+                        const uint8_t *in,
+                        uint8_t *out)
+{
+    aes_encrypt_block_portable (ctx, in, out);
+}
+
+static void
+aes_cfb (const HOST_AES_CONTEXT *ctx,
+         uint8_t *iv,
+         uint8_t *buffer,
+         size_t size,
+         int decrypt)
+{
+    uint8_t keystream[HOST_AES_BLOCK_SIZE];
+    size_t count, i;
+
+#ifdef HOST_AES_X86
+    if (aes_use_accel () && size >= HOST_AES_BLOCK_SIZE) {
+        count = size - size % HOST_AES_BLOCK_SIZE;
+        aes_cfb_aesni (ctx, iv, buffer, count, decrypt);
+        buffer += count;
+        size -= count;
+    }
+#endif
+
+    for (; size > 0; size -= count, buffer += count) {
+        aes_encrypt_block_portable (ctx, iv, keystream);
+        count = size < HOST_AES_BLOCK_SIZE ? size : HOST_AES_BLOCK_SIZE;
+        for (i = 0; i < count; i++) {
+            if (decrypt) {
+                iv[i] = buffer[i];
+                buffer[i] ^= keystream[i];
+            } else {
+                buffer[i] ^= keystream[i];
+                iv[i] = buffer[i];
+            }
+        }
+    }
+    memset (keystream, 0, sizeof (keystream));
+}
+
+void
+host_aes_cfb_encrypt (const HOST_AES_CONTEXT *ctx,
+                      uint8_t *iv,
+                      uint8_t *buffer,
+                      size_t size)
+{
+    aes_cfb (ctx, iv, buffer, size, 0);
+}
+
+void
+host_aes_cfb_decrypt (const HOST_AES_CONTEXT *ctx,
+                      uint8_t *iv,
+                      uint8_t *buffer,
+                      size_t size)
+{
+    aes_cfb (ctx, iv, buffer, size, 1);
+}
+
+void
+host_aes_clear (HOST_AES_CONTEXT *ctx)
+{
+    memset (ctx, 0, sizeof (*ctx));
+}
@@ -0,0 +1,316 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <string.h>
+
+#include "sapi/tpm20.h"
+#include "host-crypto.h"
+#include "host-sha.h"
+
+static const TSS2_SYS_CRYPTO_CALLBACKS host_crypto_builtin = {
+    .hashStart = host_sha_start,
+    .hashUpdate = host_sha_update,
+    .hashFinish = host_sha_finish,
+    .hashCopy = host_sha_copy,
+    .hashAbort = NULL,
+    .userData = NULL,
+};
+
+static TSS2_SYS_CRYPTO_CALLBACKS host_crypto_callbacks = {
+    .hashStart = host_sha_start,
+    .hashUpdate = host_sha_update,
+    .hashFinish = host_sha_finish,
+    .hashCopy = host_sha_copy,
+    .hashAbort = NULL,
+    .userData = NULL,
+};
+
+TSS2_RC
+Tss2_Sys_SetCryptoCallbacks (const TSS2_SYS_CRYPTO_CALLBACKS *callbacks)
+{
+    if (callbacks == NULL) {
+        host_crypto_callbacks = host_crypto_builtin;
+        return TSS2_RC_SUCCESS;
+    }
+    if (callbacks->hashStart == NULL || callbacks->hashUpdate == NULL ||
+        callbacks->hashFinish == NULL)
+        return TSS2_SYS_RC_BAD_VALUE;
+
+    host_crypto_callbacks = *callbacks;
+    return TSS2_RC_SUCCESS;
+}
+
+uint16_t
+host_hash_block_size (TPMI_ALG_HASH hash_alg)
+{
+    switch (hash_alg) {
+    case TPM2_ALG_SHA1:
+    case TPM2_ALG_SHA256:
+    case TPM2_ALG_SM3_256:
+        return 64;
+    case TPM2_ALG_SHA384:
+    case TPM2_ALG_SHA512:
+        return 128;
+    default:
+        return 0;
+    }
+}
+
+TSS2_RC
+host_hash_start (TSS2_SYS_HASH_CONTEXT *ctx,
+                 TPMI_ALG_HASH hash_alg)
+{
+    return host_crypto_callbacks.hashStart (ctx, hash_alg,
+                                            host_crypto_callbacks.userData);
+}
+
+TSS2_RC
+host_hash_update (TSS2_SYS_HASH_CONTEXT *ctx,
+                  const uint8_t *buffer,
+                  size_t size)
+{
+    return host_crypto_callbacks.hashUpdate (ctx, buffer, size);
+}
+
+TSS2_RC
+host_hash_finish (TSS2_SYS_HASH_CONTEXT *ctx,
+                  uint8_t *digest,
+                  size_t *digest_size)
+{
+    return host_crypto_callbacks.hashFinish (ctx, digest, digest_size);
+}
+
+void
+host_hash_abort (TSS2_SYS_HASH_CONTEXT *ctx)
+{
+    if (host_crypto_callbacks.hashAbort != NULL)
+        host_crypto_callbacks.hashAbort (ctx);
+    else
+        memset (ctx, 0, sizeof (*ctx));
+}
+
+int
+host_hash_can_copy (void)
+{
+    return host_crypto_callbacks.hashCopy != NULL;
+}
+
+TSS2_RC
+host_hash_copy (TSS2_SYS_HASH_CONTEXT *dest,
+                const TSS2_SYS_HASH_CONTEXT *src)
+{
+    if (host_crypto_callbacks.hashCopy == NULL)
+        return TSS2_SYS_RC_BAD_SEQUENCE;
+
+    return host_crypto_callbacks.hashCopy (dest, src);
+}
+
+/* Start ctx with the given key pad absorbed. */
+static TSS2_RC
+hmac_start_pad (TSS2_SYS_HASH_CONTEXT *ctx,
+                TPMI_ALG_HASH hash_alg,
+                const uint8_t *pad,
+                size_t pad_size)
+{
+    TSS2_RC rval;
+
+    rval = host_hash_start (ctx, hash_alg);
+    if (rval != TSS2_RC_SUCCESS)
+        return rval;
+    rval = host_hash_update (ctx, pad, pad_size);
+    if (rval != TSS2_RC_SUCCESS)
+        host_hash_abort (ctx);
+
+    return rval;
+}
+
+TSS2_RC
+host_hmac_start (HOST_HMAC_CONTEXT *ctx,
+                 TPMI_ALG_HASH hash_alg,
+                 const uint8_t *key,
+                 size_t key_size)
+{
+    uint8_t ipad[HOST_HASH_MAX_BLOCK_SIZE];
+    size_t digest_size;
+    unsigned int i;
+    TSS2_RC rval;
+
+    if (ctx == NULL || (key == NULL && key_size != 0))
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    ctx->hash_alg = hash_alg;
+    ctx->has_outer_ctx = 0;
+    ctx->block_size = host_hash_block_size (hash_alg);
+    if (ctx->block_size == 0)
+        return TSS2_SYS_RC_BAD_VALUE;
+
+    /* Keys longer than a block are replaced by their digest. */
+    memset (ctx->opad, 0, sizeof (ctx->opad));
+    if (key_size > ctx->block_size) {
+        rval = host_hash_start (&ctx->hash_ctx, hash_alg);
+        if (rval != TSS2_RC_SUCCESS)
+            return rval;
+        rval = host_hash_update (&ctx->hash_ctx, key, key_size);
+        if (rval != TSS2_RC_SUCCESS) {
+            host_hash_abort (&ctx->hash_ctx);
+            return rval;
+        }
+        digest_size = sizeof (ctx->opad);
+        rval = host_hash_finish (&ctx->hash_ctx, ctx->opad, &digest_size);
+        if (rval != TSS2_RC_SUCCESS)
+            return rval;
+    } else if (key_size > 0) {
+        memcpy (ctx->opad, key, key_size);
+    }
+
+    for (i = 0; i < ctx->block_size; i++) {
+        ipad[i] = ctx->opad[i] ^ 0x36;
+        ctx->opad[i] ^= 0x5c;
+    }
+
+    if (host_hash_can_copy ()) {
+        rval = hmac_start_pad (&ctx->outer_ctx, hash_alg, ctx->opad,
+                               ctx->block_size);
+        if (rval != TSS2_RC_SUCCESS)
+            goto out;
+        ctx->has_outer_ctx = 1;
+        memset (ctx->opad, 0, sizeof (ctx->opad));
+    }
+
+    rval = hmac_start_pad (&ctx->hash_ctx, hash_alg, ipad, ctx->block_size);
+    if (rval != TSS2_RC_SUCCESS && ctx->has_outer_ctx) {
+        host_hash_abort (&ctx->outer_ctx);
+        ctx->has_outer_ctx = 0;
+    }
+
+out:
+    memset (ipad, 0, sizeof (ipad));
+    return rval;
+}
+
+TSS2_RC
+host_hmac_copy (HOST_HMAC_CONTEXT *dest,
+                const HOST_HMAC_CONTEXT *src)
+{
+    TSS2_RC rval;
+
+    if (dest == NULL || src == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+    if (!src->has_outer_ctx)
+        return TSS2_SYS_RC_BAD_SEQUENCE;
+
+    rval = host_hash_copy (&dest->hash_ctx, &src->hash_ctx);
+    if (rval != TSS2_RC_SUCCESS)
+        return rval;
+    rval = host_hash_copy (&dest->outer_ctx, &src->outer_ctx);
+    if (rval != TSS2_RC_SUCCESS) {
+        host_hash_abort (&dest->hash_ctx);
+        return rval;
+    }
+    dest->hash_alg = src->hash_alg;
+    dest->block_size = src->block_size;
+    dest->has_outer_ctx = 1;
+    memset (dest->opad, 0, sizeof (dest->opad));
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+host_hmac_update (HOST_HMAC_CONTEXT *ctx,
+                  const uint8_t *buffer,
+                  size_t size)
+{
+    if (ctx == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    return host_hash_update (&ctx->hash_ctx, buffer, size);
+}
+
+TSS2_RC
+host_hmac_finish (HOST_HMAC_CONTEXT *ctx,
+                  uint8_t *digest,
+                  size_t *digest_size)
+{
+    uint8_t inner[TPM2_SHA512_DIGEST_SIZE];
+    size_t inner_size = sizeof (inner);
+    TSS2_SYS_HASH_CONTEXT *outer;
+    TSS2_RC rval;
+
+    if (ctx == NULL || digest == NULL || digest_size == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    outer = &ctx->outer_ctx;
+    rval = host_hash_finish (&ctx->hash_ctx, inner, &inner_size);
+    if (rval != TSS2_RC_SUCCESS) {
+        if (ctx->has_outer_ctx)
+            host_hash_abort (outer);
+        goto out;
+    }
+
+    if (!ctx->has_outer_ctx) {
+        rval = hmac_start_pad (outer, ctx->hash_alg, ctx->opad,
+                               ctx->block_size);
+        if (rval != TSS2_RC_SUCCESS)
+            goto out;
+    }
+    rval = host_hash_update (outer, inner, inner_size);
+    if (rval == TSS2_RC_SUCCESS)
+        rval = host_hash_finish (outer, digest, digest_size);
+    else
+        host_hash_abort (outer);
+
+out:
+    ctx->has_outer_ctx = 0;
+    memset (inner, 0, sizeof (inner));
+    memset (ctx->opad, 0, sizeof (ctx->opad));
+    return rval;
+}
+
+void
+host_hmac_abort (HOST_HMAC_CONTEXT *ctx)
+{
+    host_hash_abort (&ctx->hash_ctx);
+    if (ctx->has_outer_ctx)
+        host_hash_abort (&ctx->outer_ctx);
+    ctx->has_outer_ctx = 0;
+    memset (ctx->opad, 0, sizeof (ctx->opad));
+}
+
+int
+host_is_equal (const uint8_t *buffer_a,
+               const uint8_t *buffer_b,
+               size_t size)
+{
+    uint8_t diff = 0;
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        diff |= buffer_a[i] ^ buffer_b[i];
+
+    return diff == 0;
+}
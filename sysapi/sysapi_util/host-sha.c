@@ -0,0 +1,564 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <string.h>
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define HOST_SHA_X86 1
+#endif
+
+#include "sapi/tpm20.h"
+#include "host-sha.h"
+
+_Static_assert (sizeof (HOST_SHA_CONTEXT) <= sizeof (TSS2_SYS_HASH_CONTEXT),
+                "HOST_SHA_CONTEXT does not fit into TSS2_SYS_HASH_CONTEXT");
+
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define ROTR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+static const uint32_t sha1_init[5] = {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+};
+
+static const uint32_t sha256_init[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static const uint64_t sha384_init[8] = {
+    0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL,
+    0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+    0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL,
+    0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL,
+};
+
+static const uint64_t sha512_init[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+    0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint64_t sha512_k[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
+    0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+    0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
+    0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+    0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+    0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
+    0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
+    0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+    0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
+    0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
+    0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+    0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+    0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
+    0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+    0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
+    0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
+    0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+    0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
+    0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+    0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+    0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+static uint32_t
+load_be32 (const uint8_t *buffer)
+{
+    return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) |
+           ((uint32_t)buffer[2] << 8) | (uint32_t)buffer[3];
+}
+
+static uint64_t
+load_be64 (const uint8_t *buffer)
+{
+    return ((uint64_t)load_be32 (buffer) << 32) | load_be32 (&buffer[4]);
+}
+
+static void
+store_be32 (uint8_t *buffer,
+            uint32_t value)
+{
+    buffer[0] = (uint8_t)(value >> 24);
+    buffer[1] = (uint8_t)(value >> 16);
+    buffer[2] = (uint8_t)(value >> 8);
+    buffer[3] = (uint8_t)value;
+}
+
+static void
+store_be64 (uint8_t *buffer,
+            uint64_t value)
+{
+    store_be32 (buffer, (uint32_t)(value >> 32));
+    store_be32 (&buffer[4], (uint32_t)value);
+}
+
+static void
+sha1_compress (uint32_t *state,
+               const uint8_t *blocks,
+               size_t count)
+{
+    uint32_t w[80];
+    uint32_t a, b, c, d, e, f, k, tmp;
+    unsigned int i;
+
+    for (; count > 0; count--, blocks += 64) {
+        for (i = 0; i < 16; i++)
+            w[i] = load_be32 (&blocks[i * 4]);
+        for (i = 16; i < 80; i++)
+            w[i] = ROTL32 (w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        for (i = 0; i < 80; i++) {
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+            tmp = ROTL32 (a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = ROTL32 (b, 30);
+            b = a;
+            a = tmp;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+static void
+sha256_compress (uint32_t *state,
+                 const uint8_t *blocks,
+                 size_t count)
+{
+    uint32_t w[64];
+    uint32_t v[8];
+    uint32_t s0, s1, t1, t2;
+    unsigned int i;
+
+    for (; count > 0; count--, blocks += 64) {
+        for (i = 0; i < 16; i++)
+            w[i] = load_be32 (&blocks[i * 4]);
+        for (i = 16; i < 64; i++) {
+            s0 = ROTR32 (w[i - 15], 7) ^ ROTR32 (w[i - 15], 18) ^
+                 (w[i - 15] >> 3);
+            s1 = ROTR32 (w[i - 2], 17) ^ ROTR32 (w[i - 2], 19) ^
+                 (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        memcpy (v, state, sizeof (v));
+        for (i = 0; i < 64; i++) {
+            t1 = v[7] + (ROTR32 (v[4], 6) ^ ROTR32 (v[4], 11) ^
+                         ROTR32 (v[4], 25)) +
+                 ((v[4] & v[5]) ^ (~v[4] & v[6])) + sha256_k[i] + w[i];
+            t2 = (ROTR32 (v[0], 2) ^ ROTR32 (v[0], 13) ^ ROTR32 (v[0], 22)) +
+                 ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+            v[7] = v[6];
+            v[6] = v[5];
+            v[5] = v[4];
+            v[4] = v[3] + t1;
+            v[3] = v[2];
+            v[2] = v[1];
+            v[1] = v[0];
+            v[0] = t1 + t2;
+        }
+        for (i = 0; i < 8; i++)
+            state[i] += v[i];
+    }
+}
+
+static void
+sha512_compress (uint64_t *state,
+                 const uint8_t *blocks,
+                 size_t count)
+{
+    uint64_t w[80];
+    uint64_t v[8];
+    uint64_t s0, s1, t1, t2;
+    unsigned int i;
+
+    for (; count > 0; count--, blocks += 128) {
+        for (i = 0; i < 16; i++)
+            w[i] = load_be64 (&blocks[i * 8]);
+        for (i = 16; i < 80; i++) {
+            s0 = ROTR64 (w[i - 15], 1) ^ ROTR64 (w[i - 15], 8) ^
+                 (w[i - 15] >> 7);
+            s1 = ROTR64 (w[i - 2], 19) ^ ROTR64 (w[i - 2], 61) ^
+                 (w[i - 2] >> 6);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        memcpy (v, state, sizeof (v));
+        for (i = 0; i < 80; i++) {
+            t1 = v[7] + (ROTR64 (v[4], 14) ^ ROTR64 (v[4], 18) ^
+                         ROTR64 (v[4], 41)) +
+                 ((v[4] & v[5]) ^ (~v[4] & v[6])) + sha512_k[i] + w[i];
+            t2 = (ROTR64 (v[0], 28) ^ ROTR64 (v[0], 34) ^ ROTR64 (v[0], 39)) +
+                 ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+            v[7] = v[6];
+            v[6] = v[5];
+            v[5] = v[4];
+            v[4] = v[3] + t1;
+            v[3] = v[2];
+            v[2] = v[1];
+            v[1] = v[0];
+            v[0] = t1 + t2;
+        }
+        for (i = 0; i < 8; i++)
+            state[i] += v[i];
+    }
+}
+
+#ifdef HOST_SHA_X86
+/*
+ * SHA-256 block function using the SHA extensions (SHA256RNDS2 /
+ * SHA256MSG1 / SHA256MSG2). The state is kept in the ABEF / CDGH layout the
+ * instructions expect and converted back after the last block.
+ */
+__attribute__ ((target ("sha,sse4.1,ssse3")))
+static void
+sha256_compress_shani (uint32_t *state,
+                       const uint8_t *blocks,
+                       size_t count)
+{
+    const __m128i byte_swap = _mm_set_epi64x (0x0c0d0e0f08090a0bULL,
+                                              0x0405060700010203ULL);
+    __m128i state0, state1, abef_save, cdgh_save, msg, tmp;
+    __m128i w[4];
+    unsigned int i;
+
+    tmp = _mm_loadu_si128 ((const __m128i *)&state[0]);
+    state1 = _mm_loadu_si128 ((const __m128i *)&state[4]);
+    tmp = _mm_shuffle_epi32 (tmp, 0xb1);
+    state1 = _mm_shuffle_epi32 (state1, 0x1b);
+    state0 = _mm_alignr_epi8 (tmp, state1, 8);
+    state1 = _mm_blend_epi16 (state1, tmp, 0xf0);
+
+    for (; count > 0; count--, blocks += 64) {
+        abef_save = state0;
+        cdgh_save = state1;
+
+        /* Each pass does four rounds and schedules the next four words. */
+        for (i = 0; i < 16; i++) {
+            if (i < 4) {
+                w[i] = _mm_loadu_si128 ((const __m128i *)&blocks[i * 16]);
+                w[i] = _mm_shuffle_epi8 (w[i], byte_swap);
+            }
+            msg = _mm_add_epi32 (w[i % 4], _mm_loadu_si128 (
+                                     (const __m128i *)&sha256_k[i * 4]));
+            state1 = _mm_sha256rnds2_epu32 (state1, state0, msg);
+            if (i >= 3 && i < 15) {
+                tmp = _mm_alignr_epi8 (w[i % 4], w[(i + 3) % 4], 4);
+                w[(i + 1) % 4] = _mm_add_epi32 (w[(i + 1) % 4], tmp);
+                w[(i + 1) % 4] = _mm_sha256msg2_epu32 (w[(i + 1) % 4],
+                                                       w[i % 4]);
+            }
+            msg = _mm_shuffle_epi32 (msg, 0x0e);
+            state0 = _mm_sha256rnds2_epu32 (state0, state1, msg);
+            if (i >= 1 && i < 13)
+                w[(i + 3) % 4] = _mm_sha256msg1_epu32 (w[(i + 3) % 4],
+                                                       w[i % 4]);
+        }
+
+        state0 = _mm_add_epi32 (state0, abef_save);
+        state1 = _mm_add_epi32 (state1, cdgh_save);
+    }
+
+    tmp = _mm_shuffle_epi32 (state0, 0x1b);
+    state1 = _mm_shuffle_epi32 (state1, 0xb1);
+    state0 = _mm_blend_epi16 (tmp, state1, 0xf0);
+    state1 = _mm_alignr_epi8 (state1, tmp, 8);
+    _mm_storeu_si128 ((__m128i *)&state[0], state0);
+    _mm_storeu_si128 ((__m128i *)&state[4], state1);
+}
+
+static int
+sha_detect_shani (void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx))
+        return 0;
+    /* SSSE3 and SSE4.1 */
+    if (!(ecx & (1 << 9)) || !(ecx & (1 << 19)))
+        return 0;
+    if (__get_cpuid_max (0, NULL) < 7)
+        return 0;
+    __cpuid_count (7, 0, eax, ebx, ecx, edx);
+    /* SHA */
+    return (ebx & (1 << 29)) != 0;
+}
+#else
+static int
+sha_detect_shani (void)
+{
+    return 0;
+}
+#endif
+
+/* -1: not probed yet, 0: portable code, 1: SHA extensions */
+static int sha256_accel = -1;
+
+int
+host_sha_accel_available (void)
+{
+    return sha_detect_shani ();
+}
+
+int
+host_sha_set_accel (int enable)
+{
+    int previous = __atomic_load_n (&sha256_accel, __ATOMIC_RELAXED);
+
+    if (previous < 0)
+        previous = sha_detect_shani ();
+    __atomic_store_n (&sha256_accel, enable ? sha_detect_shani () : 0,
+                      __ATOMIC_RELAXED);
+    return previous;
+}
+
+static void
+sha256_compress_dispatch (uint32_t *state,
+                          const uint8_t *blocks,
+                          size_t count)
+{
+    int accel = __atomic_load_n (&sha256_accel, __ATOMIC_RELAXED);
+
+    if (accel < 0) {
+        accel = sha_detect_shani ();
+        __atomic_store_n (&sha256_accel, accel, __ATOMIC_RELAXED);
+    }
+#ifdef HOST_SHA_X86
+    if (accel) {
+        sha256_compress_shani (state, blocks, count);
+        return;
+    }
+#endif
+    sha256_compress (state, blocks, count);
+}
+
+static void
+host_sha_compress (HOST_SHA_CONTEXT *sha,
+                   const uint8_t *blocks,
+                   size_t count)
+{
+    switch (sha->hash_alg) {
+    case TPM2_ALG_SHA1:
+        sha1_compress (sha->state.h32, blocks, count);
+        break;
+    case TPM2_ALG_SHA256:
+        sha256_compress_dispatch (sha->state.h32, blocks, count);
+        break;
+    default:
+        sha512_compress (sha->state.h64, blocks, count);
+        break;
+    }
+}
+
+TSS2_RC
+host_sha_start (TSS2_SYS_HASH_CONTEXT *ctx,
+                TPMI_ALG_HASH hash_alg,
+                void *user_data)
+{
+    HOST_SHA_CONTEXT *sha = (HOST_SHA_CONTEXT *)ctx;
+
+    (void)user_data;
+    if (ctx == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    memset (sha, 0, sizeof (*sha));
+    sha->hash_alg = hash_alg;
+    switch (hash_alg) {
+    case TPM2_ALG_SHA1:
+        sha->block_size = 64;
+        sha->digest_size = TPM2_SHA1_DIGEST_SIZE;
+        memcpy (sha->state.h32, sha1_init, sizeof (sha1_init));
+        break;
+    case TPM2_ALG_SHA256:
+        sha->block_size = 64;
+        sha->digest_size = TPM2_SHA256_DIGEST_SIZE;
+        memcpy (sha->state.h32, sha256_init, sizeof (sha256_init));
+        break;
+    case TPM2_ALG_SHA384:
+        sha->block_size = 128;
+        sha->digest_size = TPM2_SHA384_DIGEST_SIZE;
+        memcpy (sha->state.h64, sha384_init, sizeof (sha384_init));
+        break;
+    case TPM2_ALG_SHA512:
+        sha->block_size = 128;
+        sha->digest_size = TPM2_SHA512_DIGEST_SIZE;
+        memcpy (sha->state.h64, sha512_init, sizeof (sha512_init));
+        break;
+    default:
+        return TSS2_SYS_RC_BAD_VALUE;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+host_sha_update (TSS2_SYS_HASH_CONTEXT *ctx,
+                 const uint8_t *buffer,
+                 size_t size)
+{
+    HOST_SHA_CONTEXT *sha = (HOST_SHA_CONTEXT *)ctx;
+    size_t count;
+
+    if (ctx == NULL || (buffer == NULL && size != 0))
+        return TSS2_SYS_RC_BAD_REFERENCE;
+    if (sha->block_size == 0)
+        return TSS2_SYS_RC_BAD_SEQUENCE;
+
+    sha->total_size += size;
+    if (sha->block_used > 0) {
+        count = sha->block_size - sha->block_used;
+        if (count > size)
+            count = size;
+        memcpy (&sha->block[sha->block_used], buffer, count);
+        sha->block_used += count;
+        buffer += count;
+        size -= count;
+        if (sha->block_used < sha->block_size)
+            return TSS2_RC_SUCCESS;
+        host_sha_compress (sha, sha->block, 1);
+        sha->block_used = 0;
+    }
+
+    /* Hash whole blocks straight from the caller's buffer. */
+    count = size / sha->block_size;
+    if (count > 0) {
+        host_sha_compress (sha, buffer, count);
+        buffer += count * sha->block_size;
+        size -= count * sha->block_size;
+    }
+
+    memcpy (sha->block, buffer, size);
+    sha->block_used = size;
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+host_sha_finish (TSS2_SYS_HASH_CONTEXT *ctx,
+                 uint8_t *digest,
+                 size_t *digest_size)
+{
+    HOST_SHA_CONTEXT *sha = (HOST_SHA_CONTEXT *)ctx;
+    size_t length_offset;
+    unsigned int i;
+
+    if (ctx == NULL || digest == NULL || digest_size == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+    if (sha->block_size == 0)
+        return TSS2_SYS_RC_BAD_SEQUENCE;
+    if (*digest_size < sha->digest_size)
+        return TSS2_SYS_RC_INSUFFICIENT_BUFFER;
+
+    /* Padding: 0x80, zeros, then the bit length in the last 8 bytes. */
+    length_offset = sha->block_size - 8;
+    sha->block[sha->block_used++] = 0x80;
+    if (sha->block_used > length_offset) {
+        memset (&sha->block[sha->block_used], 0,
+                sha->block_size - sha->block_used);
+        host_sha_compress (sha, sha->block, 1);
+        sha->block_used = 0;
+    }
+    memset (&sha->block[sha->block_used], 0,
+            length_offset - sha->block_used);
+    store_be64 (&sha->block[length_offset], sha->total_size << 3);
+    host_sha_compress (sha, sha->block, 1);
+
+    if (sha->block_size == 64) {
+        for (i = 0; i < sha->digest_size / 4; i++)
+            store_be32 (&digest[i * 4], sha->state.h32[i]);
+    } else {
+        for (i = 0; i < sha->digest_size / 8; i++)
+            store_be64 (&digest[i * 8], sha->state.h64[i]);
+    }
+    *digest_size = sha->digest_size;
+    memset (sha, 0, sizeof (*sha));
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+host_sha_copy (TSS2_SYS_HASH_CONTEXT *dest,
+               const TSS2_SYS_HASH_CONTEXT *src)
+{
+    if (dest == NULL || src == NULL)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    memcpy (dest, src, sizeof (HOST_SHA_CONTEXT));
+    return TSS2_RC_SUCCESS;
+}
@@ -70,6 +70,11 @@ TSS2_RC PlatformCommand(
     }
     else
     {
+        // The simulator may act on a cancel even if its reply gets lost.
+        if (cmd == MS_SIM_CANCEL_ON)
+            tcti_intel->status.cancelSent = 1;
+        else if (cmd == MS_SIM_CANCEL_OFF)
+            tcti_intel->status.cancelSent = 0;
 #ifdef DEBUG_SOCKETS
         TCTI_LOG( tctiContext, NO_PREFIX, "Send Bytes to socket #0x%x: \n", tcti_intel->otherSock );
         TCTI_LOG_BUFFER( tctiContext, NO_PREFIX, (UINT8 *)sendbuf, 4 );
@@ -0,0 +1,376 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sapi/tpm20.h"
+#include "shm.h"
+
+static inline void cpu_relax (void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause ();
+#else
+    __asm__ __volatile__ ("" ::: "memory");
+#endif
+}
+
+static void ring_write (
+    TCTI_SHM_RING *ring,
+    uint32_t position,
+    const void *src,
+    size_t len)
+{
+    uint32_t start = position % TCTI_SHM_RING_SIZE;
+    size_t first = TCTI_SHM_RING_SIZE - start;
+
+    if (first > len) {
+        first = len;
+    }
+    memcpy (&ring->data [start], src, first);
+    memcpy (ring->data, (const uint8_t *)src + first, len - first);
+}
+
+static void ring_read (
+    TCTI_SHM_RING *ring,
+    uint32_t position,
+    void *dst,
+    size_t len)
+{
+    uint32_t start = position % TCTI_SHM_RING_SIZE;
+    size_t first = TCTI_SHM_RING_SIZE - start;
+
+    if (first > len) {
+        first = len;
+    }
+    memcpy (dst, &ring->data [start], first);
+    memcpy ((uint8_t *)dst + first, ring->data, len - first);
+}
+
+void tcti_shm_drain (
+    int doorbell)
+{
+    uint64_t count;
+
+    while (read (doorbell, &count, sizeof (count)) < 0 && errno == EINTR)
+        ;
+}
+
+TSS2_RC tcti_shm_send (
+    TCTI_SHM_RING *ring,
+    int doorbell,
+    const struct iovec *iov,
+    int iovcnt,
+    size_t size,
+    uint8_t locality)
+{
+    TCTI_SHM_FRAME frame = { .size = size, .locality = locality };
+    uint32_t head = __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = ring->tail;
+    uint32_t position;
+    uint64_t one = 1;
+    int i;
+
+    if (tail - head > TCTI_SHM_RING_SIZE) {
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+    if (size > TCTI_SHM_RING_SIZE - sizeof (frame) ||
+        tail - head > TCTI_SHM_RING_SIZE - sizeof (frame) - size) {
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+
+    ring_write (ring, tail, &frame, sizeof (frame));
+    position = tail + sizeof (frame);
+    for (i = 0; i < iovcnt; i++) {
+        ring_write (ring, position, iov [i].iov_base, iov [i].iov_len);
+        position += iov [i].iov_len;
+    }
+    __atomic_store_n (&ring->tail, tail + sizeof (frame) + size,
+                      __ATOMIC_RELEASE);
+
+    /* pairs with the fence between setting 'sleeping' and the re-check */
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    if (__atomic_load_n (&ring->sleeping, __ATOMIC_RELAXED)) {
+        while (write (doorbell, &one, sizeof (one)) < 0 && errno == EINTR)
+            ;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+static int32_t time_left (
+    int32_t timeout,
+    const struct timespec *start)
+{
+    struct timespec now;
+    int64_t elapsed;
+
+    if (timeout <= 0) {
+        return timeout;
+    }
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    elapsed = (int64_t)(now.tv_sec - start->tv_sec) * 1000 +
+              (now.tv_nsec - start->tv_nsec) / 1000000;
+
+    return elapsed >= timeout ? 0 : timeout - elapsed;
+}
+
+TSS2_RC tcti_shm_wait (
+    TCTI_SHM_RING *ring,
+    int doorbell,
+    int control,
+    int32_t timeout,
+    int always_ring,
+    size_t max_size,
+    TCTI_SHM_FRAME *frame)
+{
+    struct pollfd fds [2] = {
+        { .fd = doorbell, .events = POLLIN },
+        { .fd = control,  .events = POLLIN },
+    };
+    struct timespec start;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    uint32_t used;
+    int spin = timeout == TSS2_TCTI_TIMEOUT_NONE ? TCTI_SHM_SPIN : 0;
+    int ret;
+
+    if (timeout < TSS2_TCTI_TIMEOUT_BLOCK) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+    if (timeout > 0) {
+        clock_gettime (CLOCK_MONOTONIC, &start);
+    }
+    if (always_ring) {
+        __atomic_store_n (&ring->sleeping, 1, __ATOMIC_RELAXED);
+        tcti_shm_drain (doorbell);
+    }
+
+    for (;;) {
+        used = __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE) - ring->head;
+        if (used != 0) {
+            break;
+        }
+        if (spin < TCTI_SHM_SPIN) {
+            spin++;
+            cpu_relax ();
+            continue;
+        }
+        if (timeout == TSS2_TCTI_TIMEOUT_NONE) {
+            rc = TSS2_TCTI_RC_TRY_AGAIN;
+            goto out;
+        }
+
+        __atomic_store_n (&ring->sleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence (__ATOMIC_SEQ_CST);
+        if (__atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE) != ring->head) {
+            continue;
+        }
+        ret = poll (fds, 2, time_left (timeout, &start));
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        } else if (ret < 0) {
+            rc = TSS2_TCTI_RC_IO_ERROR;
+            goto out;
+        } else if (ret == 0) {
+            rc = TSS2_TCTI_RC_TRY_AGAIN;
+            goto out;
+        }
+        /* nothing is ever sent on the session socket after the handshake */
+        if (fds [1].revents != 0) {
+            rc = TSS2_TCTI_RC_IO_ERROR;
+            goto out;
+        }
+        tcti_shm_drain (doorbell);
+    }
+
+    /* producers publish whole messages */
+    if (used < sizeof (*frame) || used > TCTI_SHM_RING_SIZE) {
+        rc = TSS2_TCTI_RC_MALFORMED_RESPONSE;
+        goto out;
+    }
+    ring_read (ring, ring->head, frame, sizeof (*frame));
+    if (frame->size > max_size || frame->size > used - sizeof (*frame)) {
+        rc = TSS2_TCTI_RC_MALFORMED_RESPONSE;
+    }
+
+out:
+    if (!always_ring) {
+        __atomic_store_n (&ring->sleeping, 0, __ATOMIC_RELAXED);
+    }
+    return rc;
+}
+
+void tcti_shm_copy_out (
+    TCTI_SHM_RING *ring,
+    const TCTI_SHM_FRAME *frame,
+    uint8_t *buffer,
+    int consume)
+{
+    if (frame->size > 0) {
+        ring_read (ring, ring->head + sizeof (*frame), buffer, frame->size);
+    }
+    if (consume) {
+        __atomic_store_n (&ring->head,
+                          ring->head + sizeof (*frame) + frame->size,
+                          __ATOMIC_RELEASE);
+    }
+}
+
+void tcti_shm_session_close (
+    TCTI_SHM_SESSION *session)
+{
+    if (session->region != NULL) {
+        munmap (session->region, sizeof (*session->region));
+        session->region = NULL;
+    }
+    if (session->commandDoorbell >= 0) {
+        close (session->commandDoorbell);
+        session->commandDoorbell = -1;
+    }
+    if (session->responseDoorbell >= 0) {
+        close (session->responseDoorbell);
+        session->responseDoorbell = -1;
+    }
+    if (session->control >= 0) {
+        close (session->control);
+        session->control = -1;
+    }
+}
+
+/*
+ * The client must have sealed the memfd against shrinking: the service
+ * would otherwise take a SIGBUS when the pages under its mapping go away.
+ */
+TSS2_RC tcti_shm_session_accept (
+    int control,
+    TCTI_SHM_SESSION *session)
+{
+    union {
+        struct cmsghdr header;
+        uint8_t buffer [CMSG_SPACE (3 * sizeof (int))];
+    } cmsg;
+    struct cmsghdr *header;
+    struct msghdr msg;
+    struct iovec iov;
+    struct stat st;
+    uint8_t version = 0, ack = 1;
+    int fds [3] = { -1, -1, -1 };
+    TSS2_RC rc = TSS2_TCTI_RC_IO_ERROR;
+    ssize_t ret;
+    void *map;
+    int seals;
+
+    session->control = control;
+    session->commandDoorbell = -1;
+    session->responseDoorbell = -1;
+    session->region = NULL;
+
+    memset (&msg, 0, sizeof (msg));
+    iov.iov_base = &version;
+    iov.iov_len = sizeof (version);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsg.buffer;
+    msg.msg_controllen = sizeof (cmsg.buffer);
+    do {
+        ret = recvmsg (control, &msg, MSG_CMSG_CLOEXEC);
+    } while (ret < 0 && errno == EINTR);
+    header = CMSG_FIRSTHDR (&msg);
+    if (header != NULL &&
+        header->cmsg_level == SOL_SOCKET &&
+        header->cmsg_type == SCM_RIGHTS &&
+        header->cmsg_len == CMSG_LEN (sizeof (fds))) {
+        memcpy (fds, CMSG_DATA (header), sizeof (fds));
+    } else if (header != NULL &&
+               header->cmsg_level == SOL_SOCKET &&
+               header->cmsg_type == SCM_RIGHTS) {
+        /* close whatever we were sent */
+        ret = (header->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+        while (ret-- > 0) {
+            close (((int *)CMSG_DATA (header)) [ret]);
+        }
+        ret = -1;
+    }
+    session->commandDoorbell = fds [1];
+    session->responseDoorbell = fds [2];
+    if (ret != 1 || version != TCTI_SHM_VERSION || fds [0] < 0 ||
+        (msg.msg_flags & MSG_CTRUNC)) {
+        goto out;
+    }
+
+    seals = fcntl (fds [0], F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_SHRINK) ||
+        fstat (fds [0], &st) < 0 ||
+        (size_t)st.st_size < sizeof (TCTI_SHM_REGION)) {
+        rc = TSS2_TCTI_RC_BAD_VALUE;
+        goto out;
+    }
+    map = mmap (NULL,
+                sizeof (TCTI_SHM_REGION),
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED,
+                fds [0],
+                0);
+    if (map == MAP_FAILED) {
+        goto out;
+    }
+    session->region = map;
+    if (session->region->magic != TCTI_SHM_MAGIC ||
+        session->region->version != TCTI_SHM_VERSION ||
+        session->region->ringSize != TCTI_SHM_RING_SIZE) {
+        rc = TSS2_TCTI_RC_BAD_VALUE;
+        goto out;
+    }
+
+    ack = 0;
+    rc = TSS2_RC_SUCCESS;
+out:
+    if (fds [0] >= 0) {
+        close (fds [0]);
+    }
+    while (send (control, &ack, sizeof (ack), MSG_NOSIGNAL) < 0 &&
+           errno == EINTR)
+        ;
+    if (rc != TSS2_RC_SUCCESS) {
+        /* the caller still owns the control socket */
+        session->control = -1;
+        tcti_shm_session_close (session);
+        session->control = control;
+    }
+
+    return rc;
+}
@@ -0,0 +1,146 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+#ifndef TCTI_SHM_RING_H
+#define TCTI_SHM_RING_H
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "sapi/tpm20.h"
+
+/*
+ * Layout of the memory shared by the shared memory TCTI and the service
+ * it talks to. The client creates a memfd holding one TCTI_SHM_REGION and
+ * hands it, together with two eventfd doorbells (command, response), to
+ * the service over a Unix socket with SCM_RIGHTS. That socket then stays
+ * open for the lifetime of the session: it going away is how either side
+ * learns that the other one is gone.
+ *
+ * Each direction is a single producer / single consumer byte ring of
+ * messages (a TCTI_SHM_FRAME followed by 'size' bytes). head and tail are
+ * free running byte counts written only by the consumer and the producer
+ * respectively. A producer only rings the doorbell when the consumer set
+ * 'sleeping' before going to sleep on it, so a busy pair exchanges
+ * messages without entering the kernel.
+ *
+ * Neither side trusts what the other wrote: frame sizes are checked and
+ * messages are copied out before they're used.
+ */
+#define TCTI_SHM_MAGIC     UINT64_C(0x314d48535353534d)
+#define TCTI_SHM_VERSION   1
+#define TCTI_SHM_RING_SIZE 8192
+/* ring polls before a consumer goes to sleep on the doorbell */
+#define TCTI_SHM_SPIN      2048
+
+typedef struct {
+    uint32_t size;
+    uint8_t locality;
+    uint8_t reserved [3];
+} TCTI_SHM_FRAME;
+
+/* producer and consumer fields on their own cache lines */
+typedef struct {
+    uint32_t head __attribute__ ((aligned (64)));
+    uint32_t sleeping;
+    uint32_t tail __attribute__ ((aligned (64)));
+    uint8_t data [TCTI_SHM_RING_SIZE] __attribute__ ((aligned (64)));
+} TCTI_SHM_RING;
+
+typedef struct TCTI_SHM_REGION {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t ringSize;
+    TCTI_SHM_RING command;  /* client to service */
+    TCTI_SHM_RING response; /* service to client */
+} TCTI_SHM_REGION;
+
+/*
+ * Queue a message made of the 'iovcnt' buffers in 'iov' ('size' bytes in
+ * total) and ring 'doorbell' if the consumer is asleep.
+ * TSS2_TCTI_RC_INSUFFICIENT_BUFFER when it doesn't fit the free space.
+ */
+TSS2_RC tcti_shm_send (
+    TCTI_SHM_RING      *ring,
+    int                 doorbell,
+    const struct iovec *iov,
+    int                 iovcnt,
+    size_t              size,
+    uint8_t             locality
+    );
+/*
+ * Wait for a message, spinning on the ring first and then sleeping on
+ * 'doorbell' for what is left of 'timeout' (TSS2_TCTI_TIMEOUT_* as for
+ * 'receive'). 'control' is the session socket, its hang up is an IO
+ * error. With 'always_ring' the consumer keeps 'sleeping' set so that the
+ * producer rings for every message: for callers that poll the doorbell
+ * themselves. The doorbell is then cleared before the ring is checked.
+ * The frame header is returned in 'frame', the message stays in the ring.
+ * Sizes above 'max_size' are TSS2_TCTI_RC_MALFORMED_RESPONSE.
+ */
+TSS2_RC tcti_shm_wait (
+    TCTI_SHM_RING  *ring,
+    int             doorbell,
+    int             control,
+    int32_t         timeout,
+    int             always_ring,
+    size_t          max_size,
+    TCTI_SHM_FRAME *frame
+    );
+/* Copy the message found by tcti_shm_wait out and, with 'consume', drop it. */
+void tcti_shm_copy_out (
+    TCTI_SHM_RING        *ring,
+    const TCTI_SHM_FRAME *frame,
+    uint8_t              *buffer,
+    int                   consume
+    );
+/* Clear a doorbell: eventfds are level triggered while their count is set. */
+void tcti_shm_drain (
+    int doorbell
+    );
+
+/*
+ * Service side of the handshake: receive the memfd and the doorbells from
+ * a client on the accepted 'control' socket, check and map the region and
+ * acknowledge the session.
+ */
+typedef struct {
+    int control;
+    int commandDoorbell;
+    int responseDoorbell;
+    TCTI_SHM_REGION *region;
+} TCTI_SHM_SESSION;
+
+TSS2_RC tcti_shm_session_accept (
+    int               control,
+    TCTI_SHM_SESSION *session
+    );
+void tcti_shm_session_close (
+    TCTI_SHM_SESSION *session
+    );
+
+#endif /* TCTI_SHM_RING_H */
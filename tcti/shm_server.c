@@ -0,0 +1,230 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+/*
+ * Reference service for the shared memory TCTI: accepts sessions on a
+ * Unix socket and forwards the commands found in the session's command
+ * ring to the TPM2 simulator through the socket TCTI, writing the
+ * simulator's responses back to the response ring. Sessions are served
+ * one after the other, like the simulator serves its connections.
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sapi/tpm20.h"
+#include "tcti/tcti_socket.h"
+#include "tcti.h"
+#include "sockets.h"
+#include "shm.h"
+
+static void
+usage (const char *name)
+{
+    fprintf (stderr,
+             "usage: %s [-a address] [-p port] [-t tpm-path -P platform-path] path\n"
+             "  -a  simulator address (default " DEFAULT_HOSTNAME ")\n"
+             "  -p  simulator TPM port (default %d)\n"
+             "  -t  simulator TPM command Unix socket instead of TCP\n"
+             "  -P  simulator platform Unix socket instead of TCP\n"
+             "  path  Unix socket to accept sessions on, '@name' for the\n"
+             "        abstract namespace\n",
+             name,
+             DEFAULT_SIMULATOR_TPM_PORT);
+}
+
+static TSS2_TCTI_CONTEXT*
+simulator_connect (const TCTI_SOCKET_CONF *conf)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+    size_t size = 0;
+    TSS2_RC rc;
+
+    rc = InitSocketTcti (NULL, &size, conf, 0);
+    if (rc != TSS2_RC_SUCCESS) {
+        return NULL;
+    }
+    tcti = calloc (1, size);
+    if (tcti == NULL) {
+        return NULL;
+    }
+    rc = InitSocketTcti (tcti, &size, conf, 0);
+    if (rc != TSS2_RC_SUCCESS) {
+        fprintf (stderr, "connecting to the simulator failed: 0x%x\n", rc);
+        free (tcti);
+        return NULL;
+    }
+
+    return tcti;
+}
+
+static void
+simulator_disconnect (TSS2_TCTI_CONTEXT *tcti)
+{
+    tss2_tcti_finalize (tcti);
+    free (tcti);
+}
+
+/*
+ * Forward commands until the client goes away. A command the simulator
+ * doesn't answer gets an empty response, which the client reports as an
+ * IO error. The socket TCTI is in no state to forward the next command
+ * after that, so it is replaced by a fresh connection, and the session
+ * ends if the simulator can't be reached again. The TCTI in use is left
+ * in *tcti, NULL if there is none.
+ */
+static void
+serve (TCTI_SHM_SESSION *session,
+       const TCTI_SOCKET_CONF *conf,
+       TSS2_TCTI_CONTEXT **tcti)
+{
+    static uint8_t command [TPM2_MAX_COMMAND_SIZE];
+    static uint8_t response [TPM2_MAX_RESPONSE_SIZE];
+    TCTI_SHM_FRAME frame;
+    struct iovec iov;
+    size_t size;
+    TSS2_RC rc;
+
+    for (;;) {
+        rc = tcti_shm_wait (&session->region->command,
+                            session->commandDoorbell,
+                            session->control,
+                            TSS2_TCTI_TIMEOUT_BLOCK,
+                            0,
+                            sizeof (command),
+                            &frame);
+        if (rc != TSS2_RC_SUCCESS) {
+            return;
+        }
+        tcti_shm_copy_out (&session->region->command, &frame, command, 1);
+
+        size = sizeof (response);
+        rc = tss2_tcti_set_locality (*tcti, frame.locality);
+        if (rc == TSS2_RC_SUCCESS) {
+            rc = tss2_tcti_transmit (*tcti, frame.size, command);
+        }
+        if (rc == TSS2_RC_SUCCESS) {
+            rc = tss2_tcti_receive (*tcti,
+                                    &size,
+                                    response,
+                                    TSS2_TCTI_TIMEOUT_BLOCK);
+        }
+        if (rc != TSS2_RC_SUCCESS) {
+            fprintf (stderr, "forwarding a command failed: 0x%x\n", rc);
+            size = 0;
+            simulator_disconnect (*tcti);
+            *tcti = simulator_connect (conf);
+        }
+
+        iov.iov_base = response;
+        iov.iov_len = size;
+        rc = tcti_shm_send (&session->region->response,
+                            session->responseDoorbell,
+                            &iov,
+                            1,
+                            size,
+                            0);
+        if (rc != TSS2_RC_SUCCESS || *tcti == NULL) {
+            return;
+        }
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+    TCTI_SOCKET_CONF conf = {
+        .hostname = DEFAULT_HOSTNAME,
+        .port     = DEFAULT_SIMULATOR_TPM_PORT,
+    };
+    TCTI_SHM_SESSION session;
+    TSS2_TCTI_CONTEXT *tcti;
+    SOCKET listener, control;
+    int opt;
+
+    while ((opt = getopt (argc, argv, "a:p:t:P:h")) != -1) {
+        switch (opt) {
+        case 'a':
+            conf.hostname = optarg;
+            break;
+        case 'p':
+            conf.port = strtoul (optarg, NULL, 10);
+            break;
+        case 't':
+            conf.path = optarg;
+            break;
+        case 'P':
+            conf.platformPath = optarg;
+            break;
+        default:
+            usage (argv [0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1 ||
+        (conf.path == NULL) != (conf.platformPath == NULL)) {
+        usage (argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    listener = listenUnixSocket (argv [optind], NULL, NULL);
+    if (listener == INVALID_SOCKET) {
+        fprintf (stderr, "listening on %s failed\n", argv [optind]);
+        return EXIT_FAILURE;
+    }
+
+    for (;;) {
+        control = accept (listener, NULL, NULL);
+        if (control == INVALID_SOCKET) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            fprintf (stderr, "accept failed with error: %d\n", errno);
+            break;
+        }
+        if (tcti_shm_session_accept (control, &session) != TSS2_RC_SUCCESS) {
+            closesocket (control);
+            continue;
+        }
+        tcti = simulator_connect (&conf);
+        if (tcti != NULL) {
+            serve (&session, &conf, &tcti);
+        }
+        if (tcti != NULL) {
+            simulator_disconnect (tcti);
+        }
+        tcti_shm_session_close (&session);
+    }
+
+    closesocket (listener);
+    return EXIT_FAILURE;
+}
@@ -1,5 +1,10 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <stddef.h>
+#include <string.h>
 #include <unistd.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 
 #include "tcti/tcti_socket.h"
 #include "common/debug.h"
@@ -8,6 +13,24 @@
 void WSACleanup() {}
 int WSAGetLastError() { return errno; }
 int wasInterrupted() { return errno == EINTR; }
+int wouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+
+/*
+ * Wait up to 'timeout' milliseconds (-1 to block) for 'events' on sock.
+ * poll has no FD_SETSIZE limit, unlike select. Returns the poll result:
+ * 1 if ready, 0 on timeout or SOCKET_ERROR.
+ */
+int waitSocket( SOCKET sock, short events, int timeout )
+{
+    struct pollfd fds = { .fd = sock, .events = events };
+    int iResult;
+
+    do {
+        iResult = poll( &fds, 1, timeout );
+    } while (iResult == SOCKET_ERROR && wasInterrupted());
+
+    return iResult;
+}
 
 void CloseSockets( SOCKET otherSock, SOCKET tpmSock)
 {
@@ -40,18 +63,40 @@ TSS2_RC recvBytes( SOCKET tpmSock, unsigned char *data, int len )
     return TSS2_RC_SUCCESS;
 }
 
+/*
+ * Receive whatever is available into the iovcnt buffers in iov with a
+ * single recvmsg. Returns the number of bytes received, 0 if the peer
+ * closed the connection or SOCKET_ERROR; on a non-blocking socket with
+ * nothing to read that is SOCKET_ERROR with wouldBlock() true.
+ */
+ssize_t recvBytesv( SOCKET tpmSock, struct iovec *iov, int iovcnt )
+{
+    struct msghdr msg = { 0 };
+    ssize_t iResult;
+
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    do {
+        iResult = recvmsg( tpmSock, &msg, 0 );
+    } while (iResult == SOCKET_ERROR && wasInterrupted());
+
+    return iResult;
+}
+
 TSS2_RC sendBytes( SOCKET tpmSock, const unsigned char *data, int len )
 {
     int iResult = 0;
     int sentLength = 0;
 
-    for( sentLength = 0; sentLength < len; )
+    while( len > 0 )
     {
-        iResult = send( tpmSock, (char *)data, len, MSG_NOSIGNAL );
+        iResult = send( tpmSock, (char *)&( data[sentLength] ), len, MSG_NOSIGNAL );
         if (iResult == SOCKET_ERROR)
         {
             if (wasInterrupted())
                 continue;
+            else if (wouldBlock() && waitSocket( tpmSock, POLLOUT, -1 ) == 1)
+                continue;
             else
                 return TSS2_TCTI_RC_IO_ERROR;
         }
@@ -63,7 +108,110 @@ TSS2_RC sendBytes( SOCKET tpmSock, const unsigned char *data, int len )
     return TSS2_RC_SUCCESS;
 }
 
+/*
+ * Send the concatenation of the iovcnt buffers in iov with as few sendmsg
+ * calls as the kernel allows. A full send buffer on a non-blocking socket
+ * is waited out: a command is only ever sent whole. The iov array is
+ * consumed: entries are advanced past whatever a short send already
+ * transferred.
+ */
+TSS2_RC sendBytesv( SOCKET tpmSock, struct iovec *iov, int iovcnt )
+{
+    struct msghdr msg = { 0 };
+    ssize_t iResult;
+
+    while (iovcnt > 0)
+    {
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcnt;
+        iResult = sendmsg( tpmSock, &msg, MSG_NOSIGNAL );
+        if (iResult == SOCKET_ERROR)
+        {
+            if (wasInterrupted())
+                continue;
+            else if (wouldBlock() && waitSocket( tpmSock, POLLOUT, -1 ) == 1)
+                continue;
+            else
+                return TSS2_TCTI_RC_IO_ERROR;
+        }
+
+        while (iovcnt > 0 && (size_t)iResult >= iov->iov_len)
+        {
+            iResult -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (UINT8 *)iov->iov_base + iResult;
+            iov->iov_len -= iResult;
+        }
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
 #define SAFE_CALL(func, ...) (func != NULL) ? func(__VA_ARGS__) : 0
+
+/*
+ * Commands and platform requests are small request / response exchanges
+ * written with a single send, so there is nothing for Nagle to coalesce:
+ * it would only hold a frame back until the previous one is ACKed.
+ */
+static void
+setNoDelay( SOCKET sock, TCTI_LOG_CALLBACK debugfunc, void *data )
+{
+    int one = 1;
+
+    if (setsockopt( sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one) ) ==
+        SOCKET_ERROR)
+    {
+        SAFE_CALL( debugfunc, data, NO_PREFIX, "setsockopt TCP_NODELAY failed with error: %d\n", WSAGetLastError() );
+    }
+}
+
+/*
+ * The TPM command socket is non-blocking so that the TCTI can honor
+ * receive timeouts and be driven from a caller's event loop through
+ * getPollHandles. The platform socket stays blocking: platform commands
+ * are synchronous request / response exchanges.
+ */
+static int
+setNonBlocking( SOCKET sock, TCTI_LOG_CALLBACK debugfunc, void *data )
+{
+    int flags;
+
+    flags = fcntl( sock, F_GETFL, 0 );
+    if (flags == SOCKET_ERROR ||
+        fcntl( sock, F_SETFL, flags | O_NONBLOCK ) == SOCKET_ERROR)
+    {
+        SAFE_CALL( debugfunc, data, NO_PREFIX, "fcntl O_NONBLOCK failed with error: %d\n", WSAGetLastError() );
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Undo setNonBlocking for a TPM socket whose I/O moves to an io_uring: the
+ * ring waits on the socket itself, while a non-blocking socket would hand
+ * the queued reads back as EAGAIN.
+ */
+int
+setSocketBlocking( SOCKET sock )
+{
+    int flags;
+
+    flags = fcntl( sock, F_GETFL, 0 );
+    if (flags == SOCKET_ERROR ||
+        fcntl( sock, F_SETFL, flags & ~O_NONBLOCK ) == SOCKET_ERROR)
+    {
+        return SOCKET_ERROR;
+    }
+
+    return 0;
+}
+
 int
 InitSockets( const char *hostName,
              UINT16 port,
@@ -115,6 +263,7 @@ InitSockets( const char *hostName,
     else
     {
         SAFE_CALL( debugfunc, data, NO_PREFIX, "Client connected to server on port:  %d\n", port + 1 );
+        setNoDelay( *otherSock, debugfunc, data );
     }
 
     // Connect to server.
@@ -132,7 +281,132 @@ InitSockets( const char *hostName,
     else
     {
         SAFE_CALL( debugfunc, data, NO_PREFIX, "Client connected to server on port:  %d\n", port );
+        setNoDelay( *tpmSock, debugfunc, data );
+    }
+
+    /* both sockets are connected: the caller closes them on failure */
+    if (setNonBlocking( *tpmSock, debugfunc, data ))
+        return 1;
+
+    return 0;
+}
+
+/*
+ * Fill in the address of a Unix domain socket. A name starting with '@'
+ * is in the Linux abstract namespace: the name (without the '@') follows
+ * a NUL byte and the address length covers exactly the name, there is no
+ * terminating NUL.
+ */
+static int
+unixAddress( const char *path, struct sockaddr_un *addr, socklen_t *addrLen )
+{
+    size_t length = strlen( path );
+
+    memset( addr, 0, sizeof (*addr) );
+    addr->sun_family = AF_UNIX;
+    if (length == 0 || length >= sizeof (addr->sun_path))
+        return 1;
+
+    if (path[0] == '@') {
+        memcpy( &addr->sun_path[1], &path[1], length - 1 );
+        *addrLen = offsetof( struct sockaddr_un, sun_path ) + length;
+    } else {
+        memcpy( addr->sun_path, path, length );
+        *addrLen = offsetof( struct sockaddr_un, sun_path ) + length + 1;
+    }
+
+    return 0;
+}
+
+SOCKET
+connectUnixSocket( const char *path, TCTI_LOG_CALLBACK debugfunc, void *data )
+{
+    struct sockaddr_un addr;
+    socklen_t addrLen;
+    SOCKET sock;
+
+    if (unixAddress( path, &addr, &addrLen )) {
+        SAFE_CALL( debugfunc, data, NO_PREFIX, "invalid unix socket path: %s\n", path );
+        return INVALID_SOCKET;
+    }
+    sock = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if (sock == INVALID_SOCKET) {
+        SAFE_CALL( debugfunc, data, NO_PREFIX, "socket creation failed with error = %d\n", WSAGetLastError() );
+        return INVALID_SOCKET;
+    }
+    if (connect( sock, (SOCKADDR *) &addr, addrLen ) == SOCKET_ERROR) {
+        SAFE_CALL( debugfunc, data, NO_PREFIX, "connect to %s failed with error: %d\n", path, WSAGetLastError() );
+        closesocket( sock );
+        return INVALID_SOCKET;
+    }
+    SAFE_CALL( debugfunc, data, NO_PREFIX, "Client connected to server on %s\n", path );
+
+    return sock;
+}
+
+/*
+ * Unix domain socket counterpart to InitSockets: the platform and TPM
+ * command channels are two stream sockets bound to their own paths (or
+ * abstract names). There is no Nagle to turn off. Both sockets are
+ * INVALID_SOCKET when this fails.
+ */
+int
+InitUnixSockets( const char *tpmPath,
+                 const char *platformPath,
+                 SOCKET *otherSock,
+                 SOCKET *tpmSock,
+                 TCTI_LOG_CALLBACK debugfunc,
+                 void *data )
+{
+    *otherSock = INVALID_SOCKET;
+    *tpmSock = INVALID_SOCKET;
+
+    *otherSock = connectUnixSocket( platformPath, debugfunc, data );
+    if (*otherSock == INVALID_SOCKET)
+        return 1;
+
+    *tpmSock = connectUnixSocket( tpmPath, debugfunc, data );
+    if (*tpmSock == INVALID_SOCKET ||
+        setNonBlocking( *tpmSock, debugfunc, data ))
+    {
+        CloseSockets( *otherSock, *tpmSock );
+        *otherSock = INVALID_SOCKET;
+        *tpmSock = INVALID_SOCKET;
+        return 1;
     }
 
     return 0;
 }
+
+/*
+ * Listening counterpart to connectUnixSocket for services on the other
+ * end of a Unix socket TCTI. A stale socket file at 'path' is replaced.
+ */
+SOCKET
+listenUnixSocket( const char *path, TCTI_LOG_CALLBACK debugfunc, void *data )
+{
+    struct sockaddr_un addr;
+    socklen_t addrLen;
+    SOCKET sock;
+
+    if (unixAddress( path, &addr, &addrLen )) {
+        SAFE_CALL( debugfunc, data, NO_PREFIX, "invalid unix socket path: %s\n", path );
+        return INVALID_SOCKET;
+    }
+    sock = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if (sock == INVALID_SOCKET) {
+        SAFE_CALL( debugfunc, data, NO_PREFIX, "socket creation failed with error = %d\n", WSAGetLastError() );
+        return INVALID_SOCKET;
+    }
+    if (path[0] != '@')
+        unlink( path );
+    if (bind( sock, (SOCKADDR *) &addr, addrLen ) == SOCKET_ERROR ||
+        listen( sock, SOMAXCONN ) == SOCKET_ERROR)
+    {
+        SAFE_CALL( debugfunc, data, NO_PREFIX, "listening on %s failed with error: %d\n", path, WSAGetLastError() );
+        closesocket( sock );
+        return INVALID_SOCKET;
+    }
+
+    return sock;
+}
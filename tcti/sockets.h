@@ -6,6 +6,7 @@ extern "C" {
 
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <arpa/inet.h>
 void WSACleanup();
@@ -25,9 +26,23 @@ InitSockets( const char *hostName,
              SOCKET *tpmSock,
              TCTI_LOG_CALLBACK  logCallback,
              void *logData );
+int
+InitUnixSockets( const char *tpmPath,
+                 const char *platformPath,
+                 SOCKET *otherSock,
+                 SOCKET *tpmSock,
+                 TCTI_LOG_CALLBACK logCallback,
+                 void *logData );
+SOCKET connectUnixSocket( const char *path, TCTI_LOG_CALLBACK logCallback, void *logData );
+SOCKET listenUnixSocket( const char *path, TCTI_LOG_CALLBACK logCallback, void *logData );
 void CloseSockets( SOCKET serverSock, SOCKET tpmSock );
 TSS2_RC recvBytes( SOCKET tpmSock, unsigned char *data, int len );
 TSS2_RC sendBytes( SOCKET tpmSock, const unsigned char *data, int len );
+TSS2_RC sendBytesv( SOCKET tpmSock, struct iovec *iov, int iovcnt );
+ssize_t recvBytesv( SOCKET tpmSock, struct iovec *iov, int iovcnt );
+int waitSocket( SOCKET sock, short events, int timeout );
+int wouldBlock();
+int setSocketBlocking( SOCKET sock );
 
 #ifdef __cplusplus
 }
@@ -25,6 +25,8 @@
  * THE POSSIBILITY OF SUCH DAMAGE.
  ***********************************************************************/
 
+#include <errno.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -67,13 +69,50 @@ TSS2_RC tcti_send_checks (
     if (command_buffer == NULL) {
         return TSS2_TCTI_RC_BAD_REFERENCE;
     }
-    if (tcti_intel->previousStage == TCTI_STAGE_SEND_COMMAND) {
+    /* a pipelining queue sends again before the previous response is in */
+    if (tcti_intel->previousStage == TCTI_STAGE_SEND_COMMAND &&
+        tcti_intel->status.queueDriving == 0) {
+        return TSS2_TCTI_RC_BAD_SEQUENCE;
+    }
+    if (tcti_intel->queueCount != 0 && tcti_intel->status.queueDriving == 0) {
         return TSS2_TCTI_RC_BAD_SEQUENCE;
     }
 
     return TSS2_RC_SUCCESS;
 }
 
+TSS2_RC tcti_sendv_checks (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    const struct iovec *iov,
+    int iovcnt,
+    size_t *command_size
+    )
+{
+    TSS2_RC rc;
+    int i;
+
+    rc = tcti_send_checks (tctiContext, (uint8_t*)iov);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    if (iovcnt <= 0 || iovcnt > TCTI_TRANSMITV_IOV_MAX || command_size == NULL) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+
+    *command_size = 0;
+    for (i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_base == NULL && iov[i].iov_len != 0) {
+            return TSS2_TCTI_RC_BAD_REFERENCE;
+        }
+        *command_size += iov[i].iov_len;
+    }
+    if (*command_size < sizeof (TPM2_ST) + 2 * sizeof (UINT32)) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
 TSS2_RC tcti_receive_checks (
     TSS2_TCTI_CONTEXT *tctiContext,
     size_t *response_size,
@@ -88,12 +127,220 @@ TSS2_RC tcti_receive_checks (
     if (rc != TSS2_RC_SUCCESS) {
         return rc;
     }
-    if (response_buffer == NULL || response_size == NULL) {
+    /* A NULL response_buffer queries the size of the pending response. */
+    if (response_size == NULL) {
+        return TSS2_TCTI_RC_BAD_REFERENCE;
+    }
+    if (tcti_intel->previousStage == TCTI_STAGE_RECEIVE_RESPONSE &&
+        tcti_intel->status.queueDriving == 0) {
+        return TSS2_TCTI_RC_BAD_SEQUENCE;
+    }
+    if (tcti_intel->queueCount != 0 && tcti_intel->status.queueDriving == 0) {
+        return TSS2_TCTI_RC_BAD_SEQUENCE;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * Transmit queued commands until queueWindow of them are in flight. A
+ * transmit that would block is retried on the next call; any other
+ * failure is recorded in the entry and reported when it is reaped, and
+ * nothing behind it is sent until then so responses stay in order.
+ */
+static void tcti_queue_start (
+    TSS2_TCTI_CONTEXT *tctiContext
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TCTI_QUEUE_ENTRY *entry;
+    TSS2_RC rc;
+
+    while (tcti_intel->queueSent < tcti_intel->queueCount &&
+           tcti_intel->queueSent < tcti_intel->queueWindow) {
+        entry = &tcti_intel->queue [(tcti_intel->queueHead +
+                                     tcti_intel->queueSent) %
+                                    TCTI_QUEUE_DEPTH];
+        if (entry->rc != TSS2_RC_SUCCESS) {
+            return;
+        }
+
+        tcti_intel->status.queueDriving = 1;
+        rc = TSS2_TCTI_TRANSMIT (tctiContext) (tctiContext,
+                                               entry->commandSize,
+                                               entry->command);
+        tcti_intel->status.queueDriving = 0;
+        if (rc == TSS2_RC_SUCCESS) {
+            tcti_intel->queueSent++;
+        } else {
+            if (rc != TSS2_TCTI_RC_TRY_AGAIN) {
+                entry->rc = rc;
+            }
+            return;
+        }
+    }
+}
+
+/*
+ * Wait until the TCTI can take the command whose transmit would have
+ * blocked: its poll handle, polled for POLLOUT. Used by a blocking 'reap',
+ * which must not hand TSS2_TCTI_RC_TRY_AGAIN back to its caller. The
+ * TCTIs sharing this queue all have a single poll handle.
+ */
+static TSS2_RC tcti_queue_wait_writable (
+    TSS2_TCTI_CONTEXT *tctiContext
+    )
+{
+    TSS2_TCTI_POLL_HANDLE handle;
+    size_t num_handles = 1;
+    TSS2_RC rc;
+    int ret;
+
+    rc = tss2_tcti_get_poll_handles (tctiContext, &handle, &num_handles);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    handle.events = POLLOUT;
+    handle.revents = 0;
+    do {
+        ret = poll (&handle, 1, -1);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC tcti_submit (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t command_size,
+    uint8_t *command,
+    size_t response_size,
+    uint8_t *response,
+    uint64_t user_tag
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TCTI_QUEUE_ENTRY *entry;
+    TSS2_RC rc;
+
+    rc = tcti_common_checks (tctiContext);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    if (command == NULL || response == NULL) {
         return TSS2_TCTI_RC_BAD_REFERENCE;
     }
-    if (tcti_intel->previousStage == TCTI_STAGE_RECEIVE_RESPONSE) {
+    /*
+     * A response that didn't fit would stay with the TCTI and be taken
+     * for the next command's, so only buffers that fit any are accepted.
+     */
+    if (response_size < TPM2_MAX_RESPONSE_SIZE) {
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+    /* a command sent with 'transmit' is still waiting for 'receive' */
+    if (tcti_intel->queueCount == 0 &&
+        tcti_intel->previousStage == TCTI_STAGE_SEND_COMMAND) {
         return TSS2_TCTI_RC_BAD_SEQUENCE;
     }
+    if (tcti_intel->queueCount == TCTI_QUEUE_DEPTH) {
+        return TSS2_TCTI_RC_TRY_AGAIN;
+    }
+
+    entry = &tcti_intel->queue [(tcti_intel->queueHead + tcti_intel->queueCount) %
+                                TCTI_QUEUE_DEPTH];
+    entry->command = command;
+    entry->commandSize = command_size;
+    entry->response = response;
+    entry->responseSize = response_size;
+    entry->userTag = user_tag;
+    entry->rc = TSS2_RC_SUCCESS;
+    tcti_intel->queueCount++;
+
+    tcti_queue_start (tctiContext);
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC tcti_reap (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    TSS2_TCTI_COMPLETION *completions,
+    size_t max,
+    size_t *count,
+    int32_t timeout
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TCTI_QUEUE_ENTRY *entry;
+    size_t size;
+    int sent;
+    TSS2_RC rc;
+
+    rc = tcti_common_checks (tctiContext);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    if (count == NULL || (completions == NULL && max != 0)) {
+        return TSS2_TCTI_RC_BAD_REFERENCE;
+    }
+    if (timeout < TSS2_TCTI_TIMEOUT_BLOCK) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+
+    *count = 0;
+    while (*count < max && tcti_intel->queueCount > 0) {
+        entry = &tcti_intel->queue [tcti_intel->queueHead];
+        tcti_queue_start (tctiContext);
+
+        size = 0;
+        sent = tcti_intel->queueSent > 0;
+        if (entry->rc == TSS2_RC_SUCCESS && !sent) {
+            /* its transmit would block: wait for it if this one may block */
+            if (*count > 0 || timeout != TSS2_TCTI_TIMEOUT_BLOCK) {
+                break;
+            }
+            rc = tcti_queue_wait_writable (tctiContext);
+            if (rc == TSS2_RC_SUCCESS) {
+                continue;
+            }
+            entry->rc = rc;
+        } else if (entry->rc == TSS2_RC_SUCCESS) {
+            /* only the first completion is waited for */
+            size = entry->responseSize;
+            tcti_intel->status.queueDriving = 1;
+            rc = TSS2_TCTI_RECEIVE (tctiContext) (tctiContext,
+                                                  &size,
+                                                  entry->response,
+                                                  *count == 0 ? timeout :
+                                                  TSS2_TCTI_TIMEOUT_NONE);
+            tcti_intel->status.queueDriving = 0;
+            if (rc == TSS2_TCTI_RC_TRY_AGAIN) {
+                break;
+            }
+            entry->rc = rc;
+            if (rc != TSS2_RC_SUCCESS) {
+                size = 0;
+            }
+        }
+
+        completions [*count].user_tag = entry->userTag;
+        completions [*count].rc = entry->rc;
+        completions [*count].response_size = size;
+        (*count)++;
+
+        tcti_intel->queueHead = (tcti_intel->queueHead + 1) % TCTI_QUEUE_DEPTH;
+        tcti_intel->queueCount--;
+        if (sent) {
+            tcti_intel->queueSent--;
+        }
+    }
+    /* keep the TPM busy while the caller processes this batch */
+    tcti_queue_start (tctiContext);
+
+    if (*count == 0 && tcti_intel->queueCount > 0) {
+        return TSS2_TCTI_RC_TRY_AGAIN;
+    }
 
     return TSS2_RC_SUCCESS;
 }
@@ -48,7 +48,16 @@
 #include <tcti/common.h>
 
 #define TCTI_MAGIC   0x7e18e9defa8bc9e2
-#define TCTI_VERSION 0x1
+#define TCTI_VERSION 0x3
+/*
+ * Size of the socket TCTI receive ring: room for a maximum size response
+ * plus the simulator framing, with whatever the peer sent past it.
+ */
+#define TCTI_RECV_RING_SIZE 8192
+/* Upper bound on the number of buffers accepted by 'transmitv'. */
+#define TCTI_TRANSMITV_IOV_MAX 16
+/* Number of commands 'submit' can queue before they are reaped. */
+#define TCTI_QUEUE_DEPTH 32
 
 #define TCTI_LOG_CALLBACK(ctx) ((TSS2_TCTI_CONTEXT_INTEL*)ctx)->logCallback
 #define TCTI_LOG_DATA(ctx)     ((TSS2_TCTI_CONTEXT_INTEL*)ctx)->logData
@@ -57,6 +66,20 @@
 
 typedef TSS2_RC (*TCTI_TRANSMIT_PTR)( TSS2_TCTI_CONTEXT *tctiContext, size_t size, uint8_t *command);
 typedef TSS2_RC (*TCTI_RECEIVE_PTR) (TSS2_TCTI_CONTEXT *tctiContext, size_t *size, uint8_t *response, int32_t timeout);
+typedef TSS2_RC (*TCTI_TRANSMITV_PTR) (TSS2_TCTI_CONTEXT *tctiContext, const struct iovec *iov, int iovcnt);
+typedef TSS2_RC (*TCTI_SUBMIT_PTR) (TSS2_TCTI_CONTEXT *tctiContext, size_t command_size, uint8_t *command, size_t response_size, uint8_t *response, uint64_t user_tag);
+typedef TSS2_RC (*TCTI_REAP_PTR) (TSS2_TCTI_CONTEXT *tctiContext, TSS2_TCTI_COMPLETION *completions, size_t max, size_t *count, int32_t timeout);
+
+/* A command queued by 'submit'. */
+typedef struct {
+    uint8_t *command;
+    size_t commandSize;
+    uint8_t *response;
+    size_t responseSize;
+    uint64_t userTag;
+    /* set when transmitting the command failed, reported by 'reap' */
+    TSS2_RC rc;
+} TCTI_QUEUE_ENTRY;
 
 enum tctiStates { TCTI_STAGE_INITIALIZE, TCTI_STAGE_SEND_COMMAND, TCTI_STAGE_RECEIVE_RESPONSE };
 
@@ -71,6 +94,9 @@ typedef struct {
     TSS2_RC (*getPollHandles) (TSS2_TCTI_CONTEXT *tctiContext,
               TSS2_TCTI_POLL_HANDLE *handles, size_t *num_handles);
     TSS2_RC (*setLocality) (TSS2_TCTI_CONTEXT *tctiContext, uint8_t locality);
+    TCTI_TRANSMITV_PTR transmitv;
+    TCTI_SUBMIT_PTR submit;
+    TCTI_REAP_PTR reap;
     struct {
         UINT32 debugMsgEnabled: 1;
         UINT32 locality: 8;
@@ -85,6 +111,15 @@ typedef struct {
         UINT32 tagReceived: 1;
         UINT32 responseSizeReceived: 1;
         UINT32 protocolResponseSizeReceived: 1;
+        /* MS_SIM_CANCEL_ON went to the simulator and was not turned off. */
+        UINT32 cancelSent: 1;
+        /* transmit / receive are being called by the queue itself. */
+        UINT32 queueDriving: 1;
+        /* io_uring backend: operations submitted and not reaped yet. */
+        UINT32 uringSendPending: 1;
+        UINT32 uringRecvPending: 1;
+        /* getPollHandles was called: the caller may wait on them. */
+        UINT32 pollHandlesUsed: 1;
     } status;
 
     /* Following two fields used to save partial response in case receive buffer's too small. */
@@ -101,7 +136,50 @@ typedef struct {
     /* File descriptor for device file if real TPM is being used. */
     int devFile;
     UINT8 previousStage;            /* Used to check for sequencing errors. */
-    unsigned char responseBuffer[4096];
+    /*
+     * Device TCTI staging buffer, only allocated while a response that
+     * could not be read straight into the caller's buffer is pending.
+     */
+    UINT8 *responseBuffer;
+    /*
+     * io_uring backend (TCTI_FLAG_IO_URING), NULL when the synchronous
+     * system calls are used. uringSendSize is the size of the command
+     * whose send is in flight, uringError the first error reaped for it.
+     */
+    struct TCTI_URING *uring;
+    size_t uringSendSize;
+    TSS2_RC uringError;
+    /*
+     * Shared memory TCTI: the region shared with the service, its eventfd
+     * doorbells and the Unix socket the session was set up on.
+     */
+    struct TCTI_SHM_REGION *shmRegion;
+    int shmCommandDoorbell;
+    int shmResponseDoorbell;
+    SOCKET shmControl;
+    /*
+     * Multiplexing TCTI: the request this context hands to the mux's I/O
+     * thread, holding the command and then the response.
+     */
+    struct TCTI_MUX_REQUEST *muxRequest;
+    /*
+     * Receive ring for the socket TCTI, TCTI_RECV_RING_SIZE bytes placed
+     * right after this structure in the context blob. recvHead / recvTail
+     * are free running byte counts (consumed / received).
+     */
+    UINT32 recvHead;
+    UINT32 recvTail;
+    UINT8 *recvRing;
+    /*
+     * Commands queued by 'submit', oldest first. The first queueSent of
+     * them have been transmitted; up to queueWindow may be in flight,
+     * which is 1 unless the TCTI pipelines commands.
+     */
+    UINT32 queueHead;
+    UINT32 queueCount;
+    UINT32 queueSent;
+    UINT32 queueWindow;
+    TCTI_QUEUE_ENTRY queue [TCTI_QUEUE_DEPTH];
     TCTI_LOG_CALLBACK logCallback;
     TCTI_LOG_BUFFER_CALLBACK logBufferCallback;
     void *logData;
@@ -133,6 +211,16 @@ TSS2_RC tcti_send_checks (
     TSS2_TCTI_CONTEXT *tctiContext,
     uint8_t           *command_buffer
     );
+/*
+ * This function performs the 'transmit' checks for the iovec array passed
+ * to the TCTI 'transmitv' functions and returns the total command size.
+ */
+TSS2_RC tcti_sendv_checks (
+    TSS2_TCTI_CONTEXT  *tctiContext,
+    const struct iovec *iov,
+    int                 iovcnt,
+    size_t             *command_size
+    );
 /*
  * This function performs common checks on the context structure, buffer and
  * size parameter passed to the TCTI 'receive' functions.
@@ -142,5 +230,25 @@ TSS2_RC tcti_receive_checks (
     size_t            *response_size,
     unsigned char     *response_buffer
     );
+/*
+ * Completion queue ('submit' / 'reap') shared by the TCTIs: queued commands
+ * are sent and received one at a time through the context's own 'transmit'
+ * and 'receive' functions.
+ */
+TSS2_RC tcti_submit (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t             command_size,
+    uint8_t           *command,
+    size_t             response_size,
+    uint8_t           *response,
+    uint64_t           user_tag
+    );
+TSS2_RC tcti_reap (
+    TSS2_TCTI_CONTEXT    *tctiContext,
+    TSS2_TCTI_COMPLETION *completions,
+    size_t                max,
+    size_t               *count,
+    int32_t               timeout
+    );
 
 #endif
@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "sapi/tpm20.h"
@@ -35,10 +36,173 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
 #include "common/debug.h"
 #include "tcti.h"
 #include "tcti/tcti_device.h"
 #include "logging.h"
+#include "uring.h"
+
+/*
+ * With the io_uring backend the staging buffer is registered with the
+ * ring and carries the command out as well as the response back in.
+ */
+#define TCTI_DEVICE_IO_SIZE \
+    (TPM2_MAX_COMMAND_SIZE > TPM2_MAX_RESPONSE_SIZE ? \
+     TPM2_MAX_COMMAND_SIZE : TPM2_MAX_RESPONSE_SIZE)
+
+/*
+ * Queue the write of the command linked to the read of the response and
+ * submit both at once: the read is issued as soon as the driver took the
+ * command, without another system call from us.
+ */
+static TSS2_RC LocalTpmUringWriteCommand (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    const uint8_t *command_buffer,
+    size_t command_size,
+    printf_type rmPrefix
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TSS2_RC rval;
+
+    if (command_size > TCTI_DEVICE_IO_SIZE) {
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+    if (command_buffer != tcti_intel->responseBuffer) {
+        memcpy (tcti_intel->responseBuffer, command_buffer, command_size);
+    }
+
+    rval = tcti_uring_prep_write_fixed (tcti_intel->uring,
+                                        tcti_intel->devFile,
+                                        tcti_intel->responseBuffer,
+                                        command_size,
+                                        1,
+                                        TCTI_URING_SEND);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+    rval = tcti_uring_prep_read_fixed (tcti_intel->uring,
+                                       tcti_intel->devFile,
+                                       tcti_intel->responseBuffer,
+                                       TCTI_DEVICE_IO_SIZE,
+                                       0,
+                                       TCTI_URING_RECV);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+    rval = tcti_uring_submit (tcti_intel->uring);
+    if (rval != TSS2_RC_SUCCESS) {
+        TCTI_LOG (tctiContext,
+                  rmPrefix,
+                  "io_uring_enter failed with error: %d\n",
+                  errno);
+        return rval;
+    }
+
+    tcti_intel->status.uringSendPending = 1;
+    tcti_intel->status.uringRecvPending = 1;
+    tcti_intel->uringSendSize = command_size;
+    tcti_intel->uringError = TSS2_RC_SUCCESS;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * Reap the completions of the write and the read submitted by
+ * LocalTpmUringWriteCommand. Once both are in the response sits in the
+ * staging buffer: status.tagReceived is set and responseSize holds its
+ * size. A failed write cancels the linked read, the write's error is the
+ * one reported.
+ */
+static TSS2_RC LocalTpmUringWaitResponse (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    int32_t timeout,
+    printf_type rmPrefix
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TCTI_URING_COMPLETION completion;
+    TSS2_RC rval;
+
+    while (tcti_intel->status.uringSendPending == 1 ||
+           tcti_intel->status.uringRecvPending == 1) {
+        rval = tcti_uring_reap (tcti_intel->uring, &completion, timeout);
+        if (rval != TSS2_RC_SUCCESS) {
+            return rval;
+        }
+        if (completion.res < 0 &&
+            tcti_intel->uringError == TSS2_RC_SUCCESS) {
+            TCTI_LOG (tctiContext,
+                      rmPrefix,
+                      "%s failed with error: %d\n",
+                      completion.tag == TCTI_URING_SEND ? "write" : "read",
+                      -completion.res);
+            tcti_intel->uringError = TSS2_TCTI_RC_IO_ERROR;
+        }
+        if (completion.tag == TCTI_URING_SEND) {
+            tcti_intel->status.uringSendPending = 0;
+            if (completion.res >= 0 &&
+                (size_t)completion.res != tcti_intel->uringSendSize) {
+                tcti_intel->uringError = TSS2_TCTI_RC_IO_ERROR;
+            }
+        } else {
+            tcti_intel->status.uringRecvPending = 0;
+            tcti_intel->responseSize = completion.res;
+        }
+    }
+
+    rval = tcti_intel->uringError;
+    if (rval != TSS2_RC_SUCCESS) {
+        tcti_intel->uringError = TSS2_RC_SUCCESS;
+        return rval;
+    }
+    tcti_intel->status.tagReceived = 1;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC LocalTpmWriteCommand (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    const uint8_t *command_buffer,
+    size_t command_size,
+    printf_type rmPrefix
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TSS2_RC rval;
+    ssize_t size;
+
+    if (tcti_intel->uring != NULL) {
+        rval = LocalTpmUringWriteCommand (tctiContext,
+                                          command_buffer,
+                                          command_size,
+                                          rmPrefix);
+        if (rval != TSS2_RC_SUCCESS) {
+            return rval;
+        }
+    } else {
+        size = write (tcti_intel->devFile, command_buffer, command_size);
+        if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return TSS2_TCTI_RC_TRY_AGAIN;
+        } else if (size < 0) {
+            TCTI_LOG (tctiContext,
+                      rmPrefix,
+                      "send failed with error: %d\n",
+                      errno);
+            return TSS2_TCTI_RC_IO_ERROR;
+        } else if ((size_t)size != command_size) {
+            return TSS2_TCTI_RC_IO_ERROR;
+        }
+    }
+
+    tcti_intel->previousStage = TCTI_STAGE_SEND_COMMAND;
+    tcti_intel->status.tagReceived = 0;
+    tcti_intel->status.responseSizeReceived = 0;
+    tcti_intel->status.protocolResponseSizeReceived = 0;
+
+    return TSS2_RC_SUCCESS;
+}
 
 TSS2_RC LocalTpmSendTpmCommand(
     TSS2_TCTI_CONTEXT *tctiContext,
@@ -48,7 +212,6 @@ TSS2_RC LocalTpmSendTpmCommand(
 {
     TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
     TSS2_RC rval = TSS2_RC_SUCCESS;
-    ssize_t size;
 
 #ifdef DEBUG
     UINT32 commandCode;
@@ -85,25 +248,117 @@ TSS2_RC LocalTpmSendTpmCommand(
         DEBUG_PRINT_BUFFER (rmPrefix, command_buffer, cnt);
     }
 #endif
-    size = write (tcti_intel->devFile, command_buffer, command_size);
-    if (size < 0) {
+    return LocalTpmWriteCommand (tctiContext,
+                                 command_buffer,
+                                 command_size,
+                                 rmPrefix);
+}
+
+/*
+ * The kernel TPM driver treats every write () as one complete command and
+ * does not implement write_iter, so a writev () with more than one segment
+ * would be split into several writes by the VFS. Single buffers go to the
+ * driver as they are; anything else is gathered into one command first,
+ * straight into the registered buffer with the io_uring backend.
+ */
+TSS2_RC LocalTpmSendTpmCommandv(
+    TSS2_TCTI_CONTEXT *tctiContext,
+    const struct iovec *iov,
+    int iovcnt
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    uint8_t stack_buffer [TPM2_MAX_COMMAND_SIZE];
+    uint8_t *command_buffer = stack_buffer;
+    size_t command_size, offset = 0;
+    TSS2_RC rval;
+    int i;
+
+    rval = tcti_sendv_checks (tctiContext, iov, iovcnt, &command_size);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+    if (iovcnt == 1) {
+        return LocalTpmWriteCommand (tctiContext,
+                                     iov [0].iov_base,
+                                     command_size,
+                                     NO_PREFIX);
+    }
+    if (command_size > sizeof (stack_buffer)) {
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+    if (tcti_intel->uring != NULL) {
+        command_buffer = tcti_intel->responseBuffer;
+    }
+
+    for (i = 0; i < iovcnt; i++) {
+        memcpy (&command_buffer [offset], iov [i].iov_base, iov [i].iov_len);
+        offset += iov [i].iov_len;
+    }
+
+    return LocalTpmWriteCommand (tctiContext,
+                                 command_buffer,
+                                 command_size,
+                                 NO_PREFIX);
+}
+
+/*
+ * The device is opened O_NONBLOCK, so wait for the response with poll ()
+ * before reading it. TSS2_TCTI_TIMEOUT_BLOCK (-1) and
+ * TSS2_TCTI_TIMEOUT_NONE (0) map directly onto poll's timeout argument.
+ */
+static TSS2_RC LocalTpmWaitResponse (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    int32_t timeout,
+    printf_type rmPrefix
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    struct pollfd fds = {
+        .fd = tcti_intel->devFile,
+        .events = POLLIN,
+    };
+    int ret;
+
+    if (timeout < TSS2_TCTI_TIMEOUT_BLOCK) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+
+    do {
+        ret = poll (&fds, 1, timeout);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
         TCTI_LOG (tctiContext,
                   rmPrefix,
-                  "send failed with error: %d\n",
+                  "poll failed with error: %d\n",
                   errno);
         return TSS2_TCTI_RC_IO_ERROR;
-    } else if ((size_t)size != command_size) {
-        return TSS2_TCTI_RC_IO_ERROR;
+    } else if (ret == 0) {
+        return TSS2_TCTI_RC_TRY_AGAIN;
     }
 
-    tcti_intel->previousStage = TCTI_STAGE_SEND_COMMAND;
-    tcti_intel->status.tagReceived = 0;
-    tcti_intel->status.responseSizeReceived = 0;
-    tcti_intel->status.protocolResponseSizeReceived = 0;
-
     return TSS2_RC_SUCCESS;
 }
 
+/*
+ * Map a failed read () of the device onto a TCTI response code: with
+ * O_NONBLOCK a response that isn't ready yet is EAGAIN.
+ */
+static TSS2_RC LocalTpmReadError (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    printf_type rmPrefix
+    )
+{
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return TSS2_TCTI_RC_TRY_AGAIN;
+    }
+    TCTI_LOG (tctiContext,
+              rmPrefix,
+              "read failed with error: %d\n",
+              errno);
+    return TSS2_TCTI_RC_IO_ERROR;
+}
+
 TSS2_RC LocalTpmReceiveTpmResponse(
     TSS2_TCTI_CONTEXT *tctiContext,
     size_t *response_size,
@@ -114,7 +369,6 @@ TSS2_RC LocalTpmReceiveTpmResponse(
     TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
     TSS2_RC rval = TSS2_RC_SUCCESS;
     ssize_t  size;
-    unsigned int i;
     printf_type rmPrefix;
 
     rval = tcti_receive_checks (tctiContext, response_size, response_buffer);
@@ -128,38 +382,79 @@ TSS2_RC LocalTpmReceiveTpmResponse(
         rmPrefix = NO_PREFIX;
     }
 
-    if (tcti_intel->status.tagReceived == 0) {
-        size = read (tcti_intel->devFile, tcti_intel->responseBuffer, 4096);
+    /*
+     * The driver hands out a response in one read and older kernels drop
+     * whatever doesn't fit, so a read must always offer room for the
+     * largest response. A caller buffer that size is read into directly;
+     * anything else (including a size query) goes through the staging
+     * buffer, which is released once the response has been delivered.
+     * The io_uring backend always reads into the (registered) staging
+     * buffer, which then lives as long as the context.
+     */
+    if (tcti_intel->uring == NULL &&
+        tcti_intel->status.tagReceived == 0 &&
+        response_buffer != NULL &&
+        *response_size >= TPM2_MAX_RESPONSE_SIZE) {
+        rval = LocalTpmWaitResponse (tctiContext, timeout, rmPrefix);
+        if (rval != TSS2_RC_SUCCESS) {
+            goto retLocalTpmReceive;
+        }
+        size = read (tcti_intel->devFile, response_buffer, *response_size);
         if (size < 0) {
-            TCTI_LOG (tctiContext,
-                      rmPrefix,
-                      "read failed with error: %d\n",
-                      errno);
-            rval = TSS2_TCTI_RC_IO_ERROR;
+            rval = LocalTpmReadError (tctiContext, rmPrefix);
             goto retLocalTpmReceive;
-        } else {
+        }
+        tcti_intel->responseSize = size;
+        *response_size = size;
+    } else {
+        if (tcti_intel->status.tagReceived == 0 && tcti_intel->uring != NULL) {
+            rval = LocalTpmUringWaitResponse (tctiContext, timeout, rmPrefix);
+            if (rval != TSS2_RC_SUCCESS) {
+                goto retLocalTpmReceive;
+            }
+        } else if (tcti_intel->status.tagReceived == 0) {
+            rval = LocalTpmWaitResponse (tctiContext, timeout, rmPrefix);
+            if (rval != TSS2_RC_SUCCESS) {
+                goto retLocalTpmReceive;
+            }
+            if (tcti_intel->responseBuffer == NULL) {
+                tcti_intel->responseBuffer = malloc (TPM2_MAX_RESPONSE_SIZE);
+                if (tcti_intel->responseBuffer == NULL) {
+                    rval = TSS2_TCTI_RC_GENERAL_FAILURE;
+                    goto retLocalTpmReceive;
+                }
+            }
+            size = read (tcti_intel->devFile,
+                         tcti_intel->responseBuffer,
+                         TPM2_MAX_RESPONSE_SIZE);
+            if (size < 0) {
+                rval = LocalTpmReadError (tctiContext, rmPrefix);
+                goto retLocalTpmReceive;
+            }
             tcti_intel->status.tagReceived = 1;
             tcti_intel->responseSize = size;
         }
 
-        tcti_intel->responseSize = size;
-    }
+        if (response_buffer == NULL) {
+            *response_size = tcti_intel->responseSize;
+            goto retLocalTpmReceive;
+        }
 
-    if (response_buffer == NULL) {
-        *response_size = tcti_intel->responseSize;
-        goto retLocalTpmReceive;
-    }
+        if (*response_size < tcti_intel->responseSize) {
+            rval = TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+            *response_size = tcti_intel->responseSize;
+            goto retLocalTpmReceive;
+        }
 
-    if (*response_size < tcti_intel->responseSize) {
-        rval = TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
         *response_size = tcti_intel->responseSize;
-        goto retLocalTpmReceive;
-    }
-
-    *response_size = tcti_intel->responseSize;
-
-    for (i = 0; i < *response_size; i++) {
-        response_buffer[i] = tcti_intel->responseBuffer[i];
+        memcpy (response_buffer,
+                tcti_intel->responseBuffer,
+                tcti_intel->responseSize);
+        if (tcti_intel->uring == NULL) {
+            free (tcti_intel->responseBuffer);
+            tcti_intel->responseBuffer = NULL;
+        }
+        tcti_intel->status.tagReceived = 0;
     }
 
 #ifdef DEBUG
@@ -195,7 +490,11 @@ void LocalTpmFinalize(
     if (rc != TSS2_RC_SUCCESS) {
         return;
     }
+    tcti_uring_finalize (tcti_intel->uring);
+    tcti_intel->uring = NULL;
     close (tcti_intel->devFile);
+    free (tcti_intel->responseBuffer);
+    tcti_intel->responseBuffer = NULL;
 }
 
 TSS2_RC LocalTpmCancel(
@@ -206,13 +505,42 @@ TSS2_RC LocalTpmCancel(
     return TSS2_TCTI_RC_NOT_IMPLEMENTED;
 }
 
+/*
+ * The device file descriptor is the one handle to wait on: it becomes
+ * readable once the response to the command sent is available. With the
+ * io_uring backend the ring is waited on instead, it becomes readable
+ * once the submitted operations complete. A NULL 'handles' array queries
+ * the number of handles.
+ */
 TSS2_RC LocalTpmGetPollHandles(
     TSS2_TCTI_CONTEXT *tctiContext,
     TSS2_TCTI_POLL_HANDLE *handles,
     size_t *num_handles)
 {
-    /* Linux driver doesn't support polling. */
-    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TSS2_RC rc;
+
+    rc = tcti_common_checks (tctiContext);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    if (num_handles == NULL) {
+        return TSS2_TCTI_RC_BAD_REFERENCE;
+    }
+    if (handles != NULL && *num_handles < 1) {
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+
+    *num_handles = 1;
+    if (handles != NULL) {
+        handles->fd = tcti_intel->uring != NULL ?
+                      tcti_uring_fd (tcti_intel->uring) :
+                      tcti_intel->devFile;
+        handles->events = POLLIN;
+        handles->revents = 0;
+    }
+
+    return TSS2_RC_SUCCESS;
 }
 
 TSS2_RC LocalTpmSetLocality(
@@ -235,6 +563,7 @@ TSS2_RC InitDeviceTcti (
 {
     TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
     TSS2_RC rval = TSS2_RC_SUCCESS;
+    int flags = O_RDWR | O_NONBLOCK;
 
     if (tctiContext == NULL && contextSize == NULL) {
         return TSS2_TCTI_RC_BAD_VALUE;
@@ -255,16 +584,56 @@ TSS2_RC InitDeviceTcti (
     TSS2_TCTI_CANCEL (tctiContext) = LocalTpmCancel;
     TSS2_TCTI_GET_POLL_HANDLES (tctiContext) = LocalTpmGetPollHandles;
     TSS2_TCTI_SET_LOCALITY (tctiContext) = LocalTpmSetLocality;
+    TSS2_TCTI_TRANSMITV (tctiContext) = LocalTpmSendTpmCommandv;
+    TSS2_TCTI_SUBMIT (tctiContext) = tcti_submit;
+    TSS2_TCTI_REAP (tctiContext) = tcti_reap;
     tcti_intel->status.locality = 3;
     tcti_intel->status.commandSent = 0;
     tcti_intel->status.rmDebugPrefix = 0;
+    tcti_intel->status.tagReceived = 0;
+    tcti_intel->status.queueDriving = 0;
+    tcti_intel->status.uringSendPending = 0;
+    tcti_intel->status.uringRecvPending = 0;
+    tcti_intel->queueHead = 0;
+    tcti_intel->queueCount = 0;
+    tcti_intel->queueSent = 0;
+    tcti_intel->queueWindow = 1;
+    tcti_intel->responseBuffer = NULL;
+    tcti_intel->uring = NULL;
+    tcti_intel->uringError = TSS2_RC_SUCCESS;
     tcti_intel->currentTctiContext = 0;
     tcti_intel->previousStage = TCTI_STAGE_INITIALIZE;
     TCTI_LOG_CALLBACK (tctiContext) = config->logCallback;
     TCTI_LOG_DATA (tctiContext) = config->logData;
 
-    tcti_intel->devFile = open (config->device_path, O_RDWR);
+    if (config->flags & TCTI_FLAG_IO_URING) {
+        tcti_intel->responseBuffer = malloc (TCTI_DEVICE_IO_SIZE);
+        if (tcti_intel->responseBuffer == NULL) {
+            return TSS2_TCTI_RC_GENERAL_FAILURE;
+        }
+        rval = tcti_uring_init (&tcti_intel->uring,
+                                tcti_intel->responseBuffer,
+                                TCTI_DEVICE_IO_SIZE);
+        if (rval == TSS2_RC_SUCCESS) {
+            /* the ring waits for the driver, reads may block in the kernel */
+            flags = O_RDWR;
+        } else {
+            TCTI_LOG (tctiContext,
+                      NO_PREFIX,
+                      "io_uring unavailable (0x%x), using read / write\n",
+                      rval);
+            free (tcti_intel->responseBuffer);
+            tcti_intel->responseBuffer = NULL;
+            rval = TSS2_RC_SUCCESS;
+        }
+    }
+
+    tcti_intel->devFile = open (config->device_path, flags);
     if (tcti_intel->devFile < 0) {
+        tcti_uring_finalize (tcti_intel->uring);
+        tcti_intel->uring = NULL;
+        free (tcti_intel->responseBuffer);
+        tcti_intel->responseBuffer = NULL;
         return TSS2_TCTI_RC_IO_ERROR;
     }
 
@@ -0,0 +1,659 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sapi/tpm20.h"
+#include "sapi/tss2_mu.h"
+#include "tcti/tcti_mux.h"
+#include "tcti.h"
+#include "logging.h"
+
+#if TPM2_MAX_COMMAND_SIZE > TPM2_MAX_RESPONSE_SIZE
+#define TCTI_MUX_BUFFER_SIZE TPM2_MAX_COMMAND_SIZE
+#else
+#define TCTI_MUX_BUFFER_SIZE TPM2_MAX_RESPONSE_SIZE
+#endif
+
+/* Link of the submission queue. */
+typedef struct TCTI_MUX_NODE {
+    struct TCTI_MUX_NODE *next;
+} TCTI_MUX_NODE;
+
+/*
+ * One per TCTI context. The context fills in the command and queues the
+ * request, the I/O thread replaces the command with the response, rings
+ * 'doorbell' and sets 'done'. Only one side owns the request at a time:
+ * the context until it is queued, the I/O thread until 'done' is set.
+ * Setting 'done' is the I/O thread's last access to the request, and the
+ * doorbell is always rung before it, so a context that sees 'done' and
+ * drains the doorbell leaves no count behind for its next command.
+ */
+typedef struct TCTI_MUX_REQUEST {
+    TCTI_MUX_NODE node;
+    TCTI_MUX *mux;
+    int doorbell;
+    int done;
+    uint8_t locality;
+    TSS2_RC rc;
+    size_t size;
+    uint8_t buffer [TCTI_MUX_BUFFER_SIZE];
+} TCTI_MUX_REQUEST;
+
+/*
+ * The submission queue is an intrusive multiple producer / single
+ * consumer list: producers only exchange 'head' and link the previous
+ * node to theirs, the I/O thread alone walks from 'tail'. 'stub' keeps
+ * the list from ever becoming empty. The I/O thread sets 'sleeping'
+ * before waiting on 'wake' so producers only write it when needed.
+ */
+struct TCTI_MUX {
+    TSS2_TCTI_CONTEXT *tcti;
+    pthread_t thread;
+    int wake;
+    int sleeping;
+    int stop;
+    /* locality last set on 'tcti', -1 until a command was sent */
+    int locality;
+    TCTI_MUX_NODE *head;
+    TCTI_MUX_NODE *tail;
+    TCTI_MUX_NODE stub;
+};
+
+static void MuxPush (
+    TCTI_MUX *mux,
+    TCTI_MUX_NODE *node
+    )
+{
+    TCTI_MUX_NODE *prev;
+
+    __atomic_store_n (&node->next, NULL, __ATOMIC_RELAXED);
+    prev = __atomic_exchange_n (&mux->head, node, __ATOMIC_ACQ_REL);
+    __atomic_store_n (&prev->next, node, __ATOMIC_RELEASE);
+}
+
+/*
+ * Take the oldest request off the queue. NULL is also returned while a
+ * producer is between exchanging 'head' and linking its node, it rings
+ * 'wake' once done if the I/O thread went to sleep meanwhile.
+ */
+static TCTI_MUX_REQUEST *MuxPop (
+    TCTI_MUX *mux
+    )
+{
+    TCTI_MUX_NODE *tail = mux->tail;
+    TCTI_MUX_NODE *next = __atomic_load_n (&tail->next, __ATOMIC_ACQUIRE);
+
+    if (tail == &mux->stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+        mux->tail = next;
+        tail = next;
+        next = __atomic_load_n (&next->next, __ATOMIC_ACQUIRE);
+    }
+    if (next != NULL) {
+        mux->tail = next;
+        return (TCTI_MUX_REQUEST*)tail;
+    }
+    if (tail != __atomic_load_n (&mux->head, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    MuxPush (mux, &mux->stub);
+    next = __atomic_load_n (&tail->next, __ATOMIC_ACQUIRE);
+    if (next != NULL) {
+        mux->tail = next;
+        return (TCTI_MUX_REQUEST*)tail;
+    }
+
+    return NULL;
+}
+
+static void MuxRing (
+    int fd
+    )
+{
+    uint64_t one = 1;
+    ssize_t ret;
+
+    do {
+        ret = write (fd, &one, sizeof (one));
+    } while (ret < 0 && errno == EINTR);
+}
+
+static void MuxDrain (
+    int fd
+    )
+{
+    uint64_t count;
+    ssize_t ret;
+
+    do {
+        ret = read (fd, &count, sizeof (count));
+    } while (ret < 0 && errno == EINTR);
+}
+
+/*
+ * Send a request's command through the underlying TCTI and receive the
+ * response in its place. Errors are reported to the request's owner.
+ */
+static void MuxExecute (
+    TCTI_MUX *mux,
+    TCTI_MUX_REQUEST *request
+    )
+{
+    size_t size = sizeof (request->buffer);
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    if (mux->locality != request->locality) {
+        rc = tss2_tcti_set_locality (mux->tcti, request->locality);
+        if (rc == TSS2_RC_SUCCESS || rc == TSS2_TCTI_RC_NOT_IMPLEMENTED) {
+            mux->locality = request->locality;
+            rc = TSS2_RC_SUCCESS;
+        }
+    }
+    if (rc == TSS2_RC_SUCCESS) {
+        rc = tss2_tcti_transmit (mux->tcti, request->size, request->buffer);
+    }
+    if (rc == TSS2_RC_SUCCESS) {
+        rc = tss2_tcti_receive (mux->tcti,
+                                &size,
+                                request->buffer,
+                                TSS2_TCTI_TIMEOUT_BLOCK);
+    }
+    request->rc = rc;
+    request->size = rc == TSS2_RC_SUCCESS ? size : 0;
+    MuxRing (request->doorbell);
+    /* the request may be freed as soon as 'done' is set */
+    __atomic_store_n (&request->done, 1, __ATOMIC_RELEASE);
+}
+
+static void *MuxThread (
+    void *arg
+    )
+{
+    TCTI_MUX *mux = (TCTI_MUX*)arg;
+    TCTI_MUX_REQUEST *request;
+    struct pollfd pfd;
+
+    for (;;) {
+        request = MuxPop (mux);
+        if (request == NULL) {
+            if (__atomic_load_n (&mux->stop, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+            __atomic_store_n (&mux->sleeping, 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence (__ATOMIC_SEQ_CST);
+            request = MuxPop (mux);
+            if (request == NULL &&
+                !__atomic_load_n (&mux->stop, __ATOMIC_ACQUIRE)) {
+                pfd.fd = mux->wake;
+                pfd.events = POLLIN;
+                while (poll (&pfd, 1, -1) < 0 && errno == EINTR);
+            }
+            __atomic_store_n (&mux->sleeping, 0, __ATOMIC_RELAXED);
+            MuxDrain (mux->wake);
+            if (request == NULL) {
+                continue;
+            }
+        }
+        MuxExecute (mux, request);
+    }
+
+    return NULL;
+}
+
+static void MuxQueue (
+    TCTI_MUX *mux,
+    TCTI_MUX_REQUEST *request
+    )
+{
+    MuxPush (mux, &request->node);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    if (__atomic_load_n (&mux->sleeping, __ATOMIC_RELAXED)) {
+        MuxRing (mux->wake);
+    }
+}
+
+TSS2_RC TctiMuxNew (
+    TSS2_TCTI_CONTEXT *tcti,
+    TCTI_MUX **mux
+    )
+{
+    TCTI_MUX *new_mux;
+
+    if (tcti == NULL || mux == NULL) {
+        return TSS2_TCTI_RC_BAD_REFERENCE;
+    }
+    new_mux = calloc (1, sizeof (TCTI_MUX));
+    if (new_mux == NULL) {
+        return TSS2_TCTI_RC_GENERAL_FAILURE;
+    }
+    new_mux->tcti = tcti;
+    new_mux->locality = -1;
+    new_mux->head = &new_mux->stub;
+    new_mux->tail = &new_mux->stub;
+    new_mux->wake = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (new_mux->wake < 0) {
+        free (new_mux);
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+    if (pthread_create (&new_mux->thread, NULL, MuxThread, new_mux) != 0) {
+        close (new_mux->wake);
+        free (new_mux);
+        return TSS2_TCTI_RC_GENERAL_FAILURE;
+    }
+    *mux = new_mux;
+
+    return TSS2_RC_SUCCESS;
+}
+
+void TctiMuxFree (
+    TCTI_MUX *mux
+    )
+{
+    if (mux == NULL) {
+        return;
+    }
+    __atomic_store_n (&mux->stop, 1, __ATOMIC_RELEASE);
+    MuxRing (mux->wake);
+    pthread_join (mux->thread, NULL);
+    close (mux->wake);
+    free (mux);
+}
+
+/* What is left of the caller's timeout, measured from 'start'. */
+static int32_t MuxTimeoutLeft (
+    int32_t timeout,
+    const struct timespec *start
+    )
+{
+    struct timespec now;
+    int64_t elapsed;
+
+    if (timeout <= 0) {
+        return timeout;
+    }
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    elapsed = (int64_t)(now.tv_sec - start->tv_sec) * 1000 +
+              (now.tv_nsec - start->tv_nsec) / 1000000;
+
+    return elapsed >= timeout ? 0 : timeout - elapsed;
+}
+
+/*
+ * Wait up to 'timeout' for the I/O thread to be done with the request.
+ * The doorbell stays readable until the response has been consumed. It
+ * is rung just before 'done' is set, so a readable doorbell without
+ * 'done' only means the I/O thread is about to set it: 'done' is checked
+ * again rather than the doorbell drained, which would lose the ring.
+ */
+static TSS2_RC MuxWait (
+    TCTI_MUX_REQUEST *request,
+    int32_t timeout
+    )
+{
+    struct timespec start;
+    struct pollfd pfd;
+    int ret;
+
+    if (timeout > 0) {
+        clock_gettime (CLOCK_MONOTONIC, &start);
+    }
+    pfd.fd = request->doorbell;
+    pfd.events = POLLIN;
+    while (!__atomic_load_n (&request->done, __ATOMIC_ACQUIRE)) {
+        ret = poll (&pfd, 1, MuxTimeoutLeft (timeout, &start));
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        } else if (ret < 0) {
+            return TSS2_TCTI_RC_IO_ERROR;
+        } else if (ret == 0) {
+            return TSS2_TCTI_RC_TRY_AGAIN;
+        }
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC MuxSend (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    const struct iovec *iov,
+    int iovcnt,
+    size_t command_size
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TCTI_MUX_REQUEST *request = tcti_intel->muxRequest;
+    size_t offset = 0;
+    int i;
+
+    if (command_size > sizeof (request->buffer)) {
+        TCTI_LOG (tctiContext,
+                  NO_PREFIX,
+                  "command of %zu bytes is too large\n",
+                  command_size);
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+    for (i = 0; i < iovcnt; ++i) {
+        if (iov [i].iov_len > 0) {
+            memcpy (&request->buffer [offset], iov [i].iov_base, iov [i].iov_len);
+            offset += iov [i].iov_len;
+        }
+    }
+    request->size = command_size;
+    request->locality = tcti_intel->status.locality;
+    request->done = 0;
+    MuxQueue (request->mux, request);
+
+    tcti_intel->status.commandSent = 1;
+    tcti_intel->previousStage = TCTI_STAGE_SEND_COMMAND;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * The command is copied into the context's request once and queued, the
+ * caller doesn't wait for the I/O thread.
+ */
+TSS2_RC MuxTransmit (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t command_size,
+    uint8_t *command_buffer
+    )
+{
+    struct iovec iov;
+    size_t offset = sizeof (TPM2_ST);
+    UINT32 cnt;
+    TSS2_RC rval;
+
+    rval = tcti_send_checks (tctiContext, command_buffer);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+    rval = Tss2_MU_UINT32_Unmarshal (command_buffer,
+                                     command_size,
+                                     &offset,
+                                     &cnt);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+    if (cnt > command_size) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+
+    iov.iov_base = command_buffer;
+    iov.iov_len = cnt;
+
+    return MuxSend (tctiContext, &iov, 1, cnt);
+}
+
+TSS2_RC MuxTransmitv (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    const struct iovec *iov,
+    int iovcnt
+    )
+{
+    size_t command_size;
+    TSS2_RC rval;
+
+    rval = tcti_sendv_checks (tctiContext, iov, iovcnt, &command_size);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+
+    return MuxSend (tctiContext, iov, iovcnt, command_size);
+}
+
+/*
+ * The response stays in the request until it has been copied out, so a
+ * size query (NULL response_buffer) or a too small buffer keep it for the
+ * next call. Errors of the underlying TCTI are returned as they are.
+ */
+TSS2_RC MuxReceive (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *response_size,
+    uint8_t *response_buffer,
+    int32_t timeout
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TCTI_MUX_REQUEST *request;
+    TSS2_RC rval;
+
+    rval = tcti_receive_checks (tctiContext, response_size, response_buffer);
+    if (rval != TSS2_RC_SUCCESS) {
+        goto retMuxReceive;
+    }
+    if (tcti_intel->status.commandSent == 0) {
+        rval = TSS2_TCTI_RC_BAD_SEQUENCE;
+        goto retMuxReceive;
+    }
+    request = tcti_intel->muxRequest;
+
+    rval = MuxWait (request, timeout);
+    if (rval != TSS2_RC_SUCCESS) {
+        goto retMuxReceive;
+    }
+    if (request->rc != TSS2_RC_SUCCESS) {
+        TCTI_LOG (tctiContext,
+                  NO_PREFIX,
+                  "underlying TCTI failed: 0x%x\n",
+                  request->rc);
+        rval = request->rc;
+        MuxDrain (request->doorbell);
+        tcti_intel->status.commandSent = 0;
+        /* the command is over, the context may send the next one */
+        tcti_intel->previousStage = TCTI_STAGE_RECEIVE_RESPONSE;
+        goto retMuxReceive;
+    }
+
+    tcti_intel->responseSize = request->size;
+    if (response_buffer == NULL) {
+        *response_size = request->size;
+        goto retMuxReceive;
+    }
+    if (*response_size < request->size) {
+        *response_size = request->size;
+        rval = TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+        goto retMuxReceive;
+    }
+
+    memcpy (response_buffer, request->buffer, request->size);
+    *response_size = request->size;
+    MuxDrain (request->doorbell);
+    tcti_intel->status.commandSent = 0;
+
+retMuxReceive:
+    if (rval == TSS2_RC_SUCCESS && response_buffer != NULL) {
+        tcti_intel->previousStage = TCTI_STAGE_RECEIVE_RESPONSE;
+    }
+
+    return rval;
+}
+
+/*
+ * A command still queued or in flight is waited for: the I/O thread owns
+ * the request, doorbell included, until it has set 'done'.
+ */
+void MuxFinalize (
+    TSS2_TCTI_CONTEXT *tctiContext
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TCTI_MUX_REQUEST *request;
+    TSS2_RC rc;
+
+    rc = tcti_common_checks (tctiContext);
+    if (rc != TSS2_RC_SUCCESS) {
+        return;
+    }
+    request = tcti_intel->muxRequest;
+    if (request == NULL) {
+        return;
+    }
+    if (tcti_intel->status.commandSent == 1) {
+        while (MuxWait (request, TSS2_TCTI_TIMEOUT_BLOCK) != TSS2_RC_SUCCESS);
+    }
+    close (request->doorbell);
+    free (request);
+    tcti_intel->muxRequest = NULL;
+}
+
+/* The underlying TCTI is shared, a command can't be cancelled for one context. */
+TSS2_RC MuxCancel (
+    TSS2_TCTI_CONTEXT *tctiContext
+    )
+{
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+/* The request's doorbell is readable while a response waits to be received. */
+TSS2_RC MuxGetPollHandles (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    TSS2_TCTI_POLL_HANDLE *handles,
+    size_t *num_handles
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TSS2_RC rc;
+
+    rc = tcti_common_checks (tctiContext);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    if (num_handles == NULL) {
+        return TSS2_TCTI_RC_BAD_REFERENCE;
+    }
+    if (handles != NULL && *num_handles < 1) {
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+
+    *num_handles = 1;
+    if (handles != NULL) {
+        handles->fd = tcti_intel->muxRequest->doorbell;
+        handles->events = POLLIN;
+        handles->revents = 0;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+/* Applied to the underlying TCTI by the I/O thread before each command. */
+TSS2_RC MuxSetLocality (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    uint8_t locality
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TSS2_RC rc;
+
+    rc = tcti_common_checks (tctiContext);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    if (tcti_intel->status.commandSent == 1) {
+        return TSS2_TCTI_RC_BAD_SEQUENCE;
+    }
+    tcti_intel->status.locality = locality;
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC InitMuxTcti (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *contextSize,
+    const TCTI_MUX_CONF *config
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TCTI_MUX_REQUEST *request;
+
+    if (tctiContext == NULL && contextSize == NULL) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    } else if (tctiContext == NULL) {
+        *contextSize = sizeof (TSS2_TCTI_CONTEXT_INTEL);
+        return TSS2_RC_SUCCESS;
+    }
+    if (config == NULL || config->mux == NULL) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+
+    request = calloc (1, sizeof (TCTI_MUX_REQUEST));
+    if (request == NULL) {
+        return TSS2_TCTI_RC_GENERAL_FAILURE;
+    }
+    request->mux = config->mux;
+    request->doorbell = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (request->doorbell < 0) {
+        free (request);
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+
+    TSS2_TCTI_MAGIC (tctiContext) = TCTI_MAGIC;
+    TSS2_TCTI_VERSION (tctiContext) = TCTI_VERSION;
+    TSS2_TCTI_TRANSMIT (tctiContext) = MuxTransmit;
+    TSS2_TCTI_RECEIVE (tctiContext) = MuxReceive;
+    TSS2_TCTI_FINALIZE (tctiContext) = MuxFinalize;
+    TSS2_TCTI_CANCEL (tctiContext) = MuxCancel;
+    TSS2_TCTI_GET_POLL_HANDLES (tctiContext) = MuxGetPollHandles;
+    TSS2_TCTI_SET_LOCALITY (tctiContext) = MuxSetLocality;
+    TSS2_TCTI_TRANSMITV (tctiContext) = MuxTransmitv;
+    TSS2_TCTI_SUBMIT (tctiContext) = tcti_submit;
+    TSS2_TCTI_REAP (tctiContext) = tcti_reap;
+    tcti_intel->status.debugMsgEnabled = 0;
+    tcti_intel->status.locality = 3;
+    tcti_intel->status.commandSent = 0;
+    tcti_intel->status.rmDebugPrefix = 0;
+    tcti_intel->status.tagReceived = 0;
+    tcti_intel->status.queueDriving = 0;
+    tcti_intel->status.pollHandlesUsed = 0;
+    tcti_intel->queueHead = 0;
+    tcti_intel->queueCount = 0;
+    tcti_intel->queueSent = 0;
+    tcti_intel->queueWindow = 1;
+    tcti_intel->responseBuffer = NULL;
+    tcti_intel->uring = NULL;
+    tcti_intel->shmRegion = NULL;
+    tcti_intel->muxRequest = request;
+    tcti_intel->currentTctiContext = 0;
+    tcti_intel->previousStage = TCTI_STAGE_INITIALIZE;
+    TCTI_LOG_CALLBACK (tctiContext) = config->logCallback;
+    TCTI_LOG_BUFFER_CALLBACK (tctiContext) = NULL;
+    TCTI_LOG_DATA (tctiContext) = config->logData;
+
+    return TSS2_RC_SUCCESS;
+}
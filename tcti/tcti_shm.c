@@ -0,0 +1,465 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sapi/tpm20.h"
+#include "sapi/tss2_mu.h"
+#include "tcti/tcti_shm.h"
+#include "tcti.h"
+#include "logging.h"
+#include "sockets.h"
+#include "shm.h"
+
+static TSS2_RC ShmSend (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    const struct iovec *iov,
+    int iovcnt,
+    size_t command_size
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TSS2_RC rval;
+
+    rval = tcti_shm_send (&tcti_intel->shmRegion->command,
+                          tcti_intel->shmCommandDoorbell,
+                          iov,
+                          iovcnt,
+                          command_size,
+                          tcti_intel->status.locality);
+    if (rval != TSS2_RC_SUCCESS) {
+        TCTI_LOG (tctiContext,
+                  NO_PREFIX,
+                  "command of %zu bytes doesn't fit the command ring: 0x%x\n",
+                  command_size,
+                  rval);
+        return rval;
+    }
+
+    tcti_intel->status.commandSent = 1;
+    tcti_intel->previousStage = TCTI_STAGE_SEND_COMMAND;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * The command is copied into the shared command ring once, there is no
+ * system call unless the service went to sleep waiting for it.
+ */
+TSS2_RC ShmTransmit (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t command_size,
+    uint8_t *command_buffer
+    )
+{
+    struct iovec iov;
+    size_t offset = sizeof (TPM2_ST);
+    UINT32 cnt;
+    TSS2_RC rval;
+
+    rval = tcti_send_checks (tctiContext, command_buffer);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+    rval = Tss2_MU_UINT32_Unmarshal (command_buffer,
+                                     command_size,
+                                     &offset,
+                                     &cnt);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+    if (cnt > command_size) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+
+    iov.iov_base = command_buffer;
+    iov.iov_len = cnt;
+
+    return ShmSend (tctiContext, &iov, 1, cnt);
+}
+
+/* The buffers are gathered straight into the command ring. */
+TSS2_RC ShmTransmitv (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    const struct iovec *iov,
+    int iovcnt
+    )
+{
+    size_t command_size;
+    TSS2_RC rval;
+
+    rval = tcti_sendv_checks (tctiContext, iov, iovcnt, &command_size);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+
+    return ShmSend (tctiContext, iov, iovcnt, command_size);
+}
+
+/*
+ * The response is left in the ring until it has been copied out, so a
+ * size query (NULL response_buffer) or a too small buffer keep it for the
+ * next call. A response of size 0 is the service reporting that it got
+ * no response from the TPM.
+ */
+TSS2_RC ShmReceive (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *response_size,
+    uint8_t *response_buffer,
+    int32_t timeout
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TCTI_SHM_FRAME frame;
+    TSS2_RC rval;
+
+    rval = tcti_receive_checks (tctiContext, response_size, response_buffer);
+    if (rval != TSS2_RC_SUCCESS) {
+        goto retShmReceive;
+    }
+
+    rval = tcti_shm_wait (&tcti_intel->shmRegion->response,
+                          tcti_intel->shmResponseDoorbell,
+                          tcti_intel->shmControl,
+                          timeout,
+                          tcti_intel->status.pollHandlesUsed,
+                          TPM2_MAX_RESPONSE_SIZE,
+                          &frame);
+    if (rval != TSS2_RC_SUCCESS) {
+        if (rval != TSS2_TCTI_RC_TRY_AGAIN) {
+            TCTI_LOG (tctiContext,
+                      NO_PREFIX,
+                      "waiting for the response failed: 0x%x\n",
+                      rval);
+        }
+        goto retShmReceive;
+    }
+    if (frame.size == 0) {
+        tcti_shm_copy_out (&tcti_intel->shmRegion->response, &frame, NULL, 1);
+        tcti_intel->status.commandSent = 0;
+        tcti_intel->previousStage = TCTI_STAGE_RECEIVE_RESPONSE;
+        rval = TSS2_TCTI_RC_IO_ERROR;
+        goto retShmReceive;
+    }
+
+    tcti_intel->responseSize = frame.size;
+    if (response_buffer == NULL) {
+        *response_size = frame.size;
+        goto retShmReceive;
+    }
+    if (*response_size < frame.size) {
+        *response_size = frame.size;
+        rval = TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+        goto retShmReceive;
+    }
+
+    tcti_shm_copy_out (&tcti_intel->shmRegion->response,
+                       &frame,
+                       response_buffer,
+                       1);
+    *response_size = frame.size;
+    tcti_intel->status.commandSent = 0;
+
+retShmReceive:
+    if (rval == TSS2_RC_SUCCESS && response_buffer != NULL) {
+        tcti_intel->previousStage = TCTI_STAGE_RECEIVE_RESPONSE;
+    }
+
+    return rval;
+}
+
+static void ShmClose (
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel
+    )
+{
+    if (tcti_intel->shmRegion != NULL) {
+        munmap (tcti_intel->shmRegion, sizeof (TCTI_SHM_REGION));
+        tcti_intel->shmRegion = NULL;
+    }
+    if (tcti_intel->shmCommandDoorbell >= 0) {
+        close (tcti_intel->shmCommandDoorbell);
+        tcti_intel->shmCommandDoorbell = -1;
+    }
+    if (tcti_intel->shmResponseDoorbell >= 0) {
+        close (tcti_intel->shmResponseDoorbell);
+        tcti_intel->shmResponseDoorbell = -1;
+    }
+    if (tcti_intel->shmControl != INVALID_SOCKET) {
+        closesocket (tcti_intel->shmControl);
+        tcti_intel->shmControl = INVALID_SOCKET;
+    }
+}
+
+void ShmFinalize (
+    TSS2_TCTI_CONTEXT *tctiContext
+    )
+{
+    TSS2_RC rc;
+
+    rc = tcti_common_checks (tctiContext);
+    if (rc != TSS2_RC_SUCCESS) {
+        return;
+    }
+    ShmClose (tcti_context_intel_cast (tctiContext));
+}
+
+TSS2_RC ShmCancel (
+    TSS2_TCTI_CONTEXT *tctiContext
+    )
+{
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+/*
+ * The response doorbell is the handle to wait on. Once it was handed out
+ * the service is asked to ring it for every response, since the caller
+ * may be waiting on it instead of in 'receive'.
+ */
+TSS2_RC ShmGetPollHandles (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    TSS2_TCTI_POLL_HANDLE *handles,
+    size_t *num_handles
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TSS2_RC rc;
+
+    rc = tcti_common_checks (tctiContext);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    if (num_handles == NULL) {
+        return TSS2_TCTI_RC_BAD_REFERENCE;
+    }
+    if (handles != NULL && *num_handles < 1) {
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+
+    *num_handles = 1;
+    if (handles != NULL) {
+        tcti_intel->status.pollHandlesUsed = 1;
+        __atomic_store_n (&tcti_intel->shmRegion->response.sleeping,
+                          1,
+                          __ATOMIC_SEQ_CST);
+        handles->fd = tcti_intel->shmResponseDoorbell;
+        handles->events = POLLIN;
+        handles->revents = 0;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC ShmSetLocality (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    uint8_t locality
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TSS2_RC rc;
+
+    rc = tcti_common_checks (tctiContext);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    if (tcti_intel->status.commandSent == 1) {
+        return TSS2_TCTI_RC_BAD_SEQUENCE;
+    }
+    tcti_intel->status.locality = locality;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * Create the region and the doorbells and hand them to the service over
+ * the session socket. The memfd is sealed so the service can rely on its
+ * size. The service acknowledges with a single 0 byte.
+ */
+static TSS2_RC ShmHandshake (
+    TSS2_TCTI_CONTEXT *tctiContext
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    union {
+        struct cmsghdr header;
+        uint8_t buffer [CMSG_SPACE (3 * sizeof (int))];
+    } cmsg;
+    struct cmsghdr *header;
+    struct msghdr msg;
+    struct iovec iov;
+    uint8_t version = TCTI_SHM_VERSION, ack = 1;
+    TSS2_RC rval = TSS2_TCTI_RC_IO_ERROR;
+    int fds [3];
+    ssize_t ret;
+    void *map;
+    int memfd;
+
+    memfd = memfd_create ("tss2-tcti-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memfd < 0) {
+        TCTI_LOG (tctiContext,
+                  NO_PREFIX,
+                  "memfd_create failed with error: %d\n",
+                  errno);
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+    if (ftruncate (memfd, sizeof (TCTI_SHM_REGION)) < 0 ||
+        fcntl (memfd,
+               F_ADD_SEALS,
+               F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        goto out;
+    }
+    map = mmap (NULL,
+                sizeof (TCTI_SHM_REGION),
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED,
+                memfd,
+                0);
+    if (map == MAP_FAILED) {
+        goto out;
+    }
+    tcti_intel->shmRegion = map;
+    tcti_intel->shmRegion->magic = TCTI_SHM_MAGIC;
+    tcti_intel->shmRegion->version = TCTI_SHM_VERSION;
+    tcti_intel->shmRegion->ringSize = TCTI_SHM_RING_SIZE;
+
+    tcti_intel->shmCommandDoorbell = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+    tcti_intel->shmResponseDoorbell = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (tcti_intel->shmCommandDoorbell < 0 ||
+        tcti_intel->shmResponseDoorbell < 0) {
+        goto out;
+    }
+
+    fds [0] = memfd;
+    fds [1] = tcti_intel->shmCommandDoorbell;
+    fds [2] = tcti_intel->shmResponseDoorbell;
+    memset (&cmsg, 0, sizeof (cmsg));
+    memset (&msg, 0, sizeof (msg));
+    iov.iov_base = &version;
+    iov.iov_len = sizeof (version);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsg.buffer;
+    msg.msg_controllen = sizeof (cmsg.buffer);
+    header = CMSG_FIRSTHDR (&msg);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN (sizeof (fds));
+    memcpy (CMSG_DATA (header), fds, sizeof (fds));
+    do {
+        ret = sendmsg (tcti_intel->shmControl, &msg, MSG_NOSIGNAL);
+    } while (ret < 0 && errno == EINTR);
+    if (ret != sizeof (version)) {
+        goto out;
+    }
+    do {
+        ret = recv (tcti_intel->shmControl, &ack, sizeof (ack), 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret != sizeof (ack) || ack != 0) {
+        TCTI_LOG (tctiContext, NO_PREFIX, "service refused the session\n");
+        goto out;
+    }
+    rval = TSS2_RC_SUCCESS;
+
+out:
+    close (memfd);
+    return rval;
+}
+
+TSS2_RC InitShmTcti (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *contextSize,
+    const TCTI_SHM_CONF *config
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TSS2_RC rval;
+
+    if (tctiContext == NULL && contextSize == NULL) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    } else if (tctiContext == NULL) {
+        *contextSize = sizeof (TSS2_TCTI_CONTEXT_INTEL);
+        return TSS2_RC_SUCCESS;
+    }
+    if (config == NULL || config->path == NULL) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+
+    TSS2_TCTI_MAGIC (tctiContext) = TCTI_MAGIC;
+    TSS2_TCTI_VERSION (tctiContext) = TCTI_VERSION;
+    TSS2_TCTI_TRANSMIT (tctiContext) = ShmTransmit;
+    TSS2_TCTI_RECEIVE (tctiContext) = ShmReceive;
+    TSS2_TCTI_FINALIZE (tctiContext) = ShmFinalize;
+    TSS2_TCTI_CANCEL (tctiContext) = ShmCancel;
+    TSS2_TCTI_GET_POLL_HANDLES (tctiContext) = ShmGetPollHandles;
+    TSS2_TCTI_SET_LOCALITY (tctiContext) = ShmSetLocality;
+    TSS2_TCTI_TRANSMITV (tctiContext) = ShmTransmitv;
+    TSS2_TCTI_SUBMIT (tctiContext) = tcti_submit;
+    TSS2_TCTI_REAP (tctiContext) = tcti_reap;
+    tcti_intel->status.debugMsgEnabled = 0;
+    tcti_intel->status.locality = 3;
+    tcti_intel->status.commandSent = 0;
+    tcti_intel->status.rmDebugPrefix = 0;
+    tcti_intel->status.tagReceived = 0;
+    tcti_intel->status.queueDriving = 0;
+    tcti_intel->status.pollHandlesUsed = 0;
+    tcti_intel->queueHead = 0;
+    tcti_intel->queueCount = 0;
+    tcti_intel->queueSent = 0;
+    tcti_intel->queueWindow = 1;
+    tcti_intel->responseBuffer = NULL;
+    tcti_intel->uring = NULL;
+    tcti_intel->shmRegion = NULL;
+    tcti_intel->shmCommandDoorbell = -1;
+    tcti_intel->shmResponseDoorbell = -1;
+    tcti_intel->currentTctiContext = 0;
+    tcti_intel->previousStage = TCTI_STAGE_INITIALIZE;
+    TCTI_LOG_CALLBACK (tctiContext) = config->logCallback;
+    TCTI_LOG_BUFFER_CALLBACK (tctiContext) = NULL;
+    TCTI_LOG_DATA (tctiContext) = config->logData;
+
+    tcti_intel->shmControl = connectUnixSocket (config->path,
+                                                config->logCallback,
+                                                config->logData);
+    if (tcti_intel->shmControl == INVALID_SOCKET) {
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+    rval = ShmHandshake (tctiContext);
+    if (rval != TSS2_RC_SUCCESS) {
+        ShmClose (tcti_intel);
+    }
+
+    return rval;
+}
@@ -27,7 +27,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <poll.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include "sapi/tpm20.h"
 #include "sapi/tss2_mu.h"
@@ -38,34 +41,16 @@
 #include "logging.h"
 #include "sockets.h"
 #include "tss2_endian.h"
+#include "uring.h"
 
-static TSS2_RC tctiRecvBytes (
+static TSS2_RC SocketUringQueueRead (
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel
+    );
+static TSS2_RC SocketUringProcess (
     TSS2_TCTI_CONTEXT *tctiContext,
-    SOCKET sock,
-    unsigned char *data,
-    int len
-    )
-{
-    TSS2_RC result = 0;
-    result = recvBytes (sock, data, len);
-    if ((INT32)result == SOCKET_ERROR) {
-        TCTI_LOG (tctiContext,
-                  NO_PREFIX,
-                  "In recvBytes, recv failed (socket: 0x%x) with error: %d\n",
-                  sock,
-                  WSAGetLastError ());
-        return TSS2_TCTI_RC_IO_ERROR;
-    }
-#ifdef DEBUG_SOCKETS
-    TCTI_LOG (tctiContext,
-              NO_PREFIX,
-              "Receive Bytes from socket #0x%x: \n",
-              sock);
-    TCTI_LOG_BUFFER (tctiContext, NO_PREFIX, data, len);
-#endif
-
-    return TSS2_RC_SUCCESS;
-}
+    int32_t timeout,
+    printf_type rmPrefix
+    );
 
 static TSS2_RC tctiSendBytes (
     TSS2_TCTI_CONTEXT *tctiContext,
@@ -121,20 +106,180 @@ TSS2_RC SendSessionEndSocketTcti (
     return( rval );
 }
 
+/*
+ * io_uring variant of the send: the frame goes out with one sendmsg linked
+ * to a read into the receive ring (the ring's registered buffer) and both
+ * are submitted with a single system call, so the read is waiting on the
+ * socket by the time the simulator answers. Frame and command are copied
+ * next to the ring as the kernel may only pick them up after we returned.
+ */
+static TSS2_RC SocketUringSend (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    const struct iovec *iov,
+    int iovcnt,
+    size_t size
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TCTI_URING_SEND_DATA *data = tcti_uring_send_data (tcti_intel->uring);
+    size_t offset = 0;
+    TSS2_RC rval;
+    int link;
+    int i;
+
+    if (size > sizeof (data->buffer)) {
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+
+    /* the previous send must be done with the send data */
+    while (tcti_intel->status.uringSendPending == 1) {
+        rval = SocketUringProcess (tctiContext,
+                                   TSS2_TCTI_TIMEOUT_BLOCK,
+                                   NO_PREFIX);
+        if (rval != TSS2_RC_SUCCESS) {
+            return rval;
+        }
+    }
+
+    for (i = 0; i < iovcnt; i++) {
+        memcpy (&data->buffer [offset], iov [i].iov_base, iov [i].iov_len);
+        offset += iov [i].iov_len;
+    }
+    data->iov [0].iov_base = data->buffer;
+    data->iov [0].iov_len = offset;
+
+    link = tcti_intel->status.uringRecvPending == 0;
+    rval = tcti_uring_prep_sendmsg (tcti_intel->uring,
+                                    tcti_intel->tpmSock,
+                                    1,
+                                    MSG_NOSIGNAL,
+                                    link,
+                                    TCTI_URING_SEND);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+    if (link) {
+        rval = SocketUringQueueRead (tcti_intel);
+        if (rval != TSS2_RC_SUCCESS) {
+            return rval;
+        }
+    }
+    rval = tcti_uring_submit (tcti_intel->uring);
+    if (rval != TSS2_RC_SUCCESS) {
+        TCTI_LOG (tctiContext,
+                  NO_PREFIX,
+                  "io_uring_enter failed with error: %d\n",
+                  errno);
+        return rval;
+    }
+
+    tcti_intel->status.uringSendPending = 1;
+    tcti_intel->uringSendSize = size;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * Send a command to the simulator: the framing (TPM_SEND_COMMAND, locality,
+ * size) is assembled in front of the caller's buffers and the whole frame
+ * is handed to the kernel in a single sendmsg. With TCP_NODELAY set on the
+ * socket (see InitSockets) it leaves immediately instead of waiting on
+ * Nagle for the ACK of an earlier small segment.
+ */
+static TSS2_RC SocketSendFramed (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    const struct iovec *iov,
+    int iovcnt,
+    size_t command_size
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    struct iovec send_iov [TCTI_TRANSMITV_IOV_MAX + 1];
+    uint8_t frame [sizeof (UINT32) + sizeof (UINT8) + sizeof (UINT32)];
+    size_t offset = 0;
+    TSS2_RC rval;
+    int i;
+
+    rval = Tss2_MU_UINT32_Marshal (MS_SIM_TPM_SEND_COMMAND,
+                                   frame,
+                                   sizeof (frame),
+                                   &offset);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+    rval = Tss2_MU_UINT8_Marshal ((UINT8)tcti_intel->status.locality,
+                                  frame,
+                                  sizeof (frame),
+                                  &offset);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+    rval = Tss2_MU_UINT32_Marshal (command_size,
+                                   frame,
+                                   sizeof (frame),
+                                   &offset);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+
+    send_iov [0].iov_base = frame;
+    send_iov [0].iov_len = sizeof (frame);
+    for (i = 0; i < iovcnt; i++) {
+        send_iov [i + 1] = iov [i];
+    }
+
+#ifdef DEBUG_SOCKETS
+    TCTI_LOG (tctiContext,
+              NO_PREFIX,
+              "Send Bytes to socket #0x%x: \n",
+              tcti_intel->tpmSock);
+    for (i = 0; i <= iovcnt; i++) {
+        TCTI_LOG_BUFFER (tctiContext,
+                         NO_PREFIX,
+                         (UINT8 *)send_iov [i].iov_base,
+                         send_iov [i].iov_len);
+    }
+#endif
+
+    if (tcti_intel->uring != NULL) {
+        rval = SocketUringSend (tctiContext,
+                                send_iov,
+                                iovcnt + 1,
+                                sizeof (frame) + command_size);
+        if (rval != TSS2_RC_SUCCESS) {
+            return rval;
+        }
+    } else {
+        rval = sendBytesv (tcti_intel->tpmSock, send_iov, iovcnt + 1);
+        if (rval != TSS2_RC_SUCCESS) {
+            TCTI_LOG (tctiContext,
+                      NO_PREFIX,
+                      "In sendBytesv, sendmsg failed (socket: 0x%x) with error: %d\n",
+                      tcti_intel->tpmSock,
+                      WSAGetLastError ());
+            return rval;
+        }
+    }
+
+    tcti_intel->status.commandSent = 1;
+    tcti_intel->previousStage = TCTI_STAGE_SEND_COMMAND;
+
+    return TSS2_RC_SUCCESS;
+}
+
 TSS2_RC SocketSendTpmCommand(
     TSS2_TCTI_CONTEXT *tctiContext,
     size_t command_size,
     uint8_t *command_buffer
     )
 {
-    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
-    UINT32 tpmSendCommand;
-    UINT32 cnt, cnt1;
-    UINT8 locality;
+    struct iovec iov;
+    UINT32 cnt;
     TSS2_RC rval = TSS2_RC_SUCCESS;
     size_t offset;
 
 #ifdef DEBUG
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
     UINT32 commandCode;
     printf_type rmPrefix;
 #endif
@@ -182,26 +327,16 @@ TSS2_RC SocketSendTpmCommand(
                                      command_size,
                                      &offset,
                                      &cnt);
-
-    /* Send TPM2_SEND_COMMAND */
-    rval = Tss2_MU_UINT32_Marshal (MS_SIM_TPM_SEND_COMMAND,
-                           (uint8_t*)&tpmSendCommand,
-                           sizeof (tpmSendCommand),
-                           NULL);  /* Value for "send command" to MS simulator. */
-    rval = tctiSendBytes (tctiContext,
-                          tcti_intel->tpmSock,
-                          (unsigned char *)&tpmSendCommand,
-                          4);
     if (rval != TSS2_RC_SUCCESS) {
         return rval;
     }
+    if (cnt > command_size) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
 
-    /* Send the locality */
-    locality = (UINT8)tcti_intel->status.locality;
-    rval = tctiSendBytes (tctiContext,
-                          tcti_intel->tpmSock,
-                          (unsigned char *)&locality,
-                          1);
+    iov.iov_base = command_buffer;
+    iov.iov_len = cnt;
+    rval = SocketSendFramed (tctiContext, &iov, 1, cnt);
     if (rval != TSS2_RC_SUCCESS) {
         return rval;
     }
@@ -212,42 +347,32 @@ TSS2_RC SocketSendTpmCommand(
                   rmPrefix,
                   "Locality = %d",
                   tcti_intel->status.locality);
+        DEBUG_PRINT_BUFFER (rmPrefix, command_buffer, cnt);
     }
 #endif
 
-    /* Send number of bytes. */
-    cnt1 = cnt;
-    cnt = HOST_TO_BE_32(cnt);
-    rval = tctiSendBytes (tctiContext,
-                          tcti_intel->tpmSock,
-                          (unsigned char *)&cnt,
-                          4);
-    if (rval != TSS2_RC_SUCCESS) {
-        return rval;
-    }
+    return rval;
+}
 
-    /* Send the TPM command buffer */
-    rval = tctiSendBytes (tctiContext,
-                          tcti_intel->tpmSock,
-                          (unsigned char *)command_buffer,
-                          cnt1);
+/*
+ * Vectored variant of SocketSendTpmCommand: the caller's buffers follow the
+ * simulator framing in the same sendmsg.
+ */
+TSS2_RC SocketSendTpmCommandv (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    const struct iovec *iov,
+    int iovcnt
+    )
+{
+    size_t command_size;
+    TSS2_RC rval;
+
+    rval = tcti_sendv_checks (tctiContext, iov, iovcnt, &command_size);
     if (rval != TSS2_RC_SUCCESS) {
         return rval;
     }
 
-#ifdef DEBUG
-    if (tcti_intel->status.debugMsgEnabled == 1) {
-        DEBUG_PRINT_BUFFER (rmPrefix, command_buffer, cnt1);
-    }
-#endif
-    tcti_intel->status.commandSent = 1;
-
-    tcti_intel->previousStage = TCTI_STAGE_SEND_COMMAND;
-    tcti_intel->status.tagReceived = 0;
-    tcti_intel->status.responseSizeReceived = 0;
-    tcti_intel->status.protocolResponseSizeReceived = 0;
-
-    return rval;
+    return SocketSendFramed (tctiContext, iov, iovcnt, command_size);
 }
 
 TSS2_RC SocketCancel(
@@ -279,7 +404,8 @@ TSS2_RC SocketSetLocality(
     if (rc != TSS2_RC_SUCCESS) {
         return rc;
     }
-    if (tcti_intel->status.commandSent == 1) {
+    /* queued commands are sent with the locality they were submitted at */
+    if (tcti_intel->status.commandSent == 1 || tcti_intel->queueCount != 0) {
         return TSS2_TCTI_RC_BAD_SEQUENCE;
     }
 
@@ -288,12 +414,42 @@ TSS2_RC SocketSetLocality(
     return TSS2_RC_SUCCESS;
 }
 
+/*
+ * The TPM command socket is non-blocking: a caller driving the TCTI from
+ * its own event loop waits for POLLIN on it and then calls receive with
+ * TSS2_TCTI_TIMEOUT_NONE. The platform socket is only used synchronously
+ * and isn't exposed. With the io_uring backend the ring is waited on
+ * instead of the socket, whose data it reads.
+ */
 TSS2_RC SocketGetPollHandles(
     TSS2_TCTI_CONTEXT *tctiContext,
     TSS2_TCTI_POLL_HANDLE *handles,
     size_t *num_handles)
 {
-    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TSS2_RC rc;
+
+    rc = tcti_common_checks (tctiContext);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    if (num_handles == NULL) {
+        return TSS2_TCTI_RC_BAD_REFERENCE;
+    }
+    if (handles != NULL && *num_handles < 1) {
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+
+    *num_handles = 1;
+    if (handles != NULL) {
+        handles->fd = tcti_intel->uring != NULL ?
+                      tcti_uring_fd (tcti_intel->uring) :
+                      tcti_intel->tpmSock;
+        handles->events = POLLIN;
+        handles->revents = 0;
+    }
+
+    return TSS2_RC_SUCCESS;
 }
 
 void SocketFinalize(
@@ -311,192 +467,407 @@ void SocketFinalize(
     SendSessionEndSocketTcti (tctiContext, 1);
     SendSessionEndSocketTcti (tctiContext, 0);
 
+    tcti_uring_finalize (tcti_intel->uring);
+    tcti_intel->uring = NULL;
     CloseSockets (tcti_intel->otherSock, tcti_intel->tpmSock);
 }
 
-TSS2_RC SocketReceiveTpmResponse(
-    TSS2_TCTI_CONTEXT *tctiContext,
-    size_t *response_size,
-    unsigned char *response_buffer,
-    int32_t timeout
+/*
+ * The receive ring holds bytes read from the TPM socket that have not been
+ * handed to the caller yet. These helpers view it through the free running
+ * recvHead / recvTail counters.
+ */
+static UINT32 SocketRingUsed (
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel
     )
 {
-    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
-    UINT32 trash;
-    TSS2_RC rval = TSS2_RC_SUCCESS;
-    fd_set readFds;
-    struct timeval tv, *tvPtr;
-    int32_t timeoutMsecs = timeout % 1000;
-    int iResult;
-    unsigned char responseSizeDelta = 0;
-    printf_type rmPrefix;
+    return tcti_intel->recvTail - tcti_intel->recvHead;
+}
 
-    rval = tcti_receive_checks (tctiContext, response_size, response_buffer);
-    if (rval != TSS2_RC_SUCCESS) {
-        goto retSocketReceiveTpmResponse;
-    }
+static void SocketRingPeek (
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel,
+    UINT32 offset,
+    UINT8 *dst,
+    UINT32 len
+    )
+{
+    UINT32 start = (tcti_intel->recvHead + offset) % TCTI_RECV_RING_SIZE;
+    UINT32 first = TCTI_RECV_RING_SIZE - start;
 
-    if (tcti_intel->status.rmDebugPrefix == 1) {
-        rmPrefix = RM_PREFIX;
-    } else {
-        rmPrefix = NO_PREFIX;
+    if (first > len) {
+        first = len;
     }
+    memcpy (dst, &tcti_intel->recvRing [start], first);
+    memcpy (dst + first, tcti_intel->recvRing, len - first);
+}
 
-    if (timeout == TSS2_TCTI_TIMEOUT_BLOCK) {
-        tvPtr = 0;
-    } else {
-        tv.tv_sec = timeout / 1000;
-        tv.tv_usec = timeoutMsecs * 1000;
-        tvPtr = &tv;
+/* What is left of the caller's timeout, measured from 'start'. */
+static int32_t SocketTimeoutLeft (
+    int32_t timeout,
+    const struct timespec *start
+    )
+{
+    struct timespec now;
+    int64_t elapsed;
+
+    if (timeout <= 0) {
+        return timeout;
     }
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    elapsed = (int64_t)(now.tv_sec - start->tv_sec) * 1000 +
+              (now.tv_nsec - start->tv_nsec) / 1000000;
 
-    FD_ZERO (&readFds);
-    FD_SET (tcti_intel->tpmSock, &readFds);
+    return elapsed >= timeout ? 0 : timeout - elapsed;
+}
 
-    iResult = select (tcti_intel->tpmSock + 1, &readFds, 0, 0, tvPtr);
+/*
+ * Wait for the TPM socket to become readable, honoring what is left of the
+ * caller's timeout (measured from 'start'). poll is used rather than select
+ * so that sockets numbered above FD_SETSIZE work.
+ */
+static TSS2_RC SocketWaitReadable (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    int32_t timeout,
+    const struct timespec *start,
+    printf_type rmPrefix
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    int iResult;
+
+    timeout = SocketTimeoutLeft (timeout, start);
+    iResult = waitSocket (tcti_intel->tpmSock, POLLIN, timeout);
     if (iResult == 0) {
         TCTI_LOG (tctiContext,
                   rmPrefix,
-                  "select failed due to timeout, socket #: 0x%x\n",
+                  "poll failed due to timeout, socket #: 0x%x\n",
                   tcti_intel->tpmSock);
-        rval = TSS2_TCTI_RC_TRY_AGAIN;
-        goto retSocketReceiveTpmResponse;
+        return TSS2_TCTI_RC_TRY_AGAIN;
     } else if (iResult == SOCKET_ERROR) {
         TCTI_LOG (tctiContext,
                   rmPrefix,
-                  "select failed with socket error: %d\n",
+                  "poll failed with socket error: %d\n",
                   WSAGetLastError ());
-        rval = TSS2_TCTI_RC_IO_ERROR;
-        goto retSocketReceiveTpmResponse;
-    } else if (iResult != 1) {
-        TCTI_LOG (tctiContext,
-                  rmPrefix,
-                  "select failed, read the wrong # of bytes: %d\n",
-                  iResult);
-        rval = TSS2_TCTI_RC_IO_ERROR;
-        goto retSocketReceiveTpmResponse;
+        return TSS2_TCTI_RC_IO_ERROR;
     }
 
-    if (tcti_intel->status.protocolResponseSizeReceived != 1) {
-        /* Receive the size of the response. */
-        rval = tctiRecvBytes (tctiContext,
-                              tcti_intel->tpmSock,
-                              (unsigned char *)&tcti_intel->responseSize,
-                              4);
-        if (rval != TSS2_RC_SUCCESS) {
-            goto retSocketReceiveTpmResponse;
-        }
+    return TSS2_RC_SUCCESS;
+}
 
-        tcti_intel->responseSize = BE_TO_HOST_32 (tcti_intel->responseSize);
-        tcti_intel->status.protocolResponseSizeReceived = 1;
-    }
+/*
+ * Queue a read of the receive ring's contiguous free space (the part up
+ * to the end of the ring when it wraps) from the TPM socket.
+ */
+static TSS2_RC SocketUringQueueRead (
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel
+    )
+{
+    UINT32 begin = tcti_intel->recvTail % TCTI_RECV_RING_SIZE;
+    UINT32 space = TCTI_RECV_RING_SIZE - SocketRingUsed (tcti_intel);
+    TSS2_RC rval;
 
-    if (response_buffer == NULL) {
-        *response_size = tcti_intel->responseSize;
-        tcti_intel->status.protocolResponseSizeReceived = 1;
-        goto retSocketReceiveTpmResponse;
+    if (space > TCTI_RECV_RING_SIZE - begin) {
+        space = TCTI_RECV_RING_SIZE - begin;
+    }
+    if (space == 0) {
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+    rval = tcti_uring_prep_read_fixed (tcti_intel->uring,
+                                       tcti_intel->tpmSock,
+                                       &tcti_intel->recvRing [begin],
+                                       space,
+                                       0,
+                                       TCTI_URING_RECV);
+    if (rval == TSS2_RC_SUCCESS) {
+        tcti_intel->status.uringRecvPending = 1;
     }
 
-    if (*response_size < tcti_intel->responseSize) {
-        *response_size = tcti_intel->responseSize;
-        rval = TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    return rval;
+}
 
-        /* If possible, receive tag from TPM. */
-        if (*response_size >= sizeof (TPM2_ST) &&
-            tcti_intel->status.tagReceived == 0)
-        {
-            rval = tctiRecvBytes (tctiContext,
-                                  tcti_intel->tpmSock,
-                                  (unsigned char *)&tcti_intel->tag,
-                                  2);
-            if (rval != TSS2_RC_SUCCESS) {
-                goto retSocketReceiveTpmResponse;
-            } else {
-                tcti_intel->status.tagReceived = 1;
-            }
-        }
+/*
+ * Reap one completion from the ring: a read moves the ring's tail, a
+ * failed (or short) send or read is kept in uringError until both halves
+ * of the exchange are in. A read linked to a failed send completes with
+ * -ECANCELED.
+ */
+static TSS2_RC SocketUringProcess (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    int32_t timeout,
+    printf_type rmPrefix
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TCTI_URING_COMPLETION completion;
+    TSS2_RC rval;
 
-        /* If possible, receive response size from TPM */
-        if (*response_size >= (sizeof (TPM2_ST) + sizeof (TPM2_RC)) &&
-            tcti_intel->status.responseSizeReceived == 0)
-        {
-            rval = tctiRecvBytes (tctiContext,
-                                  tcti_intel->tpmSock,
-                                  (unsigned char *)&tcti_intel->responseSize,
-                                  4);
-            if (rval != TSS2_RC_SUCCESS) {
-                goto retSocketReceiveTpmResponse;
-            } else {
-                tcti_intel->responseSize = BE_TO_HOST_32 (tcti_intel->responseSize);
-                tcti_intel->status.responseSizeReceived = 1;
-            }
+    rval = tcti_uring_reap (tcti_intel->uring, &completion, timeout);
+    if (rval != TSS2_RC_SUCCESS) {
+        return rval;
+    }
+
+    if (completion.tag == TCTI_URING_SEND) {
+        tcti_intel->status.uringSendPending = 0;
+        if (completion.res >= 0 &&
+            (size_t)completion.res == tcti_intel->uringSendSize) {
+            return TSS2_RC_SUCCESS;
         }
     } else {
-        if (tcti_intel->status.debugMsgEnabled == 1 &&
-            tcti_intel->responseSize > 0)
-        {
-#ifdef DEBUG
-            TCTI_LOG (tctiContext, rmPrefix, "Response Received: ");
-#endif
+        tcti_intel->status.uringRecvPending = 0;
+        if (completion.res > 0) {
 #ifdef DEBUG_SOCKETS
             TCTI_LOG (tctiContext,
-                      rmPrefix,
-                      "from socket #0x%x:\n",
+                      NO_PREFIX,
+                      "Receive Bytes from socket #0x%x: \n",
                       tcti_intel->tpmSock);
+            TCTI_LOG_BUFFER (tctiContext,
+                             NO_PREFIX,
+                             &tcti_intel->recvRing [tcti_intel->recvTail %
+                                                    TCTI_RECV_RING_SIZE],
+                             completion.res);
 #endif
+            tcti_intel->recvTail += completion.res;
+            return TSS2_RC_SUCCESS;
         }
+    }
 
-        if (tcti_intel->status.tagReceived == 1) {
-            *(TPM2_ST *)response_buffer = tcti_intel->tag;
-            responseSizeDelta += sizeof (TPM2_ST);
-            response_buffer += sizeof (TPM2_ST);
-        }
+    if (tcti_intel->uringError == TSS2_RC_SUCCESS) {
+        TCTI_LOG (tctiContext,
+                  rmPrefix,
+                  "io_uring %s on socket 0x%x failed with result: %d\n",
+                  completion.tag == TCTI_URING_SEND ? "sendmsg" : "read",
+                  tcti_intel->tpmSock,
+                  completion.res);
+        tcti_intel->uringError = TSS2_TCTI_RC_IO_ERROR;
+    }
 
-        if (tcti_intel->status.responseSizeReceived == 1) {
-            *(TPM2_RC *)response_buffer = HOST_TO_BE_32 (tcti_intel->responseSize);
-            responseSizeDelta += sizeof (TPM2_RC);
-            response_buffer += sizeof (TPM2_RC);
-        }
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * io_uring variant of SocketRingFill: keep a read of the ring's free space
+ * in flight and reap completions until enough bytes arrived.
+ */
+static TSS2_RC SocketUringFill (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    UINT32 needed,
+    int32_t timeout,
+    const struct timespec *start,
+    printf_type rmPrefix
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TSS2_RC rval;
 
-        /* Receive the TPM response. */
-        rval = tctiRecvBytes (tctiContext,
-                              tcti_intel->tpmSock,
-                              (unsigned char *)response_buffer,
-                              tcti_intel->responseSize - responseSizeDelta);
+    while (SocketRingUsed (tcti_intel) < needed ||
+           tcti_intel->uringError != TSS2_RC_SUCCESS) {
+        if (tcti_intel->uringError != TSS2_RC_SUCCESS &&
+            tcti_intel->status.uringSendPending == 0 &&
+            tcti_intel->status.uringRecvPending == 0) {
+            rval = tcti_intel->uringError;
+            tcti_intel->uringError = TSS2_RC_SUCCESS;
+            return rval;
+        }
+        if (tcti_intel->status.uringRecvPending == 0 &&
+            tcti_intel->uringError == TSS2_RC_SUCCESS) {
+            rval = SocketUringQueueRead (tcti_intel);
+            if (rval == TSS2_RC_SUCCESS) {
+                rval = tcti_uring_submit (tcti_intel->uring);
+            }
+            if (rval != TSS2_RC_SUCCESS) {
+                return rval;
+            }
+        }
+        rval = SocketUringProcess (tctiContext,
+                                   SocketTimeoutLeft (timeout, start),
+                                   rmPrefix);
         if (rval != TSS2_RC_SUCCESS) {
-            goto retSocketReceiveTpmResponse;
+            return rval;
         }
+    }
 
-#ifdef DEBUG
-        if (tcti_intel->status.debugMsgEnabled == 1) {
-            DEBUG_PRINT_BUFFER (rmPrefix,
-                                response_buffer,
-                                tcti_intel->responseSize);
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * Read from the TPM socket until the ring holds at least 'needed' bytes.
+ * Each recvmsg asks for all of the free space (both halves when it wraps),
+ * so a response that has fully arrived is drained in one system call. The
+ * socket is non-blocking: when it runs dry we wait for it within the
+ * caller's timeout. A timeout is TRY_AGAIN and keeps whatever part of the
+ * frame already arrived in the ring for the next call.
+ */
+static TSS2_RC SocketRingFill (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    UINT32 needed,
+    int32_t timeout,
+    const struct timespec *start,
+    printf_type rmPrefix
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    struct iovec iov [2];
+    UINT32 begin, space;
+    ssize_t received;
+    TSS2_RC rval;
+    int iovcnt;
+
+    if (tcti_intel->uring != NULL) {
+        return SocketUringFill (tctiContext, needed, timeout, start, rmPrefix);
+    }
+
+    while (SocketRingUsed (tcti_intel) < needed) {
+        begin = tcti_intel->recvTail % TCTI_RECV_RING_SIZE;
+        space = TCTI_RECV_RING_SIZE - SocketRingUsed (tcti_intel);
+        iov [0].iov_base = &tcti_intel->recvRing [begin];
+        iov [0].iov_len = TCTI_RECV_RING_SIZE - begin;
+        iovcnt = 1;
+        if (iov [0].iov_len >= space) {
+            iov [0].iov_len = space;
+        } else {
+            iov [1].iov_base = tcti_intel->recvRing;
+            iov [1].iov_len = space - iov [0].iov_len;
+            iovcnt = 2;
         }
-#endif
 
-        /* Receive the appended four bytes of 0's */
-        rval = tctiRecvBytes (tctiContext,
-                              tcti_intel->tpmSock,
-                              (unsigned char *)&trash,
-                              4);
-        if (rval != TSS2_RC_SUCCESS) {
-            goto retSocketReceiveTpmResponse;
+        received = recvBytesv (tcti_intel->tpmSock, iov, iovcnt);
+        if (received == SOCKET_ERROR && wouldBlock ()) {
+            rval = SocketWaitReadable (tctiContext, timeout, start, rmPrefix);
+            if (rval != TSS2_RC_SUCCESS) {
+                return rval;
+            }
+            continue;
+        }
+        if (received == SOCKET_ERROR || received == 0) {
+            TCTI_LOG (tctiContext,
+                      NO_PREFIX,
+                      "In recvBytesv, recvmsg failed (socket: 0x%x) with error: %d\n",
+                      tcti_intel->tpmSock,
+                      WSAGetLastError ());
+            return TSS2_TCTI_RC_IO_ERROR;
         }
+#ifdef DEBUG_SOCKETS
+        TCTI_LOG (tctiContext,
+                  NO_PREFIX,
+                  "Receive Bytes from socket #0x%x: \n",
+                  tcti_intel->tpmSock);
+        TCTI_LOG_BUFFER (tctiContext,
+                         NO_PREFIX,
+                         iov [0].iov_base,
+                         received < (ssize_t)iov [0].iov_len ?
+                         (UINT32)received : iov [0].iov_len);
+#endif
+        tcti_intel->recvTail += received;
     }
 
-    if (tcti_intel->responseSize < *response_size) {
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * A simulator response is framed as a 4 byte size, the TPM response and 4
+ * bytes of 0's. The frame is parsed from the receive ring and only consumed
+ * once it has been copied out, so a size query (NULL response_buffer) or a
+ * too small buffer leave it in place for the next call.
+ */
+TSS2_RC SocketReceiveTpmResponse(
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *response_size,
+    unsigned char *response_buffer,
+    int32_t timeout
+    )
+{
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (tctiContext);
+    TSS2_RC rval = TSS2_RC_SUCCESS;
+    struct timespec start;
+    UINT32 frameSize;
+    printf_type rmPrefix;
+
+    rval = tcti_receive_checks (tctiContext, response_size, response_buffer);
+    if (rval != TSS2_RC_SUCCESS) {
+        goto retSocketReceiveTpmResponse;
+    }
+
+    if (tcti_intel->status.rmDebugPrefix == 1) {
+        rmPrefix = RM_PREFIX;
+    } else {
+        rmPrefix = NO_PREFIX;
+    }
+
+    if (timeout < TSS2_TCTI_TIMEOUT_BLOCK) {
+        rval = TSS2_TCTI_RC_BAD_VALUE;
+        goto retSocketReceiveTpmResponse;
+    }
+    clock_gettime (CLOCK_MONOTONIC, &start);
+
+    /* Receive the size of the response. */
+    rval = SocketRingFill (tctiContext,
+                           sizeof (UINT32),
+                           timeout,
+                           &start,
+                           rmPrefix);
+    if (rval != TSS2_RC_SUCCESS) {
+        goto retSocketReceiveTpmResponse;
+    }
+    SocketRingPeek (tcti_intel,
+                    0,
+                    (UINT8 *)&tcti_intel->responseSize,
+                    sizeof (UINT32));
+    tcti_intel->responseSize = BE_TO_HOST_32 (tcti_intel->responseSize);
+
+    frameSize = sizeof (UINT32) + tcti_intel->responseSize + sizeof (UINT32);
+    if (tcti_intel->responseSize > TCTI_RECV_RING_SIZE ||
+        frameSize > TCTI_RECV_RING_SIZE) {
+        TCTI_LOG (tctiContext,
+                  rmPrefix,
+                  "response size 0x%x exceeds the receive ring\n",
+                  tcti_intel->responseSize);
+        rval = TSS2_TCTI_RC_MALFORMED_RESPONSE;
+        goto retSocketReceiveTpmResponse;
+    }
+
+    if (response_buffer == NULL) {
         *response_size = tcti_intel->responseSize;
+        goto retSocketReceiveTpmResponse;
     }
 
-    tcti_intel->status.commandSent = 0;
+    if (*response_size < tcti_intel->responseSize) {
+        *response_size = tcti_intel->responseSize;
+        rval = TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+        goto retSocketReceiveTpmResponse;
+    }
 
-    /* Turn cancel off. */
-    if (rval == TSS2_RC_SUCCESS) {
+    /* Receive the TPM response and the appended four bytes of 0's. */
+    rval = SocketRingFill (tctiContext, frameSize, timeout, &start, rmPrefix);
+    if (rval != TSS2_RC_SUCCESS) {
+        goto retSocketReceiveTpmResponse;
+    }
+    SocketRingPeek (tcti_intel,
+                    sizeof (UINT32),
+                    response_buffer,
+                    tcti_intel->responseSize);
+    tcti_intel->recvHead += frameSize;
+    *response_size = tcti_intel->responseSize;
+
+#ifdef DEBUG
+    if (tcti_intel->status.debugMsgEnabled == 1 &&
+        tcti_intel->responseSize > 0)
+    {
+        TCTI_LOG (tctiContext, rmPrefix, "Response Received: ");
+        DEBUG_PRINT_BUFFER (rmPrefix,
+                            response_buffer,
+                            tcti_intel->responseSize);
+    }
+#endif
+
+    /* commands pipelined behind this one are still with the TPM */
+    tcti_intel->status.commandSent = tcti_intel->queueSent > 1;
+
+    /*
+     * Turn cancel off, but only if SocketCancel turned it on: otherwise
+     * this is a second round-trip to the simulator for every command.
+     */
+    if (tcti_intel->status.cancelSent == 1) {
         rval = PlatformCommand (tctiContext, MS_SIM_CANCEL_OFF);
-    } else {
-        /* Ignore return value so earlier error code is preserved. */
-        PlatformCommand (tctiContext, MS_SIM_CANCEL_OFF);
     }
 
 retSocketReceiveTpmResponse:
@@ -558,10 +929,12 @@ TSS2_RC InitSocketTcti (
     if (tctiContext == NULL && contextSize == NULL) {
         return TSS2_TCTI_RC_BAD_VALUE;
     } else if( tctiContext == NULL ) {
-        *contextSize = sizeof (TSS2_TCTI_CONTEXT_INTEL);
+        *contextSize = sizeof (TSS2_TCTI_CONTEXT_INTEL) + TCTI_RECV_RING_SIZE;
         return TSS2_RC_SUCCESS;
     } else if( conf == NULL ) {
         return TSS2_TCTI_RC_BAD_VALUE;
+    } else if (conf->path != NULL && conf->platformPath == NULL) {
+        return TSS2_TCTI_RC_BAD_VALUE;
     }
 
     TSS2_TCTI_MAGIC (tctiContext) = TCTI_MAGIC;
@@ -572,6 +945,9 @@ TSS2_RC InitSocketTcti (
     TSS2_TCTI_CANCEL (tctiContext) = SocketCancel;
     TSS2_TCTI_GET_POLL_HANDLES (tctiContext) = SocketGetPollHandles;
     TSS2_TCTI_SET_LOCALITY (tctiContext) = SocketSetLocality;
+    TSS2_TCTI_TRANSMITV (tctiContext) = SocketSendTpmCommandv;
+    TSS2_TCTI_SUBMIT (tctiContext) = tcti_submit;
+    TSS2_TCTI_REAP (tctiContext) = tcti_reap;
     tcti_intel->status.debugMsgEnabled = 0;
     tcti_intel->status.locality = 3;
     tcti_intel->status.commandSent = 0;
@@ -579,18 +955,45 @@ TSS2_RC InitSocketTcti (
     tcti_intel->status.tagReceived = 0;
     tcti_intel->status.responseSizeReceived = 0;
     tcti_intel->status.protocolResponseSizeReceived = 0;
+    tcti_intel->status.cancelSent = 0;
+    tcti_intel->status.uringSendPending = 0;
+    tcti_intel->status.uringRecvPending = 0;
+    tcti_intel->uring = NULL;
+    tcti_intel->uringError = TSS2_RC_SUCCESS;
+    tcti_intel->recvHead = 0;
+    tcti_intel->recvTail = 0;
+    tcti_intel->recvRing = (UINT8 *)tctiContext + sizeof (TSS2_TCTI_CONTEXT_INTEL);
+    tcti_intel->status.queueDriving = 0;
+    tcti_intel->queueHead = 0;
+    tcti_intel->queueCount = 0;
+    tcti_intel->queueSent = 0;
+    tcti_intel->queueWindow = 1;
+    if (conf->pipelineDepth > 1) {
+        tcti_intel->queueWindow = conf->pipelineDepth < TCTI_QUEUE_DEPTH ?
+                                  conf->pipelineDepth : TCTI_QUEUE_DEPTH;
+    }
+    tcti_intel->responseBuffer = NULL;
     tcti_intel->currentTctiContext = 0;
     tcti_intel->previousStage = TCTI_STAGE_INITIALIZE;
     TCTI_LOG_CALLBACK (tctiContext) = conf->logCallback;
     TCTI_LOG_BUFFER_CALLBACK (tctiContext) = conf->logBufferCallback;
     TCTI_LOG_DATA (tctiContext) = conf->logData;
 
-    rval = (TSS2_RC) InitSockets (conf->hostname,
-                                  conf->port,
-                                  &otherSock,
-                                  &tpmSock,
-                                  TCTI_LOG_CALLBACK (tctiContext),
-                                  TCTI_LOG_DATA (tctiContext));
+    if (conf->path != NULL) {
+        rval = (TSS2_RC) InitUnixSockets (conf->path,
+                                          conf->platformPath,
+                                          &otherSock,
+                                          &tpmSock,
+                                          TCTI_LOG_CALLBACK (tctiContext),
+                                          TCTI_LOG_DATA (tctiContext));
+    } else {
+        rval = (TSS2_RC) InitSockets (conf->hostname,
+                                      conf->port,
+                                      &otherSock,
+                                      &tpmSock,
+                                      TCTI_LOG_CALLBACK (tctiContext),
+                                      TCTI_LOG_DATA (tctiContext));
+    }
     if (rval == TSS2_RC_SUCCESS) {
         tcti_intel->otherSock = otherSock;
         tcti_intel->tpmSock = tpmSock;
@@ -598,6 +1001,26 @@ TSS2_RC InitSocketTcti (
     } else {
         CloseSockets (otherSock, tpmSock);
     }
+    if (rval != TSS2_RC_SUCCESS || !(conf->flags & TCTI_FLAG_IO_URING)) {
+        return rval;
+    }
 
-    return rval;
+    /* the receive ring is the registered buffer the responses land in */
+    rval = tcti_uring_init (&tcti_intel->uring,
+                            tcti_intel->recvRing,
+                            TCTI_RECV_RING_SIZE);
+    if (rval == TSS2_RC_SUCCESS &&
+        setSocketBlocking (tcti_intel->tpmSock) == SOCKET_ERROR) {
+        tcti_uring_finalize (tcti_intel->uring);
+        tcti_intel->uring = NULL;
+        rval = TSS2_TCTI_RC_IO_ERROR;
+    }
+    if (rval != TSS2_RC_SUCCESS) {
+        TCTI_LOG (tctiContext,
+                  NO_PREFIX,
+                  "io_uring unavailable (0x%x), using sendmsg / recvmsg\n",
+                  rval);
+    }
+
+    return TSS2_RC_SUCCESS;
 }
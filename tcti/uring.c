@@ -0,0 +1,503 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tcti.h"
+#include "uring.h"
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+#if defined(HAVE_IO_URING) && defined(IORING_ENTER_EXT_ARG)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* A context has at most a send and a receive in flight. */
+#define TCTI_URING_ENTRIES 4
+
+struct TCTI_URING {
+    int fd;
+    void *rings;
+    size_t ringsSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqArray;
+    unsigned sqMask;
+    unsigned sqEntries;
+    /* tail including the entries queued but not submitted yet */
+    unsigned sqLocalTail;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe *cqes;
+    TCTI_URING_SEND_DATA send;
+};
+
+/*
+ * There's no libc wrapper for the io_uring system calls and the library
+ * avoids a dependency on liburing for the handful of operations it uses.
+ */
+static int uring_setup (unsigned entries, struct io_uring_params *params)
+{
+    return (int)syscall (__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter (
+    int fd,
+    unsigned to_submit,
+    unsigned min_complete,
+    unsigned flags,
+    void *arg,
+    size_t argsz)
+{
+    return (int)syscall (__NR_io_uring_enter,
+                         fd,
+                         to_submit,
+                         min_complete,
+                         flags,
+                         arg,
+                         argsz);
+}
+
+static int uring_register (int fd, unsigned opcode, void *arg, unsigned nr)
+{
+    return (int)syscall (__NR_io_uring_register, fd, opcode, arg, nr);
+}
+
+void tcti_uring_finalize (
+    TCTI_URING *uring)
+{
+    if (uring == NULL) {
+        return;
+    }
+    if (uring->sqes != NULL) {
+        munmap (uring->sqes, uring->sqesSize);
+    }
+    if (uring->rings != NULL) {
+        munmap (uring->rings, uring->ringsSize);
+    }
+    if (uring->fd >= 0) {
+        close (uring->fd);
+    }
+    free (uring);
+}
+
+TSS2_RC tcti_uring_init (
+    TCTI_URING **uring_out,
+    void *buffer,
+    size_t buffer_size)
+{
+    struct io_uring_params params;
+    struct iovec iov;
+    TCTI_URING *uring;
+    uint8_t *rings;
+    size_t cqSize;
+    void *map;
+
+    if (uring_out == NULL || buffer == NULL) {
+        return TSS2_TCTI_RC_BAD_REFERENCE;
+    }
+    uring = calloc (1, sizeof (*uring));
+    if (uring == NULL) {
+        return TSS2_TCTI_RC_GENERAL_FAILURE;
+    }
+
+    memset (&params, 0, sizeof (params));
+    uring->fd = uring_setup (TCTI_URING_ENTRIES, &params);
+    if (uring->fd < 0) {
+        goto unsupported;
+    }
+    /* the single ring mapping predates EXT_ARG, which the waits rely on */
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) ||
+        !(params.features & IORING_FEAT_EXT_ARG)) {
+        goto unsupported;
+    }
+
+    uring->ringsSize = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+    cqSize = params.cq_off.cqes +
+             params.cq_entries * sizeof (struct io_uring_cqe);
+    if (cqSize > uring->ringsSize) {
+        uring->ringsSize = cqSize;
+    }
+    map = mmap (NULL,
+                uring->ringsSize,
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE,
+                uring->fd,
+                IORING_OFF_SQ_RING);
+    if (map == MAP_FAILED) {
+        goto unsupported;
+    }
+    uring->rings = map;
+
+    uring->sqesSize = params.sq_entries * sizeof (struct io_uring_sqe);
+    map = mmap (NULL,
+                uring->sqesSize,
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE,
+                uring->fd,
+                IORING_OFF_SQES);
+    if (map == MAP_FAILED) {
+        goto unsupported;
+    }
+    uring->sqes = map;
+
+    rings = uring->rings;
+    uring->sqHead = (unsigned *)(rings + params.sq_off.head);
+    uring->sqTail = (unsigned *)(rings + params.sq_off.tail);
+    uring->sqArray = (unsigned *)(rings + params.sq_off.array);
+    uring->sqMask = *(unsigned *)(rings + params.sq_off.ring_mask);
+    uring->sqEntries = params.sq_entries;
+    uring->sqLocalTail = *uring->sqTail;
+    uring->cqHead = (unsigned *)(rings + params.cq_off.head);
+    uring->cqTail = (unsigned *)(rings + params.cq_off.tail);
+    uring->cqMask = *(unsigned *)(rings + params.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe *)(rings + params.cq_off.cqes);
+
+    /* fails e.g. when RLIMIT_MEMLOCK doesn't cover the pinned pages */
+    iov.iov_base = buffer;
+    iov.iov_len = buffer_size;
+    if (uring_register (uring->fd, IORING_REGISTER_BUFFERS, &iov, 1) < 0) {
+        goto unsupported;
+    }
+
+    *uring_out = uring;
+    return TSS2_RC_SUCCESS;
+
+unsupported:
+    tcti_uring_finalize (uring);
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+int tcti_uring_fd (
+    TCTI_URING *uring)
+{
+    return uring->fd;
+}
+
+TCTI_URING_SEND_DATA *tcti_uring_send_data (
+    TCTI_URING *uring)
+{
+    return &uring->send;
+}
+
+static struct io_uring_sqe *uring_get_sqe (
+    TCTI_URING *uring,
+    int link,
+    uint64_t tag)
+{
+    unsigned head = __atomic_load_n (uring->sqHead, __ATOMIC_ACQUIRE);
+    unsigned index;
+    struct io_uring_sqe *sqe;
+
+    if (uring->sqLocalTail - head >= uring->sqEntries) {
+        return NULL;
+    }
+    index = uring->sqLocalTail & uring->sqMask;
+    sqe = &uring->sqes [index];
+    memset (sqe, 0, sizeof (*sqe));
+    sqe->flags = link ? IOSQE_IO_LINK : 0;
+    sqe->user_data = tag;
+    uring->sqArray [index] = index;
+    uring->sqLocalTail++;
+
+    return sqe;
+}
+
+TSS2_RC tcti_uring_prep_sendmsg (
+    TCTI_URING *uring,
+    int fd,
+    int iovcnt,
+    int flags,
+    int link,
+    uint64_t tag)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe (uring, link, tag);
+
+    if (sqe == NULL) {
+        return TSS2_TCTI_RC_TRY_AGAIN;
+    }
+    memset (&uring->send.msg, 0, sizeof (uring->send.msg));
+    uring->send.msg.msg_iov = uring->send.iov;
+    uring->send.msg.msg_iovlen = iovcnt;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)&uring->send.msg;
+    sqe->len = 1;
+    sqe->msg_flags = flags;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * An offset of -1 uses (and advances) the file position where there is
+ * one, which makes no difference to the TPM device, pipes or sockets.
+ */
+static TSS2_RC uring_prep_fixed (
+    TCTI_URING *uring,
+    uint8_t opcode,
+    int fd,
+    const uint8_t *buffer,
+    size_t size,
+    int link,
+    uint64_t tag)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe (uring, link, tag);
+
+    if (sqe == NULL) {
+        return TSS2_TCTI_RC_TRY_AGAIN;
+    }
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->off = (uint64_t)-1;
+    sqe->addr = (uint64_t)(uintptr_t)buffer;
+    sqe->len = size;
+    sqe->buf_index = 0;
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC tcti_uring_prep_write_fixed (
+    TCTI_URING *uring,
+    int fd,
+    const uint8_t *buffer,
+    size_t size,
+    int link,
+    uint64_t tag)
+{
+    return uring_prep_fixed (uring,
+                             IORING_OP_WRITE_FIXED,
+                             fd,
+                             buffer,
+                             size,
+                             link,
+                             tag);
+}
+
+TSS2_RC tcti_uring_prep_read_fixed (
+    TCTI_URING *uring,
+    int fd,
+    uint8_t *buffer,
+    size_t size,
+    int link,
+    uint64_t tag)
+{
+    return uring_prep_fixed (uring,
+                             IORING_OP_READ_FIXED,
+                             fd,
+                             buffer,
+                             size,
+                             link,
+                             tag);
+}
+
+TSS2_RC tcti_uring_submit (
+    TCTI_URING *uring)
+{
+    unsigned pending;
+    int ret;
+
+    __atomic_store_n (uring->sqTail, uring->sqLocalTail, __ATOMIC_RELEASE);
+    pending = uring->sqLocalTail - __atomic_load_n (uring->sqHead,
+                                                    __ATOMIC_ACQUIRE);
+    while (pending > 0) {
+        ret = uring_enter (uring->fd, pending, 0, 0, NULL, 0);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        } else if (ret < 0 && (errno == EAGAIN || errno == EBUSY)) {
+            /* left in the ring, the next enter picks them up */
+            return TSS2_RC_SUCCESS;
+        } else if (ret < 0) {
+            return TSS2_TCTI_RC_IO_ERROR;
+        }
+        pending -= ret;
+        if (ret == 0) {
+            break;
+        }
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+static int uring_pop (
+    TCTI_URING *uring,
+    TCTI_URING_COMPLETION *completion)
+{
+    unsigned head = *uring->cqHead;
+    struct io_uring_cqe *cqe;
+
+    if (head == __atomic_load_n (uring->cqTail, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    cqe = &uring->cqes [head & uring->cqMask];
+    completion->tag = cqe->user_data;
+    completion->res = cqe->res;
+    __atomic_store_n (uring->cqHead, head + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+TSS2_RC tcti_uring_reap (
+    TCTI_URING *uring,
+    TCTI_URING_COMPLETION *completion,
+    int32_t timeout)
+{
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    struct timespec start, now;
+    int64_t left = timeout;
+    unsigned pending;
+    int ret;
+
+    if (timeout < TSS2_TCTI_TIMEOUT_BLOCK) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+    if (timeout > 0) {
+        clock_gettime (CLOCK_MONOTONIC, &start);
+    }
+
+    while (!uring_pop (uring, completion)) {
+        if (left == 0) {
+            return TSS2_TCTI_RC_TRY_AGAIN;
+        }
+        memset (&arg, 0, sizeof (arg));
+        if (left > 0) {
+            ts.tv_sec = left / 1000;
+            ts.tv_nsec = (left % 1000) * 1000000;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+        }
+        /* anything still queued in the SQ ring goes along with the wait */
+        pending = uring->sqLocalTail - __atomic_load_n (uring->sqHead,
+                                                        __ATOMIC_ACQUIRE);
+        ret = uring_enter (uring->fd,
+                           pending,
+                           1,
+                           IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                           &arg,
+                           sizeof (arg));
+        if (ret < 0 && errno == ETIME) {
+            left = 0;
+            continue;
+        } else if (ret < 0 && errno != EINTR) {
+            return TSS2_TCTI_RC_IO_ERROR;
+        }
+        if (timeout > 0) {
+            clock_gettime (CLOCK_MONOTONIC, &now);
+            left = timeout - ((int64_t)(now.tv_sec - start.tv_sec) * 1000 +
+                              (now.tv_nsec - start.tv_nsec) / 1000000);
+            if (left < 0) {
+                left = 0;
+            }
+        }
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+#else /* HAVE_IO_URING */
+
+void tcti_uring_finalize (
+    TCTI_URING *uring)
+{
+}
+
+TSS2_RC tcti_uring_init (
+    TCTI_URING **uring_out,
+    void *buffer,
+    size_t buffer_size)
+{
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+int tcti_uring_fd (
+    TCTI_URING *uring)
+{
+    return -1;
+}
+
+TCTI_URING_SEND_DATA *tcti_uring_send_data (
+    TCTI_URING *uring)
+{
+    return NULL;
+}
+
+TSS2_RC tcti_uring_prep_sendmsg (
+    TCTI_URING *uring,
+    int fd,
+    int iovcnt,
+    int flags,
+    int link,
+    uint64_t tag)
+{
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+TSS2_RC tcti_uring_prep_write_fixed (
+    TCTI_URING *uring,
+    int fd,
+    const uint8_t *buffer,
+    size_t size,
+    int link,
+    uint64_t tag)
+{
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+TSS2_RC tcti_uring_prep_read_fixed (
+    TCTI_URING *uring,
+    int fd,
+    uint8_t *buffer,
+    size_t size,
+    int link,
+    uint64_t tag)
+{
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+TSS2_RC tcti_uring_submit (
+    TCTI_URING *uring)
+{
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+TSS2_RC tcti_uring_reap (
+    TCTI_URING *uring,
+    TCTI_URING_COMPLETION *completion,
+    int32_t timeout)
+{
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+#endif /* HAVE_IO_URING */
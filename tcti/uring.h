@@ -0,0 +1,137 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+#ifndef TCTI_URING_H
+#define TCTI_URING_H
+
+#include <stdint.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+
+#include "sapi/tpm20.h"
+#include "tcti.h"
+
+/*
+ * Optional io_uring backend shared by the device and socket TCTIs. Each
+ * context that selects it (TCTI_FLAG_IO_URING) owns a small ring with its
+ * command / response area registered as a fixed buffer: transmit queues
+ * the write of the command linked to the read of the response and submits
+ * both with a single io_uring_enter, receive reaps the completions.
+ */
+
+/* user_data tags of the two operations a context has in flight */
+#define TCTI_URING_SEND 1
+#define TCTI_URING_RECV 2
+
+typedef struct TCTI_URING TCTI_URING;
+
+typedef struct {
+    uint64_t tag;
+    int32_t res;
+} TCTI_URING_COMPLETION;
+
+/*
+ * Storage for the sendmsg in flight: the kernel may only read the message
+ * header, the iovec array and the data once the operation is issued, after
+ * transmit returned and the caller reused its command buffer. So the
+ * frame and command are copied into 'buffer', which lives with the ring.
+ */
+#define TCTI_URING_SEND_SIZE (16 + TPM2_MAX_COMMAND_SIZE)
+
+typedef struct {
+    struct msghdr msg;
+    struct iovec iov [1];
+    uint8_t buffer [TCTI_URING_SEND_SIZE];
+} TCTI_URING_SEND_DATA;
+
+/*
+ * Set up a ring and register 'buffer' as its one fixed buffer. Returns
+ * TSS2_TCTI_RC_NOT_IMPLEMENTED when the library was built without io_uring
+ * or the kernel lacks the features used, callers then fall back to the
+ * synchronous path.
+ */
+TSS2_RC tcti_uring_init (
+    TCTI_URING **uring,
+    void        *buffer,
+    size_t       buffer_size
+    );
+void tcti_uring_finalize (
+    TCTI_URING *uring
+    );
+/* The ring's file descriptor: readable while completions are pending. */
+int tcti_uring_fd (
+    TCTI_URING *uring
+    );
+TCTI_URING_SEND_DATA *tcti_uring_send_data (
+    TCTI_URING *uring
+    );
+/*
+ * Queue operations without submitting them. The sendmsg sends the first
+ * 'iovcnt' entries of the ring's TCTI_URING_SEND_DATA iovec array. 'link' makes the next queued
+ * operation start only once this one completed successfully. The fixed
+ * variants must address memory inside the registered buffer.
+ */
+TSS2_RC tcti_uring_prep_sendmsg (
+    TCTI_URING *uring,
+    int         fd,
+    int         iovcnt,
+    int         flags,
+    int         link,
+    uint64_t    tag
+    );
+TSS2_RC tcti_uring_prep_write_fixed (
+    TCTI_URING    *uring,
+    int            fd,
+    const uint8_t *buffer,
+    size_t         size,
+    int            link,
+    uint64_t       tag
+    );
+TSS2_RC tcti_uring_prep_read_fixed (
+    TCTI_URING *uring,
+    int         fd,
+    uint8_t    *buffer,
+    size_t      size,
+    int         link,
+    uint64_t    tag
+    );
+/* Submit everything queued with one io_uring_enter. */
+TSS2_RC tcti_uring_submit (
+    TCTI_URING *uring
+    );
+/*
+ * Take the next completion, waiting for up to 'timeout' milliseconds
+ * (TSS2_TCTI_TIMEOUT_BLOCK / _NONE as for 'receive'). TRY_AGAIN when none
+ * arrived in time.
+ */
+TSS2_RC tcti_uring_reap (
+    TCTI_URING            *uring,
+    TCTI_URING_COMPLETION *completion,
+    int32_t                timeout
+    );
+
+#endif /* TCTI_URING_H */
@@ -29,274 +29,40 @@
 #include "sample.h"
 #include <string.h>
 
-TSS2_RC GetBlockSizeInBits( TPMI_ALG_SYM algorithm, UINT32 *blockSizeInBits )
-{
-    TSS2_RC rval = TSS2_RC_SUCCESS;
-
-    if( algorithm == TPM2_ALG_AES )
-        *blockSizeInBits = 128;
-    else if( algorithm == TPM2_ALG_SM3_256 )
-        *blockSizeInBits = 128;
-    else
-        rval = TSS2_APP_RC_BAD_ALGORITHM;
-
-    return rval;
-}
-
-TSS2_RC
-GenerateSessionEncryptDecryptKey (
-    SESSION              *session,
-    TPM2B_MAX_BUFFER     *cfbKey,
-    TPM2B_IV             *ivIn,
-    TPM2B_AUTH           *authValue)
+//
+// Parameter encryption runs on the host (Tss2_Sys_ParamCrypt); no key is
+// loaded into the TPM and no extra commands are sent.
+//
+static TSS2_RC CryptParam( SESSION *session, TPM2B_MAX_BUFFER *outputData,
+    TPM2B_MAX_BUFFER *inputData, TPM2B_AUTH *authValue, TPMI_YES_NO decrypt )
 {
-    TSS2_RC rval = TSS2_RC_SUCCESS;
-    UINT32 blockSize = 0;
-    TPM2B_MAX_BUFFER key, sessionValue;
+    TPMT_SYM_DEF symmetric = session->symmetric;
 
-    if (ivIn == NULL || cfbKey == NULL) {
+    if( inputData->size > sizeof( outputData->buffer ) )
         return APPLICATION_ERROR( TSS2_BASE_RC_INSUFFICIENT_BUFFER );
-    }
-    rval = GetBlockSizeInBits (session->symmetric.algorithm, &blockSize);
-    if (rval != TSS2_RC_SUCCESS) {
-        return rval;
-    }
-
-    INIT_SIMPLE_TPM2B_SIZE(key);
-    CopySizedByteBuffer((TPM2B *)&sessionValue, (TPM2B *)&session->sessionKey);
-    CatSizedByteBuffer((TPM2B *)&sessionValue, (TPM2B *)authValue);
-
-    rval = KDFa (session->authHash,
-                 (TPM2B *)&sessionValue,
-                 "CFB",
-                 (TPM2B *)&session->nonceNewer,
-                 (TPM2B *)&session->nonceOlder,
-                 session->symmetric.keyBits.sym + blockSize,
-                 &key);
-    if (rval != TSS2_RC_SUCCESS) {
-        return rval;
-    }
-
-    if (key.size != (session->symmetric.keyBits.sym + blockSize) / 8) {
-        return APPLICATION_ERROR (TSS2_BASE_RC_INSUFFICIENT_BUFFER);
-    }
-
-    ivIn->size = blockSize / 8;
-    cfbKey->size = (session->symmetric.keyBits.sym) / 8;
-    if (ivIn->size > sizeof (ivIn->buffer) ||
-        (cfbKey->size + ivIn->size) > TPM2_MAX_DIGEST_BUFFER) {
-        return APPLICATION_ERROR (TSS2_BASE_RC_INSUFFICIENT_BUFFER);
-    }
-    memcpy (ivIn->buffer, &key.buffer[cfbKey->size], ivIn->size);
-    memcpy (cfbKey->buffer, key.buffer, cfbKey->size);
-    return rval;
-}
-
-UINT32 LoadSessionEncryptDecryptKey( TPMT_SYM_DEF *symmetric, TPM2B_MAX_BUFFER *key, TPM2_HANDLE *keyHandle, TPM2B_NAME *keyName )
-{
-    TPM2B keyAuth = { 0 };
-    TPM2B_SENSITIVE inPrivate;
-    TPM2B_PUBLIC inPublic;
-    UINT32 rval;
-    TSS2_SYS_CONTEXT *sysContext;
-
-    inPrivate.sensitiveArea.sensitiveType = TPM2_ALG_SYMCIPHER;
-    inPrivate.size = CopySizedByteBuffer((TPM2B *)&inPrivate.sensitiveArea.authValue, (TPM2B *)&keyAuth);
-    inPrivate.sensitiveArea.seedValue.size = 0;
-    inPrivate.size += CopySizedByteBuffer((TPM2B *)&inPrivate.sensitiveArea.sensitive.bits, (TPM2B *)key);
-    inPrivate.size += 2 * sizeof( UINT16 );
-
-    inPublic.publicArea.type = TPM2_ALG_SYMCIPHER;
-    inPublic.publicArea.nameAlg = TPM2_ALG_NULL;
-    *( UINT32 *)&( inPublic.publicArea.objectAttributes )= 0;
-    inPublic.publicArea.objectAttributes.decrypt = 1;
-    inPublic.publicArea.objectAttributes.sign = 1;
-    inPublic.publicArea.objectAttributes.userWithAuth = 1;
-    inPublic.publicArea.authPolicy.size = 0;
-    inPublic.publicArea.parameters.symDetail.sym.algorithm = symmetric->algorithm;
-    inPublic.publicArea.parameters.symDetail.sym.keyBits = symmetric->keyBits;
-    inPublic.publicArea.parameters.symDetail.sym.mode = symmetric->mode;
-    inPublic.publicArea.unique.sym.size = 0;
-
-    sysContext = InitSysContext( 1000, resMgrTctiContext, &abiVersion );
-    if( sysContext == 0 )
-    {
-        return TSS2_APP_RC_INIT_SYS_CONTEXT_FAILED;
-    }
-
-    INIT_SIMPLE_TPM2B_SIZE( *keyName );
-    rval = Tss2_Sys_LoadExternal( sysContext, 0, &inPrivate, &inPublic, TPM2_RH_NULL, keyHandle, keyName, 0 );
-
-    TeardownSysContext( &sysContext );
-
-    return rval;
-}
-
-TSS2_RC EncryptCFB( SESSION *session, TPM2B_MAX_BUFFER *encryptedData, TPM2B_MAX_BUFFER *clearData, TPM2B_AUTH *authValue )
-{
-    TSS2_RC rval = TSS2_RC_SUCCESS;
-    TPM2B_MAX_BUFFER encryptKey;
-    TPM2B_IV ivIn, ivOut;
-    TPM2_HANDLE keyHandle;
-    TPM2B_NAME keyName;
-    TSS2_SYS_CONTEXT *sysContext;
-
-    // Authorization structure for command.
-    TPMS_AUTH_COMMAND sessionData;
-
-    // Create and init authorization area for command:
-    // only 1 authorization area.
-    TPMS_AUTH_COMMAND *sessionDataArray[1] = { &sessionData };
-
-    // Authorization array for command (only has one auth structure).
-    TSS2_SYS_CMD_AUTHS sessionsData = { 1, &sessionDataArray[0] };
-
-    sysContext = InitSysContext( 1000, resMgrTctiContext, &abiVersion );
-    if( sysContext == 0 )
-    {
-        TeardownSysContext( &sysContext );
-        return TSS2_APP_RC_TEARDOWN_SYS_CONTEXT_FAILED;
-    }
 
-    rval = GenerateSessionEncryptDecryptKey( session, &encryptKey, &ivIn, authValue );
+    memmove( outputData->buffer, inputData->buffer, inputData->size );
+    outputData->size = inputData->size;
 
-    if( rval == TSS2_RC_SUCCESS )
-    {
-        rval = LoadSessionEncryptDecryptKey( &session->symmetric, &encryptKey, &keyHandle, &keyName );
-        if( rval == TSS2_RC_SUCCESS )
-        {
-            // Encrypt the data.
-            sessionData.sessionHandle = TPM2_RS_PW;
-            sessionData.nonce.size = 0;
-            *( (UINT8 *)((void *)&sessionData.sessionAttributes ) ) = 0;
-            sessionData.hmac.size = 0;
-            encryptedData->size = sizeof( *encryptedData ) - 1;
-            INIT_SIMPLE_TPM2B_SIZE( ivOut );
-            rval = Tss2_Sys_EncryptDecrypt( sysContext, keyHandle, &sessionsData, NO, TPM2_ALG_CFB, &ivIn,
-                    clearData, encryptedData, &ivOut, 0 );
-            if( rval == TSS2_RC_SUCCESS )
-            {
-                rval = Tss2_Sys_FlushContext( sysContext, keyHandle );
-            }
-        }
-    }
-    TeardownSysContext( &sysContext );
-
-    return rval;
-}
-
-TSS2_RC DecryptCFB( SESSION *session, TPM2B_MAX_BUFFER *clearData, TPM2B_MAX_BUFFER *encryptedData, TPM2B_AUTH *authValue )
-{
-    TSS2_RC rval = TSS2_RC_SUCCESS;
-    TPM2B_MAX_BUFFER encryptKey;
-    TPM2B_IV ivIn, ivOut;
-    TPM2_HANDLE keyHandle;
-    TPM2B_NAME keyName;
-    TSS2_SYS_CONTEXT *sysContext;
-
-    // Authorization structure for command.
-    TPMS_AUTH_COMMAND sessionData;
-
-    // Create and init authorization area for command:
-    // only 1 authorization area.
-    TPMS_AUTH_COMMAND *sessionDataArray[1] = { &sessionData };
-
-    // Authorization array for command (only has one auth structure).
-    TSS2_SYS_CMD_AUTHS sessionsData = { 1, &sessionDataArray[0] };
-
-
-    sysContext = InitSysContext( 1000, resMgrTctiContext, &abiVersion );
-    if( sysContext == 0 )
-    {
-        TeardownSysContext( &sysContext );
-        return TSS2_APP_RC_TEARDOWN_SYS_CONTEXT_FAILED;
-    }
-
-    rval = GenerateSessionEncryptDecryptKey( session, &encryptKey, &ivIn, authValue );
-
-    if( rval == TSS2_RC_SUCCESS )
-    {
-        rval = LoadSessionEncryptDecryptKey( &session->symmetric, &encryptKey, &keyHandle, &keyName );
-        if( rval == TSS2_RC_SUCCESS )
-        {
-            // Decrypt the data.
-            sessionData.sessionHandle = TPM2_RS_PW;
-            sessionData.nonce.size = 0;
-            *( (UINT8 *)((void *)&sessionData.sessionAttributes ) ) = 0;
-            sessionData.hmac.size = 0;
-
-            INIT_SIMPLE_TPM2B_SIZE( ivOut );
-            rval = Tss2_Sys_EncryptDecrypt( sysContext, keyHandle, &sessionsData, YES, TPM2_ALG_CFB, &ivIn,
-                    encryptedData, clearData, &ivOut, 0 );
-            if( rval == TSS2_RC_SUCCESS )
-            {
-                rval = Tss2_Sys_FlushContext( sysContext, keyHandle );
-            }
-        }
-    }
-    TeardownSysContext( &sysContext );
-
-    return rval;
-}
-
-
-TSS2_RC EncryptDecryptXOR( SESSION *session, TPM2B_MAX_BUFFER *outputData, TPM2B_MAX_BUFFER *inputData, TPM2B_AUTH *authValue )
-{
-    TSS2_RC rval = TSS2_RC_SUCCESS;
-    TPM2B_MAX_BUFFER key, mask;
-    int i;
-
-    CopySizedByteBuffer((TPM2B *)&key, (TPM2B *)&session->sessionKey);
-    CatSizedByteBuffer((TPM2B *)&key, (TPM2B *)authValue);
-
-    rval = KDFa(session->authHash, (TPM2B *)&key, "XOR", (TPM2B *)&session->nonceNewer,
-                (TPM2B *)&session->nonceOlder, inputData->size * 8, &mask);
-    if( rval == TSS2_RC_SUCCESS )
-    {
-        for( i = 0; i < inputData->size; i++ )
-        {
-            outputData->buffer[i] = inputData->buffer[i] ^ mask.buffer[i];
-        }
-        outputData->size = inputData->size;
-    }
+    // Parameter encryption is always CFB for AES; anything else uses XOR
+    // obfuscation.
+    if( symmetric.algorithm == TPM2_ALG_AES )
+        symmetric.mode.aes = TPM2_ALG_CFB;
+    else
+        symmetric.algorithm = TPM2_ALG_XOR;
 
-    return rval;
+    return Tss2_Sys_ParamCrypt( &symmetric, session->authHash,
+            &session->sessionKey, authValue, &session->nonceNewer,
+            &session->nonceOlder, decrypt, outputData->buffer,
+            outputData->size );
 }
 
-
 TSS2_RC EncryptCommandParam( SESSION *session, TPM2B_MAX_BUFFER *encryptedData, TPM2B_MAX_BUFFER *clearData, TPM2B_AUTH *authValue )
 {
-    TSS2_RC rval = TSS2_RC_SUCCESS;
-
-    if( session->symmetric.algorithm == TPM2_ALG_AES )
-    {
-        // CFB mode encryption.
-        rval = EncryptCFB( session, encryptedData, clearData, authValue );
-    }
-    else
-    {
-        // XOR mode encryption.
-        rval = EncryptDecryptXOR( session, encryptedData, clearData, authValue );
-    }
-
-    return rval;
+    return CryptParam( session, encryptedData, clearData, authValue, NO );
 }
 
 TSS2_RC DecryptResponseParam( SESSION *session, TPM2B_MAX_BUFFER *clearData, TPM2B_MAX_BUFFER *encryptedData, TPM2B_AUTH *authValue )
 {
-    TSS2_RC rval = TSS2_RC_SUCCESS;
-
-    if( session->symmetric.algorithm == TPM2_ALG_AES )
-    {
-        // CFB mode decryption.
-        rval = DecryptCFB( session, clearData, encryptedData, authValue );
-    }
-    else
-    {
-        // XOR mode decryption.
-        rval = EncryptDecryptXOR( session, clearData, encryptedData, authValue );
-    }
-
-    return rval;
+    return CryptParam( session, clearData, encryptedData, authValue, YES );
 }
-
@@ -28,88 +28,62 @@
 #include "sapi/tpm20.h"
 #include "sample.h"
 #include "sysapi_util.h"
+#include "handle-table.h"
+
+//
+// Entities (handle / authValue pairs) are kept in a handle keyed table,
+// so the lookups done for every HMAC computation don't scan.
+//
+static HANDLE_TABLE entityTable;
 
 void InitEntities()
 {
-    int i;
-    for( i = 0; i < MAX_NUM_ENTITIES; i++ )
-    {
-        entities[i].entityHandle = TPM2_HT_NO_HANDLE;
-    }
+    handle_table_finalize( &entityTable );
+    handle_table_init( &entityTable, MAX_NUM_ENTITIES, sizeof( ENTITY ) );
 }
 
 TSS2_RC AddEntity( TPM2_HANDLE entityHandle, TPM2B_AUTH *auth )
 {
-    int i;
-    TSS2_RC rval = TPM2_RC_FAILURE;
-
-    for( i = 0; i < MAX_NUM_ENTITIES; i++ )
-    {
-        if( entities[i].entityHandle == TPM2_HT_NO_HANDLE )
-        {
-            entities[i].entityHandle = entityHandle;
-            CopySizedByteBuffer((TPM2B *)&entities[i].entityAuth, (TPM2B *)auth);
-
-            if( ( entityHandle >> TPM2_HR_SHIFT ) == TPM2_HT_NV_INDEX )
-            {
-                entities[i].nvNameChanged = 0;
-            }
-
-            rval = TPM2_RC_SUCCESS;
-            break;
-        }
-    }
-    return rval;
+    ENTITY entity;
+
+    entity.entityHandle = entityHandle;
+    CopySizedByteBuffer((TPM2B *)&entity.entityAuth, (TPM2B *)auth);
+    entity.nvNameChanged = 0;
+
+    if( handle_table_insert( &entityTable, entityHandle, &entity, 0 ) != TSS2_RC_SUCCESS )
+        return TPM2_RC_FAILURE;
+
+    return TPM2_RC_SUCCESS;
 }
 
 TSS2_RC DeleteEntity( TPM2_HANDLE entityHandle )
 {
-    int i;
-    TSS2_RC rval = TPM2_RC_FAILURE;
-
-    for( i = 0; i < MAX_NUM_ENTITIES; i++ )
-    {
-        if( entities[i].entityHandle == entityHandle )
-        {
-            entities[i].entityHandle = TPM2_HT_NO_HANDLE;
-            rval = TPM2_RC_SUCCESS;
-            break;
-        }
-    }
-    return rval;
+    if( handle_table_remove( &entityTable, entityHandle ) != TSS2_RC_SUCCESS )
+        return TPM2_RC_FAILURE;
+
+    return TPM2_RC_SUCCESS;
 }
 
 TSS2_RC GetEntityAuth( TPM2_HANDLE entityHandle, TPM2B_AUTH *auth )
 {
-    int i;
-    TSS2_RC rval = TPM2_RC_FAILURE;
-
-    for( i = 0; i < MAX_NUM_ENTITIES; i++ )
-    {
-        if( entities[i].entityHandle == entityHandle )
-        {
-            CopySizedByteBuffer((TPM2B *)auth, (TPM2B *)&entities[i].entityAuth);
-            rval = TPM2_RC_SUCCESS;
-            break;
-        }
-    }
-    return rval;
+    ENTITY entity;
+
+    if( handle_table_lookup( &entityTable, entityHandle, &entity ) != TSS2_RC_SUCCESS )
+        return TPM2_RC_FAILURE;
+
+    CopySizedByteBuffer((TPM2B *)auth, (TPM2B *)&entity.entityAuth);
+    return TPM2_RC_SUCCESS;
 }
 
 
 TSS2_RC GetEntity( TPM2_HANDLE entityHandle, ENTITY **entity )
 {
-    int i;
-    TSS2_RC rval = TPM2_RC_FAILURE;
-
-    for( i = 0; i < MAX_NUM_ENTITIES; i++ )
-    {
-        if( entities[i].entityHandle == entityHandle )
-        {
-            *entity = &( entities[i] );
-            rval = TPM2_RC_SUCCESS;
-        }
-    }
-    return rval;
-}
+    ENTITY *found;
+
+    found = handle_table_get( &entityTable, entityHandle );
+    if( found == 0 )
+        return TPM2_RC_FAILURE;
 
+    *entity = found;
+    return TPM2_RC_SUCCESS;
+}
@@ -49,29 +49,45 @@ UINT32 TpmComputeSessionHmac(
     TSS2_RC sessionCmdRval
     )
 {
-    TPM2B_MAX_BUFFER hmacKey;
-    TPM2B *bufferList[7];
     TPM2B_DIGEST pHash;
+    TPM2B_NAME name1;
+    TPM2B_NAME name2;
     SESSION *pSession = 0;
     TPM2B_AUTH authValue;
-    TPM2B sessionAttributesByteBuffer;
-    UINT16 i;
     TSS2_RC rval;
     UINT8 nvNameChanged = 0;
     ENTITY *nvEntity;
     TPM2_CC cmdCode;
 
-    hmacKey.size = 0;
-
     rval = GetSessionStruct( pSessionDataIn->sessionHandle, &pSession );
     if( rval != TPM2_RC_SUCCESS )
     {
         return rval;
     }
 
-    INIT_SIMPLE_TPM2B_SIZE( pHash );
-    rval = TpmCalcPHash(sysContext, handle1, handle2, pSession->authHash,
-            responseCode, &pHash);
+    if( responseCode == TPM2_RC_NO_RESPONSE )
+    {
+        // Command HMAC:  cpHash covers the names of the handles.
+        name1.size = name2.size = 0;
+        if( handle1 != TPM2_HT_NO_HANDLE )
+        {
+            rval = TpmHandleToName( handle1, &name1 );
+            if( rval != TPM2_RC_SUCCESS )
+                return rval;
+        }
+        if( handle2 != TPM2_HT_NO_HANDLE )
+        {
+            rval = TpmHandleToName( handle2, &name2 );
+            if( rval != TPM2_RC_SUCCESS )
+                return rval;
+        }
+        rval = Tss2_Sys_GetCpHash( sysContext, pSession->authHash,
+                &name1, &name2, NULL, &pHash );
+    }
+    else
+    {
+        rval = Tss2_Sys_GetRpHash( sysContext, pSession->authHash, &pHash );
+    }
     if( rval != TPM2_RC_SUCCESS )
         return rval;
 
@@ -100,40 +116,19 @@ UINT32 TpmComputeSessionHmac(
         nvNameChanged = pSession->nvNameChanged;
     }
 
-    rval = ConcatSizedByteBuffer((TPM2B_MAX_BUFFER *)&hmacKey, (TPM2B *)&pSession->sessionKey);
-
-    if( ( pSession->bind == TPM2_RH_NULL ) || ( pSession->bind != entityHandle )
-            || nvNameChanged )
-    {
-        rval = ConcatSizedByteBuffer((TPM2B_MAX_BUFFER *)&hmacKey, (TPM2B *)&authValue);
-    }
-
-#ifdef  DEBUG
-    DebugPrintf( 0, "\n\nhmacKey = " );
-    PrintSizedBuffer(&hmacKey);
-#endif
-
-    // Create buffer list
-    i = 0;
-    bufferList[i++] = (TPM2B *)&pHash;
-    bufferList[i++] = (TPM2B *)&pSession->nonceNewer;
-    bufferList[i++] = (TPM2B *)&pSession->nonceOlder;
-    bufferList[i++] = (TPM2B *)&pSession->nonceTpmDecrypt;
-    bufferList[i++] = (TPM2B *)&pSession->nonceTpmEncrypt;
-    sessionAttributesByteBuffer.size = 1;
-    sessionAttributesByteBuffer.buffer[0] = *(UINT8 *)&sessionAttributes;
-    bufferList[i++] = &sessionAttributesByteBuffer;
-    bufferList[i++] = 0;
-
-#ifdef  DEBUG
-    for( i = 0; bufferList[i] != 0; i++ )
+    // The entity's authValue is only part of the HMAC key if the entity is
+    // not the bound entity (or the bound NV index's name has changed).
+    if( ( pSession->bind != TPM2_RH_NULL ) && ( pSession->bind == entityHandle )
+            && !nvNameChanged )
     {
-        DebugPrintf( 0, "\n\nbufferlist[%d]:\n", i );
-        PrintSizedBuffer( bufferList[i] );
+        authValue.size = 0;
     }
-#endif
 
-    rval = TpmHmac(pSession->authHash, (TPM2B *)&hmacKey, bufferList, result);
+    // Computed on the host; no TPM round trips needed.
+    rval = Tss2_Sys_CalcSessionHmac( pSession->authHash, &pHash,
+            &pSession->sessionKey, &authValue, &pSession->nonceNewer,
+            &pSession->nonceOlder, &pSession->nonceTpmDecrypt,
+            &pSession->nonceTpmEncrypt, sessionAttributes, result );
     if( rval != TPM2_RC_SUCCESS )
         return rval;
 
@@ -28,98 +28,56 @@
 #include "sapi/tpm20.h"
 #include "sample.h"
 #include "../integration/sapi-util.h"
-#include <stdlib.h>
-
-#define SESSIONS_ARRAY_COUNT MAX_NUM_SESSIONS+1
-
-typedef struct _SESSION_LIST_ENTRY *SESSION_LIST_ENTRY_PTR;
-
-typedef struct _SESSION_LIST_ENTRY{
-    SESSION session;
-    SESSION_LIST_ENTRY_PTR nextEntry;
-} SESSION_LIST_ENTRY;
-
-SESSION_LIST_ENTRY *sessionsList = 0;
-INT16 sessionEntriesUsed = 0;
+#include "handle-table.h"
+#include <string.h>
 
+//
+// Active sessions, keyed by session handle.  The table is allocated once
+// and SESSION structs stay put in it until the session is deleted.
+//
+static HANDLE_TABLE sessionsTable;
 
-TSS2_RC AddSession( SESSION_LIST_ENTRY **sessionEntry )
+void InitSessionsTable()
 {
-    SESSION_LIST_ENTRY **lastEntry, *newEntry;
+    handle_table_finalize( &sessionsTable );
+    handle_table_init( &sessionsTable, MAX_NUM_SESSIONS, sizeof( SESSION ) );
+}
 
-//    DebugPrintf( 0, "In AddSession\n" );
+static TSS2_RC AddSession( SESSION *newSession, SESSION **session )
+{
+    void *stored;
 
-    // find end of list.
-    for( lastEntry = &sessionsList; *lastEntry != 0; lastEntry = &( (SESSION_LIST_ENTRY *)*lastEntry)->nextEntry )
-        ;
+    if( sessionsTable.pool == 0 )
+        InitSessionsTable();
 
-    // allocate space for session structure.
-    newEntry = (SESSION_LIST_ENTRY *)malloc( sizeof( SESSION_LIST_ENTRY ) );
-    if( newEntry != 0 )
-    {
-        *sessionEntry = *lastEntry = newEntry;
-        newEntry->nextEntry = 0;
-        sessionEntriesUsed++;
-        return TPM2_RC_SUCCESS;
-    }
-    else
-    {
+    if( handle_table_insert( &sessionsTable, newSession->sessionHandle,
+            newSession, &stored ) != TSS2_RC_SUCCESS )
         return TSS2_APP_RC_SESSION_SLOT_NOT_FOUND;
-    }
+
+    *session = stored;
+    return TPM2_RC_SUCCESS;
 }
 
 
 void DeleteSession( SESSION *session )
 {
-    SESSION_LIST_ENTRY *predSession;
-    SESSION_LIST_ENTRY *newNextEntry;
-
-//    DebugPrintf( 0, "In DeleteSession\n" );
-
-    if( session == &sessionsList->session )
-        sessionsList = 0;
-    else
-    {
-        // Find predecessor.
-        for( predSession = sessionsList;
-                predSession != 0 && &( ( ( SESSION_LIST_ENTRY *)predSession->nextEntry )->session ) != session;
-                predSession = predSession->nextEntry )
-            ;
-
-        if( predSession != 0 )
-        {
-            sessionEntriesUsed--;
-
-            newNextEntry = ( (SESSION_LIST_ENTRY *)predSession->nextEntry)->nextEntry;
-
-            free( predSession->nextEntry );
-
-            predSession->nextEntry = newNextEntry;
-        }
-    }
+    handle_table_remove( &sessionsTable, session->sessionHandle );
 }
 
 
 TSS2_RC GetSessionStruct( TPMI_SH_AUTH_SESSION sessionHandle, SESSION **session )
 {
     TSS2_RC rval = TSS2_APP_RC_GET_SESSION_STRUCT_FAILED;
-    SESSION_LIST_ENTRY *sessionEntry;
+    SESSION *found;
 
     DebugPrintf( 0, "In GetSessionStruct\n" );
 
     if( session != 0 )
     {
-        //
-        // Get pointer to session structure using the sessionHandle
-        //
-        for( sessionEntry = sessionsList;
-                sessionEntry != 0 && sessionEntry->session.sessionHandle != sessionHandle;
-                sessionEntry = sessionEntry->nextEntry )
-            ;
-
-        if( sessionEntry != 0 )
+        found = handle_table_get( &sessionsTable, sessionHandle );
+        if( found != 0 )
         {
-            *session = &sessionEntry->session;
+            *session = found;
             rval = TSS2_RC_SUCCESS;
         }
     }
@@ -258,70 +216,65 @@ TSS2_RC StartAuthSessionWithParams( SESSION **session,
     TSS2_TCTI_CONTEXT *tctiContext )
 {
     TSS2_RC rval;
-    SESSION_LIST_ENTRY *sessionEntry;
+    SESSION newSession;
 
     if (session == NULL) {
         return TSS2_APP_RC_BAD_REFERENCE;
     }
 
-    rval = AddSession( &sessionEntry );
-    if( rval == TSS2_RC_SUCCESS )
-    {
-        *session = &sessionEntry->session;
-
-        // Copy handles to session struct.
-        (*session)->bind = bind;
-        (*session)->tpmKey = tpmKey;
+    // The session is set up here and only stored in the sessions
+    // table, keyed by its handle, once the TPM has started it.
+    memset( &newSession, 0, sizeof( newSession ) );
 
-        // Copy nonceCaller to nonceOlder in session struct.
-        // This will be used as nonceCaller when StartAuthSession
-        // is called.
-        CopySizedByteBuffer((TPM2B *)&(*session)->nonceOlder, (TPM2B *)nonceCaller);
+    // Copy handles to session struct.
+    newSession.bind = bind;
+    newSession.tpmKey = tpmKey;
 
-        // Copy encryptedSalt
-        CopySizedByteBuffer((TPM2B *)&(*session)->encryptedSalt, (TPM2B *)encryptedSalt);
+    // Copy nonceCaller to nonceOlder in session struct.
+    // This will be used as nonceCaller when StartAuthSession
+    // is called.
+    CopySizedByteBuffer((TPM2B *)&newSession.nonceOlder, (TPM2B *)nonceCaller);
 
-        // Copy sessionType.
-        (*session)->sessionType = sessionType;
+    // Copy encryptedSalt
+    CopySizedByteBuffer((TPM2B *)&newSession.encryptedSalt, (TPM2B *)encryptedSalt);
 
-        // Init symmetric.
-        (*session)->symmetric.algorithm = symmetric->algorithm;
-        (*session)->symmetric.keyBits.sym = symmetric->keyBits.sym;
-        (*session)->symmetric.mode.sym = symmetric->mode.sym;
-        (*session)->authHash = algId;
+    // Copy sessionType.
+    newSession.sessionType = sessionType;
 
-        // Copy bind' authValue.
-        if( bindAuth == 0 )
-        {
-            (*session)->authValueBind.size = 0;
-        }
-        else
-        {
-            CopySizedByteBuffer((TPM2B *)&(*session)->authValueBind, (TPM2B *)bindAuth);
-        }
-
-        // Calculate sessionKey
-        if( (*session)->tpmKey == TPM2_RH_NULL )
-        {
-            (*session)->salt.size = 0;
-        }
-        else
-        {
-            CopySizedByteBuffer((TPM2B *)&(*session)->salt, (TPM2B *)salt);
-        }
+    // Init symmetric.
+    newSession.symmetric.algorithm = symmetric->algorithm;
+    newSession.symmetric.keyBits.sym = symmetric->keyBits.sym;
+    newSession.symmetric.mode.sym = symmetric->mode.sym;
+    newSession.authHash = algId;
 
-        if( (*session)->bind == TPM2_RH_NULL )
-            (*session)->authValueBind.size = 0;
+    // Copy bind' authValue.
+    if( bindAuth == 0 )
+    {
+        newSession.authValueBind.size = 0;
+    }
+    else
+    {
+        CopySizedByteBuffer((TPM2B *)&newSession.authValueBind, (TPM2B *)bindAuth);
+    }
 
-        rval = StartAuthSession( *session, tctiContext );
-        if( rval != TSS2_RC_SUCCESS )
-        {
-            DeleteSession( *session );
-        }
+    // Calculate sessionKey
+    if( newSession.tpmKey == TPM2_RH_NULL )
+    {
+        newSession.salt.size = 0;
     }
     else
     {
-        DeleteSession( *session );
+        CopySizedByteBuffer((TPM2B *)&newSession.salt, (TPM2B *)salt);
+    }
+
+    if( newSession.bind == TPM2_RH_NULL )
+        newSession.authValueBind.size = 0;
+
+    *session = 0;
+    rval = StartAuthSession( &newSession, tctiContext );
+    if( rval == TSS2_RC_SUCCESS )
+    {
+        rval = AddSession( &newSession, session );
     }
     return( rval );
 }
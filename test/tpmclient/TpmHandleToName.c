@@ -25,12 +25,40 @@
 // THE POSSIBILITY OF SUCH DAMAGE.
 //**********************************************************************;
 
+#include <stdlib.h>
+
 #include "sapi/tpm20.h"
 #include "sample.h"
 #include "sysapi_util.h"
 #include "tss2_endian.h"
 
+static TSS2_SYS_NAME_CACHE *nameCache = 0;
+
+//
+// Returns the name cache shared by all of the test's SAPI contexts,
+// allocating it on first use.  Returns NULL if that fails.
+//
+TSS2_SYS_NAME_CACHE *TpmNameCache()
+{
+    size_t cacheSize;
+
+    if( nameCache == 0 )
+    {
+        cacheSize = Tss2_Sys_GetNameCacheSize( 0 );
+        nameCache = malloc( cacheSize );
+        if( nameCache != 0 &&
+                Tss2_Sys_InitializeNameCache( nameCache, cacheSize, 0 ) != TSS2_RC_SUCCESS )
+        {
+            free( nameCache );
+            nameCache = 0;
+        }
+    }
+    return nameCache;
+}
+
 //
+// Names of loaded objects and NV indices come from the name cache; the
+// TPM is only asked (and the cache filled in) on a miss.
 //
 UINT32 TpmHandleToName( TPM2_HANDLE handle, TPM2B_NAME *name )
 {
@@ -39,17 +67,25 @@ UINT32 TpmHandleToName( TPM2_HANDLE handle, TPM2B_NAME *name )
     TPM2B_PUBLIC public;
     TPM2B_NV_PUBLIC nvPublic;
     TSS2_SYS_CONTEXT *sysContext;
+    TSS2_SYS_NAME_CACHE *cache;
     UINT8 *namePtr = name->name;
 
     // Initialize name to zero length in case of failure.
     INIT_SIMPLE_TPM2B_SIZE( *name );
     INIT_SIMPLE_TPM2B_SIZE( qualifiedName );
 
+    cache = TpmNameCache();
+
     if( handle == ( TPM2_HT_NO_HANDLE ) )
     {
         name->size = 0;
         rval = TPM2_RC_SUCCESS;
     }
+    else if( cache != 0 &&
+            Tss2_Sys_NameCacheLookup( cache, handle, name ) == TSS2_RC_SUCCESS )
+    {
+        rval = TPM2_RC_SUCCESS;
+    }
     else
     {
         switch( handle >> TPM2_HR_SHIFT )
@@ -30,22 +30,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "sysapi_util.h"
-#include "tss2_endian.h"
 
 //
+// Session key derivation now runs on the host (see Tss2_Sys_KDFa); this
+// wrapper keeps the existing tpmclient call sites unchanged.
 //
 TSS2_RC KDFa( TPMI_ALG_HASH hashAlg, TPM2B *key, char *label,
     TPM2B *contextU, TPM2B *contextV, UINT16 bits, TPM2B_MAX_BUFFER  *resultKey )
 {
-    TPM2B_DIGEST tmpResult;
-    TPM2B_DIGEST tpm2bLabel, tpm2bBits, tpm2b_i_2;
-    UINT8 *tpm2bBitsPtr = &tpm2bBits.buffer[0];
-    UINT8 *tpm2b_i_2Ptr = &tpm2b_i_2.buffer[0];
-    TPM2B_DIGEST *bufferList[8];
-    UINT32 bitsSwizzled, i_Swizzled;
     TSS2_RC rval;
-    int i, j;
-    UINT16 bytes = bits / 8;
 
 #ifdef DEBUG
     DebugPrintf( 0, "KDFA, hashAlg = %4.4x\n", hashAlg );
@@ -53,69 +46,10 @@ TSS2_RC KDFa( TPMI_ALG_HASH hashAlg, TPM2B *key, char *label,
     PrintSizedBuffer( key );
 #endif
 
-    resultKey->size = 0;
-
-    tpm2b_i_2.size = 4;
-
-    tpm2bBits.size = 4;
-    bitsSwizzled = BE_TO_HOST_32(bits);
-    *(UINT32 *)tpm2bBitsPtr = bitsSwizzled;
-
-    for(i = 0; label[i] != 0 ;i++ );
-
-    tpm2bLabel.size = i+1;
-    for( i = 0; i < tpm2bLabel.size; i++ )
-    {
-        tpm2bLabel.buffer[i] = label[i];
-    }
-
-#ifdef DEBUG
-    DebugPrintf( 0, "\n\nKDFA, tpm2bLabel = \n" );
-    PrintSizedBuffer((TPM2B *)&tpm2bLabel);
-
-    DebugPrintf( 0, "\n\nKDFA, contextU = \n" );
-    PrintSizedBuffer( contextU );
-
-    DebugPrintf( 0, "\n\nKDFA, contextV = \n" );
-    PrintSizedBuffer( contextV );
-#endif
-
-    resultKey->size = 0;
-
-    i = 1;
-
-    while(resultKey->size < bytes)
-    {
-        // Inner loop
-
-        i_Swizzled = BE_TO_HOST_32(i++);
-        *(UINT32 *)tpm2b_i_2Ptr = i_Swizzled;
-
-        j = 0;
-        bufferList[j++] = (TPM2B_DIGEST *)&(tpm2b_i_2);
-        bufferList[j++] = (TPM2B_DIGEST *)&(tpm2bLabel);
-        bufferList[j++] = (TPM2B_DIGEST *)contextU;
-        bufferList[j++] = (TPM2B_DIGEST *)contextV;
-        bufferList[j++] = (TPM2B_DIGEST *)&(tpm2bBits);
-        bufferList[j++] = (TPM2B_DIGEST *)0;
-#ifdef DEBUG
-        for( j = 0; bufferList[j] != 0; j++ )
-        {
-            DebugPrintf( 0, "\n\nbufferlist[%d]:\n", j );
-            PrintSizedBuffer( &( bufferList[j]->b ) );
-        }
-#endif
-        rval = TpmHmac(hashAlg, key, (TPM2B **)&( bufferList[0] ), &tmpResult);
-        if( rval != TPM2_RC_SUCCESS )
-        {
-            return( rval );
-        }
-
-        ConcatSizedByteBuffer(resultKey, (TPM2B *)&tmpResult);
-    }
-
-    // Truncate the result to the desired size.
-    resultKey->size = bytes;
+    rval = Tss2_Sys_KDFa( hashAlg, key, label, contextU, contextV, bits,
+            resultKey );
+    if( rval != TPM2_RC_SUCCESS )
+        return rval;
 
 #ifdef DEBUG
     DebugPrintf( 0, "\n\nKDFA, resultKey = \n" );
@@ -79,7 +79,7 @@ enum TSS2_APP_RC_CODE
 #define TPM2_HT_NO_HANDLE 0xfc000000
 #define TPM2_RC_NO_RESPONSE 0xffffffff
 
-#define MAX_NUM_SESSIONS MAX_ACTIVE_SESSIONS
+#define MAX_NUM_SESSIONS 256
 #define MAX_NUM_ENTITIES 100
 
 #define APPLICATION_ERROR( errCode ) \
@@ -151,8 +151,6 @@ TSS2_RC ComputeCommandHmacs( TSS2_SYS_CONTEXT *sysContext, TPM2_HANDLE handle1,
     TPM2_HANDLE handle2, TSS2_SYS_CMD_AUTHS *pSessionsData,
     TSS2_RC sessionCmdRval );
 
-extern INT16 sessionEntriesUsed;
-
 extern void InitSessionsTable();
 
 extern UINT32 ( *ComputeSessionHmacPtr )(
@@ -183,13 +181,6 @@ TSS2_RC StartAuthSessionWithParams( SESSION **session, TPMI_DH_OBJECT tpmKey, TP
 //
 // Used by upper layer code to save and update entity data
 // (authValue, specifically) at creation and use time.
-//
-// NOTE: this really needs to be turned into a linked list
-// with add, find, and remove entries, instead of a fixed
-// length array.
-//
-ENTITY entities[MAX_NUM_ENTITIES+1];
-
 //
 // This function calculates the session HMAC
 //
@@ -208,9 +199,6 @@ UINT32 TpmComputeSessionHmac(
     TSS2_RC sessionCmdRval
     );
 
-TSS2_RC TpmCalcPHash( TSS2_SYS_CONTEXT *sysContext, TPM2_HANDLE handle1,
-    TPM2_HANDLE handle2, TPMI_ALG_HASH authHash, TSS2_RC responseCode, TPM2B_DIGEST *pHash );
-
 void PrintSizedBuffer( TPM2B *sizedBuffer );
 
 void InitNullSession( TPMS_AUTH_COMMAND *nullSessionData );
@@ -240,6 +228,8 @@ UINT32 TpmHash( TPMI_ALG_HASH hashAlg, UINT16 size, BYTE *data, TPM2B_DIGEST *re
 
 UINT32 TpmHandleToName( TPM2_HANDLE handle, TPM2B_NAME *name );
 
+TSS2_SYS_NAME_CACHE *TpmNameCache();
+
 int TpmClientPrintf( UINT8 type, const char *format, ...);
 
 #ifdef __cplusplus
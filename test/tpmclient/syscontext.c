@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "sysapi_util.h"
+#include "sample.h"
 
 
 // Allocates space for and initializes system
@@ -59,6 +60,9 @@ TSS2_SYS_CONTEXT *InitSysContext(
         rval = Tss2_Sys_Initialize( sysContext, contextSize, tctiContext, abiVersion );
 
         if( rval == TSS2_RC_SUCCESS ) {
+            // Keep the shared name cache current from this context's
+            // responses.
+            Tss2_Sys_SetNameCache( sysContext, TpmNameCache() );
             return sysContext;
         } else {
             free (sysContext);
@@ -4401,6 +4401,7 @@ test_invoke (TSS2_SYS_CONTEXT *sapi_context)
     TSS2_RC rval = TSS2_RC_SUCCESS;
 
     sysContext = sapi_context;
+    Tss2_Sys_SetNameCache (sysContext, TpmNameCache ());
     rval = Tss2_Sys_GetTctiContext (sapi_context, &resMgrTctiContext);
     if (rval != TSS2_RC_SUCCESS) {
         printf ("Failed to get TCTI context from sapi_context: 0x%" PRIx32
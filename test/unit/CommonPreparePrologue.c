@@ -86,6 +86,28 @@ CommonPreparePrologue_previous_stage_response (void **state)
     rc = CommonPreparePrologue (sys_ctx, 0);
     assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
 }
+/**
+ * The handle counts and session flags for the command come from the
+ * command table: NV_Read has two command handles, no response handles and
+ * only allows response parameter encryption.
+ */
+static void
+CommonPreparePrologue_command_info (void **state)
+{
+    _TSS2_SYS_CONTEXT_BLOB *sys_ctx = (_TSS2_SYS_CONTEXT_BLOB*)*state;
+    TSS2_RC rc;
+
+    InitSysContextPtrs (sys_ctx, Tss2_Sys_GetContextSize (MAX_SIZE_CTX));
+    sys_ctx->previousStage = CMD_STAGE_INITIALIZE;
+    rc = CommonPreparePrologue (sys_ctx, TPM2_CC_NV_Read);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (sys_ctx->decryptAllowed, 0);
+    assert_int_equal (sys_ctx->encryptAllowed, 1);
+    assert_int_equal (sys_ctx->authAllowed, 1);
+    assert_int_equal (sys_ctx->numResponseHandles, 0);
+    assert_ptr_equal (sys_ctx->cpBuffer, sys_ctx->cmdBuffer +
+                      sizeof (TPM20_Header_In) + 2 * sizeof (TPM2_HANDLE));
+}
 int
 main (int argc, char* arvg[])
 {
@@ -100,6 +122,9 @@ main (int argc, char* arvg[])
         cmocka_unit_test_setup_teardown (CommonPreparePrologue_previous_stage_response,
                                   CommonPreparePrologue_sys_setup,
                                   CommonPreparePrologue_sys_teardown),
+        cmocka_unit_test_setup_teardown (CommonPreparePrologue_command_info,
+                                  CommonPreparePrologue_sys_setup,
+                                  CommonPreparePrologue_sys_teardown),
     };
     return cmocka_run_group_tests (tests, NULL, NULL);
 }
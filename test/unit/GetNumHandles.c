@@ -34,6 +34,33 @@ GetNumResponseHandles_HMAC_Start_unit (void **state)
     assert_int_equal (num_handles, 1);
 }
 
+/**
+ * PolicyNvWritten takes the policy session in its handle area, TestParms
+ * takes no handles at all.
+ */
+static void
+GetNumCommandHandles_PolicyNvWritten_unit (void **state)
+{
+    assert_int_equal (GetNumCommandHandles (TPM2_CC_PolicyNvWritten), 1);
+}
+
+static void
+GetNumCommandHandles_TestParms_unit (void **state)
+{
+    assert_int_equal (GetNumCommandHandles (TPM2_CC_TestParms), 0);
+}
+
+/**
+ * 0x123 falls in a hole of the command code space between
+ * TPM2_CC_NV_UndefineSpace and TPM2_CC_ChangeEPS.
+ */
+static void
+GetNumHandles_unassigned_unit (void **state)
+{
+    assert_int_equal (GetNumCommandHandles (0x123), 0);
+    assert_int_equal (GetNumResponseHandles (0x123), 0);
+}
+
 /**
  * Tests to ensure that GetNumCommandHandles and GetNumResponseHandles
  * returns 0 for unknown command codes.
@@ -68,6 +95,9 @@ main (int   argc,
     const struct CMUnitTest tests [] = {
         cmocka_unit_test (GetNumCommandHandles_PolicyPCR_unit),
         cmocka_unit_test (GetNumResponseHandles_HMAC_Start_unit),
+        cmocka_unit_test (GetNumCommandHandles_PolicyNvWritten_unit),
+        cmocka_unit_test (GetNumCommandHandles_TestParms_unit),
+        cmocka_unit_test (GetNumHandles_unassigned_unit),
         cmocka_unit_test (GetNumCommandHandles_LAST_plus_one),
         cmocka_unit_test (GetNumResponseHandles_LAST_plus_one),
     };
@@ -0,0 +1,329 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "sapi-mock.h"
+
+/* TPM2_NV_Read (owner, 0x01500000, 16, 0) with a password session "pw" */
+static const uint8_t nv_read_command[] = {
+    0x80, 0x02, 0x00, 0x00, 0x00, 0x25, 0x00, 0x00, 0x01, 0x4e,
+    0x40, 0x00, 0x00, 0x01, 0x01, 0x50, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x0b, 0x40, 0x00, 0x00, 0x09, 0x00, 0x00,
+    0x00, 0x00, 0x02, 'p', 'w',
+    0x00, 0x10, 0x00, 0x00,
+};
+
+static uint8_t sent[TPM2_MAX_COMMAND_SIZE];
+static size_t sent_size;
+static int sent_iovcnt;
+
+static TSS2_RC
+tcti_transmit_record (TSS2_TCTI_CONTEXT *tctiContext,
+                      size_t size,
+                      uint8_t *command)
+{
+    memcpy (sent, command, size);
+    sent_size = size;
+    sent_iovcnt = 0;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_transmitv_record (TSS2_TCTI_CONTEXT *tctiContext,
+                       const struct iovec *iov,
+                       int iovcnt)
+{
+    int i;
+
+    sent_size = 0;
+    for (i = 0; i < iovcnt; i++) {
+        memcpy (&sent[sent_size], iov[i].iov_base, iov[i].iov_len);
+        sent_size += iov[i].iov_len;
+    }
+    sent_iovcnt = iovcnt;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_receive_unused (TSS2_TCTI_CONTEXT *tctiContext,
+                     size_t *size,
+                     uint8_t *response,
+                     int32_t timeout)
+{
+    return TSS2_TCTI_RC_GENERAL_FAILURE;
+}
+
+static TSS2_TCTI_CONTEXT_COMMON_V1 tcti_v1 = {
+    .magic = 1,
+    .version = 1,
+    .transmit = tcti_transmit_record,
+    .receive = tcti_receive_unused,
+};
+
+static TSS2_TCTI_CONTEXT_COMMON_V2 tcti_v2 = {
+    .magic = 1,
+    .version = 2,
+    .transmit = tcti_transmit_record,
+    .receive = tcti_receive_unused,
+    .transmitv = tcti_transmitv_record,
+};
+
+static int
+cmd_auths_setup_v1 (void **state)
+{
+    *state = sapi_mock_init ((TSS2_TCTI_CONTEXT *)&tcti_v1);
+    return 0;
+}
+
+static int
+cmd_auths_setup_v2 (void **state)
+{
+    *state = sapi_mock_init ((TSS2_TCTI_CONTEXT *)&tcti_v2);
+    return 0;
+}
+
+static void
+cmd_auths_prepare (TSS2_SYS_CONTEXT *sys_ctx,
+                   UINT8 cmdAuthsCount)
+{
+    TPMS_AUTH_COMMAND session = {
+        .sessionHandle = TPM2_RS_PW,
+        .hmac = { .size = 2, .buffer = { 'p', 'w' } },
+    };
+    TPMS_AUTH_COMMAND *sessions[] = { &session };
+    TSS2_SYS_CMD_AUTHS auths = {
+        .cmdAuthsCount = cmdAuthsCount,
+        .cmdAuths = sessions,
+    };
+    const uint8_t *cp_before, *cp_after;
+    size_t cp_size;
+    TSS2_RC rc;
+
+    rc = Tss2_Sys_NV_Read_Prepare (sys_ctx, TPM2_RH_OWNER, 0x01500000, 16, 0);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_GetCpBuffer (sys_ctx, &cp_size, &cp_before);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    rc = Tss2_Sys_SetCmdAuths (sys_ctx, &auths);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    /* The parameters are not moved to make room for the auth area. */
+    rc = Tss2_Sys_GetCpBuffer (sys_ctx, &cp_size, &cp_after);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_ptr_equal (cp_before, cp_after);
+    assert_int_equal (cp_size, 4);
+}
+
+/*
+ * The auth area is marshalled in its final place, so a version 2 TCTI
+ * gets the command as one buffer too.
+ */
+static void
+cmd_auths_transmit_v2 (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TSS2_RC rc;
+
+    cmd_auths_prepare (sys_ctx, 1);
+    rc = Tss2_Sys_ExecuteAsync (sys_ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (sent_iovcnt, 0);
+    assert_int_equal (sent_size, sizeof (nv_read_command));
+    assert_memory_equal (sent, nv_read_command, sizeof (nv_read_command));
+}
+
+/* A version 1 TCTI gets the same command in one buffer. */
+static void
+cmd_auths_transmit_v1 (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TSS2_RC rc;
+
+    cmd_auths_prepare (sys_ctx, 1);
+    rc = Tss2_Sys_ExecuteAsync (sys_ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (sent_iovcnt, 0);
+    assert_int_equal (sent_size, sizeof (nv_read_command));
+    assert_memory_equal (sent, nv_read_command, sizeof (nv_read_command));
+}
+
+/*
+ * Setting the auths again replaces the area rather than growing the
+ * command, and setting none drops it again.
+ */
+static void
+cmd_auths_replace (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TPMS_AUTH_COMMAND session = {
+        .sessionHandle = TPM2_RS_PW,
+        .hmac = { .size = 2, .buffer = { 'p', 'w' } },
+    };
+    TPMS_AUTH_COMMAND *sessions[] = { &session };
+    TSS2_SYS_CMD_AUTHS auths = {
+        .cmdAuthsCount = 1,
+        .cmdAuths = sessions,
+    };
+    TSS2_RC rc;
+
+    cmd_auths_prepare (sys_ctx, 1);
+    rc = Tss2_Sys_SetCmdAuths (sys_ctx, &auths);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_ExecuteAsync (sys_ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (sent_size, sizeof (nv_read_command));
+    assert_memory_equal (sent, nv_read_command, sizeof (nv_read_command));
+}
+
+/* Three sessions: the header and handles move further down. */
+static TSS2_SYS_CMD_AUTHS *
+cmd_auths_three (void)
+{
+    static TPMS_AUTH_COMMAND session = {
+        .sessionHandle = TPM2_RS_PW,
+        .hmac = { .size = 2, .buffer = { 'p', 'w' } },
+    };
+    static TPMS_AUTH_COMMAND large = {
+        .sessionHandle = 0x02000000,
+        .nonce = { .size = 32 },
+        .hmac = { .size = 32 },
+    };
+    static TPMS_AUTH_COMMAND *sessions[] = { &session, &large, &large };
+    static TSS2_SYS_CMD_AUTHS auths = {
+        .cmdAuthsCount = 3,
+        .cmdAuths = sessions,
+    };
+
+    return &auths;
+}
+
+static void
+cmd_auths_grow (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    /* two more sessions of 4 + 2 + 32 + 1 + 2 + 32 bytes */
+    size_t size = sizeof (nv_read_command) + 2 * 73;
+    const uint8_t *cp_before, *cp_after;
+    size_t cp_size;
+    TSS2_RC rc;
+
+    cmd_auths_prepare (sys_ctx, 1);
+    rc = Tss2_Sys_GetCpBuffer (sys_ctx, &cp_size, &cp_before);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_SetCmdAuths (sys_ctx, cmd_auths_three ());
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_GetCpBuffer (sys_ctx, &cp_size, &cp_after);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_ptr_equal (cp_before, cp_after);
+
+    rc = Tss2_Sys_ExecuteAsync (sys_ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (sent_size, size);
+    assert_int_equal (sent[4], size >> 8);
+    assert_int_equal (sent[5], size & 0xff);
+    /* handles, then the area size and the first session as before */
+    assert_memory_equal (sent + 6, nv_read_command + 6, 12);
+    assert_int_equal (sent[21], 11 + 2 * 73);
+    assert_memory_equal (sent + 22, nv_read_command + 22, 11);
+    assert_memory_equal (sent + size - 4, nv_read_command + 33, 4);
+}
+
+/* Going back to a smaller area moves the header and handles back up. */
+static void
+cmd_auths_shrink (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TSS2_SYS_CMD_AUTHS one = {
+        .cmdAuthsCount = 1,
+        .cmdAuths = cmd_auths_three ()->cmdAuths,
+    };
+    TSS2_RC rc;
+
+    cmd_auths_prepare (sys_ctx, 1);
+    rc = Tss2_Sys_SetCmdAuths (sys_ctx, cmd_auths_three ());
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_SetCmdAuths (sys_ctx, &one);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_ExecuteAsync (sys_ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (sent_size, sizeof (nv_read_command));
+    assert_memory_equal (sent, nv_read_command, sizeof (nv_read_command));
+}
+
+static void
+cmd_auths_remove (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TSS2_SYS_CMD_AUTHS auths = {
+        .cmdAuthsCount = 0,
+    };
+    TSS2_RC rc;
+
+    cmd_auths_prepare (sys_ctx, 1);
+    rc = Tss2_Sys_SetCmdAuths (sys_ctx, &auths);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_ExecuteAsync (sys_ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (sent_size, 22);
+    assert_int_equal (sent[1], 0x01);
+    assert_int_equal (sent[5], 22);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const struct CMUnitTest tests [] = {
+        cmocka_unit_test_setup_teardown (cmd_auths_transmit_v2,
+                                         cmd_auths_setup_v2,
+                                         sapi_mock_teardown),
+        cmocka_unit_test_setup_teardown (cmd_auths_transmit_v1,
+                                         cmd_auths_setup_v1,
+                                         sapi_mock_teardown),
+        cmocka_unit_test_setup_teardown (cmd_auths_grow,
+                                         cmd_auths_setup_v1,
+                                         sapi_mock_teardown),
+        cmocka_unit_test_setup_teardown (cmd_auths_shrink,
+                                         cmd_auths_setup_v1,
+                                         sapi_mock_teardown),
+        cmocka_unit_test_setup_teardown (cmd_auths_replace,
+                                         cmd_auths_setup_v2,
+                                         sapi_mock_teardown),
+        cmocka_unit_test_setup_teardown (cmd_auths_remove,
+                                         cmd_auths_setup_v2,
+                                         sapi_mock_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
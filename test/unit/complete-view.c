@@ -0,0 +1,240 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "sapi-mock.h"
+
+/* Canned response the mock TCTI answers the next command with. */
+static struct {
+    uint8_t response [TPM2_MAX_RESPONSE_SIZE];
+    size_t size;
+} mock;
+
+/* Start a TPM2_ST_NO_SESSIONS success response; the parameters follow. */
+static void
+response_begin (void)
+{
+    size_t offset = 0;
+
+    Tss2_MU_TPM2_ST_Marshal (TPM2_ST_NO_SESSIONS, mock.response,
+                             sizeof (mock.response), &offset);
+    mock.size = 10;
+    memset (&mock.response [offset], 0, mock.size - offset);
+}
+
+static void
+response_end (void)
+{
+    mock.response [2] = mock.size >> 24;
+    mock.response [3] = mock.size >> 16;
+    mock.response [4] = mock.size >> 8;
+    mock.response [5] = mock.size;
+    sapi_mock_respond (mock.response, mock.size);
+}
+
+/* Append a TPM2B holding 'size' bytes counting up from 'first'. */
+static void
+response_add_tpm2b (UINT16 size, uint8_t first)
+{
+    UINT16 i;
+
+    mock.response [mock.size++] = size >> 8;
+    mock.response [mock.size++] = size;
+    for (i = 0; i < size; i++)
+        mock.response [mock.size++] = first + i;
+}
+
+static void
+nv_read (TSS2_SYS_CONTEXT *sys_ctx)
+{
+    TSS2_RC rc;
+
+    rc = Tss2_Sys_NV_Read_Prepare (sys_ctx, 0x01500000, 0x01500000, 16, 0);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_Execute (sys_ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
+
+/*
+ * Check that the view points at the data in the response buffer and holds
+ * the same bytes _Complete copies out.
+ */
+static void
+nv_read_view_test (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TSS2_SYS_TPM2B_VIEW view = { 0 };
+    TPM2B_MAX_NV_BUFFER data = { 0 };
+    TSS2_RC rc;
+
+    response_begin ();
+    response_add_tpm2b (16, 0x40);
+    response_end ();
+    nv_read (sys_ctx);
+
+    rc = Tss2_Sys_NV_Read_CompleteView (sys_ctx, &view);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (view.len, 16);
+    assert_true (view.ptr > (uint8_t *)sys_ctx);
+    assert_true (view.ptr + view.len <=
+                 (uint8_t *)sys_ctx + Tss2_Sys_GetContextSize (0));
+
+    rc = Tss2_Sys_NV_Read_Complete (sys_ctx, &data);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (data.size, view.len);
+    assert_memory_equal (data.buffer, view.ptr, view.len);
+
+    rc = Tss2_Sys_NV_Read_CompleteView (sys_ctx, NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
+
+/* A TPM2B running past the end of the response is rejected. */
+static void
+nv_read_view_truncated_test (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TSS2_SYS_TPM2B_VIEW view = { 0 };
+    TSS2_RC rc;
+
+    response_begin ();
+    response_add_tpm2b (16, 0x40);
+    mock.size -= 6;
+    response_end ();
+    nv_read (sys_ctx);
+
+    rc = Tss2_Sys_NV_Read_CompleteView (sys_ctx, &view);
+    assert_int_equal (rc, TSS2_TYPES_RC_INSUFFICIENT_BUFFER);
+    assert_null (view.ptr);
+}
+
+/* A TPM2B larger than the TPM2B type it stands for is rejected. */
+static void
+nv_read_view_oversized_test (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TSS2_SYS_TPM2B_VIEW view = { 0 };
+    TSS2_RC rc;
+
+    response_begin ();
+    response_add_tpm2b (TPM2_MAX_NV_BUFFER_SIZE + 1, 0);
+    response_end ();
+    nv_read (sys_ctx);
+
+    rc = Tss2_Sys_NV_Read_CompleteView (sys_ctx, &view);
+    assert_int_equal (rc, TSS2_SYS_RC_MALFORMED_RESPONSE);
+    assert_null (view.ptr);
+}
+
+/*
+ * Check the three ReadPublic views against a marshaled public area and
+ * against what _Complete copies out.
+ */
+static void
+read_public_view_test (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TSS2_SYS_TPM2B_VIEW out_public, name, qualified_name;
+    TPM2B_PUBLIC in = { 0 }, out = { 0 };
+    TPM2B_NAME name_copy = { 0 }, qualified_copy = { 0 };
+    size_t offset;
+    TSS2_RC rc;
+
+    in.publicArea.type = TPM2_ALG_KEYEDHASH;
+    in.publicArea.nameAlg = TPM2_ALG_SHA256;
+    in.publicArea.objectAttributes.userWithAuth = 1;
+    in.publicArea.parameters.keyedHashDetail.scheme.scheme = TPM2_ALG_NULL;
+    in.publicArea.unique.keyedHash.size = 32;
+    memset (in.publicArea.unique.keyedHash.buffer, 0xaa, 32);
+
+    response_begin ();
+    offset = mock.size;
+    rc = Tss2_MU_TPM2B_PUBLIC_Marshal (&in, mock.response,
+                                       sizeof (mock.response), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    mock.size = offset;
+    response_add_tpm2b (34, 0x10);
+    response_add_tpm2b (34, 0x80);
+    response_end ();
+
+    rc = Tss2_Sys_ReadPublic_Prepare (sys_ctx, 0x81000001);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_Execute (sys_ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    rc = Tss2_Sys_ReadPublic_CompleteView (sys_ctx, &out_public, &name,
+                                           &qualified_name);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (out_public.len, offset - 12);
+    assert_memory_equal (out_public.ptr, &mock.response [12],
+                         out_public.len);
+    assert_ptr_equal (name.ptr, out_public.ptr + out_public.len + 2);
+    assert_int_equal (name.len, 34);
+    assert_ptr_equal (qualified_name.ptr, name.ptr + name.len + 2);
+    assert_int_equal (qualified_name.len, 34);
+
+    rc = Tss2_Sys_ReadPublic_Complete (sys_ctx, &out, &name_copy,
+                                       &qualified_copy);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (out.size, out_public.len);
+    assert_memory_equal (&out.publicArea.unique.keyedHash.buffer,
+                         &in.publicArea.unique.keyedHash.buffer, 32);
+    assert_memory_equal (name_copy.name, name.ptr, name.len);
+    assert_memory_equal (qualified_copy.name, qualified_name.ptr,
+                         qualified_name.len);
+
+    rc = Tss2_Sys_ReadPublic_CompleteView (sys_ctx, NULL, &name, NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (name.len, 34);
+}
+
+int
+main (int argc, char* argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown (nv_read_view_test,
+                                         sapi_mock_setup,
+                                         sapi_mock_teardown),
+        cmocka_unit_test_setup_teardown (nv_read_view_truncated_test,
+                                         sapi_mock_setup,
+                                         sapi_mock_teardown),
+        cmocka_unit_test_setup_teardown (nv_read_view_oversized_test,
+                                         sapi_mock_setup,
+                                         sapi_mock_teardown),
+        cmocka_unit_test_setup_teardown (read_public_view_test,
+                                         sapi_mock_setup,
+                                         sapi_mock_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
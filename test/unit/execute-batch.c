@@ -0,0 +1,415 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "sapi-mock.h"
+
+#define BATCH_SIZE 5
+
+/*
+ * Mock version 3 TCTI with a submit queue 'depth' commands deep. Every
+ * command is expected to be a TPM2_GetRandom; its response holds as many
+ * bytes as were requested, each set to the command's tag.
+ */
+typedef struct {
+    uint8_t *command;
+    uint8_t *response;
+    uint64_t tag;
+} mock_entry;
+
+static struct {
+    size_t depth;
+    mock_entry queue [BATCH_SIZE];
+    size_t count;
+    size_t submitted;
+    size_t max_in_flight;
+    size_t transmitted;
+    uint8_t *last_command;
+    /* per tag: error for the completion, response code from the TPM */
+    TSS2_RC tcti_rc [BATCH_SIZE];
+    TPM2_RC tpm_rc [BATCH_SIZE];
+    /* per call to reap: error returned instead of completions */
+    TSS2_RC reap_rc [4];
+    size_t reaps;
+} mock;
+
+static size_t
+get_random_respond (uint8_t *command, uint8_t *response, uint8_t value,
+                    TPM2_RC tpm_rc)
+{
+    size_t requested = command [10] << 8 | command [11];
+    size_t size = tpm_rc ? 10 : 12 + requested;
+
+    assert_int_equal (command [9], TPM2_CC_GetRandom & 0xff);
+    response [0] = 0x80;
+    response [1] = 0x01;
+    response [2] = response [3] = response [4] = 0;
+    response [5] = size;
+    response [6] = tpm_rc >> 24;
+    response [7] = tpm_rc >> 16;
+    response [8] = tpm_rc >> 8;
+    response [9] = tpm_rc;
+    if (tpm_rc == TPM2_RC_SUCCESS) {
+        response [10] = 0;
+        response [11] = requested;
+        memset (&response [12], value, requested);
+    }
+    return size;
+}
+
+static TSS2_RC
+tcti_transmit (TSS2_TCTI_CONTEXT *tctiContext,
+               size_t size,
+               uint8_t *command)
+{
+    mock.last_command = command;
+    mock.transmitted++;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_receive (TSS2_TCTI_CONTEXT *tctiContext,
+              size_t *size,
+              uint8_t *response,
+              int32_t timeout)
+{
+    assert_int_equal (timeout, TSS2_TCTI_TIMEOUT_BLOCK);
+    *size = get_random_respond (mock.last_command, response,
+                                mock.transmitted - 1, TPM2_RC_SUCCESS);
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_submit (TSS2_TCTI_CONTEXT *tctiContext,
+             size_t command_size,
+             uint8_t *command,
+             size_t response_size,
+             uint8_t *response,
+             uint64_t user_tag)
+{
+    assert_true (response_size >= TPM2_MAX_RESPONSE_SIZE);
+    assert_int_equal (command_size, 12);
+    if (mock.count == mock.depth)
+        return TSS2_TCTI_RC_TRY_AGAIN;
+
+    mock.queue [mock.count].command = command;
+    mock.queue [mock.count].response = response;
+    mock.queue [mock.count].tag = user_tag;
+    mock.count++;
+    mock.submitted++;
+    if (mock.count > mock.max_in_flight)
+        mock.max_in_flight = mock.count;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_reap (TSS2_TCTI_CONTEXT *tctiContext,
+           TSS2_TCTI_COMPLETION *completions,
+           size_t max,
+           size_t *count,
+           int32_t timeout)
+{
+    mock_entry *entry;
+
+    assert_int_equal (timeout, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_true (mock.count > 0);
+    if (mock.reaps < 4 && mock.reap_rc [mock.reaps] != TSS2_RC_SUCCESS)
+        return mock.reap_rc [mock.reaps++];
+    mock.reaps++;
+
+    for (*count = 0; *count < max && mock.count > 0; (*count)++) {
+        entry = &mock.queue [0];
+        completions [*count].user_tag = entry->tag;
+        completions [*count].rc = mock.tcti_rc [entry->tag];
+        completions [*count].response_size = 0;
+        if (mock.tcti_rc [entry->tag] == TSS2_RC_SUCCESS)
+            completions [*count].response_size =
+                get_random_respond (entry->command, entry->response,
+                                    entry->tag, mock.tpm_rc [entry->tag]);
+        mock.count--;
+        memmove (&mock.queue [0], &mock.queue [1],
+                 mock.count * sizeof (mock.queue [0]));
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_TCTI_CONTEXT_COMMON_V3 tcti_v3 = {
+    .magic = 1,
+    .version = 3,
+    .transmit = tcti_transmit,
+    .receive = tcti_receive,
+    .submit = tcti_submit,
+    .reap = tcti_reap,
+};
+
+static TSS2_TCTI_CONTEXT_COMMON_V1 tcti_v1 = {
+    .magic = 1,
+    .version = 1,
+    .transmit = tcti_transmit,
+    .receive = tcti_receive,
+};
+
+/* Context i asks for i + 1 random bytes. */
+static void
+batch_prepare (TSS2_SYS_CONTEXT **sys_ctx, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++)
+        assert_int_equal (Tss2_Sys_GetRandom_Prepare (sys_ctx [i], i + 1),
+                          TSS2_RC_SUCCESS);
+}
+
+static void
+batch_check (TSS2_SYS_CONTEXT *sys_ctx, size_t i)
+{
+    TPM2B_DIGEST random = { .size = 0 };
+    uint8_t expected [BATCH_SIZE];
+
+    memset (expected, i, sizeof (expected));
+    assert_int_equal (Tss2_Sys_GetRandom_Complete (sys_ctx, &random),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (random.size, i + 1);
+    assert_memory_equal (random.buffer, expected, i + 1);
+}
+
+static int
+batch_setup (void **state)
+{
+    TSS2_SYS_CONTEXT **sys_ctx;
+    size_t i;
+
+    memset (&mock, 0, sizeof (mock));
+    mock.depth = BATCH_SIZE;
+    sys_ctx = calloc (BATCH_SIZE, sizeof (*sys_ctx));
+    assert_non_null (sys_ctx);
+    for (i = 0; i < BATCH_SIZE; i++)
+        sys_ctx [i] = sapi_mock_init ((TSS2_TCTI_CONTEXT *)&tcti_v3);
+
+    *state = sys_ctx;
+    return 0;
+}
+
+static int
+batch_teardown (void **state)
+{
+    TSS2_SYS_CONTEXT **sys_ctx = *state;
+    size_t i;
+
+    for (i = 0; i < BATCH_SIZE; i++)
+        free (sys_ctx [i]);
+    free (sys_ctx);
+    return 0;
+}
+/*
+ * All commands are queued before the first response is reaped, and each
+ * response ends up in the context that sent the command.
+ */
+static void
+batch_queued (void **state)
+{
+    TSS2_SYS_CONTEXT **sys_ctx = *state;
+    TSS2_RC rvals [BATCH_SIZE];
+    size_t i;
+
+    batch_prepare (sys_ctx, BATCH_SIZE);
+    assert_int_equal (Tss2_Sys_ExecuteBatch (sys_ctx, BATCH_SIZE, rvals),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (mock.submitted, BATCH_SIZE);
+    assert_int_equal (mock.max_in_flight, BATCH_SIZE);
+    assert_int_equal (mock.transmitted, 0);
+    for (i = 0; i < BATCH_SIZE; i++) {
+        assert_int_equal (rvals [i], TSS2_RC_SUCCESS);
+        batch_check (sys_ctx [i], i);
+    }
+}
+/*
+ * A queue shorter than the batch is refilled as responses are reaped.
+ */
+static void
+batch_queue_full (void **state)
+{
+    TSS2_SYS_CONTEXT **sys_ctx = *state;
+    TSS2_RC rvals [BATCH_SIZE];
+    size_t i;
+
+    mock.depth = 2;
+    batch_prepare (sys_ctx, BATCH_SIZE);
+    assert_int_equal (Tss2_Sys_ExecuteBatch (sys_ctx, BATCH_SIZE, rvals),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (mock.submitted, BATCH_SIZE);
+    assert_int_equal (mock.max_in_flight, 2);
+    for (i = 0; i < BATCH_SIZE; i++)
+        batch_check (sys_ctx [i], i);
+}
+/*
+ * A failing command doesn't stop the others. A TPM error is reported like
+ * Tss2_Sys_Execute does, a TCTI error requires preparing the command
+ * again.
+ */
+static void
+batch_errors (void **state)
+{
+    TSS2_SYS_CONTEXT **sys_ctx = *state;
+    TSS2_RC rvals [BATCH_SIZE];
+    TSS2_RC rc;
+    size_t i;
+
+    mock.tpm_rc [1] = TPM2_RC_FAILURE;
+    mock.tcti_rc [3] = TSS2_TCTI_RC_IO_ERROR;
+    batch_prepare (sys_ctx, BATCH_SIZE);
+    rc = Tss2_Sys_ExecuteBatch (sys_ctx, BATCH_SIZE, rvals);
+    assert_int_equal (rc, TPM2_RC_FAILURE);
+    assert_int_equal (rvals [1], TPM2_RC_FAILURE);
+    assert_int_equal (rvals [3], TSS2_TCTI_RC_IO_ERROR);
+    for (i = 0; i < BATCH_SIZE; i++)
+        if (i != 1 && i != 3)
+            batch_check (sys_ctx [i], i);
+
+    rc = Tss2_Sys_ExecuteAsync (sys_ctx [3]);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
+    rc = Tss2_Sys_GetRandom_Prepare (sys_ctx [3], 4);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
+/*
+ * reap returning TSS2_TCTI_RC_TRY_AGAIN is retried. Any other error fails
+ * the outstanding commands, but they are still reaped so the TCTI's queue
+ * is empty and the next batch goes through.
+ */
+static void
+batch_reap_errors (void **state)
+{
+    TSS2_SYS_CONTEXT **sys_ctx = *state;
+    TSS2_RC rvals [BATCH_SIZE];
+    TSS2_RC rc;
+    size_t i;
+
+    mock.reap_rc [0] = TSS2_TCTI_RC_TRY_AGAIN;
+    mock.reap_rc [1] = TSS2_TCTI_RC_IO_ERROR;
+    batch_prepare (sys_ctx, BATCH_SIZE);
+    rc = Tss2_Sys_ExecuteBatch (sys_ctx, BATCH_SIZE, rvals);
+    assert_int_equal (rc, TSS2_TCTI_RC_IO_ERROR);
+    assert_int_equal (mock.reaps, 3);
+    assert_int_equal (mock.count, 0);
+    for (i = 0; i < BATCH_SIZE; i++) {
+        assert_int_equal (rvals [i], TSS2_TCTI_RC_IO_ERROR);
+        rc = Tss2_Sys_ExecuteAsync (sys_ctx [i]);
+        assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
+    }
+
+    batch_prepare (sys_ctx, BATCH_SIZE);
+    assert_int_equal (Tss2_Sys_ExecuteBatch (sys_ctx, BATCH_SIZE, rvals),
+                      TSS2_RC_SUCCESS);
+    for (i = 0; i < BATCH_SIZE; i++)
+        batch_check (sys_ctx [i], i);
+}
+/*
+ * Nothing is sent unless every context has a command prepared for the
+ * same TCTI.
+ */
+static void
+batch_bad_args (void **state)
+{
+    TSS2_SYS_CONTEXT **sys_ctx = *state;
+    TSS2_SYS_CONTEXT *dup [2] = { sys_ctx [0], sys_ctx [0] };
+    TSS2_SYS_CONTEXT *other;
+    TSS2_RC rvals [BATCH_SIZE];
+    TSS2_RC rc;
+
+    rc = Tss2_Sys_ExecuteBatch (NULL, 1, rvals);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_REFERENCE);
+    rc = Tss2_Sys_ExecuteBatch (sys_ctx, 1, NULL);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_REFERENCE);
+    rc = Tss2_Sys_ExecuteBatch (sys_ctx, 0, rvals);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    batch_prepare (sys_ctx, 1);
+    rc = Tss2_Sys_ExecuteBatch (sys_ctx, 2, rvals);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
+    rc = Tss2_Sys_ExecuteBatch (dup, 2, rvals);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_VALUE);
+
+    other = sapi_mock_init ((TSS2_TCTI_CONTEXT *)&tcti_v1);
+    assert_int_equal (Tss2_Sys_GetRandom_Prepare (other, 1), TSS2_RC_SUCCESS);
+    dup [1] = other;
+    rc = Tss2_Sys_ExecuteBatch (dup, 2, rvals);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_VALUE);
+    free (other);
+
+    assert_int_equal (mock.submitted, 0);
+    assert_int_equal (mock.transmitted, 0);
+}
+/*
+ * TCTIs without a submit queue run the batch one command at a time.
+ */
+static void
+batch_v1 (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx [BATCH_SIZE];
+    TSS2_RC rvals [BATCH_SIZE];
+    size_t i;
+
+    memset (&mock, 0, sizeof (mock));
+    for (i = 0; i < BATCH_SIZE; i++)
+        sys_ctx [i] = sapi_mock_init ((TSS2_TCTI_CONTEXT *)&tcti_v1);
+    batch_prepare (sys_ctx, BATCH_SIZE);
+    assert_int_equal (Tss2_Sys_ExecuteBatch (sys_ctx, BATCH_SIZE, rvals),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (mock.transmitted, BATCH_SIZE);
+    for (i = 0; i < BATCH_SIZE; i++) {
+        batch_check (sys_ctx [i], i);
+        free (sys_ctx [i]);
+    }
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown (batch_queued,
+                                         batch_setup, batch_teardown),
+        cmocka_unit_test_setup_teardown (batch_queue_full,
+                                         batch_setup, batch_teardown),
+        cmocka_unit_test_setup_teardown (batch_errors,
+                                         batch_setup, batch_teardown),
+        cmocka_unit_test_setup_teardown (batch_reap_errors,
+                                         batch_setup, batch_teardown),
+        cmocka_unit_test_setup_teardown (batch_bad_args,
+                                         batch_setup, batch_teardown),
+        cmocka_unit_test (batch_v1),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,249 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "sapi-mock.h"
+
+/* TPM2_GetRandom response: 4 random bytes */
+static const uint8_t get_random_response[] = {
+    0x80, 0x01, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x04, 0xde, 0xad, 0xbe, 0xef,
+};
+
+static uint8_t *receive_buffer;
+static size_t receive_size;
+/* set when the next receive may offer a scratch buffer to drop a response */
+static int discard_expected;
+
+static TSS2_RC
+tcti_transmit (TSS2_TCTI_CONTEXT *tctiContext,
+               size_t size,
+               uint8_t *command)
+{
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * The mock queue holds the return code and, for TSS2_RC_SUCCESS, the
+ * number of bytes of the response to deliver (and the response). Every
+ * call must be offered the same buffer of the same size, except for the
+ * one dropping a response that didn't fit.
+ */
+static TSS2_RC
+tcti_receive (TSS2_TCTI_CONTEXT *tctiContext,
+              size_t *size,
+              uint8_t *response,
+              int32_t timeout)
+{
+    TSS2_RC rc = mock_type (TSS2_RC);
+    size_t len;
+
+    if (receive_buffer == NULL) {
+        receive_buffer = response;
+        receive_size = *size;
+    }
+    if (discard_expected && response != receive_buffer) {
+        assert_true (*size >= TPM2_MAX_RESPONSE_SIZE);
+        discard_expected = 0;
+    } else {
+        assert_ptr_equal (response, receive_buffer);
+        assert_int_equal (*size, receive_size);
+    }
+    assert_int_equal (timeout, TSS2_TCTI_TIMEOUT_NONE);
+
+    if (rc == TSS2_RC_SUCCESS) {
+        len = mock_type (size_t);
+        memcpy (response, mock_ptr_type (uint8_t *), len);
+        *size = len;
+    }
+    return rc;
+}
+
+static TSS2_TCTI_CONTEXT_COMMON_V1 tcti = {
+    .magic = 1,
+    .version = 1,
+    .transmit = tcti_transmit,
+    .receive = tcti_receive,
+};
+
+static int
+execute_finish_setup (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx;
+    TSS2_RC rc;
+
+    sys_ctx = sapi_mock_init ((TSS2_TCTI_CONTEXT *)&tcti);
+    rc = Tss2_Sys_GetRandom_Prepare (sys_ctx, 4);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_ExecuteAsync (sys_ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    receive_buffer = NULL;
+    discard_expected = 0;
+    *state = sys_ctx;
+    return 0;
+}
+/*
+ * TRY_AGAIN leaves the context waiting for the response: it can be polled
+ * any number of times and completes normally once the response is in.
+ */
+static void
+execute_finish_try_again (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TPM2B_DIGEST random = { .size = 0 };
+    TSS2_RC rc;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        will_return (tcti_receive, TSS2_TCTI_RC_TRY_AGAIN);
+        rc = Tss2_Sys_ExecuteFinish (sys_ctx, TSS2_TCTI_TIMEOUT_NONE);
+        assert_int_equal (rc, TSS2_TCTI_RC_TRY_AGAIN);
+        rc = Tss2_Sys_GetRandom_Complete (sys_ctx, &random);
+        assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
+        rc = Tss2_Sys_GetRandom_Prepare (sys_ctx, 4);
+        assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
+    }
+
+    will_return (tcti_receive, TSS2_RC_SUCCESS);
+    will_return (tcti_receive, sizeof (get_random_response));
+    will_return (tcti_receive, get_random_response);
+    rc = Tss2_Sys_ExecuteFinish (sys_ctx, TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_GetRandom_Complete (sys_ctx, &random);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (random.size, 4);
+    assert_memory_equal (random.buffer, &get_random_response [12], 4);
+
+    rc = Tss2_Sys_ExecuteFinish (sys_ctx, TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
+}
+/*
+ * A response that doesn't fit is taken off the TCTI and dropped, so it
+ * can't be mistaken for the next command's, and the context accepts a new
+ * command. Until all of it is in, the context keeps waiting for it.
+ */
+static void
+execute_finish_insufficient_buffer (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TSS2_RC rc;
+
+    will_return (tcti_receive, TSS2_TCTI_RC_INSUFFICIENT_BUFFER);
+    will_return (tcti_receive, TSS2_TCTI_RC_TRY_AGAIN);
+    discard_expected = 1;
+    rc = Tss2_Sys_ExecuteFinish (sys_ctx, TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_TCTI_RC_TRY_AGAIN);
+    rc = Tss2_Sys_GetRandom_Prepare (sys_ctx, 4);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
+
+    will_return (tcti_receive, TSS2_TCTI_RC_INSUFFICIENT_BUFFER);
+    will_return (tcti_receive, TSS2_RC_SUCCESS);
+    will_return (tcti_receive, sizeof (get_random_response));
+    will_return (tcti_receive, get_random_response);
+    discard_expected = 1;
+    rc = Tss2_Sys_ExecuteFinish (sys_ctx, TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_SYS_RC_INSUFFICIENT_CONTEXT);
+    rc = Tss2_Sys_ExecuteFinish (sys_ctx, TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
+    rc = Tss2_Sys_GetRandom_Prepare (sys_ctx, 4);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
+/*
+ * Once received, an unusable response ends the command: the context goes
+ * back to accepting a new one instead of waiting on the TCTI again.
+ */
+static void
+execute_finish_bad_responses (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    uint8_t response [sizeof (get_random_response)];
+    TSS2_RC rc;
+
+    /* shorter than a response header */
+    will_return (tcti_receive, TSS2_RC_SUCCESS);
+    will_return (tcti_receive, 6);
+    will_return (tcti_receive, get_random_response);
+    rc = Tss2_Sys_ExecuteFinish (sys_ctx, TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_SYS_RC_INSUFFICIENT_RESPONSE);
+    rc = Tss2_Sys_ExecuteFinish (sys_ctx, TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
+
+    /* header claims more bytes than were received */
+    rc = Tss2_Sys_GetRandom_Prepare (sys_ctx, 4);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_ExecuteAsync (sys_ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    will_return (tcti_receive, TSS2_RC_SUCCESS);
+    will_return (tcti_receive, 12);
+    will_return (tcti_receive, get_random_response);
+    rc = Tss2_Sys_ExecuteFinish (sys_ctx, TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_SYS_RC_MALFORMED_RESPONSE);
+
+    /* canceled */
+    memcpy (response, get_random_response, sizeof (response));
+    response [5] = 0x0a;
+    response [8] = (TPM2_RC_CANCELED >> 8) & 0xff;
+    response [9] = TPM2_RC_CANCELED & 0xff;
+    rc = Tss2_Sys_GetRandom_Prepare (sys_ctx, 4);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_ExecuteAsync (sys_ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    will_return (tcti_receive, TSS2_RC_SUCCESS);
+    will_return (tcti_receive, 10);
+    will_return (tcti_receive, response);
+    rc = Tss2_Sys_ExecuteFinish (sys_ctx, TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_SYS_RC_INSUFFICIENT_RESPONSE);
+    rc = Tss2_Sys_GetRandom_Prepare (sys_ctx, 4);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown (execute_finish_try_again,
+                                         execute_finish_setup,
+                                         sapi_mock_teardown),
+        cmocka_unit_test_setup_teardown (execute_finish_insufficient_buffer,
+                                         execute_finish_setup,
+                                         sapi_mock_teardown),
+        cmocka_unit_test_setup_teardown (execute_finish_bad_responses,
+                                         execute_finish_setup,
+                                         sapi_mock_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,260 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "handle-table.h"
+
+#define TABLE_CAPACITY 4096
+#define READER_COUNT 4
+
+typedef struct {
+    TPM2_HANDLE handle;
+    TPM2B_AUTH auth;
+} TEST_VALUE;
+
+static void
+test_value (TEST_VALUE *value,
+            TPM2_HANDLE handle)
+{
+    memset (value, 0, sizeof (*value));
+    value->handle = handle;
+    value->auth.size = sizeof (handle);
+    memcpy (value->auth.buffer, &handle, sizeof (handle));
+}
+
+static int
+handle_table_setup (void **state)
+{
+    HANDLE_TABLE *table = calloc (1, sizeof (HANDLE_TABLE));
+
+    assert_int_equal (handle_table_init (table, TABLE_CAPACITY,
+                                         sizeof (TEST_VALUE)),
+                      TSS2_RC_SUCCESS);
+    *state = table;
+    return 0;
+}
+
+static int
+handle_table_teardown (void **state)
+{
+    handle_table_finalize (*state);
+    free (*state);
+    return 0;
+}
+
+static void
+handle_table_insert_lookup_remove (void **state)
+{
+    HANDLE_TABLE *table = *state;
+    TEST_VALUE value, found;
+    void *stored;
+
+    test_value (&value, 0x02000000);
+    assert_int_equal (handle_table_lookup (table, value.handle, &found),
+                      TSS2_SYS_RC_NOT_FOUND);
+    assert_null (handle_table_get (table, value.handle));
+
+    assert_int_equal (handle_table_insert (table, value.handle, &value,
+                                           &stored),
+                      TSS2_RC_SUCCESS);
+    assert_ptr_equal (handle_table_get (table, value.handle), stored);
+    assert_int_equal (handle_table_lookup (table, value.handle, &found),
+                      TSS2_RC_SUCCESS);
+    assert_memory_equal (&found, &value, sizeof (value));
+    assert_int_equal (handle_table_count (table), 1);
+
+    /* Inserting again replaces the value in place. */
+    value.auth.size = 0;
+    assert_int_equal (handle_table_insert (table, value.handle, &value, NULL),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (((TEST_VALUE *)stored)->auth.size, 0);
+    assert_int_equal (handle_table_count (table), 1);
+
+    assert_int_equal (handle_table_remove (table, value.handle),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (handle_table_remove (table, value.handle),
+                      TSS2_SYS_RC_NOT_FOUND);
+    assert_null (handle_table_get (table, value.handle));
+    assert_int_equal (handle_table_count (table), 0);
+}
+
+/*
+ * Fill the pool, remove every third entry, refill: values never move and
+ * the entries left behind stay reachable across the index shifts.
+ */
+static void
+handle_table_pool (void **state)
+{
+    HANDLE_TABLE *table = *state;
+    void **stored = calloc (TABLE_CAPACITY, sizeof (void *));
+    TEST_VALUE value, found;
+    UINT32 i;
+
+    for (i = 0; i < TABLE_CAPACITY; i++) {
+        test_value (&value, TPM2_HR_TRANSIENT + i);
+        assert_int_equal (handle_table_insert (table, value.handle, &value,
+                                               &stored[i]),
+                          TSS2_RC_SUCCESS);
+    }
+    test_value (&value, TPM2_HR_PERSISTENT);
+    assert_int_equal (handle_table_insert (table, value.handle, &value, NULL),
+                      TSS2_SYS_RC_INSUFFICIENT_CONTEXT);
+
+    for (i = 0; i < TABLE_CAPACITY; i += 3)
+        assert_int_equal (handle_table_remove (table, TPM2_HR_TRANSIENT + i),
+                          TSS2_RC_SUCCESS);
+    for (i = 0; i < TABLE_CAPACITY; i++) {
+        if (i % 3 == 0) {
+            assert_null (handle_table_get (table, TPM2_HR_TRANSIENT + i));
+            continue;
+        }
+        assert_ptr_equal (handle_table_get (table, TPM2_HR_TRANSIENT + i),
+                          stored[i]);
+        assert_int_equal (handle_table_lookup (table, TPM2_HR_TRANSIENT + i,
+                                               &found),
+                          TSS2_RC_SUCCESS);
+        assert_int_equal (found.handle, TPM2_HR_TRANSIENT + i);
+    }
+
+    for (i = 0; i < TABLE_CAPACITY; i += 3) {
+        test_value (&value, TPM2_HR_PERSISTENT + i);
+        assert_int_equal (handle_table_insert (table, value.handle, &value,
+                                               NULL),
+                          TSS2_RC_SUCCESS);
+    }
+    assert_int_equal (handle_table_count (table), TABLE_CAPACITY);
+    free (stored);
+}
+
+typedef struct {
+    HANDLE_TABLE *table;
+    int failures;
+} READER_STATE;
+
+/* Readers only look at the even handles, which the writer never touches. */
+static void *
+handle_table_reader (void *arg)
+{
+    READER_STATE *reader = arg;
+    TEST_VALUE found;
+    UINT32 round, i;
+
+    for (round = 0; round < 20; round++) {
+        for (i = 0; i < TABLE_CAPACITY / 2; i += 2) {
+            if (handle_table_lookup (reader->table, TPM2_HR_NV_INDEX + i,
+                                     &found) != TSS2_RC_SUCCESS ||
+                found.handle != TPM2_HR_NV_INDEX + i)
+                reader->failures++;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+handle_table_concurrent_readers (void **state)
+{
+    HANDLE_TABLE *table = *state;
+    READER_STATE readers[READER_COUNT];
+    pthread_t threads[READER_COUNT];
+    TEST_VALUE value;
+    UINT32 round, i;
+
+    for (i = 0; i < TABLE_CAPACITY / 2; i += 2) {
+        test_value (&value, TPM2_HR_NV_INDEX + i);
+        assert_int_equal (handle_table_insert (table, value.handle, &value,
+                                               NULL),
+                          TSS2_RC_SUCCESS);
+    }
+
+    for (i = 0; i < READER_COUNT; i++) {
+        readers[i].table = table;
+        readers[i].failures = 0;
+        assert_int_equal (pthread_create (&threads[i], NULL,
+                                          handle_table_reader, &readers[i]),
+                          0);
+    }
+
+    /* Churn the odd handles meanwhile, shifting clusters around. */
+    for (round = 0; round < 20; round++) {
+        for (i = 1; i < TABLE_CAPACITY / 2; i += 2) {
+            test_value (&value, TPM2_HR_NV_INDEX + i);
+            handle_table_insert (table, value.handle, &value, NULL);
+        }
+        for (i = 1; i < TABLE_CAPACITY / 2; i += 2)
+            handle_table_remove (table, TPM2_HR_NV_INDEX + i);
+    }
+
+    for (i = 0; i < READER_COUNT; i++) {
+        assert_int_equal (pthread_join (threads[i], NULL), 0);
+        assert_int_equal (readers[i].failures, 0);
+    }
+}
+
+static void
+handle_table_bad_args (void **state)
+{
+    HANDLE_TABLE table;
+    TEST_VALUE value;
+
+    assert_int_equal (handle_table_init (NULL, 1, sizeof (value)),
+                      TSS2_SYS_RC_BAD_REFERENCE);
+    assert_int_equal (handle_table_init (&table, 0, sizeof (value)),
+                      TSS2_SYS_RC_BAD_VALUE);
+    assert_int_equal (handle_table_lookup (*state, 1, NULL),
+                      TSS2_SYS_RC_BAD_REFERENCE);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const struct CMUnitTest tests [] = {
+        cmocka_unit_test_setup_teardown (handle_table_insert_lookup_remove,
+                                         handle_table_setup,
+                                         handle_table_teardown),
+        cmocka_unit_test_setup_teardown (handle_table_pool,
+                                         handle_table_setup,
+                                         handle_table_teardown),
+        cmocka_unit_test_setup_teardown (handle_table_concurrent_readers,
+                                         handle_table_setup,
+                                         handle_table_teardown),
+        cmocka_unit_test_setup_teardown (handle_table_bad_args,
+                                         handle_table_setup,
+                                         handle_table_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
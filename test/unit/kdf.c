@@ -0,0 +1,279 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "host-crypto.h"
+#include "host-sha.h"
+
+/*
+ * Expected values generated with an independent implementation of
+ * TPM 2.0 Part 1, 11.4.10.2 (KDFa) and 11.4.10.3 (KDFe). The key / Z is
+ * 0x00..0x1f, contextU / partyUInfo is 16 x 0xa5 and contextV /
+ * partyVInfo is 16 x 0x5a.
+ */
+static const uint8_t kdfa_sha256_256[] = {
+    0x27, 0x17, 0xcc, 0x08, 0x18, 0x04, 0xb5, 0xed,
+    0x94, 0xfd, 0xc5, 0x4a, 0x6d, 0xe3, 0xb7, 0xe4,
+    0x2f, 0xa7, 0x75, 0x1c, 0x71, 0xa7, 0x08, 0x0a,
+    0x66, 0x9d, 0x6c, 0x09, 0x12, 0x84, 0x09, 0xb3,
+};
+
+static const uint8_t kdfa_sha256_600[] = {
+    0x02, 0xd7, 0xea, 0xeb, 0x90, 0xc6, 0x66, 0x42,
+    0x9c, 0x38, 0x2e, 0xe4, 0xc7, 0x03, 0xba, 0x08,
+    0x65, 0xa9, 0x57, 0x54, 0x7f, 0x07, 0xc6, 0x5e,
+    0x29, 0xf2, 0xcf, 0x44, 0xb0, 0x83, 0xb4, 0xee,
+    0xe8, 0x96, 0xb0, 0xfb, 0x41, 0xe1, 0xbe, 0xc7,
+    0x2a, 0xec, 0x0d, 0xb9, 0x4e, 0x01, 0xe6, 0x20,
+    0xf6, 0x3e, 0x6a, 0x30, 0x9d, 0x6e, 0x84, 0xb6,
+    0x52, 0x77, 0xe0, 0x76, 0x87, 0x15, 0x70, 0xf7,
+    0x18, 0x28, 0x3d, 0xa6, 0x8c, 0xca, 0xd5, 0x32,
+    0x90, 0x00, 0xad,
+};
+
+static const uint8_t kdfa_sha1_13[] = {
+    0x08, 0xd7,
+};
+
+static const uint8_t kdfe_sha256_384[] = {
+    0x98, 0x89, 0xd1, 0xc6, 0x1d, 0xbc, 0xf8, 0xe0,
+    0x4e, 0x35, 0xe4, 0x78, 0x9e, 0xbd, 0xe4, 0x52,
+    0x02, 0x2e, 0x51, 0x54, 0x89, 0x18, 0x13, 0x97,
+    0xfd, 0x1f, 0x02, 0x39, 0x84, 0xdb, 0x0b, 0xc5,
+    0xd7, 0xfd, 0x00, 0xb1, 0x10, 0xc7, 0x03, 0xdb,
+    0xbf, 0x1a, 0x37, 0x06, 0x79, 0x0d, 0x18, 0x81,
+};
+
+typedef struct {
+    TPM2B_DIGEST key;
+    TPM2B_DIGEST context_u;
+    TPM2B_DIGEST context_v;
+} KDF_INPUT;
+
+static int
+kdf_setup (void **state)
+{
+    KDF_INPUT *input = calloc (1, sizeof (KDF_INPUT));
+    unsigned int i;
+
+    input->key.size = 32;
+    for (i = 0; i < 32; i++)
+        input->key.buffer[i] = i;
+    input->context_u.size = 16;
+    memset (input->context_u.buffer, 0xa5, 16);
+    input->context_v.size = 16;
+    memset (input->context_v.buffer, 0x5a, 16);
+
+    *state = input;
+    return 0;
+}
+
+static int
+kdf_teardown (void **state)
+{
+    free (*state);
+    return 0;
+}
+
+static void
+kdfa_sha256_single_block (void **state)
+{
+    KDF_INPUT *input = *state;
+    TPM2B_MAX_BUFFER result;
+    TSS2_RC rc;
+
+    rc = Tss2_Sys_KDFa (TPM2_ALG_SHA256, (TPM2B *)&input->key, "ATH",
+                        (TPM2B *)&input->context_u,
+                        (TPM2B *)&input->context_v, 256, &result);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (result.size, sizeof (kdfa_sha256_256));
+    assert_memory_equal (result.buffer, kdfa_sha256_256,
+                         sizeof (kdfa_sha256_256));
+}
+
+/*
+ * 600 bits takes three iterations with the last one clipped.
+ */
+static void
+kdfa_sha256_multi_block (void **state)
+{
+    KDF_INPUT *input = *state;
+    TPM2B_MAX_BUFFER result;
+    TSS2_RC rc;
+
+    rc = Tss2_Sys_KDFa (TPM2_ALG_SHA256, (TPM2B *)&input->key, "CFB",
+                        (TPM2B *)&input->context_u,
+                        (TPM2B *)&input->context_v, 600, &result);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (result.size, sizeof (kdfa_sha256_600));
+    assert_memory_equal (result.buffer, kdfa_sha256_600,
+                         sizeof (kdfa_sha256_600));
+}
+
+/*
+ * A bit count that is not a multiple of 8 masks the leading byte.
+ */
+static void
+kdfa_sha1_odd_bits (void **state)
+{
+    KDF_INPUT *input = *state;
+    TPM2B_MAX_BUFFER result;
+    TSS2_RC rc;
+
+    rc = Tss2_Sys_KDFa (TPM2_ALG_SHA1, (TPM2B *)&input->key, "XOR",
+                        (TPM2B *)&input->context_u, NULL, 13, &result);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (result.size, 2);
+    assert_memory_equal (result.buffer, kdfa_sha1_13, sizeof (kdfa_sha1_13));
+}
+
+static void
+kdfa_bad_args (void **state)
+{
+    KDF_INPUT *input = *state;
+    TPM2B_MAX_BUFFER result;
+
+    assert_int_equal (Tss2_Sys_KDFa (TPM2_ALG_SHA256, NULL, "ATH", NULL,
+                                     NULL, 256, &result),
+                      TSS2_SYS_RC_BAD_REFERENCE);
+    assert_int_equal (Tss2_Sys_KDFa (TPM2_ALG_AES, (TPM2B *)&input->key,
+                                     "ATH", NULL, NULL, 256, &result),
+                      TSS2_SYS_RC_BAD_VALUE);
+    assert_int_equal (Tss2_Sys_KDFa (TPM2_ALG_SHA256, (TPM2B *)&input->key,
+                                     "ATH", NULL, NULL, 65535, &result),
+                      TSS2_SYS_RC_BAD_SIZE);
+}
+
+static void
+kdfe_sha256 (void **state)
+{
+    KDF_INPUT *input = *state;
+    TPM2B_MAX_BUFFER result;
+    TSS2_RC rc;
+
+    rc = Tss2_Sys_KDFe (TPM2_ALG_SHA256, (TPM2B *)&input->key, "SECRET",
+                        (TPM2B *)&input->context_u,
+                        (TPM2B *)&input->context_v, 384, &result);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (result.size, sizeof (kdfe_sha256_384));
+    assert_memory_equal (result.buffer, kdfe_sha256_384,
+                         sizeof (kdfe_sha256_384));
+}
+
+/*
+ * Without a hashCopy callback every iteration is keyed from scratch; the
+ * result must not change.
+ */
+static void
+kdfa_backend_without_copy (void **state)
+{
+    KDF_INPUT *input = *state;
+    TSS2_SYS_CRYPTO_CALLBACKS callbacks = {
+        .hashStart = host_sha_start,
+        .hashUpdate = host_sha_update,
+        .hashFinish = host_sha_finish,
+    };
+    TPM2B_MAX_BUFFER result;
+    TSS2_RC rc;
+
+    assert_int_equal (Tss2_Sys_SetCryptoCallbacks (&callbacks),
+                      TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_KDFa (TPM2_ALG_SHA256, (TPM2B *)&input->key, "CFB",
+                        (TPM2B *)&input->context_u,
+                        (TPM2B *)&input->context_v, 600, &result);
+    Tss2_Sys_SetCryptoCallbacks (NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (result.buffer, kdfa_sha256_600,
+                         sizeof (kdfa_sha256_600));
+}
+
+/*
+ * The SHA extension code path must produce the same digests as the
+ * portable one for every split of the input across blocks.
+ */
+static void
+host_sha256_accel_matches_portable (void **state)
+{
+    TSS2_SYS_HASH_CONTEXT ctx;
+    uint8_t message[300];
+    uint8_t portable[TPM2_SHA256_DIGEST_SIZE];
+    uint8_t accel[TPM2_SHA256_DIGEST_SIZE];
+    size_t digest_size, size;
+    int previous;
+
+    if (!host_sha_accel_available ())
+        skip ();
+    for (size = 0; size < sizeof (message); size++)
+        message[size] = (uint8_t)(size * 7 + 3);
+
+    for (size = 0; size <= sizeof (message); size += 13) {
+        previous = host_sha_set_accel (0);
+        host_sha_start (&ctx, TPM2_ALG_SHA256, NULL);
+        host_sha_update (&ctx, message, size);
+        digest_size = sizeof (portable);
+        host_sha_finish (&ctx, portable, &digest_size);
+
+        host_sha_set_accel (1);
+        host_sha_start (&ctx, TPM2_ALG_SHA256, NULL);
+        host_sha_update (&ctx, message, size);
+        digest_size = sizeof (accel);
+        host_sha_finish (&ctx, accel, &digest_size);
+        host_sha_set_accel (previous);
+
+        assert_memory_equal (portable, accel, sizeof (portable));
+    }
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const struct CMUnitTest tests [] = {
+        cmocka_unit_test_setup_teardown (kdfa_sha256_single_block,
+                                         kdf_setup, kdf_teardown),
+        cmocka_unit_test_setup_teardown (kdfa_sha256_multi_block,
+                                         kdf_setup, kdf_teardown),
+        cmocka_unit_test_setup_teardown (kdfa_sha1_odd_bits,
+                                         kdf_setup, kdf_teardown),
+        cmocka_unit_test_setup_teardown (kdfa_bad_args,
+                                         kdf_setup, kdf_teardown),
+        cmocka_unit_test_setup_teardown (kdfe_sha256,
+                                         kdf_setup, kdf_teardown),
+        cmocka_unit_test_setup_teardown (kdfa_backend_without_copy,
+                                         kdf_setup, kdf_teardown),
+        cmocka_unit_test (host_sha256_accel_matches_portable),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
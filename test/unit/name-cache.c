@@ -0,0 +1,545 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "sapi-mock.h"
+
+#define NV_INDEX 0x01500000
+#define OBJECT_HANDLE 0x80000001
+#define PERSISTENT_HANDLE 0x81000001
+
+/* SHA256 of the marshaled keyedhash TPMT_PUBLIC built in test_public () */
+static const uint8_t public_digest[] = {
+    0x4f, 0x0e, 0xff, 0x4b, 0x7e, 0xe7, 0xc6, 0x11,
+    0xf1, 0x88, 0x83, 0x6a, 0xf4, 0x0c, 0x1a, 0x3b,
+    0x91, 0x1b, 0x00, 0xbc, 0x91, 0x41, 0x63, 0x36,
+    0x37, 0xd8, 0xba, 0x2c, 0x84, 0x01, 0x3a, 0x6b,
+};
+/* SHA256 of the marshaled TPMS_NV_PUBLIC built in test_nv_public () */
+static const uint8_t nv_public_digest[] = {
+    0x37, 0xb5, 0xb3, 0x1a, 0x2d, 0x36, 0xd2, 0xae,
+    0x6f, 0x7d, 0xec, 0x7e, 0xb0, 0x63, 0xff, 0x7d,
+    0x67, 0xfb, 0x9e, 0xeb, 0x71, 0x61, 0x7a, 0x82,
+    0x6b, 0xbe, 0x98, 0xc5, 0x3d, 0x9b, 0x5b, 0x98,
+};
+
+/* Canned response handed back by the TCTI for the next command. */
+static uint8_t response[128];
+
+typedef struct {
+    TSS2_SYS_NAME_CACHE *cache;
+    TSS2_SYS_CONTEXT *sys_ctx;
+} NAME_CACHE_STATE;
+
+static TSS2_SYS_NAME_CACHE *
+cache_new (UINT32 max_entries)
+{
+    TSS2_SYS_NAME_CACHE *cache;
+    size_t size;
+
+    size = Tss2_Sys_GetNameCacheSize (max_entries);
+    assert_int_not_equal (size, 0);
+    cache = malloc (size);
+    assert_non_null (cache);
+    assert_int_equal (Tss2_Sys_InitializeNameCache (cache, size, max_entries),
+                      TSS2_RC_SUCCESS);
+
+    return cache;
+}
+
+static int
+name_cache_setup (void **state)
+{
+    NAME_CACHE_STATE *data = calloc (1, sizeof (NAME_CACHE_STATE));
+    TSS2_RC rc;
+
+    data->cache = cache_new (0);
+    data->sys_ctx = sapi_mock_init (NULL);
+    rc = Tss2_Sys_SetNameCache (data->sys_ctx, data->cache);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    *state = data;
+    return 0;
+}
+
+static int
+name_cache_teardown (void **state)
+{
+    NAME_CACHE_STATE *data = *state;
+
+    free (data->sys_ctx);
+    free (data->cache);
+    free (data);
+    return 0;
+}
+
+static void
+test_name (TPM2B_NAME *name,
+           uint8_t fill)
+{
+    name->size = 34;
+    name->name[0] = 0x00;
+    name->name[1] = 0x0b;
+    memset (&name->name[2], fill, 32);
+}
+
+static void
+test_public (TPM2B_PUBLIC *public)
+{
+    memset (public, 0, sizeof (*public));
+    public->publicArea.type = TPM2_ALG_KEYEDHASH;
+    public->publicArea.nameAlg = TPM2_ALG_SHA256;
+    public->publicArea.parameters.keyedHashDetail.scheme.scheme = TPM2_ALG_NULL;
+}
+
+static void
+test_nv_public (TPM2B_NV_PUBLIC *nv_public)
+{
+    memset (nv_public, 0, sizeof (*nv_public));
+    nv_public->nvPublic.nvIndex = NV_INDEX;
+    nv_public->nvPublic.nameAlg = TPM2_ALG_SHA256;
+    nv_public->nvPublic.dataSize = 32;
+}
+
+static void
+assert_name_digest (const TPM2B_NAME *name,
+                    const uint8_t *digest)
+{
+    assert_int_equal (name->size, 34);
+    assert_int_equal (name->name[0], 0x00);
+    assert_int_equal (name->name[1], 0x0b);
+    assert_memory_equal (&name->name[2], digest, 32);
+}
+
+static void
+name_cache_add_lookup_remove (void **state)
+{
+    NAME_CACHE_STATE *data = *state;
+    TPM2B_NAME name, found;
+
+    test_name (&name, 0xaa);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, OBJECT_HANDLE,
+                                                &found),
+                      TSS2_SYS_RC_NOT_FOUND);
+    assert_int_equal (Tss2_Sys_NameCacheAdd (data->cache, OBJECT_HANDLE,
+                                             &name),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, OBJECT_HANDLE,
+                                                &found),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (found.size, name.size);
+    assert_memory_equal (found.name, name.name, name.size);
+
+    assert_int_equal (Tss2_Sys_NameCacheRemove (data->cache, OBJECT_HANDLE),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, OBJECT_HANDLE,
+                                                &found),
+                      TSS2_SYS_RC_NOT_FOUND);
+
+    /* Permanent handles are their own name and are never stored. */
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, TPM2_RH_OWNER,
+                                                &found),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (found.size, 4);
+    assert_int_equal (found.name[0], 0x40);
+    assert_int_equal (found.name[3], 0x01);
+    assert_int_equal (Tss2_Sys_NameCacheAdd (data->cache, TPM2_RH_OWNER,
+                                             &name),
+                      TSS2_SYS_RC_BAD_VALUE);
+}
+
+/* Remove every other entry of a dense table; the rest must stay reachable. */
+static void
+name_cache_delete_keeps_clusters (void **state)
+{
+    TSS2_SYS_NAME_CACHE *cache = cache_new (64);
+    TPM2B_NAME name, found;
+    TSS2_RC rc;
+    UINT32 i;
+
+    for (i = 0; i < 64; i++) {
+        test_name (&name, i);
+        rc = Tss2_Sys_NameCacheAdd (cache, TPM2_HR_TRANSIENT + i, &name);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    for (i = 0; i < 64; i += 2)
+        Tss2_Sys_NameCacheRemove (cache, TPM2_HR_TRANSIENT + i);
+    for (i = 0; i < 64; i++) {
+        rc = Tss2_Sys_NameCacheLookup (cache, TPM2_HR_TRANSIENT + i, &found);
+        if (i % 2) {
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            assert_int_equal (found.name[2], i);
+        } else {
+            assert_int_equal (rc, TSS2_SYS_RC_NOT_FOUND);
+        }
+    }
+    free (cache);
+}
+
+static void
+name_cache_full_evicts (void **state)
+{
+    TSS2_SYS_NAME_CACHE *cache = cache_new (4);
+    TPM2B_NAME name, found;
+    unsigned int hits = 0;
+    UINT32 i;
+
+    for (i = 0; i < 16; i++) {
+        test_name (&name, i);
+        assert_int_equal (Tss2_Sys_NameCacheAdd (cache, NV_INDEX + i, &name),
+                          TSS2_RC_SUCCESS);
+        /* The entry just added is always present. */
+        assert_int_equal (Tss2_Sys_NameCacheLookup (cache, NV_INDEX + i,
+                                                    &found),
+                          TSS2_RC_SUCCESS);
+    }
+    for (i = 0; i < 16; i++) {
+        if (Tss2_Sys_NameCacheLookup (cache, NV_INDEX + i, &found) ==
+            TSS2_RC_SUCCESS)
+            hits++;
+    }
+    assert_int_equal (hits, 4);
+    free (cache);
+}
+
+static void
+name_cache_public_names (void **state)
+{
+    NAME_CACHE_STATE *data = *state;
+    TPM2B_NV_PUBLIC nv_public;
+    TPM2B_PUBLIC public;
+    TPM2B_NAME name;
+
+    test_public (&public);
+    assert_int_equal (Tss2_Sys_GetPublicName (&public, &name),
+                      TSS2_RC_SUCCESS);
+    assert_name_digest (&name, public_digest);
+
+    test_nv_public (&nv_public);
+    assert_int_equal (Tss2_Sys_GetNvPublicName (&nv_public, &name),
+                      TSS2_RC_SUCCESS);
+    assert_name_digest (&name, nv_public_digest);
+
+    assert_int_equal (Tss2_Sys_NameCacheAddPublic (data->cache, OBJECT_HANDLE,
+                                                   &public),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, OBJECT_HANDLE,
+                                                &name),
+                      TSS2_RC_SUCCESS);
+    assert_name_digest (&name, public_digest);
+
+    assert_int_equal (Tss2_Sys_NameCacheAddNvPublic (data->cache, &nv_public),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, NV_INDEX, &name),
+                      TSS2_RC_SUCCESS);
+    assert_name_digest (&name, nv_public_digest);
+}
+
+/* Response header with no sessions, followed by an optional handle. */
+static size_t
+response_header (TPM2_HANDLE handle)
+{
+    size_t offset = 0;
+
+    Tss2_MU_TPM2_ST_Marshal (TPM2_ST_NO_SESSIONS, response,
+                             sizeof (response), &offset);
+    Tss2_MU_UINT32_Marshal (0, response, sizeof (response), &offset);
+    Tss2_MU_UINT32_Marshal (TPM2_RC_SUCCESS, response, sizeof (response),
+                            &offset);
+    if (handle != 0)
+        Tss2_MU_UINT32_Marshal (handle, response, sizeof (response), &offset);
+
+    return offset;
+}
+
+static void
+response_finish (size_t size)
+{
+    size_t offset = 2;
+
+    Tss2_MU_UINT32_Marshal (size, response, sizeof (response), &offset);
+    sapi_mock_respond (response, size);
+}
+
+static void
+name_cache_tracks_nv_commands (void **state)
+{
+    NAME_CACHE_STATE *data = *state;
+    TPM2B_MAX_NV_BUFFER nv_data = { .size = 4 };
+    TPM2B_NV_PUBLIC nv_public;
+    TPM2B_AUTH auth = { .size = 0 };
+    TPM2B_NAME name;
+
+    /* DefineSpace: the name is computed from publicInfo. */
+    test_nv_public (&nv_public);
+    assert_int_equal (Tss2_Sys_NV_DefineSpace_Prepare (data->sys_ctx,
+                                                       TPM2_RH_OWNER, &auth,
+                                                       &nv_public),
+                      TSS2_RC_SUCCESS);
+    response_finish (response_header (0));
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, NV_INDEX, &name),
+                      TSS2_RC_SUCCESS);
+    assert_name_digest (&name, nv_public_digest);
+
+    /* The first write sets TPMA_NV_WRITTEN: the cached name goes stale. */
+    assert_int_equal (Tss2_Sys_NV_Write_Prepare (data->sys_ctx, NV_INDEX,
+                                                 NV_INDEX, &nv_data, 0),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, NV_INDEX, &name),
+                      TSS2_SYS_RC_NOT_FOUND);
+
+    /* Once known to be written, further writes keep the entry. */
+    nv_public.nvPublic.attributes.TPMA_NV_WRITTEN = 1;
+    assert_int_equal (Tss2_Sys_NameCacheAddNvPublic (data->cache, &nv_public),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NV_Write_Prepare (data->sys_ctx, NV_INDEX,
+                                                 NV_INDEX, &nv_data, 0),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, NV_INDEX, &name),
+                      TSS2_RC_SUCCESS);
+
+    assert_int_equal (Tss2_Sys_NV_UndefineSpace_Prepare (data->sys_ctx,
+                                                         TPM2_RH_OWNER,
+                                                         NV_INDEX),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, NV_INDEX, &name),
+                      TSS2_SYS_RC_NOT_FOUND);
+}
+
+static void
+name_cache_tracks_objects (void **state)
+{
+    NAME_CACHE_STATE *data = *state;
+    TPM2B_PUBLIC public;
+    TPM2B_NAME name, loaded_name;
+    size_t offset;
+
+    /* Load: the TPM returns the handle and the name. */
+    test_public (&public);
+    test_name (&loaded_name, 0x5a);
+    assert_int_equal (Tss2_Sys_Load_Prepare (data->sys_ctx, PERSISTENT_HANDLE,
+                                             NULL, &public),
+                      TSS2_RC_SUCCESS);
+    offset = response_header (OBJECT_HANDLE);
+    Tss2_MU_TPM2B_NAME_Marshal (&loaded_name, response, sizeof (response),
+                                &offset);
+    response_finish (offset);
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, OBJECT_HANDLE,
+                                                &name),
+                      TSS2_RC_SUCCESS);
+    assert_memory_equal (name.name, loaded_name.name, loaded_name.size);
+
+    /* Persisting the object gives the persistent handle the same name. */
+    assert_int_equal (Tss2_Sys_EvictControl_Prepare (data->sys_ctx,
+                                                     TPM2_RH_OWNER,
+                                                     OBJECT_HANDLE,
+                                                     PERSISTENT_HANDLE),
+                      TSS2_RC_SUCCESS);
+    response_finish (response_header (0));
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache,
+                                                PERSISTENT_HANDLE, &name),
+                      TSS2_RC_SUCCESS);
+    assert_memory_equal (name.name, loaded_name.name, loaded_name.size);
+
+    assert_int_equal (Tss2_Sys_FlushContext_Prepare (data->sys_ctx,
+                                                     OBJECT_HANDLE),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, OBJECT_HANDLE,
+                                                &name),
+                      TSS2_SYS_RC_NOT_FOUND);
+
+    /* Evicting the persistent object. */
+    assert_int_equal (Tss2_Sys_EvictControl_Prepare (data->sys_ctx,
+                                                     TPM2_RH_OWNER,
+                                                     PERSISTENT_HANDLE,
+                                                     PERSISTENT_HANDLE),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache,
+                                                PERSISTENT_HANDLE, &name),
+                      TSS2_SYS_RC_NOT_FOUND);
+}
+
+/* NV_ReadPublic caches the returned name along with TPMA_NV_WRITTEN. */
+static void
+name_cache_nv_read_public_written (void **state)
+{
+    NAME_CACHE_STATE *data = *state;
+    TPM2B_MAX_NV_BUFFER nv_data = { .size = 4 };
+    TPM2B_NV_PUBLIC nv_public;
+    TPM2B_NAME name, nv_name;
+    size_t offset;
+
+    test_nv_public (&nv_public);
+    nv_public.nvPublic.attributes.TPMA_NV_WRITTEN = 1;
+    test_name (&nv_name, 0x33);
+    assert_int_equal (Tss2_Sys_NV_ReadPublic_Prepare (data->sys_ctx,
+                                                      NV_INDEX),
+                      TSS2_RC_SUCCESS);
+    offset = response_header (0);
+    Tss2_MU_TPM2B_NV_PUBLIC_Marshal (&nv_public, response, sizeof (response),
+                                     &offset);
+    Tss2_MU_TPM2B_NAME_Marshal (&nv_name, response, sizeof (response),
+                                &offset);
+    response_finish (offset);
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, NV_INDEX, &name),
+                      TSS2_RC_SUCCESS);
+    assert_memory_equal (name.name, nv_name.name, nv_name.size);
+
+    /* Already written: a write does not change the name. */
+    assert_int_equal (Tss2_Sys_NV_Write_Prepare (data->sys_ctx, NV_INDEX,
+                                                 NV_INDEX, &nv_data, 0),
+                      TSS2_RC_SUCCESS);
+    response_finish (response_header (0));
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, NV_INDEX, &name),
+                      TSS2_RC_SUCCESS);
+}
+
+/*
+ * NV_WriteLock and NV_ReadLock change the attributes, and so the name, of
+ * their index; NV_GlobalWriteLock those of any number of indices.
+ */
+static void
+name_cache_nv_locks (void **state)
+{
+    NAME_CACHE_STATE *data = *state;
+    TPM2B_NAME name;
+
+    test_name (&name, 0x44);
+    Tss2_Sys_NameCacheAdd (data->cache, NV_INDEX, &name);
+    Tss2_Sys_NameCacheAdd (data->cache, NV_INDEX + 1, &name);
+    Tss2_Sys_NameCacheAdd (data->cache, NV_INDEX + 2, &name);
+    Tss2_Sys_NameCacheAdd (data->cache, OBJECT_HANDLE, &name);
+    response_finish (response_header (0));
+
+    assert_int_equal (Tss2_Sys_NV_WriteLock_Prepare (data->sys_ctx,
+                                                     TPM2_RH_OWNER, NV_INDEX),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, NV_INDEX, &name),
+                      TSS2_SYS_RC_NOT_FOUND);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, NV_INDEX + 1,
+                                                &name),
+                      TSS2_RC_SUCCESS);
+
+    assert_int_equal (Tss2_Sys_NV_ReadLock_Prepare (data->sys_ctx,
+                                                    NV_INDEX + 1,
+                                                    NV_INDEX + 1),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, NV_INDEX + 1,
+                                                &name),
+                      TSS2_SYS_RC_NOT_FOUND);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, NV_INDEX + 2,
+                                                &name),
+                      TSS2_RC_SUCCESS);
+
+    Tss2_Sys_NameCacheAdd (data->cache, NV_INDEX, &name);
+    assert_int_equal (Tss2_Sys_NV_GlobalWriteLock_Prepare (data->sys_ctx,
+                                                           TPM2_RH_OWNER),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, NV_INDEX, &name),
+                      TSS2_SYS_RC_NOT_FOUND);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, NV_INDEX + 2,
+                                                &name),
+                      TSS2_SYS_RC_NOT_FOUND);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, OBJECT_HANDLE,
+                                                &name),
+                      TSS2_RC_SUCCESS);
+}
+
+/* Failed commands leave the cache alone. */
+static void
+name_cache_ignores_errors (void **state)
+{
+    NAME_CACHE_STATE *data = *state;
+    TPM2B_NAME name;
+    size_t offset = 6;
+
+    test_name (&name, 0x11);
+    Tss2_Sys_NameCacheAdd (data->cache, OBJECT_HANDLE, &name);
+    assert_int_equal (Tss2_Sys_FlushContext_Prepare (data->sys_ctx,
+                                                     OBJECT_HANDLE),
+                      TSS2_RC_SUCCESS);
+    response_finish (response_header (0));
+    Tss2_MU_UINT32_Marshal (TPM2_RC_HANDLE, response, sizeof (response),
+                            &offset);
+    assert_int_equal (Tss2_Sys_Execute (data->sys_ctx), TPM2_RC_HANDLE);
+    assert_int_equal (Tss2_Sys_NameCacheLookup (data->cache, OBJECT_HANDLE,
+                                                &name),
+                      TSS2_RC_SUCCESS);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const struct CMUnitTest tests [] = {
+        cmocka_unit_test_setup_teardown (name_cache_add_lookup_remove,
+                                         name_cache_setup,
+                                         name_cache_teardown),
+        cmocka_unit_test (name_cache_delete_keeps_clusters),
+        cmocka_unit_test (name_cache_full_evicts),
+        cmocka_unit_test_setup_teardown (name_cache_public_names,
+                                         name_cache_setup,
+                                         name_cache_teardown),
+        cmocka_unit_test_setup_teardown (name_cache_tracks_nv_commands,
+                                         name_cache_setup,
+                                         name_cache_teardown),
+        cmocka_unit_test_setup_teardown (name_cache_tracks_objects,
+                                         name_cache_setup,
+                                         name_cache_teardown),
+        cmocka_unit_test_setup_teardown (name_cache_nv_read_public_written,
+                                         name_cache_setup,
+                                         name_cache_teardown),
+        cmocka_unit_test_setup_teardown (name_cache_nv_locks,
+                                         name_cache_setup,
+                                         name_cache_teardown),
+        cmocka_unit_test_setup_teardown (name_cache_ignores_errors,
+                                         name_cache_setup,
+                                         name_cache_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
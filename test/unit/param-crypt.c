@@ -0,0 +1,314 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "sapi-mock.h"
+#include "sysapi_util.h"
+#include "host-aes.h"
+
+#define PARAM_DATA "parameter encryption test vector, more than two AES blocks!"
+
+/*
+ * Session: SHA256, sessionKey 32 x 0x11, authValue "password",
+ * nonceNewer 16 x 0x33, nonceOlder 16 x 0x44. Expected values generated
+ * with an independent KDFa and OpenSSL's AES-128-CFB.
+ */
+static const uint8_t xor_expected[] = {
+    0x7b, 0xa4, 0x0a, 0x33, 0x2e, 0x56, 0x1a, 0x3b,
+    0xfe, 0x4d, 0xb7, 0x77, 0x70, 0x9d, 0x6d, 0x59,
+    0x1d, 0x4f, 0x30, 0xfc, 0xf3, 0x9d, 0x82, 0x19,
+    0x29, 0xd0, 0x53, 0xcc, 0x59, 0xdc, 0x71, 0xb3,
+    0xcc, 0xff, 0x12, 0x99, 0x00, 0xc6, 0x8e, 0x0e,
+    0x73, 0xa4, 0x81, 0xe2, 0xb0, 0xc6, 0x71, 0x3a,
+    0xb6, 0x3b, 0xcd, 0x95, 0x54, 0xa3, 0x05, 0x54,
+    0x0c, 0x3e, 0x26,
+};
+
+static const uint8_t cfb_expected[] = {
+    0xaa, 0x10, 0x3a, 0x6a, 0xd8, 0x3e, 0x98, 0x37,
+    0xeb, 0xb5, 0x32, 0xbc, 0xc9, 0xca, 0x80, 0x74,
+    0x01, 0x7d, 0x31, 0x98, 0xfe, 0xb9, 0x2b, 0xad,
+    0x2b, 0xc0, 0xc6, 0xb4, 0x6c, 0xb6, 0x15, 0xf4,
+    0x4a, 0x58, 0xdd, 0xd0, 0xe9, 0xbf, 0xfc, 0x61,
+    0xf6, 0x17, 0x4d, 0x8a, 0x86, 0x62, 0x12, 0x81,
+    0xe7, 0x67, 0xf9, 0x74, 0xb3, 0xb0, 0x2f, 0x2a,
+    0xd5, 0x1a, 0x37,
+};
+
+/* FIPS 197, appendix C */
+static const uint8_t fips197_plain[] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+    0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+};
+static const uint8_t fips197_aes128[] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+    0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a,
+};
+static const uint8_t fips197_aes192[] = {
+    0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0,
+    0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91,
+};
+static const uint8_t fips197_aes256[] = {
+    0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf,
+    0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89,
+};
+
+typedef struct {
+    TPM2B_DIGEST session_key;
+    TPM2B_AUTH auth_value;
+    TPM2B_NONCE nonce_newer;
+    TPM2B_NONCE nonce_older;
+    uint8_t data[sizeof (PARAM_DATA) - 1];
+} PARAM_CRYPT_STATE;
+
+static int
+param_crypt_setup (void **state)
+{
+    PARAM_CRYPT_STATE *param = calloc (1, sizeof (PARAM_CRYPT_STATE));
+
+    param->session_key.size = 32;
+    memset (param->session_key.buffer, 0x11, 32);
+    param->auth_value.size = 8;
+    memcpy (param->auth_value.buffer, "password", 8);
+    param->nonce_newer.size = 16;
+    memset (param->nonce_newer.buffer, 0x33, 16);
+    param->nonce_older.size = 16;
+    memset (param->nonce_older.buffer, 0x44, 16);
+    memcpy (param->data, PARAM_DATA, sizeof (param->data));
+
+    *state = param;
+    return 0;
+}
+
+static int
+param_crypt_teardown (void **state)
+{
+    free (*state);
+    return 0;
+}
+
+static void
+host_aes_fips197 (void **state)
+{
+    HOST_AES_CONTEXT ctx;
+    uint8_t key[32];
+    uint8_t out[16];
+    unsigned int i;
+
+    for (i = 0; i < sizeof (key); i++)
+        key[i] = i;
+
+    assert_int_equal (host_aes_init (&ctx, key, 128), TSS2_RC_SUCCESS);
+    host_aes_encrypt_block (&ctx, fips197_plain, out);
+    assert_memory_equal (out, fips197_aes128, sizeof (out));
+
+    assert_int_equal (host_aes_init (&ctx, key, 192), TSS2_RC_SUCCESS);
+    host_aes_encrypt_block (&ctx, fips197_plain, out);
+    assert_memory_equal (out, fips197_aes192, sizeof (out));
+
+    assert_int_equal (host_aes_init (&ctx, key, 256), TSS2_RC_SUCCESS);
+    host_aes_encrypt_block (&ctx, fips197_plain, out);
+    assert_memory_equal (out, fips197_aes256, sizeof (out));
+
+    assert_int_equal (host_aes_init (&ctx, key, 64), TSS2_SYS_RC_BAD_VALUE);
+}
+
+static void
+param_crypt_aes (void **state, int accel)
+{
+    PARAM_CRYPT_STATE *param = *state;
+    TPMT_SYM_DEF symmetric = {
+        .algorithm = TPM2_ALG_AES,
+        .keyBits.aes = 128,
+        .mode.aes = TPM2_ALG_CFB,
+    };
+    int previous;
+    TSS2_RC rc;
+
+    previous = host_aes_set_accel (accel);
+    rc = Tss2_Sys_ParamCrypt (&symmetric, TPM2_ALG_SHA256,
+                              &param->session_key, &param->auth_value,
+                              &param->nonce_newer, &param->nonce_older, NO,
+                              param->data, sizeof (param->data));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (param->data, cfb_expected, sizeof (cfb_expected));
+
+    rc = Tss2_Sys_ParamCrypt (&symmetric, TPM2_ALG_SHA256,
+                              &param->session_key, &param->auth_value,
+                              &param->nonce_newer, &param->nonce_older, YES,
+                              param->data, sizeof (param->data));
+    host_aes_set_accel (previous);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (param->data, PARAM_DATA, sizeof (param->data));
+}
+
+static void
+param_crypt_aes_portable (void **state)
+{
+    param_crypt_aes (state, 0);
+}
+
+static void
+param_crypt_aes_accel (void **state)
+{
+    if (!host_aes_accel_available ())
+        skip ();
+    param_crypt_aes (state, 1);
+}
+
+static void
+param_crypt_xor (void **state)
+{
+    PARAM_CRYPT_STATE *param = *state;
+    TPMT_SYM_DEF symmetric = {
+        .algorithm = TPM2_ALG_XOR,
+        .keyBits.exclusiveOr = TPM2_ALG_SHA256,
+    };
+    TSS2_RC rc;
+
+    rc = Tss2_Sys_ParamCrypt (&symmetric, TPM2_ALG_SHA256,
+                              &param->session_key, &param->auth_value,
+                              &param->nonce_newer, &param->nonce_older, NO,
+                              param->data, sizeof (param->data));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (param->data, xor_expected, sizeof (xor_expected));
+
+    rc = Tss2_Sys_ParamCrypt (&symmetric, TPM2_ALG_SHA256,
+                              &param->session_key, &param->auth_value,
+                              &param->nonce_newer, &param->nonce_older, YES,
+                              param->data, sizeof (param->data));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (param->data, PARAM_DATA, sizeof (param->data));
+}
+
+static void
+param_crypt_bad_mode (void **state)
+{
+    PARAM_CRYPT_STATE *param = *state;
+    TPMT_SYM_DEF symmetric = {
+        .algorithm = TPM2_ALG_AES,
+        .keyBits.aes = 128,
+        .mode.aes = TPM2_ALG_CBC,
+    };
+
+    assert_int_equal (Tss2_Sys_ParamCrypt (&symmetric, TPM2_ALG_SHA256,
+                                           &param->session_key, NULL,
+                                           &param->nonce_newer,
+                                           &param->nonce_older, NO,
+                                           param->data, sizeof (param->data)),
+                      TSS2_SYS_RC_BAD_VALUE);
+    symmetric.algorithm = TPM2_ALG_NULL;
+    assert_int_equal (Tss2_Sys_ParamCrypt (&symmetric, TPM2_ALG_SHA256,
+                                           &param->session_key, NULL,
+                                           &param->nonce_newer,
+                                           &param->nonce_older, NO,
+                                           param->data, sizeof (param->data)),
+                      TSS2_SYS_RC_BAD_VALUE);
+}
+
+/*
+ * The first parameter of NV_Write is encrypted where it sits in the
+ * command buffer, without going through Get/SetDecryptParam copies.
+ */
+static void
+param_crypt_command_in_place (void **state)
+{
+    PARAM_CRYPT_STATE *param = *state;
+    TPMT_SYM_DEF symmetric = {
+        .algorithm = TPM2_ALG_AES,
+        .keyBits.aes = 128,
+        .mode.aes = TPM2_ALG_CFB,
+    };
+    TPM2B_MAX_NV_BUFFER data;
+    TSS2_SYS_CONTEXT *sys_ctx;
+    const uint8_t *buffer;
+    size_t size;
+    TSS2_RC rc;
+
+    sys_ctx = sapi_mock_init (NULL);
+
+    data.size = sizeof (param->data);
+    memcpy (data.buffer, param->data, sizeof (param->data));
+    rc = Tss2_Sys_NV_Write_Prepare (sys_ctx, TPM2_RH_OWNER, 0x01500000,
+                                    &data, 0);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    rc = Tss2_Sys_EncryptCommandParam (sys_ctx, &symmetric, TPM2_ALG_SHA256,
+                                       &param->session_key,
+                                       &param->auth_value,
+                                       &param->nonce_newer,
+                                       &param->nonce_older);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    rc = Tss2_Sys_GetDecryptParam (sys_ctx, &size, &buffer);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, sizeof (cfb_expected));
+    assert_memory_equal (buffer, cfb_expected, sizeof (cfb_expected));
+
+    /* No response yet, so nothing to decrypt. */
+    rc = Tss2_Sys_DecryptResponseParam (sys_ctx, &symmetric, TPM2_ALG_SHA256,
+                                        &param->session_key,
+                                        &param->auth_value,
+                                        &param->nonce_older,
+                                        &param->nonce_newer);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
+
+    free (sys_ctx);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const struct CMUnitTest tests [] = {
+        cmocka_unit_test (host_aes_fips197),
+        cmocka_unit_test_setup_teardown (param_crypt_aes_portable,
+                                         param_crypt_setup,
+                                         param_crypt_teardown),
+        cmocka_unit_test_setup_teardown (param_crypt_aes_accel,
+                                         param_crypt_setup,
+                                         param_crypt_teardown),
+        cmocka_unit_test_setup_teardown (param_crypt_xor,
+                                         param_crypt_setup,
+                                         param_crypt_teardown),
+        cmocka_unit_test_setup_teardown (param_crypt_bad_mode,
+                                         param_crypt_setup,
+                                         param_crypt_teardown),
+        cmocka_unit_test_setup_teardown (param_crypt_command_in_place,
+                                         param_crypt_setup,
+                                         param_crypt_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,183 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "sapi-mock.h"
+
+#define NV_DATA_SIZE 2000
+
+/* SHA256 / SHA1 of CC_NV_Write || name1 || name2 || cpBuffer */
+static const uint8_t cp_hash_sha256[] = {
+    0xd0, 0xa5, 0x60, 0x4e, 0x1d, 0x43, 0xf2, 0x5f,
+    0x1f, 0xdb, 0x08, 0x72, 0xd0, 0xa8, 0x1d, 0xec,
+    0x5a, 0x0e, 0x34, 0x2b, 0xd4, 0xed, 0xd8, 0x94,
+    0xdf, 0xa3, 0x94, 0xff, 0xb7, 0x50, 0x23, 0xaf,
+};
+static const uint8_t cp_hash_sha1[] = {
+    0x66, 0xb3, 0xad, 0x14, 0x11, 0x6e, 0x03, 0xe0,
+    0xe9, 0x05, 0x44, 0x4e, 0xbb, 0x79, 0x20, 0x30,
+    0x59, 0x78, 0x36, 0x98,
+};
+/* SHA256 of TPM2_RC_SUCCESS || CC_GetRandom || rpBuffer */
+static const uint8_t rp_hash_sha256[] = {
+    0x6a, 0xc9, 0xe9, 0x06, 0x41, 0x12, 0xc1, 0x75,
+    0x85, 0x8f, 0x38, 0x1e, 0x78, 0x20, 0x6e, 0x5a,
+    0x30, 0xbe, 0xd9, 0xc5, 0x66, 0xf5, 0xf1, 0x50,
+    0x26, 0x6e, 0xab, 0x94, 0xa1, 0x69, 0x92, 0x41,
+};
+/* TPM2_GetRandom response carrying the 4 bytes "abcd" */
+static const uint8_t get_random_response[] = {
+    0x80, 0x01, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x04, 'a', 'b', 'c', 'd',
+};
+
+static int
+phash_setup (void **state)
+{
+    sapi_mock_respond (get_random_response, sizeof (get_random_response));
+    return sapi_mock_setup (state);
+}
+
+static void
+phash_prepare_nv_write (TSS2_SYS_CONTEXT *sys_ctx)
+{
+    TPM2B_MAX_NV_BUFFER data;
+    unsigned int i;
+    TSS2_RC rc;
+
+    data.size = NV_DATA_SIZE;
+    for (i = 0; i < NV_DATA_SIZE; i++)
+        data.buffer[i] = i & 0xff;
+    rc = Tss2_Sys_NV_Write_Prepare (sys_ctx, TPM2_RH_OWNER, 0x01500000,
+                                    &data, 7);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
+
+/*
+ * The parameter area is larger than a TPM2B_MAX_BUFFER, which the old
+ * copy-then-hash helper could not handle.
+ */
+static void
+phash_cp_hash_large (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TPM2B_NAME name1 = { .size = 4, .name = { 0x40, 0x00, 0x00, 0x01 } };
+    TPM2B_NAME name2 = { .size = 34, .name = { 0x00, 0x0b } };
+    TPM2B_DIGEST cp_hash;
+    TSS2_RC rc;
+
+    memset (&name2.name[2], 0x55, 32);
+    phash_prepare_nv_write (sys_ctx);
+
+    rc = Tss2_Sys_GetCpHash (sys_ctx, TPM2_ALG_SHA256, &name1, &name2, NULL,
+                             &cp_hash);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (cp_hash.size, sizeof (cp_hash_sha256));
+    assert_memory_equal (cp_hash.buffer, cp_hash_sha256,
+                         sizeof (cp_hash_sha256));
+
+    rc = Tss2_Sys_GetCpHash (sys_ctx, TPM2_ALG_SHA1, &name1, &name2, NULL,
+                             &cp_hash);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (cp_hash.size, sizeof (cp_hash_sha1));
+    assert_memory_equal (cp_hash.buffer, cp_hash_sha1, sizeof (cp_hash_sha1));
+}
+
+static void
+phash_cp_hash_bad_args (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TPM2B_NAME name = { .size = sizeof (TPMU_NAME) + 1 };
+    TPM2B_DIGEST cp_hash;
+
+    assert_int_equal (Tss2_Sys_GetCpHash (sys_ctx, TPM2_ALG_SHA256, NULL,
+                                          NULL, NULL, &cp_hash),
+                      TSS2_SYS_RC_BAD_SEQUENCE);
+    phash_prepare_nv_write (sys_ctx);
+    assert_int_equal (Tss2_Sys_GetCpHash (NULL, TPM2_ALG_SHA256, NULL,
+                                          NULL, NULL, &cp_hash),
+                      TSS2_SYS_RC_BAD_REFERENCE);
+    assert_int_equal (Tss2_Sys_GetCpHash (sys_ctx, TPM2_ALG_SHA256, NULL,
+                                          NULL, NULL, NULL),
+                      TSS2_SYS_RC_BAD_REFERENCE);
+    assert_int_equal (Tss2_Sys_GetCpHash (sys_ctx, TPM2_ALG_SHA256, &name,
+                                          NULL, NULL, &cp_hash),
+                      TSS2_SYS_RC_BAD_SIZE);
+    assert_int_not_equal (Tss2_Sys_GetCpHash (sys_ctx, TPM2_ALG_NULL, NULL,
+                                              NULL, NULL, &cp_hash),
+                          TSS2_RC_SUCCESS);
+}
+
+static void
+phash_rp_hash (void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = *state;
+    TPM2B_DIGEST random_bytes, rp_hash;
+    TSS2_RC rc;
+
+    rc = Tss2_Sys_GetRandom_Prepare (sys_ctx, 4);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_GetRpHash (sys_ctx, TPM2_ALG_SHA256, &rp_hash),
+                      TSS2_SYS_RC_BAD_SEQUENCE);
+
+    rc = Tss2_Sys_Execute (sys_ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_GetRandom_Complete (sys_ctx, &random_bytes);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    rc = Tss2_Sys_GetRpHash (sys_ctx, TPM2_ALG_SHA256, &rp_hash);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (rp_hash.size, sizeof (rp_hash_sha256));
+    assert_memory_equal (rp_hash.buffer, rp_hash_sha256,
+                         sizeof (rp_hash_sha256));
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const struct CMUnitTest tests [] = {
+        cmocka_unit_test_setup_teardown (phash_cp_hash_large,
+                                         phash_setup,
+                                         sapi_mock_teardown),
+        cmocka_unit_test_setup_teardown (phash_cp_hash_bad_args,
+                                         phash_setup,
+                                         sapi_mock_teardown),
+        cmocka_unit_test_setup_teardown (phash_rp_hash,
+                                         phash_setup,
+                                         sapi_mock_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
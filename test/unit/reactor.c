@@ -0,0 +1,445 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "sapi/tss2_reactor.h"
+#include "sapi-mock.h"
+
+#define MOCK_CONTEXTS 256
+
+/*
+ * A TCTI whose "TPM" is a pipe: the test writes a byte to make a response
+ * available. 'p' delivers only part of it (receive returns TRY_AGAIN), 'c'
+ * does the same but also replaces the pipe, which drops the old one from
+ * the reactor's epoll set. Any other byte completes the response.
+ */
+typedef struct {
+    TSS2_TCTI_CONTEXT_COMMON_V1 common;
+    int fds [2];
+} MOCK_TCTI;
+
+typedef struct {
+    MOCK_TCTI tcti;
+    TSS2_SYS_CONTEXT *sys;
+    TSS2_REACTOR_ENTRY *entry;
+    unsigned int completions;
+    TSS2_RC rc;
+} MOCK_CONTEXT;
+
+typedef struct {
+    TSS2_REACTOR *reactor;
+    MOCK_CONTEXT contexts [MOCK_CONTEXTS];
+} REACTOR_STATE;
+
+static const uint8_t startup_response [] = {
+    0x80, 0x01, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x00,
+};
+
+static unsigned int transmitted;
+
+static TSS2_RC
+mock_transmit (TSS2_TCTI_CONTEXT *tctiContext,
+               size_t size,
+               uint8_t *command)
+{
+    transmitted++;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+mock_receive (TSS2_TCTI_CONTEXT *tctiContext,
+              size_t *size,
+              uint8_t *response,
+              int32_t timeout)
+{
+    MOCK_TCTI *tcti = (MOCK_TCTI *)tctiContext;
+    char c;
+
+    assert_int_equal (timeout, TSS2_TCTI_TIMEOUT_NONE);
+    if (read (tcti->fds [0], &c, 1) != 1 || c == 'p')
+        return TSS2_TCTI_RC_TRY_AGAIN;
+    if (c == 'c') {
+        close (tcti->fds [0]);
+        close (tcti->fds [1]);
+        assert_int_equal (pipe2 (tcti->fds, O_NONBLOCK), 0);
+        return TSS2_TCTI_RC_TRY_AGAIN;
+    }
+
+    memcpy (response, startup_response, sizeof (startup_response));
+    *size = sizeof (startup_response);
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+mock_get_poll_handles (TSS2_TCTI_CONTEXT *tctiContext,
+                       TSS2_TCTI_POLL_HANDLE *handles,
+                       size_t *num_handles)
+{
+    MOCK_TCTI *tcti = (MOCK_TCTI *)tctiContext;
+
+    if (handles != NULL) {
+        handles->fd = tcti->fds [0];
+        handles->events = POLLIN;
+    }
+    *num_handles = 1;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+mock_respond (MOCK_CONTEXT *ctx,
+              char c)
+{
+    assert_int_equal (write (ctx->tcti.fds [1], &c, 1), 1);
+}
+
+static void
+mock_prepare (MOCK_CONTEXT *ctx)
+{
+    assert_int_equal (Tss2_Sys_Startup_Prepare (ctx->sys, TPM2_SU_CLEAR),
+                      TSS2_RC_SUCCESS);
+}
+
+static void
+record_completion (TSS2_SYS_CONTEXT *sysContext,
+                   TSS2_RC rc,
+                   void *data)
+{
+    MOCK_CONTEXT *ctx = data;
+
+    assert_ptr_equal (sysContext, ctx->sys);
+    ctx->completions++;
+    ctx->rc = rc;
+}
+
+static int
+reactor_setup (void **state)
+{
+    REACTOR_STATE *rs;
+    MOCK_CONTEXT *ctx;
+    TSS2_RC rc;
+    int i;
+
+    rs = calloc (1, sizeof (*rs));
+    assert_non_null (rs);
+    rc = Tss2_Reactor_New (&rs->reactor);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    for (i = 0; i < MOCK_CONTEXTS; i++) {
+        ctx = &rs->contexts [i];
+        ctx->tcti.common.magic = 1;
+        ctx->tcti.common.version = 1;
+        ctx->tcti.common.transmit = mock_transmit;
+        ctx->tcti.common.receive = mock_receive;
+        ctx->tcti.common.getPollHandles = mock_get_poll_handles;
+        assert_int_equal (pipe2 (ctx->tcti.fds, O_NONBLOCK), 0);
+
+        ctx->sys = sapi_mock_init ((TSS2_TCTI_CONTEXT *)&ctx->tcti);
+        rc = Tss2_Reactor_Register (rs->reactor, ctx->sys, &ctx->entry);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+
+    *state = rs;
+    return 0;
+}
+
+static int
+reactor_teardown (void **state)
+{
+    REACTOR_STATE *rs = *state;
+    int i;
+
+    Tss2_Reactor_Free (rs->reactor);
+    for (i = 0; i < MOCK_CONTEXTS; i++) {
+        close (rs->contexts [i].tcti.fds [0]);
+        close (rs->contexts [i].tcti.fds [1]);
+        free (rs->contexts [i].sys);
+    }
+    free (rs);
+    return 0;
+}
+/*
+ * Only the contexts whose TPM answered complete; the rest stay outstanding
+ * until theirs does, in whatever order that happens.
+ */
+static void
+reactor_completes_ready_contexts (void **state)
+{
+    REACTOR_STATE *rs = *state;
+    size_t completed, total = 0;
+    TSS2_RC rc;
+    int i;
+
+    for (i = 0; i < MOCK_CONTEXTS; i++) {
+        mock_prepare (&rs->contexts [i]);
+        rc = Tss2_Reactor_Submit (rs->contexts [i].entry,
+                                  record_completion,
+                                  &rs->contexts [i]);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    assert_int_equal (Tss2_Reactor_Outstanding (rs->reactor), MOCK_CONTEXTS);
+
+    rc = Tss2_Reactor_Dispatch (rs->reactor, TSS2_TCTI_TIMEOUT_NONE,
+                                &completed);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (completed, 0);
+
+    for (i = MOCK_CONTEXTS - 1; i >= 0; i -= 2)
+        mock_respond (&rs->contexts [i], 'r');
+    while (total < MOCK_CONTEXTS / 2) {
+        rc = Tss2_Reactor_Dispatch (rs->reactor, TSS2_TCTI_TIMEOUT_BLOCK,
+                                    &completed);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        total += completed;
+    }
+    assert_int_equal (total, MOCK_CONTEXTS / 2);
+    for (i = 0; i < MOCK_CONTEXTS; i++) {
+        assert_int_equal (rs->contexts [i].completions, i % 2);
+    }
+    assert_int_equal (Tss2_Reactor_Outstanding (rs->reactor),
+                      MOCK_CONTEXTS / 2);
+
+    for (i = 0; i < MOCK_CONTEXTS; i += 2)
+        mock_respond (&rs->contexts [i], 'r');
+    while (Tss2_Reactor_Outstanding (rs->reactor) > 0) {
+        rc = Tss2_Reactor_Dispatch (rs->reactor, TSS2_TCTI_TIMEOUT_BLOCK,
+                                    NULL);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    for (i = 0; i < MOCK_CONTEXTS; i++) {
+        assert_int_equal (rs->contexts [i].completions, 1);
+        assert_int_equal (rs->contexts [i].rc, TSS2_RC_SUCCESS);
+    }
+}
+/*
+ * A TRY_AGAIN from ExecuteFinish (part of the response arrived) re-arms the
+ * context instead of completing it.
+ */
+static void
+reactor_partial_response (void **state)
+{
+    REACTOR_STATE *rs = *state;
+    MOCK_CONTEXT *ctx = &rs->contexts [0];
+    size_t completed;
+    TSS2_RC rc;
+
+    mock_prepare (ctx);
+    rc = Tss2_Reactor_Submit (ctx->entry, record_completion, ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Reactor_Submit (ctx->entry, record_completion, ctx);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
+
+    mock_respond (ctx, 'p');
+    rc = Tss2_Reactor_Dispatch (rs->reactor, 100, &completed);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (completed, 0);
+    assert_int_equal (Tss2_Reactor_Outstanding (rs->reactor), 1);
+
+    mock_respond (ctx, 'r');
+    rc = Tss2_Reactor_Dispatch (rs->reactor, 100, &completed);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (completed, 1);
+    assert_int_equal (ctx->completions, 1);
+    assert_int_equal (Tss2_Reactor_Outstanding (rs->reactor), 0);
+}
+/*
+ * An entry that can't be rearmed after a partial response would never be
+ * reported again: it completes with the error instead.
+ */
+static void
+reactor_rearm_fails (void **state)
+{
+    REACTOR_STATE *rs = *state;
+    MOCK_CONTEXT *ctx = &rs->contexts [0];
+    size_t completed;
+    TSS2_RC rc;
+
+    mock_prepare (ctx);
+    rc = Tss2_Reactor_Submit (ctx->entry, record_completion, ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    mock_respond (ctx, 'c');
+    rc = Tss2_Reactor_Dispatch (rs->reactor, 100, &completed);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (completed, 1);
+    assert_int_equal (ctx->completions, 1);
+    assert_int_equal (ctx->rc, TSS2_SYS_RC_GENERAL_FAILURE);
+    assert_int_equal (Tss2_Reactor_Outstanding (rs->reactor), 0);
+}
+/*
+ * Callbacks may submit the next command or unregister their entry,
+ * including entries with events later in the same batch.
+ */
+static void
+resubmit_completion (TSS2_SYS_CONTEXT *sysContext,
+                     TSS2_RC rc,
+                     void *data)
+{
+    MOCK_CONTEXT *ctx = data;
+
+    record_completion (sysContext, rc, data);
+    if (ctx->completions < 3) {
+        mock_prepare (ctx);
+        assert_int_equal (Tss2_Reactor_Submit (ctx->entry,
+                                               resubmit_completion,
+                                               ctx),
+                          TSS2_RC_SUCCESS);
+        mock_respond (ctx, 'r');
+    }
+}
+
+static void
+unregister_completion (TSS2_SYS_CONTEXT *sysContext,
+                       TSS2_RC rc,
+                       void *data)
+{
+    MOCK_CONTEXT *pair = data;
+
+    pair [0].completions++;
+    assert_int_equal (Tss2_Reactor_Unregister (pair [0].entry),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Reactor_Unregister (pair [1].entry),
+                      TSS2_RC_SUCCESS);
+}
+
+static void
+reactor_callbacks_reenter (void **state)
+{
+    REACTOR_STATE *rs = *state;
+    MOCK_CONTEXT *ctx = rs->contexts;
+    TSS2_RC rc;
+
+    mock_prepare (&ctx [0]);
+    rc = Tss2_Reactor_Submit (ctx [0].entry, resubmit_completion, &ctx [0]);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    mock_respond (&ctx [0], 'r');
+    while (Tss2_Reactor_Outstanding (rs->reactor) > 0) {
+        rc = Tss2_Reactor_Dispatch (rs->reactor, TSS2_TCTI_TIMEOUT_BLOCK,
+                                    NULL);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    assert_int_equal (ctx [0].completions, 3);
+
+    /* both respond, the first callback to run unregisters both */
+    mock_prepare (&ctx [1]);
+    mock_prepare (&ctx [2]);
+    rc = Tss2_Reactor_Submit (ctx [1].entry, unregister_completion, &ctx [1]);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Reactor_Submit (ctx [2].entry, unregister_completion, &ctx [1]);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    mock_respond (&ctx [1], 'r');
+    mock_respond (&ctx [2], 'r');
+    rc = Tss2_Reactor_Dispatch (rs->reactor, 100, NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (ctx [1].completions, 1);
+    assert_int_equal (Tss2_Reactor_Outstanding (rs->reactor), 0);
+}
+/*
+ * Registering requires poll handles, and they can't be shared.
+ */
+static void
+reactor_register_errors (void **state)
+{
+    REACTOR_STATE *rs = *state;
+    TSS2_REACTOR_ENTRY *entry;
+    TSS2_RC rc;
+
+    rc = Tss2_Reactor_Register (rs->reactor, rs->contexts [0].sys, &entry);
+    assert_int_equal (rc, TSS2_SYS_RC_GENERAL_FAILURE);
+
+    rs->contexts [0].tcti.common.getPollHandles = NULL;
+    rc = Tss2_Reactor_Register (rs->reactor, rs->contexts [0].sys, &entry);
+    assert_int_equal (rc, TSS2_TCTI_RC_NOT_IMPLEMENTED);
+
+    rc = Tss2_Reactor_Register (rs->reactor, NULL, &entry);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_REFERENCE);
+    rc = Tss2_Reactor_Dispatch (rs->reactor, -2, NULL);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_VALUE);
+}
+
+/*
+ * A submit that can't wait for the response sends nothing and leaves
+ * nothing outstanding: the caller may prepare and submit again.
+ */
+static void
+reactor_submit_arm_fails (void **state)
+{
+    REACTOR_STATE *rs = *state;
+    MOCK_CONTEXT *ctx = &rs->contexts [0];
+    TSS2_RC rc;
+
+    /* closing the pipe drops it from the epoll set */
+    close (ctx->tcti.fds [0]);
+    close (ctx->tcti.fds [1]);
+    assert_int_equal (pipe2 (ctx->tcti.fds, O_NONBLOCK), 0);
+
+    transmitted = 0;
+    mock_prepare (ctx);
+    rc = Tss2_Reactor_Submit (ctx->entry, record_completion, ctx);
+    assert_int_equal (rc, TSS2_SYS_RC_GENERAL_FAILURE);
+    assert_int_equal (transmitted, 0);
+    assert_int_equal (Tss2_Reactor_Outstanding (rs->reactor), 0);
+    assert_int_equal (Tss2_Sys_ExecuteAsync (ctx->sys), TSS2_RC_SUCCESS);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown (reactor_completes_ready_contexts,
+                                         reactor_setup,
+                                         reactor_teardown),
+        cmocka_unit_test_setup_teardown (reactor_partial_response,
+                                         reactor_setup,
+                                         reactor_teardown),
+        cmocka_unit_test_setup_teardown (reactor_rearm_fails,
+                                         reactor_setup,
+                                         reactor_teardown),
+        cmocka_unit_test_setup_teardown (reactor_callbacks_reenter,
+                                         reactor_setup,
+                                         reactor_teardown),
+        cmocka_unit_test_setup_teardown (reactor_register_errors,
+                                         reactor_setup,
+                                         reactor_teardown),
+        cmocka_unit_test_setup_teardown (reactor_submit_arm_fails,
+                                         reactor_setup,
+                                         reactor_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,113 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "sapi-mock.h"
+
+static const uint8_t *mock_response;
+static size_t mock_response_size;
+
+static TSS2_RC
+tcti_transmit_ok (TSS2_TCTI_CONTEXT *tctiContext,
+                  size_t size,
+                  uint8_t *command)
+{
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_receive_canned (TSS2_TCTI_CONTEXT *tctiContext,
+                     size_t *size,
+                     uint8_t *response,
+                     int32_t timeout)
+{
+    if (*size < mock_response_size)
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    memcpy (response, mock_response, mock_response_size);
+    *size = mock_response_size;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_TCTI_CONTEXT_COMMON_V1 tcti_canned = {
+    .magic = 1,
+    .version = 1,
+    .transmit = tcti_transmit_ok,
+    .receive = tcti_receive_canned,
+};
+
+void
+sapi_mock_respond (const uint8_t *response,
+                   size_t size)
+{
+    mock_response = response;
+    mock_response_size = size;
+}
+/*
+ * Allocate and initialize a SAPI context on 'tcti', or on the canned
+ * response TCTI if 'tcti' is NULL.
+ */
+TSS2_SYS_CONTEXT*
+sapi_mock_init (TSS2_TCTI_CONTEXT *tcti)
+{
+    TSS2_ABI_VERSION abi = { TSSWG_INTEROP, TSS_SAPI_FIRST_FAMILY,
+                             TSS_SAPI_FIRST_LEVEL, TSS_SAPI_FIRST_VERSION };
+    TSS2_SYS_CONTEXT *sys_ctx;
+    size_t size;
+    TSS2_RC rc;
+
+    if (tcti == NULL)
+        tcti = (TSS2_TCTI_CONTEXT *)&tcti_canned;
+    size = Tss2_Sys_GetContextSize (0);
+    sys_ctx = calloc (1, size);
+    assert_non_null (sys_ctx);
+    rc = Tss2_Sys_Initialize (sys_ctx, size, tcti, &abi);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    return sys_ctx;
+}
+/* cmocka setup / teardown for tests whose state is just the context. */
+int
+sapi_mock_setup (void **state)
+{
+    *state = sapi_mock_init (NULL);
+    return 0;
+}
+
+int
+sapi_mock_teardown (void **state)
+{
+    Tss2_Sys_Finalize (*state);
+    free (*state);
+    return 0;
+}
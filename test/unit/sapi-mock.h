@@ -0,0 +1,46 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+#ifndef SAPI_MOCK_H
+#define SAPI_MOCK_H
+
+#include "sapi/tpm20.h"
+
+/*
+ * SAPI context fixture shared by the unit tests that drive commands
+ * through a mock TCTI. Unless a test brings its own TCTI, the context
+ * uses a v1 TCTI whose 'transmit' always succeeds and whose 'receive'
+ * hands back the canned response last passed to sapi_mock_respond. The
+ * response isn't copied and must stay around until it is received.
+ */
+void                sapi_mock_respond   (const uint8_t      *response,
+                                         size_t              size);
+TSS2_SYS_CONTEXT*   sapi_mock_init      (TSS2_TCTI_CONTEXT  *tcti);
+int                 sapi_mock_setup     (void              **state);
+int                 sapi_mock_teardown  (void              **state);
+
+#endif /* SAPI_MOCK_H */
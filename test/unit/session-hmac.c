@@ -0,0 +1,364 @@
+/***********************************************************************
+ * Copyright (c) 2017, Intel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "host-crypto.h"
+#include "host-sha.h"
+
+static const uint8_t sha1_abc[] = {
+    0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a,
+    0xba, 0x3e, 0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c,
+    0x9c, 0xd0, 0xd8, 0x9d,
+};
+
+static const uint8_t sha256_abc[] = {
+    0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+    0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+    0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+    0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+};
+
+static const uint8_t sha384_abc[] = {
+    0xcb, 0x00, 0x75, 0x3f, 0x45, 0xa3, 0x5e, 0x8b,
+    0xb5, 0xa0, 0x3d, 0x69, 0x9a, 0xc6, 0x50, 0x07,
+    0x27, 0x2c, 0x32, 0xab, 0x0e, 0xde, 0xd1, 0x63,
+    0x1a, 0x8b, 0x60, 0x5a, 0x43, 0xff, 0x5b, 0xed,
+    0x80, 0x86, 0x07, 0x2b, 0xa1, 0xe7, 0xcc, 0x23,
+    0x58, 0xba, 0xec, 0xa1, 0x34, 0xc8, 0x25, 0xa7,
+};
+
+static const uint8_t sha512_abc[] = {
+    0xdd, 0xaf, 0x35, 0xa1, 0x93, 0x61, 0x7a, 0xba,
+    0xcc, 0x41, 0x73, 0x49, 0xae, 0x20, 0x41, 0x31,
+    0x12, 0xe6, 0xfa, 0x4e, 0x89, 0xa9, 0x7e, 0xa2,
+    0x0a, 0x9e, 0xee, 0xe6, 0x4b, 0x55, 0xd3, 0x9a,
+    0x21, 0x92, 0x99, 0x2a, 0x27, 0x4f, 0xc1, 0xa8,
+    0x36, 0xba, 0x3c, 0x23, 0xa3, 0xfe, 0xeb, 0xbd,
+    0x45, 0x4d, 0x44, 0x23, 0x64, 0x3c, 0xe8, 0x0e,
+    0x2a, 0x9a, 0xc9, 0x4f, 0xa5, 0x4c, 0xa4, 0x9f,
+};
+
+static const uint8_t sha256_two_blocks[] = {
+    0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8,
+    0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+    0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67,
+    0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1,
+};
+
+static const uint8_t hmac_sha256_jefe[] = {
+    0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e,
+    0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+    0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83,
+    0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43,
+};
+
+static const uint8_t hmac_sha512_long_key[] = {
+    0x80, 0xb2, 0x42, 0x63, 0xc7, 0xc1, 0xa3, 0xeb,
+    0xb7, 0x14, 0x93, 0xc1, 0xdd, 0x7b, 0xe8, 0xb4,
+    0x9b, 0x46, 0xd1, 0xf4, 0x1b, 0x4a, 0xee, 0xc1,
+    0x12, 0x1b, 0x01, 0x37, 0x83, 0xf8, 0xf3, 0x52,
+    0x6b, 0x56, 0xd0, 0x37, 0xe0, 0x5f, 0x25, 0x98,
+    0xbd, 0x0f, 0xd2, 0x21, 0x5d, 0x6a, 0x1e, 0x52,
+    0x95, 0xe6, 0x4f, 0x73, 0xf6, 0x3f, 0x0a, 0xec,
+    0x8b, 0x91, 0x5a, 0x98, 0x5d, 0x78, 0x65, 0x98,
+};
+
+static const uint8_t session_hmac_expected[] = {
+    0x68, 0x9d, 0xb8, 0xbd, 0x7b, 0xde, 0x9f, 0x3f,
+    0xfe, 0xce, 0x6b, 0x55, 0xbe, 0x2c, 0xb4, 0x33,
+    0xfb, 0xfa, 0x95, 0x57, 0xff, 0x20, 0x7e, 0x8e,
+    0xb5, 0x06, 0x42, 0x55, 0x8f, 0xf7, 0x72, 0x1c,
+};
+
+static void
+hash_buffer (TPMI_ALG_HASH hash_alg,
+             const uint8_t *buffer,
+             size_t size,
+             size_t chunk,
+             uint8_t *digest,
+             size_t *digest_size)
+{
+    TSS2_SYS_HASH_CONTEXT ctx;
+    size_t offset, count;
+    TSS2_RC rc;
+
+    rc = host_hash_start (&ctx, hash_alg);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    for (offset = 0; offset < size; offset += count) {
+        count = size - offset < chunk ? size - offset : chunk;
+        rc = host_hash_update (&ctx, &buffer[offset], count);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    rc = host_hash_finish (&ctx, digest, digest_size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
+
+/*
+ * FIPS 180-2 "abc" vectors for each of the built-in algorithms.
+ */
+static void
+host_hash_abc (void **state)
+{
+    uint8_t digest[TPM2_SHA512_DIGEST_SIZE];
+    size_t digest_size;
+
+    digest_size = sizeof (digest);
+    hash_buffer (TPM2_ALG_SHA1, (uint8_t *)"abc", 3, 3, digest, &digest_size);
+    assert_int_equal (digest_size, sizeof (sha1_abc));
+    assert_memory_equal (digest, sha1_abc, sizeof (sha1_abc));
+
+    digest_size = sizeof (digest);
+    hash_buffer (TPM2_ALG_SHA256, (uint8_t *)"abc", 3, 3, digest, &digest_size);
+    assert_int_equal (digest_size, sizeof (sha256_abc));
+    assert_memory_equal (digest, sha256_abc, sizeof (sha256_abc));
+
+    digest_size = sizeof (digest);
+    hash_buffer (TPM2_ALG_SHA384, (uint8_t *)"abc", 3, 3, digest, &digest_size);
+    assert_int_equal (digest_size, sizeof (sha384_abc));
+    assert_memory_equal (digest, sha384_abc, sizeof (sha384_abc));
+
+    digest_size = sizeof (digest);
+    hash_buffer (TPM2_ALG_SHA512, (uint8_t *)"abc", 3, 3, digest, &digest_size);
+    assert_int_equal (digest_size, sizeof (sha512_abc));
+    assert_memory_equal (digest, sha512_abc, sizeof (sha512_abc));
+}
+
+/*
+ * The 56 byte message needs a second block for the padding. Feed it in
+ * odd sized chunks to exercise the partial block handling.
+ */
+static void
+host_hash_sha256_chunked (void **state)
+{
+    const char *message =
+        "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    uint8_t digest[TPM2_SHA256_DIGEST_SIZE];
+    size_t digest_size;
+    size_t chunk;
+
+    for (chunk = 1; chunk <= 56; chunk += 5) {
+        digest_size = sizeof (digest);
+        hash_buffer (TPM2_ALG_SHA256, (uint8_t *)message, strlen (message),
+                     chunk, digest, &digest_size);
+        assert_memory_equal (digest, sha256_two_blocks, sizeof (digest));
+    }
+}
+
+static void
+host_hash_bad_alg (void **state)
+{
+    TSS2_SYS_HASH_CONTEXT ctx;
+
+    assert_int_equal (host_hash_start (&ctx, TPM2_ALG_AES),
+                      TSS2_SYS_RC_BAD_VALUE);
+}
+
+static void
+host_hash_small_digest_buffer (void **state)
+{
+    TSS2_SYS_HASH_CONTEXT ctx;
+    uint8_t digest[TPM2_SHA1_DIGEST_SIZE];
+    size_t digest_size = sizeof (digest);
+
+    assert_int_equal (host_hash_start (&ctx, TPM2_ALG_SHA256),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (host_hash_finish (&ctx, digest, &digest_size),
+                      TSS2_SYS_RC_INSUFFICIENT_BUFFER);
+}
+
+/*
+ * RFC 4231 test cases 2 and 6 (key longer than the block size).
+ */
+static void
+host_hmac_rfc4231 (void **state)
+{
+    const char *data = "what do ya want for nothing?";
+    const char *long_data =
+        "Test Using Larger Than Block-Size Key - Hash Key First";
+    HOST_HMAC_CONTEXT ctx;
+    uint8_t key[131];
+    uint8_t digest[TPM2_SHA512_DIGEST_SIZE];
+    size_t digest_size;
+
+    assert_int_equal (host_hmac_start (&ctx, TPM2_ALG_SHA256,
+                                       (uint8_t *)"Jefe", 4),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (host_hmac_update (&ctx, (uint8_t *)data, strlen (data)),
+                      TSS2_RC_SUCCESS);
+    digest_size = sizeof (digest);
+    assert_int_equal (host_hmac_finish (&ctx, digest, &digest_size),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (digest_size, sizeof (hmac_sha256_jefe));
+    assert_memory_equal (digest, hmac_sha256_jefe, sizeof (hmac_sha256_jefe));
+
+    memset (key, 0xaa, sizeof (key));
+    assert_int_equal (host_hmac_start (&ctx, TPM2_ALG_SHA512,
+                                       key, sizeof (key)),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (host_hmac_update (&ctx, (uint8_t *)long_data,
+                                        strlen (long_data)),
+                      TSS2_RC_SUCCESS);
+    digest_size = sizeof (digest);
+    assert_int_equal (host_hmac_finish (&ctx, digest, &digest_size),
+                      TSS2_RC_SUCCESS);
+    assert_memory_equal (digest, hmac_sha512_long_key,
+                         sizeof (hmac_sha512_long_key));
+}
+
+static void
+session_hmac_fill (TPM2B_DIGEST *buffer,
+                   uint8_t value,
+                   uint16_t size)
+{
+    buffer->size = size;
+    memset (buffer->buffer, value, size);
+}
+
+/*
+ * Session HMAC keyed with sessionKey || authValue over
+ * pHash || nonceNewer || nonceOlder || sessionAttributes.
+ */
+static void
+session_hmac_calc_and_check (void **state)
+{
+    TPM2B_DIGEST pHash, sessionKey, hmac;
+    TPM2B_NONCE nonceNewer, nonceOlder;
+    TPM2B_AUTH authValue;
+    TPMA_SESSION attributes = { .val = 0x01 };
+    TSS2_RC rc;
+
+    session_hmac_fill (&pHash, 0x22, 32);
+    session_hmac_fill (&sessionKey, 0x11, 32);
+    session_hmac_fill (&nonceNewer, 0x33, 16);
+    session_hmac_fill (&nonceOlder, 0x44, 16);
+    authValue.size = 8;
+    memcpy (authValue.buffer, "password", 8);
+
+    rc = Tss2_Sys_CalcSessionHmac (TPM2_ALG_SHA256, &pHash, &sessionKey,
+                                   &authValue, &nonceNewer, &nonceOlder,
+                                   NULL, NULL, attributes, &hmac);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (hmac.size, sizeof (session_hmac_expected));
+    assert_memory_equal (hmac.buffer, session_hmac_expected,
+                         sizeof (session_hmac_expected));
+
+    rc = Tss2_Sys_CheckSessionHmac (TPM2_ALG_SHA256, &pHash, &sessionKey,
+                                    &authValue, &nonceNewer, &nonceOlder,
+                                    NULL, NULL, attributes, &hmac);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    hmac.buffer[5] ^= 0x01;
+    rc = Tss2_Sys_CheckSessionHmac (TPM2_ALG_SHA256, &pHash, &sessionKey,
+                                    &authValue, &nonceNewer, &nonceOlder,
+                                    NULL, NULL, attributes, &hmac);
+    assert_int_equal (rc, TSS2_SYS_RC_RSP_AUTH_FAILED);
+}
+
+static void
+session_hmac_null_result (void **state)
+{
+    TPMA_SESSION attributes = { .val = 0 };
+
+    assert_int_equal (Tss2_Sys_CalcSessionHmac (TPM2_ALG_SHA256, NULL, NULL,
+                                                NULL, NULL, NULL, NULL, NULL,
+                                                attributes, NULL),
+                      TSS2_SYS_RC_BAD_REFERENCE);
+}
+
+static unsigned int backend_start_count;
+
+static TSS2_RC
+counting_hash_start (TSS2_SYS_HASH_CONTEXT *ctx,
+                     TPMI_ALG_HASH hash_alg,
+                     void *user_data)
+{
+    *(unsigned int *)user_data += 1;
+    return host_sha_start (ctx, hash_alg, NULL);
+}
+
+/*
+ * An installed backend must be used for the HMAC computation and the
+ * built-in one restored by passing NULL.
+ */
+static void
+session_hmac_custom_backend (void **state)
+{
+    TSS2_SYS_CRYPTO_CALLBACKS callbacks = {
+        .hashStart = counting_hash_start,
+        .hashUpdate = host_sha_update,
+        .hashFinish = host_sha_finish,
+        .userData = &backend_start_count,
+    };
+    TSS2_SYS_CRYPTO_CALLBACKS incomplete = { .hashStart = NULL };
+    TPMA_SESSION attributes = { .val = 0 };
+    TPM2B_DIGEST hmac;
+
+    assert_int_equal (Tss2_Sys_SetCryptoCallbacks (&incomplete),
+                      TSS2_SYS_RC_BAD_VALUE);
+    assert_int_equal (Tss2_Sys_SetCryptoCallbacks (&callbacks),
+                      TSS2_RC_SUCCESS);
+
+    backend_start_count = 0;
+    assert_int_equal (Tss2_Sys_CalcSessionHmac (TPM2_ALG_SHA1, NULL, NULL,
+                                                NULL, NULL, NULL, NULL, NULL,
+                                                attributes, &hmac),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (hmac.size, TPM2_SHA1_DIGEST_SIZE);
+    assert_int_equal (backend_start_count, 2);
+
+    assert_int_equal (Tss2_Sys_SetCryptoCallbacks (NULL), TSS2_RC_SUCCESS);
+    assert_int_equal (Tss2_Sys_CalcSessionHmac (TPM2_ALG_SHA1, NULL, NULL,
+                                                NULL, NULL, NULL, NULL, NULL,
+                                                attributes, &hmac),
+                      TSS2_RC_SUCCESS);
+    assert_int_equal (backend_start_count, 2);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const struct CMUnitTest tests [] = {
+        cmocka_unit_test (host_hash_abc),
+        cmocka_unit_test (host_hash_sha256_chunked),
+        cmocka_unit_test (host_hash_bad_alg),
+        cmocka_unit_test (host_hash_small_digest_buffer),
+        cmocka_unit_test (host_hmac_rfc4231),
+        cmocka_unit_test (session_hmac_calc_and_check),
+        cmocka_unit_test (session_hmac_null_result),
+        cmocka_unit_test (session_hmac_custom_backend),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
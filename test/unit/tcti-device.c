@@ -1,6 +1,12 @@
+#include <errno.h>
 #include <inttypes.h>
+#include <poll.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <setjmp.h>
 #include <cmocka.h>
@@ -125,15 +131,30 @@ tcti_device_log_called_test (void **state)
 }
 /* end tcti_dev_init_log */
 /* wrap functions for read & write required to test receive / transmit */
+static void *read_buffer;
 ssize_t
 __wrap_read (int fd, void *buffer, size_t count)
 {
-    return mock_type (ssize_t);
+    ssize_t ret = mock_type (ssize_t);
+
+    read_buffer = buffer;
+    if (ret < 0)
+        errno = EAGAIN;
+    return ret;
+}
+int
+__wrap_poll (struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    return mock_type (int);
 }
 ssize_t
 __wrap_write (int fd, const void *buffer, size_t buffer_size)
 {
-    return mock_type (ssize_t);
+    ssize_t ret = mock_type (ssize_t);
+
+    if (ret < 0)
+        errno = EAGAIN;
+    return ret;
 }
 
 typedef struct {
@@ -210,6 +231,7 @@ tcti_device_receive_success (void **state)
     data_t *data = *state;
     TSS2_RC rc;
 
+    will_return (__wrap_poll, 1);
     will_return (__wrap_read, data->data_size);
     rc = tss2_tcti_receive (data->ctx,
                             &data->buffer_size,
@@ -218,6 +240,258 @@ tcti_device_receive_success (void **state)
     assert_true (rc == TSS2_RC_SUCCESS);
     assert_int_equal (data->data_size, data->buffer_size);
 }
+/*
+ * A caller buffer that can hold any response is read into directly, without
+ * the TCTI allocating a staging buffer.
+ */
+static void
+tcti_device_receive_direct (void **state)
+{
+    data_t *data = *state;
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel;
+    uint8_t buffer [TPM2_MAX_RESPONSE_SIZE];
+    size_t size = sizeof (buffer);
+    TSS2_RC rc;
+
+    tcti_intel = tcti_context_intel_cast (data->ctx);
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_read, data->data_size);
+    rc = tss2_tcti_receive (data->ctx,
+                            &size,
+                            buffer,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, data->data_size);
+    assert_ptr_equal (read_buffer, buffer);
+    assert_null (tcti_intel->responseBuffer);
+}
+/*
+ * A size query reads the response into the staging buffer, reports its size
+ * and hands it out on the next call; the staging buffer is released then.
+ */
+static void
+tcti_device_receive_size_query (void **state)
+{
+    data_t *data = *state;
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel;
+    size_t size = 0;
+    TSS2_RC rc;
+
+    tcti_intel = tcti_context_intel_cast (data->ctx);
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_read, data->data_size);
+    rc = tss2_tcti_receive (data->ctx,
+                            &size,
+                            NULL,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, data->data_size);
+    assert_non_null (tcti_intel->responseBuffer);
+    assert_ptr_equal (read_buffer, tcti_intel->responseBuffer);
+
+    size = 10;
+    rc = tss2_tcti_receive (data->ctx,
+                            &size,
+                            data->buffer,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_TCTI_RC_INSUFFICIENT_BUFFER);
+    assert_int_equal (size, data->data_size);
+
+    size = data->buffer_size;
+    rc = tss2_tcti_receive (data->ctx,
+                            &size,
+                            data->buffer,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, data->data_size);
+    assert_null (tcti_intel->responseBuffer);
+}
+/*
+ * With a finite timeout (or TSS2_TCTI_TIMEOUT_NONE) a response that isn't
+ * ready yet is TRY_AGAIN, whether poll times out or the non-blocking read
+ * comes back empty. The next call picks the response up.
+ */
+static void
+tcti_device_receive_timeout (void **state)
+{
+    data_t *data = *state;
+    size_t size = data->buffer_size;
+    TSS2_RC rc;
+
+    will_return (__wrap_poll, 0);
+    rc = tss2_tcti_receive (data->ctx,
+                            &size,
+                            data->buffer,
+                            TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_TCTI_RC_TRY_AGAIN);
+
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_read, -1);
+    rc = tss2_tcti_receive (data->ctx,
+                            &size,
+                            data->buffer,
+                            100);
+    assert_int_equal (rc, TSS2_TCTI_RC_TRY_AGAIN);
+
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_read, data->data_size);
+    rc = tss2_tcti_receive (data->ctx,
+                            &size,
+                            data->buffer,
+                            100);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, data->data_size);
+}
+/*
+ * getPollHandles reports the device file descriptor, waiting for POLLIN.
+ */
+static void
+tcti_device_get_poll_handles (void **state)
+{
+    data_t *data = *state;
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel;
+    TSS2_TCTI_POLL_HANDLE handles [2];
+    size_t num_handles = 0;
+    TSS2_RC rc;
+
+    tcti_intel = tcti_context_intel_cast (data->ctx);
+    rc = tss2_tcti_get_poll_handles (data->ctx, NULL, &num_handles);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (num_handles, 1);
+
+    num_handles = 0;
+    rc = tss2_tcti_get_poll_handles (data->ctx, handles, &num_handles);
+    assert_int_equal (rc, TSS2_TCTI_RC_INSUFFICIENT_BUFFER);
+
+    num_handles = 2;
+    rc = tss2_tcti_get_poll_handles (data->ctx, handles, &num_handles);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (num_handles, 1);
+    assert_int_equal (handles [0].fd, tcti_intel->devFile);
+    assert_int_equal (handles [0].events, POLLIN);
+
+    rc = tss2_tcti_get_poll_handles (data->ctx, handles, NULL);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_REFERENCE);
+}
+/*
+ * A submitted command whose write would block stays queued. A blocking
+ * reap waits for the device to become writable and sends it rather than
+ * returning TSS2_TCTI_RC_TRY_AGAIN; a non-blocking reap does not wait.
+ */
+static void
+tcti_device_reap_block_write (void **state)
+{
+    data_t *data = *state;
+    static uint8_t response [TPM2_MAX_RESPONSE_SIZE];
+    TSS2_TCTI_COMPLETION completion;
+    size_t count;
+    TSS2_RC rc;
+
+    will_return (__wrap_write, -1);
+    rc = tss2_tcti_submit (data->ctx,
+                           data->buffer_size,
+                           data->buffer,
+                           sizeof (response),
+                           response,
+                           7);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    will_return (__wrap_write, -1);
+    will_return (__wrap_write, -1);
+    rc = tss2_tcti_reap (data->ctx, &completion, 1, &count,
+                         TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_TCTI_RC_TRY_AGAIN);
+    assert_int_equal (count, 0);
+
+    /* still full once, then writable */
+    will_return (__wrap_write, -1);
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_write, -1);
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_write, data->buffer_size);
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_read, 10);
+    rc = tss2_tcti_reap (data->ctx, &completion, 1, &count,
+                         TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (count, 1);
+    assert_int_equal (completion.user_tag, 7);
+    assert_int_equal (completion.rc, TSS2_RC_SUCCESS);
+    assert_int_equal (completion.response_size, 10);
+}
+/*
+ * Submitted commands go to the device one at a time: the next is written
+ * as soon as the previous response has been read. reap waits for the
+ * first completion only and returns the rest that are ready with it.
+ */
+static void
+tcti_device_submit_reap (void **state)
+{
+    data_t *data = *state;
+    static uint8_t responses [3][TPM2_MAX_RESPONSE_SIZE];
+    TSS2_TCTI_COMPLETION completions [8];
+    size_t count;
+    TSS2_RC rc;
+    int i;
+
+    will_return (__wrap_write, data->buffer_size);
+    for (i = 0; i < 3; i++) {
+        rc = tss2_tcti_submit (data->ctx,
+                               data->buffer_size,
+                               data->buffer,
+                               sizeof (responses [i]),
+                               responses [i],
+                               100 + i);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    rc = tss2_tcti_submit (data->ctx,
+                           data->buffer_size,
+                           data->buffer,
+                           data->buffer_size,
+                           data->buffer,
+                           0);
+    assert_int_equal (rc, TSS2_TCTI_RC_INSUFFICIENT_BUFFER);
+    rc = tss2_tcti_transmit (data->ctx, data->buffer_size, data->buffer);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+
+    /* two responses are ready, the third isn't */
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_read, 10);
+    will_return (__wrap_write, data->buffer_size);
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_read, 12);
+    will_return (__wrap_write, data->buffer_size);
+    will_return (__wrap_poll, 0);
+    rc = tss2_tcti_reap (data->ctx, completions, 8, &count,
+                         TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (count, 2);
+    assert_int_equal (completions [0].user_tag, 100);
+    assert_int_equal (completions [0].rc, TSS2_RC_SUCCESS);
+    assert_int_equal (completions [0].response_size, 10);
+    assert_int_equal (completions [1].user_tag, 101);
+    assert_int_equal (completions [1].response_size, 12);
+    assert_ptr_equal (read_buffer, responses [1]);
+
+    will_return (__wrap_poll, 0);
+    rc = tss2_tcti_reap (data->ctx, completions, 8, &count,
+                         TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_TCTI_RC_TRY_AGAIN);
+    assert_int_equal (count, 0);
+
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_read, 14);
+    rc = tss2_tcti_reap (data->ctx, completions, 8, &count, 100);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (count, 1);
+    assert_int_equal (completions [0].user_tag, 102);
+    assert_int_equal (completions [0].response_size, 14);
+
+    /* the queue is empty: plain transmit works again */
+    will_return (__wrap_write, data->buffer_size);
+    rc = tss2_tcti_transmit (data->ctx, data->buffer_size, data->buffer);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
 /*
  * A test case for a successful call to the transmit function. This requires
  * that the context and the cmmand buffer be valid. The only indication of
@@ -235,6 +509,121 @@ tcti_device_transmit_success (void **state)
                              data->buffer);
     assert_true (rc == TSS2_RC_SUCCESS);
 }
+/*
+ * The vectored transmit gathers the buffers into a single write: the mock
+ * write reports the full command size so the call must succeed.
+ */
+static void
+tcti_device_transmitv_success (void **state)
+{
+    data_t *data = *state;
+    struct iovec iov [3] = {
+        { .iov_base = data->buffer,      .iov_len = 2 },
+        { .iov_base = data->buffer + 2,  .iov_len = 8 },
+        { .iov_base = data->buffer + 10, .iov_len = data->buffer_size - 10 },
+    };
+    TSS2_RC rc;
+
+    will_return (__wrap_write, data->buffer_size);
+    rc = tss2_tcti_transmitv (data->ctx, iov, 3);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
+/*
+ * A short write from the driver is an IO error, and an empty iovec array
+ * is rejected before anything is written.
+ */
+static void
+tcti_device_transmitv_errors (void **state)
+{
+    data_t *data = *state;
+    struct iovec iov [2] = {
+        { .iov_base = data->buffer,      .iov_len = 10 },
+        { .iov_base = data->buffer + 10, .iov_len = data->buffer_size - 10 },
+    };
+    TSS2_RC rc;
+
+    rc = tss2_tcti_transmitv (data->ctx, iov, 0);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+
+    will_return (__wrap_write, 10);
+    rc = tss2_tcti_transmitv (data->ctx, iov, 2);
+    assert_int_equal (rc, TSS2_TCTI_RC_IO_ERROR);
+}
+/*
+ * The io_uring backend against a FIFO: whatever is written comes back as
+ * the "response", which runs the linked write / read through the
+ * registered buffer without a TPM. The read / write / poll wrappers are
+ * bypassed entirely. Skipped when the build or the kernel has no io_uring
+ * (InitDeviceTcti then falls back to read / write).
+ */
+static void
+tcti_device_io_uring_loopback (void **state)
+{
+    char dir [] = "/tmp/tcti-device-XXXXXX";
+    char fifo [sizeof (dir) + sizeof ("/fifo")];
+    uint8_t command [16] = { 0x80, 0x01, 0x00, 0x00, 0x00, 0x10,
+                             0x00, 0x00, 0x01, 0x7b, 0xa5, 0xa5 };
+    uint8_t response [TPM2_MAX_RESPONSE_SIZE];
+    struct iovec iov [2] = {
+        { .iov_base = command,     .iov_len = 10 },
+        { .iov_base = command + 10, .iov_len = 6 },
+    };
+    TCTI_DEVICE_CONF conf = {
+        .device_path = fifo,
+        .flags       = TCTI_FLAG_IO_URING,
+    };
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel;
+    TSS2_TCTI_POLL_HANDLE handle;
+    TSS2_TCTI_CONTEXT *ctx;
+    size_t size = 0, num_handles = 1;
+    TSS2_RC rc;
+
+    assert_non_null (mkdtemp (dir));
+    snprintf (fifo, sizeof (fifo), "%s/fifo", dir);
+    assert_int_equal (mkfifo (fifo, 0600), 0);
+    rc = InitDeviceTcti (NULL, &size, NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    ctx = calloc (1, size);
+    assert_non_null (ctx);
+    rc = InitDeviceTcti (ctx, 0, &conf);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    unlink (fifo);
+    rmdir (dir);
+    tcti_intel = tcti_context_intel_cast (ctx);
+    if (tcti_intel->uring == NULL) {
+        tss2_tcti_finalize (ctx);
+        free (ctx);
+        skip ();
+    }
+
+    /* the ring is the handle to wait on, not the device */
+    rc = tss2_tcti_get_poll_handles (ctx, &handle, &num_handles);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_not_equal (handle.fd, tcti_intel->devFile);
+
+    rc = tss2_tcti_transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    size = 0;
+    rc = tss2_tcti_receive (ctx, &size, NULL, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, sizeof (command));
+    rc = tss2_tcti_receive (ctx, &size, response, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (response, command, sizeof (command));
+
+    /* gathered straight into the registered buffer */
+    memset (response, 0, sizeof (response));
+    rc = tss2_tcti_transmitv (ctx, iov, 2);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    size = sizeof (response);
+    rc = tss2_tcti_receive (ctx, &size, response, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, sizeof (command));
+    assert_memory_equal (response, command, sizeof (command));
+
+    tss2_tcti_finalize (ctx);
+    free (ctx);
+}
 
 int
 main(int argc, char* argv[])
@@ -248,9 +637,34 @@ main(int argc, char* argv[])
         cmocka_unit_test_setup_teardown (tcti_device_receive_success,
                                   tcti_device_setup_with_command,
                                   tcti_device_teardown),
+        cmocka_unit_test_setup_teardown (tcti_device_receive_direct,
+                                  tcti_device_setup_with_command,
+                                  tcti_device_teardown),
+        cmocka_unit_test_setup_teardown (tcti_device_receive_size_query,
+                                  tcti_device_setup_with_command,
+                                  tcti_device_teardown),
+        cmocka_unit_test_setup_teardown (tcti_device_receive_timeout,
+                                  tcti_device_setup_with_command,
+                                  tcti_device_teardown),
+        cmocka_unit_test_setup_teardown (tcti_device_get_poll_handles,
+                                  tcti_device_setup_with_command,
+                                  tcti_device_teardown),
+        cmocka_unit_test_setup_teardown (tcti_device_submit_reap,
+                                  tcti_device_setup_with_command,
+                                  tcti_device_teardown),
+        cmocka_unit_test_setup_teardown (tcti_device_reap_block_write,
+                                  tcti_device_setup_with_command,
+                                  tcti_device_teardown),
         cmocka_unit_test_setup_teardown (tcti_device_transmit_success,
                                   tcti_device_setup_with_command,
                                   tcti_device_teardown),
+        cmocka_unit_test_setup_teardown (tcti_device_transmitv_success,
+                                  tcti_device_setup_with_command,
+                                  tcti_device_teardown),
+        cmocka_unit_test_setup_teardown (tcti_device_transmitv_errors,
+                                  tcti_device_setup_with_command,
+                                  tcti_device_teardown),
+        cmocka_unit_test (tcti_device_io_uring_loopback),
     };
     return cmocka_run_group_tests (tests, NULL, NULL);
 }
@@ -0,0 +1,515 @@
+#define _GNU_SOURCE
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "tcti/tcti_mux.h"
+#include "tcti/tcti.h"
+
+/*
+ * Underlying TCTI for the mux: echoes each command back as its response.
+ * It records how many threads are inside it at once, which the mux must
+ * keep at one. Commands starting with SLOW_COMMAND are answered late and
+ * those starting with FAIL_COMMAND fail in 'receive'.
+ */
+#define SLOW_COMMAND 0xff
+#define FAIL_COMMAND 0xee
+
+typedef struct {
+    TSS2_TCTI_CONTEXT_INTEL intel;
+    uint8_t buffer [TPM2_MAX_COMMAND_SIZE];
+    size_t size;
+    int inside;
+    int max_inside;
+    size_t commands;
+    uint8_t locality;
+    size_t locality_calls;
+} echo_tcti;
+
+static echo_tcti*
+echo_cast (TSS2_TCTI_CONTEXT *ctx)
+{
+    return (echo_tcti*)ctx;
+}
+
+static void
+echo_enter (echo_tcti *echo)
+{
+    int inside = __atomic_add_fetch (&echo->inside, 1, __ATOMIC_SEQ_CST);
+
+    if (inside > echo->max_inside) {
+        echo->max_inside = inside;
+    }
+}
+
+static void
+echo_leave (echo_tcti *echo)
+{
+    __atomic_sub_fetch (&echo->inside, 1, __ATOMIC_SEQ_CST);
+}
+
+static TSS2_RC
+echo_transmit (TSS2_TCTI_CONTEXT *ctx, size_t size, uint8_t *command)
+{
+    echo_tcti *echo = echo_cast (ctx);
+
+    echo_enter (echo);
+    memcpy (echo->buffer, command, size);
+    echo->size = size;
+    ++echo->commands;
+    echo_leave (echo);
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+echo_receive (TSS2_TCTI_CONTEXT *ctx,
+              size_t *size,
+              uint8_t *response,
+              int32_t timeout)
+{
+    echo_tcti *echo = echo_cast (ctx);
+    struct timespec delay = { .tv_sec = 0, .tv_nsec = 50000000 };
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    echo_enter (echo);
+    if (echo->buffer [0] == SLOW_COMMAND) {
+        nanosleep (&delay, NULL);
+    }
+    if (echo->buffer [0] == FAIL_COMMAND) {
+        rc = TSS2_TCTI_RC_IO_ERROR;
+    } else {
+        memcpy (response, echo->buffer, echo->size);
+        *size = echo->size;
+    }
+    echo_leave (echo);
+
+    return rc;
+}
+
+static TSS2_RC
+echo_set_locality (TSS2_TCTI_CONTEXT *ctx, uint8_t locality)
+{
+    echo_tcti *echo = echo_cast (ctx);
+
+    echo->locality = locality;
+    ++echo->locality_calls;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * Writes to 'delayed_fd' are held back a little, which widens the window
+ * between the I/O thread finishing a request and ringing its doorbell.
+ */
+static int delayed_fd = -1;
+
+ssize_t __real_write (int fd, const void *buffer, size_t count);
+
+ssize_t
+__wrap_write (int fd, const void *buffer, size_t count)
+{
+    struct timespec delay = { .tv_sec = 0, .tv_nsec = 1000000 };
+
+    if (fd == delayed_fd) {
+        nanosleep (&delay, NULL);
+    }
+    return __real_write (fd, buffer, count);
+}
+
+typedef struct {
+    echo_tcti echo;
+    TCTI_MUX *mux;
+} mux_test_state;
+
+static int
+tcti_mux_setup (void **state)
+{
+    mux_test_state *data;
+    TSS2_RC rc;
+
+    data = calloc (1, sizeof (mux_test_state));
+    assert_non_null (data);
+    TSS2_TCTI_MAGIC (&data->echo) = TCTI_MAGIC;
+    TSS2_TCTI_VERSION (&data->echo) = TCTI_VERSION;
+    TSS2_TCTI_TRANSMIT (&data->echo) = echo_transmit;
+    TSS2_TCTI_RECEIVE (&data->echo) = echo_receive;
+    TSS2_TCTI_SET_LOCALITY (&data->echo) = echo_set_locality;
+    rc = TctiMuxNew ((TSS2_TCTI_CONTEXT*)&data->echo, &data->mux);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    *state = data;
+    return 0;
+}
+
+static int
+tcti_mux_teardown (void **state)
+{
+    mux_test_state *data = *state;
+
+    TctiMuxFree (data->mux);
+    assert_int_equal (data->echo.max_inside, 1);
+    free (data);
+
+    return 0;
+}
+/* Allocate and initialize a TCTI context on the test's mux. */
+static TSS2_TCTI_CONTEXT*
+tcti_mux_context (mux_test_state *data)
+{
+    TSS2_TCTI_CONTEXT *ctx;
+    TCTI_MUX_CONF conf = { .mux = data->mux };
+    size_t size = 0;
+    TSS2_RC rc;
+
+    rc = InitMuxTcti (NULL, &size, NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    ctx = calloc (1, size);
+    assert_non_null (ctx);
+    rc = InitMuxTcti (ctx, &size, &conf);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    return ctx;
+}
+
+static void
+tcti_mux_context_free (TSS2_TCTI_CONTEXT *ctx)
+{
+    tss2_tcti_finalize (ctx);
+    free (ctx);
+}
+/* Build a command of 'size' bytes with a valid header. */
+static void
+tcti_mux_command (uint8_t *buf, size_t size, uint8_t first, uint8_t fill)
+{
+    memset (buf, fill, size);
+    buf [0] = first;
+    buf [1] = 0x01;
+    buf [2] = (size >> 24) & 0xff;
+    buf [3] = (size >> 16) & 0xff;
+    buf [4] = (size >> 8) & 0xff;
+    buf [5] = size & 0xff;
+}
+
+static void
+tcti_mux_init_errors_test (void **state)
+{
+    TSS2_TCTI_CONTEXT_INTEL tcti_intel = { 0 };
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)&tcti_intel;
+    TCTI_MUX_CONF conf = { 0 };
+    TCTI_MUX *mux;
+    size_t size;
+    TSS2_RC rc;
+
+    rc = InitMuxTcti (NULL, NULL, NULL);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+    rc = InitMuxTcti (ctx, &size, NULL);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+    rc = InitMuxTcti (ctx, &size, &conf);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+    rc = TctiMuxNew (NULL, &mux);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_REFERENCE);
+    rc = TctiMuxNew (ctx, NULL);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_REFERENCE);
+}
+/*
+ * A command goes through the I/O thread and comes back unchanged. The
+ * size query and a too small buffer leave the response in place.
+ */
+static void
+tcti_mux_round_trip_test (void **state)
+{
+    mux_test_state *data = *state;
+    TSS2_TCTI_CONTEXT *ctx = tcti_mux_context (data);
+    uint8_t command [64], response [64] = { 0 };
+    struct iovec iov [2];
+    size_t size = 0;
+    TSS2_RC rc;
+
+    tcti_mux_command (command, sizeof (command), 0x80, 0x5a);
+    rc = tss2_tcti_receive (ctx, &size, NULL, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+    rc = tss2_tcti_transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = tss2_tcti_receive (ctx, &size, NULL, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, sizeof (command));
+    size = 10;
+    rc = tss2_tcti_receive (ctx, &size, response, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_TCTI_RC_INSUFFICIENT_BUFFER);
+    assert_int_equal (size, sizeof (command));
+    rc = tss2_tcti_receive (ctx, &size, response, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (response, command, sizeof (command));
+
+    iov [0].iov_base = command;
+    iov [0].iov_len = 10;
+    iov [1].iov_base = &command [10];
+    iov [1].iov_len = sizeof (command) - 10;
+    rc = tss2_tcti_transmitv (ctx, iov, 2);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    size = sizeof (response);
+    memset (response, 0, sizeof (response));
+    rc = tss2_tcti_receive (ctx, &size, response, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (response, command, sizeof (command));
+    assert_int_equal (data->echo.commands, 2);
+
+    rc = tss2_tcti_cancel (ctx);
+    assert_int_equal (rc, TSS2_TCTI_RC_NOT_IMPLEMENTED);
+    tcti_mux_context_free (ctx);
+}
+/*
+ * A receive that times out returns TRY_AGAIN, the poll handle becomes
+ * readable once the response is there and stays so until it has been
+ * received.
+ */
+static void
+tcti_mux_poll_timeout_test (void **state)
+{
+    mux_test_state *data = *state;
+    TSS2_TCTI_CONTEXT *ctx = tcti_mux_context (data);
+    TSS2_TCTI_POLL_HANDLE handle;
+    uint8_t command [32], response [32];
+    size_t num = 1, size = sizeof (response);
+    TSS2_RC rc;
+
+    rc = tss2_tcti_get_poll_handles (ctx, &handle, &num);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (num, 1);
+    tcti_mux_command (command, sizeof (command), SLOW_COMMAND, 0x11);
+    rc = tss2_tcti_transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = tss2_tcti_receive (ctx, &size, response, TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_TCTI_RC_TRY_AGAIN);
+    assert_int_equal (poll (&handle, 1, 5000), 1);
+    assert_int_equal (poll (&handle, 1, 0), 1);
+    rc = tss2_tcti_receive (ctx, &size, response, TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (response, command, sizeof (command));
+    assert_int_equal (poll (&handle, 1, 0), 0);
+
+    tcti_mux_context_free (ctx);
+}
+/*
+ * Blocking receives back to back on one context: each must wait for its
+ * own response, and receiving it must leave the doorbell quiet so the
+ * next command isn't woken early by a ring left over from this one. The
+ * doorbell is rung late to give a ring out of order time to show.
+ */
+#define BACK_TO_BACK 100
+
+static void
+tcti_mux_back_to_back_test (void **state)
+{
+    mux_test_state *data = *state;
+    TSS2_TCTI_CONTEXT *ctx = tcti_mux_context (data);
+    TSS2_TCTI_POLL_HANDLE handle;
+    uint8_t command [32], response [32];
+    size_t num = 1, size;
+    int i;
+    TSS2_RC rc;
+
+    rc = tss2_tcti_get_poll_handles (ctx, &handle, &num);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    delayed_fd = handle.fd;
+    for (i = 0; i < BACK_TO_BACK; ++i) {
+        tcti_mux_command (command, sizeof (command), 0x80, (uint8_t)i);
+        rc = tss2_tcti_transmit (ctx, sizeof (command), command);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        size = sizeof (response);
+        rc = tss2_tcti_receive (ctx, &size, response,
+                                TSS2_TCTI_TIMEOUT_BLOCK);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_memory_equal (response, command, sizeof (command));
+        assert_int_equal (poll (&handle, 1, 0), 0);
+    }
+    delayed_fd = -1;
+    assert_int_equal (data->echo.commands, BACK_TO_BACK);
+
+    tcti_mux_context_free (ctx);
+}
+/*
+ * Errors from the underlying TCTI end the command: they are returned by
+ * 'receive' and the context can send the next one.
+ */
+static void
+tcti_mux_error_test (void **state)
+{
+    mux_test_state *data = *state;
+    TSS2_TCTI_CONTEXT *ctx = tcti_mux_context (data);
+    uint8_t command [16], response [16];
+    size_t size = sizeof (response);
+    TSS2_RC rc;
+
+    tcti_mux_command (command, sizeof (command), FAIL_COMMAND, 0);
+    rc = tss2_tcti_transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = tss2_tcti_receive (ctx, &size, response, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_TCTI_RC_IO_ERROR);
+    tcti_mux_command (command, sizeof (command), 0x80, 0);
+    rc = tss2_tcti_transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = tss2_tcti_receive (ctx, &size, response, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    tcti_mux_context_free (ctx);
+}
+/*
+ * Each context's locality is set on the underlying TCTI before its
+ * commands, only when it differs from the previous command's.
+ */
+static void
+tcti_mux_locality_test (void **state)
+{
+    mux_test_state *data = *state;
+    TSS2_TCTI_CONTEXT *ctx [2] = { tcti_mux_context (data),
+                                   tcti_mux_context (data) };
+    uint8_t command [16], response [16];
+    size_t size;
+    int i;
+    TSS2_RC rc;
+
+    rc = tss2_tcti_set_locality (ctx [1], 1);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    tcti_mux_command (command, sizeof (command), 0x80, 0);
+    for (i = 0; i < 4; ++i) {
+        rc = tss2_tcti_transmit (ctx [i / 2], sizeof (command), command);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        rc = tss2_tcti_set_locality (ctx [i / 2], 2);
+        assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+        size = sizeof (response);
+        rc = tss2_tcti_receive (ctx [i / 2], &size, response,
+                                TSS2_TCTI_TIMEOUT_BLOCK);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_int_equal (data->echo.locality, i < 2 ? 3 : 1);
+    }
+    assert_int_equal (data->echo.locality_calls, 2);
+
+    tcti_mux_context_free (ctx [0]);
+    tcti_mux_context_free (ctx [1]);
+}
+/*
+ * Worker threads with a context each hammer the same mux. Every thread
+ * must get back its own commands and the underlying TCTI is only ever
+ * entered by the I/O thread.
+ */
+#define WORKERS 8
+#define WORKER_COMMANDS 200
+
+typedef struct {
+    mux_test_state *data;
+    TSS2_TCTI_CONTEXT *ctx;
+    uint8_t id;
+    int failures;
+} mux_worker;
+
+static void*
+tcti_mux_worker (void *arg)
+{
+    mux_worker *worker = (mux_worker*)arg;
+    uint8_t command [48], response [48];
+    size_t size;
+    int i;
+    TSS2_RC rc;
+
+    for (i = 0; i < WORKER_COMMANDS; ++i) {
+        tcti_mux_command (command, sizeof (command), 0x80, worker->id);
+        command [10] = (uint8_t)i;
+        rc = tss2_tcti_transmit (worker->ctx, sizeof (command), command);
+        if (rc != TSS2_RC_SUCCESS) {
+            ++worker->failures;
+            continue;
+        }
+        size = sizeof (response);
+        rc = tss2_tcti_receive (worker->ctx, &size, response,
+                                TSS2_TCTI_TIMEOUT_BLOCK);
+        if (rc != TSS2_RC_SUCCESS || size != sizeof (command) ||
+            memcmp (response, command, size) != 0) {
+            ++worker->failures;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+tcti_mux_threads_test (void **state)
+{
+    mux_test_state *data = *state;
+    mux_worker workers [WORKERS];
+    pthread_t threads [WORKERS];
+    int i;
+
+    for (i = 0; i < WORKERS; ++i) {
+        workers [i].data = data;
+        workers [i].ctx = tcti_mux_context (data);
+        workers [i].id = (uint8_t)i;
+        workers [i].failures = 0;
+        assert_int_equal (pthread_create (&threads [i],
+                                          NULL,
+                                          tcti_mux_worker,
+                                          &workers [i]),
+                          0);
+    }
+    for (i = 0; i < WORKERS; ++i) {
+        assert_int_equal (pthread_join (threads [i], NULL), 0);
+        assert_int_equal (workers [i].failures, 0);
+        tcti_mux_context_free (workers [i].ctx);
+    }
+    assert_int_equal (data->echo.commands, WORKERS * WORKER_COMMANDS);
+}
+/* Finalizing a context with a command in flight waits for the I/O thread. */
+static void
+tcti_mux_finalize_outstanding_test (void **state)
+{
+    mux_test_state *data = *state;
+    TSS2_TCTI_CONTEXT *ctx = tcti_mux_context (data);
+    uint8_t command [16];
+    TSS2_RC rc;
+
+    tcti_mux_command (command, sizeof (command), SLOW_COMMAND, 0);
+    rc = tss2_tcti_transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    tcti_mux_context_free (ctx);
+    assert_int_equal (data->echo.commands, 1);
+}
+
+int
+main (int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test (tcti_mux_init_errors_test),
+        cmocka_unit_test_setup_teardown (tcti_mux_round_trip_test,
+                                         tcti_mux_setup,
+                                         tcti_mux_teardown),
+        cmocka_unit_test_setup_teardown (tcti_mux_poll_timeout_test,
+                                         tcti_mux_setup,
+                                         tcti_mux_teardown),
+        cmocka_unit_test_setup_teardown (tcti_mux_back_to_back_test,
+                                         tcti_mux_setup,
+                                         tcti_mux_teardown),
+        cmocka_unit_test_setup_teardown (tcti_mux_error_test,
+                                         tcti_mux_setup,
+                                         tcti_mux_teardown),
+        cmocka_unit_test_setup_teardown (tcti_mux_locality_test,
+                                         tcti_mux_setup,
+                                         tcti_mux_teardown),
+        cmocka_unit_test_setup_teardown (tcti_mux_threads_test,
+                                         tcti_mux_setup,
+                                         tcti_mux_teardown),
+        cmocka_unit_test_setup_teardown (tcti_mux_finalize_outstanding_test,
+                                         tcti_mux_setup,
+                                         tcti_mux_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,410 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "sapi/tpm20.h"
+#include "tcti/tcti_shm.h"
+#include "tcti/tcti.h"
+#include "tcti/sockets.h"
+#include "tcti/shm.h"
+
+/*
+ * A service thread standing in for tcti-shm-server: it accepts a single
+ * session and echoes every command back as the response. Commands
+ * starting with 0xff are answered late so the timeouts can be exercised,
+ * and those starting with 0xfe get the empty response the server sends
+ * when the TPM didn't answer.
+ */
+typedef struct {
+    SOCKET listen_sock;
+    pthread_t thread;
+    char path [64];
+    size_t commands;
+    TSS2_RC rc;
+} shm_service;
+
+typedef struct {
+    TSS2_TCTI_CONTEXT *ctx;
+    shm_service service;
+} shm_test_state;
+
+#define SLOW_COMMAND 0xff
+#define UNANSWERED_COMMAND 0xfe
+
+static void*
+shm_service_thread (void *arg)
+{
+    shm_service *service = (shm_service*)arg;
+    TCTI_SHM_SESSION session;
+    TCTI_SHM_FRAME frame;
+    uint8_t buf [TPM2_MAX_COMMAND_SIZE];
+    struct iovec iov;
+    struct timespec delay = { .tv_sec = 0, .tv_nsec = 50000000 };
+    int control;
+    TSS2_RC rc;
+
+    control = accept (service->listen_sock, NULL, NULL);
+    if (control < 0) {
+        service->rc = TSS2_TCTI_RC_IO_ERROR;
+        return NULL;
+    }
+    rc = tcti_shm_session_accept (control, &session);
+    if (rc != TSS2_RC_SUCCESS) {
+        service->rc = rc;
+        return NULL;
+    }
+    for (;;) {
+        rc = tcti_shm_wait (&session.region->command,
+                            session.commandDoorbell,
+                            session.control,
+                            TSS2_TCTI_TIMEOUT_BLOCK,
+                            0,
+                            sizeof (buf),
+                            &frame);
+        if (rc != TSS2_RC_SUCCESS) {
+            break;
+        }
+        tcti_shm_copy_out (&session.region->command, &frame, buf, 1);
+        ++service->commands;
+        if (frame.size > 0 && buf [0] == SLOW_COMMAND) {
+            nanosleep (&delay, NULL);
+        }
+        if (frame.size > 0 && buf [0] == UNANSWERED_COMMAND) {
+            frame.size = 0;
+        }
+        iov.iov_base = buf;
+        iov.iov_len = frame.size;
+        rc = tcti_shm_send (&session.region->response,
+                            session.responseDoorbell,
+                            &iov,
+                            1,
+                            frame.size,
+                            frame.locality);
+        if (rc != TSS2_RC_SUCCESS) {
+            break;
+        }
+    }
+    /* the client going away is how a session ends */
+    service->rc = rc == TSS2_TCTI_RC_IO_ERROR ? TSS2_RC_SUCCESS : rc;
+    tcti_shm_session_close (&session);
+
+    return NULL;
+}
+/*
+ * Start the service and initialize a shm TCTI connected to it. The
+ * socket lives in the abstract namespace so no file is left behind.
+ */
+static int
+tcti_shm_setup (void **state)
+{
+    shm_test_state *data;
+    shm_service *service;
+    TCTI_SHM_CONF conf = { 0 };
+    size_t size = 0;
+    TSS2_RC rc;
+
+    data = calloc (1, sizeof (shm_test_state));
+    assert_non_null (data);
+    service = &data->service;
+    snprintf (service->path, sizeof (service->path),
+              "@tss2-tcti-shm-test-%d", (int)getpid ());
+    service->listen_sock = listenUnixSocket (service->path, NULL, NULL);
+    assert_int_not_equal (service->listen_sock, INVALID_SOCKET);
+    assert_int_equal (pthread_create (&service->thread,
+                                      NULL,
+                                      shm_service_thread,
+                                      service),
+                      0);
+
+    rc = InitShmTcti (NULL, &size, NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    data->ctx = calloc (1, size);
+    assert_non_null (data->ctx);
+    conf.path = service->path;
+    rc = InitShmTcti (data->ctx, &size, &conf);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    *state = data;
+    return 0;
+}
+/*
+ * Finalizing the TCTI closes the session socket, which must make the
+ * service thread leave its loop cleanly.
+ */
+static int
+tcti_shm_teardown (void **state)
+{
+    shm_test_state *data = *state;
+
+    tss2_tcti_finalize (data->ctx);
+    assert_int_equal (pthread_join (data->service.thread, NULL), 0);
+    assert_int_equal (data->service.rc, TSS2_RC_SUCCESS);
+    closesocket (data->service.listen_sock);
+    free (data->ctx);
+    free (data);
+
+    return 0;
+}
+/* Build a command of 'size' bytes with a valid header. */
+static void
+tcti_shm_command (uint8_t *buf, size_t size, uint8_t first)
+{
+    size_t i;
+
+    memset (buf, 0, size);
+    buf [0] = first;
+    buf [1] = 0x01;
+    buf [2] = (size >> 24) & 0xff;
+    buf [3] = (size >> 16) & 0xff;
+    buf [4] = (size >> 8) & 0xff;
+    buf [5] = size & 0xff;
+    for (i = 10; i < size; ++i) {
+        buf [i] = (uint8_t)i;
+    }
+}
+
+static void
+tcti_shm_init_errors_test (void **state)
+{
+    TSS2_TCTI_CONTEXT_INTEL tcti_intel = { 0 };
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)&tcti_intel;
+    TCTI_SHM_CONF conf = { 0 };
+    size_t size;
+    TSS2_RC rc;
+
+    rc = InitShmTcti (NULL, NULL, NULL);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+    rc = InitShmTcti (ctx, &size, NULL);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+    rc = InitShmTcti (ctx, &size, &conf);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+    /* nobody listening */
+    conf.path = "@tss2-tcti-shm-test-nobody";
+    rc = InitShmTcti (ctx, &size, &conf);
+    assert_int_equal (rc, TSS2_TCTI_RC_IO_ERROR);
+}
+/*
+ * A command goes through the command ring and comes back unchanged. The
+ * size query leaves the response in place for the actual receive.
+ */
+static void
+tcti_shm_round_trip_test (void **state)
+{
+    shm_test_state *data = *state;
+    uint8_t command [64], response [64] = { 0 };
+    size_t size = 0;
+    TSS2_RC rc;
+
+    tcti_shm_command (command, sizeof (command), 0x80);
+    rc = tss2_tcti_transmit (data->ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = tss2_tcti_receive (data->ctx, &size, NULL, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, sizeof (command));
+    rc = tss2_tcti_receive (data->ctx, &size, response,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, sizeof (command));
+    assert_memory_equal (response, command, sizeof (command));
+    /* a second command over the same session */
+    rc = tss2_tcti_transmit (data->ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    size = sizeof (response);
+    rc = tss2_tcti_receive (data->ctx, &size, response,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (data->service.commands, 2);
+}
+/*
+ * The empty response for a command the TPM didn't answer fails the
+ * receive, and ends the command so the next one can be sent.
+ */
+static void
+tcti_shm_no_response_test (void **state)
+{
+    shm_test_state *data = *state;
+    uint8_t command [64], response [64] = { 0 };
+    size_t size = sizeof (response);
+    TSS2_RC rc;
+
+    tcti_shm_command (command, sizeof (command), UNANSWERED_COMMAND);
+    rc = tss2_tcti_transmit (data->ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = tss2_tcti_receive (data->ctx, &size, response,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_TCTI_RC_IO_ERROR);
+    rc = tss2_tcti_receive (data->ctx, &size, response,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+
+    tcti_shm_command (command, sizeof (command), 0x80);
+    rc = tss2_tcti_transmit (data->ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    size = sizeof (response);
+    rc = tss2_tcti_receive (data->ctx, &size, response,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (response, command, sizeof (command));
+    assert_int_equal (data->service.commands, 2);
+}
+/*
+ * The iovecs are gathered into the ring. A buffer too small for the
+ * response gets INSUFFICIENT_BUFFER and the response is still there for a
+ * second try.
+ */
+static void
+tcti_shm_transmitv_test (void **state)
+{
+    shm_test_state *data = *state;
+    uint8_t command [TPM2_MAX_COMMAND_SIZE / 2], response [sizeof (command)];
+    struct iovec iov [3];
+    size_t size;
+    TSS2_RC rc;
+
+    tcti_shm_command (command, sizeof (command), 0x80);
+    iov [0].iov_base = command;
+    iov [0].iov_len = 10;
+    iov [1].iov_base = &command [10];
+    iov [1].iov_len = 100;
+    iov [2].iov_base = &command [110];
+    iov [2].iov_len = sizeof (command) - 110;
+    rc = tss2_tcti_transmitv (data->ctx, iov, 3);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    size = 10;
+    rc = tss2_tcti_receive (data->ctx, &size, response,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_TCTI_RC_INSUFFICIENT_BUFFER);
+    assert_int_equal (size, sizeof (command));
+    rc = tss2_tcti_receive (data->ctx, &size, response,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (response, command, sizeof (command));
+}
+/*
+ * A receive that times out returns TRY_AGAIN without losing the response
+ * and a later receive picks it up.
+ */
+static void
+tcti_shm_timeout_test (void **state)
+{
+    shm_test_state *data = *state;
+    uint8_t command [32], response [32];
+    size_t size = sizeof (response);
+    TSS2_RC rc;
+
+    tcti_shm_command (command, sizeof (command), SLOW_COMMAND);
+    rc = tss2_tcti_transmit (data->ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = tss2_tcti_receive (data->ctx, &size, response, 1);
+    assert_int_equal (rc, TSS2_TCTI_RC_TRY_AGAIN);
+    rc = tss2_tcti_transmit (data->ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+    rc = tss2_tcti_receive (data->ctx, &size, response,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (response, command, sizeof (command));
+}
+/*
+ * Once the poll handle was handed out the service rings the response
+ * doorbell for every response: poll wakes up and a non-blocking receive
+ * then finds the response.
+ */
+static void
+tcti_shm_poll_handles_test (void **state)
+{
+    shm_test_state *data = *state;
+    TSS2_TCTI_POLL_HANDLE handle;
+    uint8_t command [32], response [32];
+    size_t num = 0, size = sizeof (response);
+    int i;
+    TSS2_RC rc;
+
+    rc = tss2_tcti_get_poll_handles (data->ctx, NULL, &num);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (num, 1);
+    num = 0;
+    rc = tss2_tcti_get_poll_handles (data->ctx, &handle, &num);
+    assert_int_equal (rc, TSS2_TCTI_RC_INSUFFICIENT_BUFFER);
+    num = 1;
+    rc = tss2_tcti_get_poll_handles (data->ctx, &handle, &num);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    for (i = 0; i < 3; ++i) {
+        tcti_shm_command (command, sizeof (command), i ? 0x80 : SLOW_COMMAND);
+        rc = tss2_tcti_transmit (data->ctx, sizeof (command), command);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_int_equal (poll (&handle, 1, 5000), 1);
+        assert_true (handle.revents & POLLIN);
+        size = sizeof (response);
+        rc = tss2_tcti_receive (data->ctx, &size, response,
+                                TSS2_TCTI_TIMEOUT_NONE);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_memory_equal (response, command, sizeof (command));
+        /* the doorbell was cleared by the receive */
+        assert_int_equal (poll (&handle, 1, 0), 0);
+    }
+}
+/*
+ * Locality travels in the frame header and can't change while a command
+ * is outstanding.
+ */
+static void
+tcti_shm_locality_test (void **state)
+{
+    shm_test_state *data = *state;
+    uint8_t command [16], response [16];
+    size_t size = sizeof (response);
+    TSS2_RC rc;
+
+    rc = tss2_tcti_set_locality (data->ctx, 1);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    tcti_shm_command (command, sizeof (command), 0x80);
+    rc = tss2_tcti_transmit (data->ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = tss2_tcti_set_locality (data->ctx, 2);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+    rc = tss2_tcti_receive (data->ctx, &size, response,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = tss2_tcti_cancel (data->ctx);
+    assert_int_equal (rc, TSS2_TCTI_RC_NOT_IMPLEMENTED);
+}
+
+int
+main (int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test (tcti_shm_init_errors_test),
+        cmocka_unit_test_setup_teardown (tcti_shm_round_trip_test,
+                                         tcti_shm_setup,
+                                         tcti_shm_teardown),
+        cmocka_unit_test_setup_teardown (tcti_shm_no_response_test,
+                                         tcti_shm_setup,
+                                         tcti_shm_teardown),
+        cmocka_unit_test_setup_teardown (tcti_shm_transmitv_test,
+                                         tcti_shm_setup,
+                                         tcti_shm_teardown),
+        cmocka_unit_test_setup_teardown (tcti_shm_timeout_test,
+                                         tcti_shm_setup,
+                                         tcti_shm_teardown),
+        cmocka_unit_test_setup_teardown (tcti_shm_poll_handles_test,
+                                         tcti_shm_setup,
+                                         tcti_shm_teardown),
+        cmocka_unit_test_setup_teardown (tcti_shm_locality_test,
+                                         tcti_shm_setup,
+                                         tcti_shm_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
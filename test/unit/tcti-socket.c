@@ -25,9 +25,16 @@
 // THE POSSIBILITY OF SUCH DAMAGE.
 //**********************************************************************;
 
+#include <errno.h>
 #include <inttypes.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include <setjmp.h>
 #include <cmocka.h>
@@ -36,6 +43,7 @@
 #include "tcti/tcti.h"
 #include "tcti/logging.h"
 #include "tcti/tcti_socket.h"
+#include "tcti/sockets.h"
 
 /* When passed all NULL values ensure that we get back the expected RC. */
 static void
@@ -59,7 +67,8 @@ tcti_socket_init_size_test (void **state)
 
     ret = InitSocketTcti (NULL, &tcti_size, NULL, 0);
     assert_int_equal (ret, TSS2_RC_SUCCESS);
-    assert_int_equal (tcti_size, sizeof (TSS2_TCTI_CONTEXT_INTEL));
+    assert_int_equal (tcti_size,
+                      sizeof (TSS2_TCTI_CONTEXT_INTEL) + TCTI_RECV_RING_SIZE);
 }
 /*
  * When passed a non-NULL context blob and size the config structure must
@@ -78,13 +87,22 @@ tcti_socket_init_null_config_test (void **state)
 }
 /*
  * Wrap the 'connect' system call. The mock queue for this function must have
- * an integer to return as a response.
+ * an integer to return as a response. The addresses of the first two calls
+ * after connect_count is reset are recorded.
  */
+static struct sockaddr_un connect_addr [2];
+static socklen_t connect_len [2];
+static size_t connect_count;
 int
 __wrap_connect (int                    sockfd,
                 const struct sockaddr *addr,
                 socklen_t              addrlen)
 {
+    if (connect_count < 2 && addrlen <= sizeof (connect_addr [0])) {
+        memcpy (&connect_addr [connect_count], addr, addrlen);
+        connect_len [connect_count] = addrlen;
+    }
+    connect_count++;
     return mock_type (int);
 }
 /*
@@ -105,23 +123,24 @@ __wrap_recv (int sockfd,
     return ret;
 }
 /*
- * Wrap the 'select' system call. The mock queue for this function must have
- * an integer to return as a response (the # of fds ready to be read /
- * written).
+ * Wrap the 'poll' system call. The mock queue for this function must have
+ * an integer to return as a response (the # of fds ready).
  */
 int
-__wrap_select (int             nfds,
-               fd_set         *readfds,
-               fd_set         *writefds,
-               fd_set         *exceptfds,
-               struct timeval *timeout)
+__wrap_poll (struct pollfd *fds,
+             nfds_t         nfds,
+             int            timeout)
 {
     return mock_type (int);
 }
 /*
  * Wrap the 'send' system call. The mock queue for this function must have an
- * integer to return as a response.
+ * integer to return as a response. The bytes reported as sent are appended
+ * to 'send_log'.
  */
+static uint8_t send_log [64];
+static size_t  send_log_size;
+
 ssize_t
 __wrap_send (int         sockfd,
              const void *buf,
@@ -129,7 +148,57 @@ __wrap_send (int         sockfd,
              int         flags)
 
 {
-    return mock_type (TSS2_RC);
+    ssize_t ret = mock_type (ssize_t);
+
+    if (ret > 0) {
+        assert_true ((size_t)ret <= len);
+        if (send_log_size + ret <= sizeof (send_log)) {
+            memcpy (&send_log [send_log_size], buf, ret);
+            send_log_size += ret;
+        }
+    }
+    return ret;
+}
+/*
+ * Wrap the 'recvmsg' system call. The mock queue for this function must have
+ * an integer return value (the number of bytes received) and a pointer to
+ * the data, which is scattered over the caller's buffers. A negative return
+ * value means the non-blocking socket has nothing to read (EAGAIN).
+ */
+ssize_t
+__wrap_recvmsg (int            sockfd,
+                struct msghdr *msg,
+                int            flags)
+{
+    ssize_t  ret = mock_type (ssize_t);
+    uint8_t *buf_in = mock_ptr_type (uint8_t*);
+    size_t   copied = 0, len;
+    size_t   i;
+
+    if (ret < 0) {
+        errno = EAGAIN;
+        return ret;
+    }
+    for (i = 0; i < msg->msg_iovlen && copied < (size_t)ret; i++) {
+        len = msg->msg_iov [i].iov_len;
+        if (len > ret - copied)
+            len = ret - copied;
+        memcpy (msg->msg_iov [i].iov_base, &buf_in [copied], len);
+        copied += len;
+    }
+    assert_int_equal (copied, ret);
+    return ret;
+}
+/*
+ * Wrap the 'sendmsg' system call. The mock queue for this function must have
+ * an integer to return as a response (the number of bytes sent).
+ */
+ssize_t
+__wrap_sendmsg (int                  sockfd,
+                const struct msghdr *msg,
+                int                  flags)
+{
+    return mock_type (ssize_t);
 }
 /*
  * This is a utility function used by other tests to setup a TCTI context. It
@@ -338,40 +407,343 @@ tcti_socket_receive_success_test (void **state)
     TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
     TSS2_RC rc = TSS2_RC_SUCCESS;
     size_t response_size = 0xc;
-    uint8_t response_in [] = { 0x80, 0x02,
-                               0x00, 0x00, 0x00, 0x0c,
-                               0x00, 0x00, 0x00, 0x00,
-                               0x01, 0x02,
+    uint8_t frame [] = { 0x00, 0x00, 0x00, 0x0c,
+                         0x80, 0x02,
+                         0x00, 0x00, 0x00, 0x0c,
+                         0x00, 0x00, 0x00, 0x00,
+                         0x01, 0x02,
     /* simulator appends 4 bytes of 0's to every response */
-                               0x00, 0x00, 0x00, 0x00 };
+                         0x00, 0x00, 0x00, 0x00 };
+    uint8_t *response_in = &frame [4];
     uint8_t response_out [12] = { 0 };
+
+    /*
+     * the whole frame (response size, response, 4 bytes of 0's appended by
+     * the simulator) arrives with one recvmsg
+     */
+    will_return (__wrap_recvmsg, sizeof (frame));
+    will_return (__wrap_recvmsg, frame);
+    /* no cancel was sent so there is no MS_SIM_CANCEL_OFF platform command */
+
+    rc = tss2_tcti_receive (ctx, &response_size, response_out, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (response_in, response_out, response_size);
+}
+/*
+ * After a cancel the response is followed by a MS_SIM_CANCEL_OFF platform
+ * command, once: the next command's response doesn't send it again.
+ */
+static void
+tcti_socket_receive_after_cancel_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    uint8_t command [] = { 0x80, 0x01,
+                           0x00, 0x00, 0x00, 0x0a,
+                           0x00, 0x00, 0x01, 0x7b };
+    uint8_t frame [] = { 0x00, 0x00, 0x00, 0x0a,
+                         0x80, 0x01,
+                         0x00, 0x00, 0x00, 0x0a,
+                         0x00, 0x00, 0x09, 0x22,
+                         0x00, 0x00, 0x00, 0x00 };
+    uint8_t *response_in = &frame [4];
+    uint8_t response_out [10] = { 0 };
     uint8_t platform_command_recv [4] = { 0 };
+    size_t response_size;
+    int i;
 
-    /* select returns 1 fd ready for recv-ing */
-    will_return (__wrap_select, 1);
-    /* receive response size */
-    will_return (__wrap_recv, 4);
-    will_return (__wrap_recv, &response_in [2]);
-    /* receive tag */
-    will_return (__wrap_recv, 2);
-    will_return (__wrap_recv, response_in);
-    /* receive size (again)  */
-    will_return (__wrap_recv, 4);
-    will_return (__wrap_recv, &response_in [2]);
-    /* receive the rest of the command */
-    will_return (__wrap_recv, 0xc - sizeof (TPM2_ST) - sizeof (UINT32));
-    will_return (__wrap_recv, &response_in [6]);
-    /* receive the 4 bytes of 0's appended by the simulator */
+    for (i = 0; i < 2; i++) {
+        will_return (__wrap_sendmsg, 9 + sizeof (command));
+        rc = tss2_tcti_transmit (ctx, sizeof (command), command);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+        if (i == 0) {
+            /* MS_SIM_CANCEL_ON */
+            will_return (__wrap_send, 4);
+            will_return (__wrap_recv, 4);
+            will_return (__wrap_recv, platform_command_recv);
+            rc = tss2_tcti_cancel (ctx);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+        }
+
+        will_return (__wrap_recvmsg, sizeof (frame));
+        will_return (__wrap_recvmsg, frame);
+        if (i == 0) {
+            /* MS_SIM_CANCEL_OFF */
+            will_return (__wrap_send, 4);
+            will_return (__wrap_recv, 4);
+            will_return (__wrap_recv, platform_command_recv);
+        }
+
+        response_size = sizeof (response_out);
+        rc = tss2_tcti_receive (ctx, &response_size, response_out,
+                                TSS2_TCTI_TIMEOUT_BLOCK);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_memory_equal (response_in, response_out, response_size);
+    }
+}
+/*
+ * A size query (NULL response buffer) and a too small buffer both leave
+ * the frame in the receive ring; the rest of it is read when the response
+ * is finally received.
+ */
+static void
+tcti_socket_receive_size_query_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    uint8_t frame [] = { 0x00, 0x00, 0x00, 0x0c,
+                         0x80, 0x01,
+                         0x00, 0x00, 0x00, 0x0c,
+                         0x00, 0x00, 0x00, 0x00,
+                         0x01, 0x02,
+                         0x00, 0x00, 0x00, 0x00 };
+    uint8_t response_out [12] = { 0 };
+    size_t response_size = 0;
+
+    /* only the size and the tag have arrived */
+    will_return (__wrap_recvmsg, 6);
+    will_return (__wrap_recvmsg, frame);
+    rc = tss2_tcti_receive (ctx, &response_size, NULL, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (response_size, 0xc);
+
+    response_size = 4;
+    rc = tss2_tcti_receive (ctx, &response_size, response_out,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_TCTI_RC_INSUFFICIENT_BUFFER);
+    assert_int_equal (response_size, 0xc);
+
+    will_return (__wrap_recvmsg, sizeof (frame) - 6);
+    will_return (__wrap_recvmsg, &frame [6]);
+    response_size = sizeof (response_out);
+    rc = tss2_tcti_receive (ctx, &response_size, response_out,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (response_size, 0xc);
+    assert_memory_equal (&frame [4], response_out, response_size);
+}
+/*
+ * Frames that arrive back to back are drained by one recvmsg and parsed
+ * from the ring, including across its end: the second response of each
+ * pair needs no recvmsg.
+ */
+static void
+tcti_socket_receive_ring_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    uint8_t command [] = { 0x80, 0x01,
+                           0x00, 0x00, 0x00, 0x0a,
+                           0x00, 0x00, 0x01, 0x7b };
+    uint8_t frames [2 * 24];
+    uint8_t response_out [16];
+    size_t response_size;
+    int i, j;
+
+    for (j = 0; j < 2; j++) {
+        uint8_t *frame = &frames [j * 24];
+        memset (frame, 0, 24);
+        frame [3] = 0x10;
+        frame [4] = 0x80;
+        frame [5] = 0x01;
+        frame [9] = 0x10;
+    }
+
+    for (i = 0; i < 1000; i++) {
+        frames [16] = i & 0xff;
+        frames [24 + 16] = ~i & 0xff;
+        will_return (__wrap_recvmsg, sizeof (frames));
+        will_return (__wrap_recvmsg, frames);
+        for (j = 0; j < 2; j++) {
+            will_return (__wrap_sendmsg, 9 + sizeof (command));
+            rc = tss2_tcti_transmit (ctx, sizeof (command), command);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            response_size = sizeof (response_out);
+            rc = tss2_tcti_receive (ctx, &response_size, response_out,
+                                    TSS2_TCTI_TIMEOUT_BLOCK);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            assert_int_equal (response_size, 0x10);
+            assert_memory_equal (&frames [j * 24 + 4], response_out, 0x10);
+        }
+    }
+}
+/*
+ * Nothing to read on the non-blocking socket: the receive waits for it with
+ * poll and a timeout is TRY_AGAIN. Part of a frame that arrived before the
+ * timeout stays in the ring and the next call completes it.
+ */
+static void
+tcti_socket_receive_timeout_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    uint8_t frame [] = { 0x00, 0x00, 0x00, 0x0c,
+                         0x80, 0x01,
+                         0x00, 0x00, 0x00, 0x0c,
+                         0x00, 0x00, 0x00, 0x00,
+                         0x01, 0x02,
+                         0x00, 0x00, 0x00, 0x00 };
+    uint8_t response_out [12] = { 0 };
+    size_t response_size = sizeof (response_out);
+
+    rc = tss2_tcti_receive (ctx, &response_size, response_out, -2);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+
+    will_return (__wrap_recvmsg, -1);
+    will_return (__wrap_recvmsg, NULL);
+    will_return (__wrap_poll, 0);
+    rc = tss2_tcti_receive (ctx, &response_size, response_out,
+                            TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_TCTI_RC_TRY_AGAIN);
+
+    will_return (__wrap_recvmsg, -1);
+    will_return (__wrap_recvmsg, NULL);
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_recvmsg, 8);
+    will_return (__wrap_recvmsg, frame);
+    will_return (__wrap_recvmsg, -1);
+    will_return (__wrap_recvmsg, NULL);
+    will_return (__wrap_poll, 0);
+    rc = tss2_tcti_receive (ctx, &response_size, response_out, 100);
+    assert_int_equal (rc, TSS2_TCTI_RC_TRY_AGAIN);
+
+    will_return (__wrap_recvmsg, sizeof (frame) - 8);
+    will_return (__wrap_recvmsg, &frame [8]);
+    rc = tss2_tcti_receive (ctx, &response_size, response_out,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (response_size, 0xc);
+    assert_memory_equal (&frame [4], response_out, response_size);
+}
+/*
+ * getPollHandles exposes the TPM command socket, waiting for POLLIN.
+ */
+static void
+tcti_socket_get_poll_handles_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel = tcti_context_intel_cast (ctx);
+    TSS2_TCTI_POLL_HANDLE handles [2];
+    size_t num_handles = 0;
+    TSS2_RC rc;
+
+    rc = tss2_tcti_get_poll_handles (ctx, NULL, &num_handles);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (num_handles, 1);
+
+    num_handles = 0;
+    rc = tss2_tcti_get_poll_handles (ctx, handles, &num_handles);
+    assert_int_equal (rc, TSS2_TCTI_RC_INSUFFICIENT_BUFFER);
+
+    num_handles = 2;
+    rc = tss2_tcti_get_poll_handles (ctx, handles, &num_handles);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (num_handles, 1);
+    assert_int_equal (handles [0].fd, tcti_intel->tpmSock);
+    assert_int_equal (handles [0].events, POLLIN);
+
+    rc = tss2_tcti_get_poll_handles (ctx, handles, NULL);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_REFERENCE);
+}
+/*
+ * With a pipeline depth of 3 the first three submitted commands are sent
+ * before any response is read, the fourth once the first response is in.
+ * The mocks only allow that many sendmsg calls at each step. Responses
+ * that arrive together are completed in submission order. While commands
+ * are queued the locality can't change, and while any is with the TPM it
+ * can be cancelled.
+ */
+static void
+tcti_socket_pipeline_test (void **state)
+{
+    TCTI_SOCKET_CONF conf = {
+        .hostname      = "localhost",
+        .port          = 666,
+        .pipelineDepth = 3,
+    };
+    TSS2_TCTI_CONTEXT *ctx;
+    uint8_t command [] = { 0x80, 0x01,
+                           0x00, 0x00, 0x00, 0x0a,
+                           0x00, 0x00, 0x01, 0x7b };
+    static uint8_t responses [4][TPM2_MAX_RESPONSE_SIZE];
+    uint8_t frames [4 * 24] = { 0 };
+    uint8_t platform_command_recv [4] = { 0 };
+    TSS2_TCTI_COMPLETION completions [4];
+    size_t count;
+    TSS2_RC rc;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        frames [i * 24 + 3] = 0x10;
+        frames [i * 24 + 4] = 0x80;
+        frames [i * 24 + 5] = 0x01;
+        frames [i * 24 + 9] = 0x10;
+        frames [i * 24 + 16] = i;
+    }
+
+    ctx = tcti_socket_init_from_conf (&conf);
+    for (i = 0; i < 3; i++) {
+        will_return (__wrap_sendmsg, 9 + sizeof (command));
+    }
+    for (i = 0; i < 4; i++) {
+        rc = tss2_tcti_submit (ctx, sizeof (command), command,
+                               TPM2_MAX_RESPONSE_SIZE, responses [i], i);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    rc = tss2_tcti_transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+    rc = tss2_tcti_set_locality (ctx, 1);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+
+    /* three responses in one read, the fourth hasn't arrived yet */
+    will_return (__wrap_recvmsg, 3 * 24);
+    will_return (__wrap_recvmsg, frames);
+    will_return (__wrap_sendmsg, 9 + sizeof (command));
+    will_return (__wrap_recvmsg, -1);
+    will_return (__wrap_recvmsg, NULL);
+    will_return (__wrap_poll, 0);
+    rc = tss2_tcti_reap (ctx, completions, 4, &count, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (count, 3);
+    rc = tss2_tcti_set_locality (ctx, 1);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+    /* MS_SIM_CANCEL_ON for the fourth command, still in flight */
+    will_return (__wrap_send, 4);
     will_return (__wrap_recv, 4);
-    will_return (__wrap_recv, &response_in [12]);
-    /* platform command sends 4 bytes and receives the same */
+    will_return (__wrap_recv, platform_command_recv);
+    rc = tss2_tcti_cancel (ctx);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    will_return (__wrap_recvmsg, 24);
+    will_return (__wrap_recvmsg, &frames [3 * 24]);
+    /* MS_SIM_CANCEL_OFF */
     will_return (__wrap_send, 4);
     will_return (__wrap_recv, 4);
     will_return (__wrap_recv, platform_command_recv);
+    rc = tss2_tcti_reap (ctx, &completions [3], 1, &count,
+                         TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (count, 1);
 
-    rc = tss2_tcti_receive (ctx, &response_size, response_out, TSS2_TCTI_TIMEOUT_BLOCK);
+    for (i = 0; i < 4; i++) {
+        assert_int_equal (completions [i].user_tag, i);
+        assert_int_equal (completions [i].rc, TSS2_RC_SUCCESS);
+        assert_int_equal (completions [i].response_size, 0x10);
+        assert_memory_equal (responses [i], &frames [i * 24 + 4], 0x10);
+    }
+
+    /* the queue is empty again: transmit / receive work as usual */
+    rc = tss2_tcti_cancel (ctx);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+    rc = tss2_tcti_set_locality (ctx, 1);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
-    assert_memory_equal (response_in, response_out, response_size);
+    will_return (__wrap_sendmsg, 9 + sizeof (command));
+    rc = tss2_tcti_transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    tss2_tcti_finalize (ctx);
+    free (ctx);
 }
 /*
  * This test exercises the successful code path through the transmit function.
@@ -387,16 +759,234 @@ tcti_socket_transmit_success_test (void **state)
                            0x01, 0x02 };
     size_t  command_size = sizeof (command);
 
-    /* send the TPM2_SEND_COMMAND code */
+    /*
+     * The TPM2_SEND_COMMAND code, locality, number of bytes in the command
+     * and the command buffer all go out in one sendmsg.
+     */
+    will_return (__wrap_sendmsg, 4 + 1 + 4 + 0xc);
+    rc = tss2_tcti_transmit (ctx, command_size, command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
+/*
+ * The vectored transmit sends the simulator framing (9 bytes) and the
+ * command buffers with one sendmsg.
+ */
+static void
+tcti_socket_transmitv_success_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    uint8_t header [] = { 0x80, 0x01,
+                          0x00, 0x00, 0x00, 0x0c,
+                          0x00, 0x00, 0x00, 0x00 };
+    uint8_t params [] = { 0x01, 0x02 };
+    struct iovec iov [2] = {
+        { .iov_base = header, .iov_len = sizeof (header) },
+        { .iov_base = params, .iov_len = sizeof (params) },
+    };
+
+    will_return (__wrap_sendmsg, 9 + 0xc);
+    rc = tss2_tcti_transmitv (ctx, iov, 2);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
+/*
+ * Short sends are resumed where they stopped, including in the middle of
+ * the framing, until the whole command has been sent.
+ */
+static void
+tcti_socket_transmitv_partial_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    uint8_t command [] = { 0x80, 0x01,
+                           0x00, 0x00, 0x00, 0x0c,
+                           0x00, 0x00, 0x00, 0x00,
+                           0x01, 0x02 };
+    struct iovec iov [1] = {
+        { .iov_base = command, .iov_len = sizeof (command) },
+    };
+
+    will_return (__wrap_sendmsg, 5);
+    will_return (__wrap_sendmsg, 10);
+    will_return (__wrap_sendmsg, 6);
+    rc = tss2_tcti_transmitv (ctx, iov, 1);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
+/*
+ * sendBytes keeps calling send with the rest of the buffer until all of
+ * it has gone out, whatever the size of the individual writes.
+ */
+static void
+tcti_socket_send_bytes_partial_test (void **state)
+{
+    const unsigned char data [] = { 0x00, 0x01, 0x02, 0x03, 0x04,
+                                    0x05, 0x06, 0x07, 0x08, 0x09 };
+    TSS2_RC rc;
+
+    send_log_size = 0;
+    will_return (__wrap_send, 3);
     will_return (__wrap_send, 4);
-    /* send the locality for the command */
+    will_return (__wrap_send, 2);
     will_return (__wrap_send, 1);
-    /* send the number of bytes in command */
-    will_return (__wrap_send, 4);
-    /* send the command buffer */
-    will_return (__wrap_send, 0xc);
-    rc = tss2_tcti_transmit (ctx, command_size, command);
+    rc = sendBytes (0, data, sizeof (data));
     assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (send_log_size, sizeof (data));
+    assert_memory_equal (send_log, data, sizeof (data));
+}
+/*
+ * The io_uring backend on a real connection: after initialization the TPM
+ * socket is replaced by one end of a socketpair, the test plays the
+ * simulator on the other. The send / recv wrappers are bypassed by the
+ * ring. Skipped when the build or the kernel has no io_uring.
+ */
+static void
+tcti_socket_io_uring_test (void **state)
+{
+    TCTI_SOCKET_CONF conf = {
+        .hostname = "localhost",
+        .port     = 666,
+        .flags    = TCTI_FLAG_IO_URING,
+    };
+    uint8_t command [10] = { 0x80, 0x01, 0x00, 0x00, 0x00, 0x0a,
+                             0x00, 0x00, 0x01, 0x7b };
+    uint8_t frame_expected [9] = { 0x00, 0x00, 0x00, 0x08, 0x03,
+                                   0x00, 0x00, 0x00, 0x0a };
+    uint8_t response_frame [18] = { 0x00, 0x00, 0x00, 0x0a,
+                                    0x80, 0x01, 0x00, 0x00, 0x00, 0x0a,
+                                    0x00, 0x00, 0x00, 0x00 };
+    uint8_t frame [sizeof (frame_expected) + sizeof (command)];
+    uint8_t command_sent [sizeof (command)];
+    uint8_t response [TPM2_MAX_RESPONSE_SIZE];
+    TSS2_TCTI_CONTEXT_INTEL *tcti_intel;
+    TSS2_TCTI_POLL_HANDLE handle;
+    TSS2_TCTI_CONTEXT *ctx;
+    size_t size, num_handles = 1, got = 0;
+    ssize_t ret;
+    int pair [2];
+    TSS2_RC rc;
+
+    ctx = tcti_socket_init_from_conf (&conf);
+    tcti_intel = tcti_context_intel_cast (ctx);
+    if (tcti_intel->uring == NULL) {
+        free (ctx);
+        skip ();
+    }
+    assert_int_equal (socketpair (AF_UNIX, SOCK_STREAM, 0, pair), 0);
+    assert_int_equal (dup2 (pair [0], tcti_intel->tpmSock),
+                      tcti_intel->tpmSock);
+    close (pair [0]);
+
+    rc = tss2_tcti_get_poll_handles (ctx, &handle, &num_handles);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_not_equal (handle.fd, tcti_intel->tpmSock);
+
+    /* the caller may reuse the command buffer once transmit returned */
+    memcpy (command_sent, command, sizeof (command));
+    rc = tss2_tcti_transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    memset (command, 0xff, sizeof (command));
+    while (got < sizeof (frame)) {
+        ret = read (pair [1], &frame [got], sizeof (frame) - got);
+        assert_true (ret > 0);
+        got += ret;
+    }
+    assert_memory_equal (frame, frame_expected, sizeof (frame_expected));
+    assert_memory_equal (&frame [sizeof (frame_expected)],
+                         command_sent,
+                         sizeof (command_sent));
+
+    /* the read is in flight but nothing arrived yet */
+    size = sizeof (response);
+    rc = tss2_tcti_receive (ctx, &size, response, TSS2_TCTI_TIMEOUT_NONE);
+    assert_int_equal (rc, TSS2_TCTI_RC_TRY_AGAIN);
+
+    assert_int_equal (write (pair [1], response_frame, sizeof (response_frame)),
+                      sizeof (response_frame));
+    size = sizeof (response);
+    rc = tss2_tcti_receive (ctx, &size, response, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 10);
+    assert_memory_equal (response, &response_frame [4], 10);
+
+    tss2_tcti_finalize (ctx);
+    close (pair [1]);
+    free (ctx);
+}
+/*
+ * With 'path' set the TCTI connects Unix domain sockets: the platform
+ * channel first, then the TPM command channel. A '@' name is an abstract
+ * address (leading NUL, no terminator), anything else a filesystem path.
+ */
+static void
+tcti_socket_init_unix_test (void **state)
+{
+    TCTI_SOCKET_CONF conf = {
+        .path         = "/run/tpm2/sim0.sock",
+        .platformPath = "@tpm2-sim0-platform",
+    };
+    TSS2_TCTI_CONTEXT *ctx;
+    int domain;
+    socklen_t len = sizeof (domain);
+
+    connect_count = 0;
+    ctx = tcti_socket_init_from_conf (&conf);
+    assert_int_equal (connect_count, 2);
+
+    assert_int_equal (connect_addr [0].sun_family, AF_UNIX);
+    assert_int_equal (connect_len [0],
+                      offsetof (struct sockaddr_un, sun_path) +
+                      strlen ("@tpm2-sim0-platform"));
+    assert_int_equal (connect_addr [0].sun_path [0], '\0');
+    assert_memory_equal (&connect_addr [0].sun_path [1],
+                         "tpm2-sim0-platform",
+                         strlen ("tpm2-sim0-platform"));
+
+    assert_int_equal (connect_addr [1].sun_family, AF_UNIX);
+    assert_int_equal (connect_len [1],
+                      offsetof (struct sockaddr_un, sun_path) +
+                      strlen ("/run/tpm2/sim0.sock") + 1);
+    assert_string_equal (connect_addr [1].sun_path, "/run/tpm2/sim0.sock");
+
+    assert_int_equal (getsockopt (tcti_context_intel_cast (ctx)->tpmSock,
+                                  SOL_SOCKET,
+                                  SO_DOMAIN,
+                                  &domain,
+                                  &len),
+                      0);
+    assert_int_equal (domain, AF_UNIX);
+    free (ctx);
+}
+/*
+ * A Unix socket configuration needs both paths, and a path that doesn't
+ * fit a sockaddr_un fails before anything is connected.
+ */
+static void
+tcti_socket_init_unix_errors_test (void **state)
+{
+    char long_path [sizeof (connect_addr [0].sun_path) + 1];
+    TCTI_SOCKET_CONF conf = {
+        .path = "/run/tpm2/sim0.sock",
+    };
+    TSS2_TCTI_CONTEXT *ctx;
+    size_t size = 0;
+    TSS2_RC rc;
+
+    rc = InitSocketTcti (NULL, &size, NULL, 0);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    ctx = calloc (1, size);
+    assert_non_null (ctx);
+
+    rc = InitSocketTcti (ctx, &size, &conf, 0);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+
+    memset (long_path, 'a', sizeof (long_path) - 1);
+    long_path [sizeof (long_path) - 1] = '\0';
+    conf.platformPath = long_path;
+    connect_count = 0;
+    rc = InitSocketTcti (ctx, &size, &conf, 0);
+    assert_int_not_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (connect_count, 0);
+    free (ctx);
 }
 
 int
@@ -414,9 +1004,35 @@ main (int   argc,
         cmocka_unit_test_setup_teardown (tcti_socket_receive_success_test,
                                   tcti_socket_setup,
                                   tcti_socket_teardown),
+        cmocka_unit_test_setup_teardown (tcti_socket_receive_after_cancel_test,
+                                  tcti_socket_setup,
+                                  tcti_socket_teardown),
+        cmocka_unit_test_setup_teardown (tcti_socket_receive_size_query_test,
+                                  tcti_socket_setup,
+                                  tcti_socket_teardown),
+        cmocka_unit_test_setup_teardown (tcti_socket_receive_ring_test,
+                                  tcti_socket_setup,
+                                  tcti_socket_teardown),
+        cmocka_unit_test_setup_teardown (tcti_socket_receive_timeout_test,
+                                  tcti_socket_setup,
+                                  tcti_socket_teardown),
+        cmocka_unit_test_setup_teardown (tcti_socket_get_poll_handles_test,
+                                  tcti_socket_setup,
+                                  tcti_socket_teardown),
         cmocka_unit_test_setup_teardown (tcti_socket_transmit_success_test,
                                   tcti_socket_setup,
-                                  tcti_socket_teardown)
+                                  tcti_socket_teardown),
+        cmocka_unit_test_setup_teardown (tcti_socket_transmitv_success_test,
+                                  tcti_socket_setup,
+                                  tcti_socket_teardown),
+        cmocka_unit_test_setup_teardown (tcti_socket_transmitv_partial_test,
+                                  tcti_socket_setup,
+                                  tcti_socket_teardown),
+        cmocka_unit_test (tcti_socket_send_bytes_partial_test),
+        cmocka_unit_test (tcti_socket_pipeline_test),
+        cmocka_unit_test (tcti_socket_io_uring_test),
+        cmocka_unit_test (tcti_socket_init_unix_test),
+        cmocka_unit_test (tcti_socket_init_unix_errors_test),
     };
     return cmocka_run_group_tests (tests, NULL, NULL);
 }